@@ -0,0 +1,250 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "rapidjson/document.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * One benchmark per operator and operand shape, over frames of 10^3 to BENCH_MAX_ROWS rows and with one
+ * thread or all of them. Arguments are {rows, threads}; items_per_second is rows per second and
+ * bytes_per_row counts the column bytes the query reads. Write JSON with
+ *   bench --benchmark_out=results.json --benchmark_out_format=json
+ * or build the bench_json target.
+ */
+
+#ifndef BENCH_MAX_ROWS
+#define BENCH_MAX_ROWS 100000000
+#endif
+
+static constexpr int64_t INTERVAL = 100'000'000;
+
+namespace {
+    struct Case {
+        std::string name;
+        std::string task;
+    };
+
+    std::string select(const std::string &column) {
+        return R"({"type":"operation","operation":"SELECT","value":")" + column + R"("})";
+    }
+
+    std::string value(const std::string &json) {
+        return R"({"type":"value","value":)" + json + "}";
+    }
+
+    std::string binary(const std::string &op, const std::string &left, const std::string &right) {
+        return R"({"type":"operation","operation":")" + op + R"(","left":)" + left + R"(,"right":)" + right + "}";
+    }
+
+    std::string unary(const std::string &op, const std::string &operand) {
+        return R"({"type":"operation","operation":")" + op + R"(","value":)" + operand + "}";
+    }
+
+    std::string logical(const std::string &op, const std::string &left, const std::string &right) {
+        return R"({"type":"operation","operation":")" + op + R"(","operands":[)" + left + "," + right + "]}";
+    }
+
+    std::string transition(const std::string &op, const std::string &operand, const std::string &from,
+                           const std::string &to) {
+        return R"({"type":"operation","operation":")" + op + R"(","value":)" + operand + R"(,"from":)" + value(from) +
+               R"(,"to":)" + value(to);
+    }
+
+    /*
+     * Columns with the shapes of vehicle signals:
+     *   state  uint8_t  low-cardinality gear-like states, in runs of geometric length
+     *   mode   uint32_t a few mode codes, in longer runs
+     *   rpm    int32_t  noisy engine speed around a slow drift
+     *   speed  double   noisy analog value between 0 and 120
+     *   level  double   random walk with noise
+     */
+    std::unique_ptr<DataFrame> makeFrame(const std::size_t rows) {
+        std::vector<uint8_t> state(rows);
+        std::vector<uint32_t> mode(rows);
+        std::vector<int32_t> rpm(rows);
+        std::vector<double> speed(rows);
+        std::vector<double> level(rows);
+        uint64_t seed = 42;
+        const auto next = [&seed] {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return seed >> 33;
+        };
+        uint8_t currentState = 0;
+        uint32_t currentMode = 0;
+        double walk = 50.0;
+        for (std::size_t i = 0; i < rows; ++i) {
+            if (next() % 64 == 0) {
+                currentState = static_cast<uint8_t>(next() % 6);
+            }
+            if (next() % 1024 == 0) {
+                currentMode = static_cast<uint32_t>(next() % 4 * 10);
+            }
+            const double noise = static_cast<double>(next() % 1000) / 1000.0 - 0.5;
+            walk = std::clamp(walk + noise, 0.0, 100.0);
+            state[i] = currentState;
+            mode[i] = currentMode;
+            rpm[i] = 800 + static_cast<int32_t>(currentState) * 500 + static_cast<int32_t>(next() % 200);
+            speed[i] = 60.0 + 55.0 * std::sin(static_cast<double>(i) * 1e-4) + noise * 10.0;
+            level[i] = walk + noise;
+        }
+        auto frame = std::make_unique<DataFrame>(0, static_cast<int64_t>(rows) * INTERVAL, INTERVAL);
+        frame->addColumn("state", state);
+        frame->addColumn("mode", mode);
+        frame->addColumn("rpm", rpm);
+        frame->addColumn("speed", speed);
+        frame->addColumn("level", level);
+        return frame;
+    }
+
+    // Frames are large, so only the one of the current size is kept.
+    const DataFrame &getFrame(const std::size_t rows) {
+        static std::size_t cachedRows = 0;
+        static std::unique_ptr<DataFrame> cached;
+        if (cached == nullptr || cachedRows != rows) {
+            cached.reset();
+            cached = makeFrame(rows);
+            cachedRows = rows;
+        }
+        return *cached;
+    }
+
+    std::vector<Case> makeCases() {
+        const std::string state = select("state");
+        const std::string mode = select("mode");
+        const std::string rpm = select("rpm");
+        const std::string speed = select("speed");
+        const std::string level = select("level");
+        const std::string fast = binary("GT", speed, value("80"));
+        const std::string second = binary("EQ", state, value("2"));
+
+        std::vector<Case> cases;
+        for (const std::string op: {"EQ", "NE", "LT", "LE", "GT", "GE"}) {
+            cases.push_back({op + "/scalar", binary(op, speed, value("40"))});
+            cases.push_back({op + "/vector", binary(op, speed, level)});
+        }
+        cases.push_back({"EQ/state", second});
+        for (const std::string op: {"ADD", "SUB", "MUL", "DIV"}) {
+            cases.push_back({op + "/scalar", binary(op, rpm, value("3"))});
+            cases.push_back({op + "/vector", binary(op, speed, level)});
+        }
+        cases.push_back({"POW/scalar", binary("POW", speed, value("2"))});
+        cases.push_back({"POW/vector", binary("POW", level, value("0.5"))});
+        cases.push_back({"ABS", unary("ABS", binary("SUB", speed, value("60")))});
+        cases.push_back({"AND", logical("AND", fast, second)});
+        cases.push_back({"OR", logical("OR", fast, second)});
+        cases.push_back({"NOT", unary("NOT", fast)});
+        cases.push_back({"COUNT", R"({"type":"operation","operation":"COUNT","value":)" + second +
+                                  R"(,"initialValue":)" + value("0") + R"(,"unit":)" + value("0.1") + "}"});
+        cases.push_back({"MAX", unary("MAX", speed)});
+        cases.push_back({"MIN", unary("MIN", rpm)});
+        cases.push_back({"AVG", unary("AVG", level)});
+        cases.push_back({"SUM", unary("SUM", rpm)});
+        cases.push_back({"MAX/range", R"({"type":"operation","operation":"MAX","value":)" + speed + R"(,"start":)" +
+                                      value("10") + R"(,"end":)" + value("60") + "}"});
+        cases.push_back({"AVG/where", R"({"type":"operation","operation":"AVG","value":)" + rpm + R"(,"where":)" +
+                                      second + "}"});
+        cases.push_back({"COUNT/where", R"({"type":"operation","operation":"COUNT","value":)" + fast +
+                                        R"(,"initialValue":)" + value("0") + R"(,"unit":)" + value("1") +
+                                        R"(,"where":)" + second + "}"});
+        for (const std::string op: {"ROLLING_MAX", "ROLLING_MIN", "ROLLING_AVG", "ROLLING_SUM"}) {
+            cases.push_back({op, R"({"type":"operation","operation":")" + op + R"(","value":)" + speed +
+                                 R"(,"duration":)" + value("60") + "}"});
+        }
+        cases.push_back({"ROLLING_COUNT", R"({"type":"operation","operation":"ROLLING_COUNT","value":)" + fast +
+                                          R"(,"duration":)" + value("60") + "}"});
+        cases.push_back({"SEGMENT_AGG", R"({"type":"operation","operation":"SEGMENT_AGG","value":)" + fast +
+                                        R"(,"target":)" + rpm + "}"});
+        cases.push_back({"JUMP", transition("JUMP", state, "[1]", "[2, 3]") + "}"});
+        cases.push_back({"JUMP/mode", transition("JUMP", mode, "[0]", "[10, 20]") + "}"});
+        cases.push_back({"BEFORE", R"({"type":"operation","operation":"BEFORE"})"});
+        cases.push_back({"AFTER", transition("AFTER", level, "30", "60") + R"(,"duration":)" + value("1") + "}"});
+        cases.push_back({"HOLD", transition("HOLD", state, "[1]", "[2]") + R"(,"duration":)" + value("2") + "}"});
+        cases.push_back({"HOLD/reverse", transition("HOLD", state, "[]", "[3]") + R"(,"duration":)" + value("-2") +
+                                         "}"});
+        cases.push_back({"DURATION", R"({"type":"operation","operation":"DURATION","value":)" + fast +
+                                     R"(,"minDuration":{"type":"value","value":2}})"});
+        cases.push_back({"SELECT", speed});
+        return cases;
+    }
+
+    ComputeLib::CompiledQuery compileTask(const std::string &task) {
+        rapidjson::Document doc;
+        doc.Parse(task.c_str());
+        return ComputeLib::CompiledQuery::compile(doc);
+    }
+
+    // Bytes of column data per row read by plan.
+    double columnBytes(const ComputeLib::CompiledQuery &plan, const DataFrame &frame) {
+        std::size_t bytes = 0;
+        for (uint32_t i = 0; i < frame.getColumnCount(); ++i) {
+            if (std::ranges::find(plan.columns(), frame.getColumnName(i)) != plan.columns().end()) {
+                bytes += std::visit([](const auto &view) { return sizeof(view[0]); }, frame.getColumnView(i));
+            }
+        }
+        return static_cast<double>(bytes);
+    }
+
+    void runCase(benchmark::State &state, const ComputeLib::CompiledQuery &plan) {
+        const auto rows = static_cast<std::size_t>(state.range(0));
+        const DataFrame &frame = getFrame(rows);
+        ComputeLib::Executor executor(static_cast<uint32_t>(state.range(1)));
+        executor.setDataSource(&frame);
+        for (auto _: state) {
+            benchmark::DoNotOptimize(executor.run(plan));
+        }
+        const double bytesPerRow = columnBytes(plan, frame);
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(rows));
+        state.SetBytesProcessed(static_cast<int64_t>(static_cast<double>(state.iterations()) *
+                                                     static_cast<double>(rows) * bytesPerRow));
+        state.counters["bytes_per_row"] = bytesPerRow;
+    }
+}
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    const std::vector<Case> cases = makeCases();
+    std::set<ComputeLib::OperatorEnum> covered;
+    std::vector<ComputeLib::CompiledQuery> plans;
+    for (const auto &item: cases) {
+        plans.push_back(compileTask(item.task));
+        for (const auto &node: plans.back().nodes()) {
+            if (node.kind == ComputeLib::NodeKind::OPERATION) {
+                covered.insert(node.op);
+            }
+        }
+    }
+    // Every operator needs a case, so a new one cannot be added without a benchmark.
+    if (covered.size() != static_cast<std::size_t>(ComputeLib::OperatorEnum::SELECT) + 1) {
+        std::cerr << "Only " << covered.size() << " operators have a benchmark" << std::endl;
+        return 1;
+    }
+
+    std::vector<int64_t> threads = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threads.push_back(std::thread::hardware_concurrency());
+    }
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        const ComputeLib::CompiledQuery &plan = plans[i];
+        benchmark::RegisterBenchmark(cases[i].name.c_str(), [&plan](benchmark::State &state) { runCase(state, plan); })
+            ->ArgsProduct({benchmark::CreateRange(1000, BENCH_MAX_ROWS, 10), threads})
+            ->ArgNames({"rows", "threads"})
+            ->Unit(benchmark::kMicrosecond)
+            ->UseRealTime();
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -20,6 +20,13 @@ option(${PROJECT_NAME}_ENABLE_UNIT_TESTING "Enable unit tests for the projects (
 option(${PROJECT_NAME}_USE_GTEST "Use the GoogleTest project for creating unit tests." ON)
 option(${PROJECT_NAME}_USE_GOOGLE_MOCK "Use the GoogleMock project for extending the unit tests." OFF)
 
+#
+# Benchmarks
+#
+
+option(${PROJECT_NAME}_ENABLE_BENCHMARKS "Build the Google Benchmark suite (from the `bench` folder)." OFF)
+set(${PROJECT_NAME}_BENCHMARK_MAX_ROWS 100000000 CACHE STRING "Largest frame, in rows, the benchmarks run on.")
+
 #
 # Static analyzers
 #
@@ -0,0 +1,300 @@
+#ifndef COLUMN_FILE_H
+#define COLUMN_FILE_H
+
+#include "data_frame.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Columnar file format, in native byte order:
+ *   ColumnFileHeader
+ *   ColumnFileEntry, one per column
+ *   the column names, back to back
+ *   the column blocks, rowCount values of the column's type each, at offsets that are multiples of
+ *   COLUMN_FILE_ALIGNMENT
+ *   the zone map of each column, at offsets that are multiples of COLUMN_FILE_ALIGNMENT: its min and
+ *   max as doubles, distinct as uint32_t and hasNaN as uint8_t, one per block of ZoneMap::BLOCK_ROWS
+ * openColumnFile maps the file and hands out views of the blocks, so a column is only read from disk
+ * once an operator scans it. Only the zone maps are read up front.
+ */
+inline constexpr char COLUMN_FILE_MAGIC[8] = {'C', 'E', 'C', 'O', 'L', 'U', 'M', 'N'};
+inline constexpr uint32_t COLUMN_FILE_VERSION = 2;
+inline constexpr uint32_t COLUMN_FILE_BYTE_ORDER = 0x01020304;
+inline constexpr std::size_t COLUMN_FILE_ALIGNMENT = 64;
+
+struct ColumnFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t columnCount;
+    uint64_t rowCount;
+    int64_t startTimestamp;
+    int64_t interval;
+};
+
+struct ColumnFileEntry {
+    uint32_t type; // index into DataColumn
+    uint32_t nameLength;
+    uint64_t nameOffset;
+    uint64_t dataOffset;
+    uint64_t zoneOffset;
+};
+
+// Read-only mapping of a whole file, unmapped when the last frame using it goes away.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Cannot open file: " + path);
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+        size = static_cast<std::size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void *view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (view == nullptr) {
+            if (mapping != nullptr) {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+        data = static_cast<const std::byte *>(view);
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file: " + path);
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            close(fd);
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+        size = static_cast<std::size_t>(info.st_size);
+        void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps the file referenced on its own.
+        close(fd);
+        if (view == MAP_FAILED) {
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+        data = static_cast<const std::byte *>(view);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(const_cast<std::byte *>(data), size);
+#endif
+    }
+
+    [[nodiscard]] std::span<const std::byte> bytes() const {
+        return {data, size};
+    }
+
+private:
+    const std::byte *data{nullptr};
+    std::size_t size{0};
+#ifdef _WIN32
+    HANDLE file{INVALID_HANDLE_VALUE};
+    HANDLE mapping{nullptr};
+#endif
+};
+
+inline std::size_t columnFileAlign(const std::size_t offset) {
+    return (offset + COLUMN_FILE_ALIGNMENT - 1) / COLUMN_FILE_ALIGNMENT * COLUMN_FILE_ALIGNMENT;
+}
+
+inline std::size_t zoneMapBytes(const std::size_t blocks) {
+    return blocks * (2 * sizeof(double) + sizeof(uint32_t) + sizeof(uint8_t));
+}
+
+inline void writeColumnFile(const DataFrame &frame, const std::string &path) {
+    const std::size_t columnCount = frame.getColumnCount();
+    const std::size_t rowCount = frame.getRowCount();
+    ColumnFileHeader header{};
+    std::memcpy(header.magic, COLUMN_FILE_MAGIC, sizeof(header.magic));
+    header.version = COLUMN_FILE_VERSION;
+    header.byteOrder = COLUMN_FILE_BYTE_ORDER;
+    header.columnCount = columnCount;
+    header.rowCount = rowCount;
+    header.startTimestamp = frame.getStartTimestamp();
+    header.interval = frame.getSamplingIntervalNs();
+
+    std::vector<ColumnFileEntry> entries(columnCount);
+    std::size_t offset = sizeof(ColumnFileHeader) + columnCount * sizeof(ColumnFileEntry);
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        entries[i].type = static_cast<uint32_t>(frame.getColumnType(i));
+        entries[i].nameLength = static_cast<uint32_t>(frame.getColumnName(i).size());
+        entries[i].nameOffset = offset;
+        offset += entries[i].nameLength;
+    }
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        offset = columnFileAlign(offset);
+        entries[i].dataOffset = offset;
+        offset += std::visit([](const auto &view) { return view.size_bytes(); }, frame.getColumnView(i));
+    }
+    const std::size_t blocks = ZoneMap::blockCount(rowCount);
+    std::vector<ZoneMap> zoneMaps(columnCount);
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        offset = columnFileAlign(offset);
+        entries[i].zoneOffset = offset;
+        offset += zoneMapBytes(blocks);
+        if (const ZoneMap *zones = frame.getZoneMap(i); zones != nullptr) {
+            zoneMaps[i] = *zones;
+        } else {
+            std::visit([&](const auto &view) { zoneMaps[i].update(view); }, frame.getColumnView(i));
+        }
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(ColumnFileEntry)));
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        const std::string &name = frame.getColumnName(i);
+        out.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+    const char padding[COLUMN_FILE_ALIGNMENT] = {};
+    const auto pad = [&](const std::size_t to) {
+        const auto position = static_cast<std::size_t>(out.tellp());
+        out.write(padding, static_cast<std::streamsize>(to - position));
+    };
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        pad(entries[i].dataOffset);
+        std::visit([&](const auto &view) {
+            out.write(reinterpret_cast<const char *>(view.data()), static_cast<std::streamsize>(view.size_bytes()));
+        }, frame.getColumnView(i));
+    }
+    for (uint32_t i = 0; i < columnCount; ++i) {
+        pad(entries[i].zoneOffset);
+        const auto write = [&]<typename T>(const std::vector<T> &field) {
+            out.write(reinterpret_cast<const char *>(field.data()), static_cast<std::streamsize>(blocks * sizeof(T)));
+        };
+        write(zoneMaps[i].min);
+        write(zoneMaps[i].max);
+        write(zoneMaps[i].distinct);
+        write(zoneMaps[i].hasNaN);
+    }
+    if (!out.flush()) {
+        throw std::runtime_error("Cannot write file: " + path);
+    }
+}
+
+// A frame whose columns are views into the mapped file; nothing but the header, directory and zone maps is read.
+inline DataFrame openColumnFile(const std::string &path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    const std::span<const std::byte> bytes = file->bytes();
+    const auto corrupt = [&path] { return std::runtime_error("Invalid column file: " + path); };
+
+    ColumnFileHeader header{};
+    if (bytes.size() < sizeof(header)) {
+        throw corrupt();
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, COLUMN_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != COLUMN_FILE_VERSION || header.byteOrder != COLUMN_FILE_BYTE_ORDER || header.interval <= 0 ||
+        header.columnCount > (bytes.size() - sizeof(header)) / sizeof(ColumnFileEntry)) {
+        throw corrupt();
+    }
+
+    // Every column holds at least a byte per row, and the frame ends at a timestamp that fits into int64_t.
+    const int64_t maxTimestamp = std::numeric_limits<int64_t>::max();
+    if ((header.columnCount > 0 && header.rowCount > bytes.size()) ||
+        header.rowCount > static_cast<uint64_t>(maxTimestamp / header.interval) ||
+        header.startTimestamp > maxTimestamp - static_cast<int64_t>(header.rowCount) * header.interval) {
+        throw corrupt();
+    }
+    const auto rowCount = static_cast<std::size_t>(header.rowCount);
+    DataFrame frame(header.startTimestamp, header.startTimestamp + static_cast<int64_t>(rowCount) * header.interval,
+                    header.interval);
+    const std::size_t blocks = ZoneMap::blockCount(rowCount);
+    for (std::size_t i = 0; i < header.columnCount; ++i) {
+        ColumnFileEntry entry{};
+        std::memcpy(&entry, bytes.data() + sizeof(header) + i * sizeof(ColumnFileEntry), sizeof(entry));
+        if (entry.type >= std::variant_size_v<DataColumn> || entry.nameOffset > bytes.size() ||
+            entry.nameLength > bytes.size() - entry.nameOffset || entry.dataOffset % COLUMN_FILE_ALIGNMENT != 0 ||
+            entry.dataOffset > bytes.size() || entry.zoneOffset % COLUMN_FILE_ALIGNMENT != 0 ||
+            entry.zoneOffset > bytes.size() || zoneMapBytes(blocks) > bytes.size() - entry.zoneOffset) {
+            throw corrupt();
+        }
+        const std::string name(reinterpret_cast<const char *>(bytes.data() + entry.nameOffset), entry.nameLength);
+        const std::byte *block = bytes.data() + entry.dataOffset;
+        const std::size_t available = bytes.size() - entry.dataOffset;
+
+        // A column of type T, checked to fit into the file.
+        const auto view = [&]<typename T>(const T *) -> ColumnView {
+            if (rowCount > available / sizeof(T)) {
+                throw corrupt();
+            }
+            return std::span<const T>(reinterpret_cast<const T *>(block), rowCount);
+        };
+        switch (entry.type) {
+            case 0:
+                frame.addColumnView(name, view(static_cast<const uint8_t *>(nullptr)), file);
+                break;
+            case 1:
+                frame.addColumnView(name, view(static_cast<const int32_t *>(nullptr)), file);
+                break;
+            case 2:
+                frame.addColumnView(name, view(static_cast<const uint32_t *>(nullptr)), file);
+                break;
+            default:
+                frame.addColumnView(name, view(static_cast<const double *>(nullptr)), file);
+                break;
+        }
+
+        ZoneMap zones;
+        const std::byte *zoneBlock = bytes.data() + entry.zoneOffset;
+        const auto read = [&]<typename T>(std::vector<T> &field) {
+            field.resize(blocks);
+            std::memcpy(field.data(), zoneBlock, blocks * sizeof(T));
+            zoneBlock += blocks * sizeof(T);
+        };
+        read(zones.min);
+        read(zones.max);
+        read(zones.distinct);
+        read(zones.hasNaN);
+        frame.setZoneMap(static_cast<uint32_t>(i), std::move(zones));
+    }
+    return frame;
+}
+
+#endif //COLUMN_FILE_H
@@ -1,60 +1,546 @@
 #ifndef DATA_FRAME_H
 #define DATA_FRAME_H
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <variant>
 #include <stdexcept>
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 
 using DataColumn = std::variant<std::vector<uint8_t>, std::vector<int32_t>, std::vector<uint32_t>, std::vector<double> >
 ;
 
+// Non-owning, type-preserving view of a DataColumn.
+using ColumnView = std::variant<std::span<const uint8_t>, std::span<const int32_t>, std::span<const uint32_t>,
+    std::span<const double> >;
+
+// Run-length encoding of a column: run i repeats values[i] up to row ends[i], exclusive.
+struct RunLengthColumn {
+    DataColumn values{};
+    std::vector<std::size_t> ends{};
+
+    static RunLengthColumn encode(const DataColumn &column) {
+        RunLengthColumn result;
+        result.values = std::visit([&](const auto &vec) -> DataColumn {
+            using T = typename std::decay_t<decltype(vec)>::value_type;
+            std::vector<T> runValues;
+            for (std::size_t i = 0; i < vec.size(); ++i) {
+                // Doubles are compared bit for bit, so decoding restores -0.0; every NaN is a run of its own.
+                if (!runValues.empty() && sameBits(runValues.back(), vec[i])) {
+                    result.ends.back() = i + 1;
+                } else {
+                    runValues.emplace_back(vec[i]);
+                    result.ends.emplace_back(i + 1);
+                }
+            }
+            return runValues;
+        }, column);
+        return result;
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return ends.empty() ? 0 : ends.back();
+    }
+
+    [[nodiscard]] DataColumn decode() const {
+        return std::visit([&](const auto &runValues) -> DataColumn {
+            std::decay_t<decltype(runValues)> vec;
+            vec.reserve(size());
+            for (std::size_t i = 0; i < runValues.size(); ++i) {
+                vec.insert(vec.end(), ends[i] - vec.size(), runValues[i]);
+            }
+            return vec;
+        }, values);
+    }
+
+private:
+    template<typename T>
+    static bool sameBits(const T &left, const T &right) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return std::bit_cast<uint64_t>(left) == std::bit_cast<uint64_t>(right) && left == left;
+        } else {
+            return left == right;
+        }
+    }
+};
+
+/*
+ * Statistics of each block of BLOCK_ROWS rows of a column, for operators to answer a predicate on a
+ * whole block without reading it. min and max leave out NaN rows, which hasNaN records; a block of NaN
+ * only has min > max. distinct counts the values other than NaN, up to MAX_DISTINCT.
+ */
+struct ZoneMap {
+    static constexpr std::size_t BLOCK_ROWS = 64 * 1024;
+    static constexpr uint32_t MAX_DISTINCT = 256;
+
+    std::vector<double> min{};
+    std::vector<double> max{};
+    std::vector<uint32_t> distinct{};
+    std::vector<uint8_t> hasNaN{};
+
+    [[nodiscard]] static std::size_t blockCount(const std::size_t rows) {
+        return (rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    }
+
+    [[nodiscard]] std::size_t blockCount() const {
+        return min.size();
+    }
+
+    /*
+     * Brings the blocks up to date with values, of which the rows before from are unchanged since the
+     * last update. A partial last block is continued from what the last update saw of it, so appending
+     * a few rows at a time does not scan the block again.
+     */
+    template<typename T>
+    void update(const std::span<const T> values, const std::size_t from = 0) {
+        std::size_t begin = from / BLOCK_ROWS * BLOCK_ROWS;
+        Block block;
+        if (begin < from && from < values.size() && blockCount() == begin / BLOCK_ROWS + 1) {
+            block = resume();
+            begin = from;
+        } else {
+            truncate(begin / BLOCK_ROWS);
+        }
+        for (; begin < values.size(); block = Block{}) {
+            block.end = std::min(values.size(), (begin / BLOCK_ROWS + 1) * BLOCK_ROWS);
+            for (std::size_t i = begin; i < block.end; ++i) {
+                block.add(values[i]);
+            }
+            begin = block.end;
+            append(std::move(block));
+        }
+    }
+
+    // Blocks of a run-length encoded column, from the values of the runs that overlap each block.
+    void update(const RunLengthColumn &column) {
+        truncate(0);
+        std::visit([&]<typename T>(const std::vector<T> &values) {
+            std::size_t run = 0;
+            for (std::size_t begin = 0; begin < column.size(); begin += BLOCK_ROWS) {
+                Block block;
+                block.end = std::min(column.size(), begin + BLOCK_ROWS);
+                for (; run < values.size() && (run == 0 || column.ends[run - 1] < block.end); ++run) {
+                    block.add(values[run]);
+                }
+                // The last run may go on into the next block.
+                if (column.ends[run - 1] > block.end) {
+                    --run;
+                }
+                append(std::move(block));
+            }
+        }, column.values);
+    }
+
+private:
+    struct Block {
+        std::size_t end{0}; // row after the block
+        double low{std::numeric_limits<double>::infinity()};
+        double high{-std::numeric_limits<double>::infinity()};
+        bool nan{false};
+        std::unordered_set<double> seen{}; // until there are MAX_DISTINCT values
+        double last{std::numeric_limits<double>::quiet_NaN()};
+
+        void add(const double value) {
+            if (std::isnan(value)) {
+                nan = true;
+                return;
+            }
+            low = std::min(low, value);
+            high = std::max(high, value);
+            // Columns mostly repeat the row before, which needs no lookup.
+            if (value != last && seen.size() < MAX_DISTINCT) {
+                seen.insert(value);
+            }
+            last = value;
+        }
+    };
+
+    // Distinct values of the last block while it is partial, to resume counting them.
+    std::unordered_set<double> open_{};
+
+    Block resume() {
+        Block block;
+        block.low = min.back();
+        block.high = max.back();
+        block.nan = hasNaN.back() != 0;
+        block.seen = std::move(open_);
+        truncate(blockCount() - 1);
+        return block;
+    }
+
+    void truncate(const std::size_t blocks) {
+        min.resize(std::min(blocks, min.size()));
+        max.resize(min.size());
+        distinct.resize(min.size());
+        hasNaN.resize(min.size());
+        open_.clear();
+    }
+
+    void append(Block &&block) {
+        min.emplace_back(block.low);
+        max.emplace_back(block.high);
+        distinct.emplace_back(static_cast<uint32_t>(block.seen.size()));
+        hasNaN.emplace_back(block.nan);
+        if (block.end % BLOCK_ROWS != 0) {
+            open_ = std::move(block.seen);
+        }
+    }
+};
+
+/*
+ * Answers SUM, MAX and MIN over any range of rows of a column without scanning all of it, from blocks of
+ * BLOCK_ROWS rows: SUM from a tree of block sums, MAX and MIN from a sparse table over blocks. At most
+ * two partial blocks at the ends of the range are read. Sums only ever add rows of the range, so unlike
+ * differences of prefix sums they do not cancel against large rows outside it. NaN rows are left out;
+ * nanCount tells the ranges that hold one, which callers scan instead.
+ */
+struct RangeIndex {
+    static constexpr std::size_t BLOCK_ROWS = 1024;
+
+    RangeIndex() = default;
+
+    template<typename T>
+    explicit RangeIndex(const std::span<const T> values) {
+        const std::size_t blocks = (values.size() + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        std::vector<double> high(blocks, -std::numeric_limits<double>::infinity());
+        std::vector<double> low(blocks, std::numeric_limits<double>::infinity());
+        leaves_ = std::bit_ceil(std::max(blocks, std::size_t{1}));
+        sums_.assign(2 * leaves_, 0);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            const auto value = static_cast<double>(values[i]);
+            if (std::isnan(value)) {
+                nans_.emplace_back(i);
+                continue;
+            }
+            sums_[leaves_ + i / BLOCK_ROWS] += value;
+            high[i / BLOCK_ROWS] = std::max(high[i / BLOCK_ROWS], value);
+            low[i / BLOCK_ROWS] = std::min(low[i / BLOCK_ROWS], value);
+        }
+        for (std::size_t node = leaves_; node-- > 1;) {
+            sums_[node] = sums_[2 * node] + sums_[2 * node + 1];
+        }
+        max_.emplace_back(std::move(high));
+        min_.emplace_back(std::move(low));
+        // Level k holds the extremes of blocks [b, b + 2^k), each from two entries of level k - 1.
+        for (std::size_t width = 1; 2 * width <= blocks; width *= 2) {
+            std::vector<double> wideHigh(blocks - 2 * width + 1);
+            std::vector<double> wideLow(wideHigh.size());
+            for (std::size_t b = 0; b < wideHigh.size(); ++b) {
+                wideHigh[b] = std::max(max_.back()[b], max_.back()[b + width]);
+                wideLow[b] = std::min(min_.back()[b], min_.back()[b + width]);
+            }
+            max_.emplace_back(std::move(wideHigh));
+            min_.emplace_back(std::move(wideLow));
+        }
+    }
+
+    // Sum of rows [begin, end) of values, the column the index was built from, NaN rows left out.
+    template<typename T>
+    [[nodiscard]] double sum(const std::span<const T> values, const std::size_t begin, const std::size_t end) const {
+        double result = 0;
+        const auto scan = [&](const std::size_t from, const std::size_t to) {
+            for (std::size_t i = from; i < to; ++i) {
+                const auto value = static_cast<double>(values[i]);
+                result += std::isnan(value) ? 0 : value;
+            }
+        };
+        const std::size_t first = (begin + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        const std::size_t last = end / BLOCK_ROWS;
+        if (first >= last) {
+            scan(begin, end);
+            return result;
+        }
+        scan(begin, first * BLOCK_ROWS);
+        // The fewest tree nodes that cover blocks [first, last).
+        for (std::size_t low = leaves_ + first, high = leaves_ + last; low < high; low /= 2, high /= 2) {
+            if (low % 2 == 1) {
+                result += sums_[low++];
+            }
+            if (high % 2 == 1) {
+                result += sums_[--high];
+            }
+        }
+        scan(last * BLOCK_ROWS, end);
+        return result;
+    }
+
+    // NaN rows among rows [begin, end).
+    [[nodiscard]] std::size_t nanCount(const std::size_t begin, const std::size_t end) const {
+        return static_cast<std::size_t>(std::ranges::lower_bound(nans_, end) - std::ranges::lower_bound(nans_, begin));
+    }
+
+    // Largest of rows [begin, end) of values, the column the index was built from. The range must not be
+    // empty or hold NaN.
+    template<typename T>
+    [[nodiscard]] double max(const std::span<const T> values, const std::size_t begin, const std::size_t end) const {
+        return extreme(values, begin, end, max_, [](const double l, const double r) { return std::max(l, r); });
+    }
+
+    // Smallest of rows [begin, end) of values, as max.
+    template<typename T>
+    [[nodiscard]] double min(const std::span<const T> values, const std::size_t begin, const std::size_t end) const {
+        return extreme(values, begin, end, min_, [](const double l, const double r) { return std::min(l, r); });
+    }
+
+private:
+    std::size_t leaves_{1};
+    std::vector<double> sums_{}; // block b at leaves_ + b, each inner node the sum of its two children
+    std::vector<std::size_t> nans_{}; // rows that hold NaN, in order
+    std::vector<std::vector<double> > max_{};
+    std::vector<std::vector<double> > min_{};
+
+    template<typename T, typename Pick>
+    static double extreme(const std::span<const T> values, const std::size_t begin, const std::size_t end,
+                          const std::vector<std::vector<double> > &table, Pick &&pick) {
+        double result = static_cast<double>(values[begin]);
+        const auto scan = [&](const std::size_t from, const std::size_t to) {
+            for (std::size_t i = from; i < to; ++i) {
+                result = pick(result, static_cast<double>(values[i]));
+            }
+        };
+        const std::size_t first = (begin + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        const std::size_t last = end / BLOCK_ROWS;
+        if (first >= last) {
+            scan(begin + 1, end);
+            return result;
+        }
+        // Two overlapping power-of-two spans cover the whole blocks.
+        const std::size_t width = std::bit_floor(last - first);
+        const auto level = static_cast<std::size_t>(std::countr_zero(width));
+        result = pick(result, pick(table[level][first], table[level][last - width]));
+        scan(begin + 1, first * BLOCK_ROWS);
+        scan(last * BLOCK_ROWS, end);
+        return result;
+    }
+};
 
 class DataFrame {
 public:
-    DataFrame(const int64_t startTimestamp, const int64_t endTimestamp, const int64_t interval) {
-        for (int64_t i = startTimestamp; i < endTimestamp; i += interval) {
-            timestamps.emplace_back(i);
+    // Rows sampled every interval from start on, up to but excluding end. The interval must be positive
+    // even for an empty frame, as executors divide durations by it.
+    DataFrame(const int64_t start, const int64_t end, const int64_t interval)
+        : samplingInterval(interval), startTimestamp(start) {
+        if (interval <= 0) {
+            throw std::runtime_error("Sampling interval must be positive");
+        }
+        if (end > start) {
+            // The difference does not fit into int64_t for timestamps far apart, but always into uint64_t.
+            const uint64_t span = static_cast<uint64_t>(end) - static_cast<uint64_t>(start);
+            rowCount = (span - 1) / static_cast<uint64_t>(interval) + 1;
         }
     }
 
     std::size_t getRowCount() const {
-        return timestamps.size();
+        return rowCount;
     }
 
     void addColumn(const std::string &name, const DataColumn &column) {
         if (nameMap.contains(name)) {
             throw std::runtime_error("Column already exists");
         }
-        if (std::holds_alternative<std::vector<uint8_t> >(column)) {
-            auto &vec = std::get<std::vector<uint8_t> >(column);
-            if (vec.size() != getRowCount()) {
-                throw std::runtime_error("Column size does not match timestamps size");
-            }
-            columns.emplace_back(vec);
+        const std::size_t size = std::visit([](const auto &vec) { return vec.size(); }, column);
+        if (size != getRowCount()) {
+            throw std::runtime_error("Column size does not match timestamps size");
         }
+        const auto index = static_cast<uint32_t>(columns.size());
+        nameMap.emplace(name, index);
+        columnNames.emplace_back(name);
+        columns.emplace_back(column);
+        std::visit([&](const auto &vec) { zoneMaps[index].update(std::span(vec)); }, columns.back());
     };
 
-    [[nodiscard]] const DataColumn &getColumn(const std::string &name) const {
-        if (!nameMap.contains(name)) {
+    // Adds a column stored outside the frame, e.g. in a mapped file; owner keeps that storage alive as
+    // long as the frame. The column is only readable through getColumnView.
+    void addColumnView(const std::string &name, const ColumnView &view, std::shared_ptr<const void> owner) {
+        if (nameMap.contains(name)) {
+            throw std::runtime_error("Column already exists");
+        }
+        if (std::visit([](const auto &span) { return span.size(); }, view) != getRowCount()) {
+            throw std::runtime_error("Column size does not match timestamps size");
+        }
+        const auto index = static_cast<uint32_t>(columns.size());
+        nameMap.emplace(name, index);
+        columnNames.emplace_back(name);
+        // An empty vector of the same type keeps getColumnType and appendRows checks uniform.
+        columns.emplace_back(std::visit([](const auto &span) -> DataColumn {
+            return std::vector<std::remove_const_t<typename std::decay_t<decltype(span)>::element_type> >{};
+        }, view));
+        columnViews.emplace(index, view);
+        storageOwners.emplace_back(std::move(owner));
+    }
+
+    // Adds a column kept as runs of equal values. Operators that read runs use getRunLengthColumn; the
+    // others see the column expanded on first use.
+    void addRunLengthColumn(const std::string &name, RunLengthColumn column) {
+        if (nameMap.contains(name)) {
+            throw std::runtime_error("Column already exists");
+        }
+        if (column.size() != getRowCount() || std::visit([](const auto &vec) { return vec.size(); },
+                                                         column.values) != column.ends.size()) {
+            throw std::runtime_error("Column size does not match timestamps size");
+        }
+        const auto index = static_cast<uint32_t>(columns.size());
+        nameMap.emplace(name, index);
+        columnNames.emplace_back(name);
+        columns.emplace_back(std::visit([](const auto &vec) -> DataColumn {
+            return std::decay_t<decltype(vec)>{};
+        }, column.values));
+        zoneMaps[index].update(column);
+        runLengthColumns.emplace(index, std::move(column));
+    }
+
+    // The runs of a column added with addRunLengthColumn, nullptr for other columns.
+    [[nodiscard]] const RunLengthColumn *getRunLengthColumn(const uint32_t index) const {
+        const auto it = runLengthColumns.find(index);
+        return it != runLengthColumns.end() ? &it->second : nullptr;
+    }
+
+    // Block statistics of a column, nullptr for a view added without them.
+    [[nodiscard]] const ZoneMap *getZoneMap(const uint32_t index) const {
+        const auto it = zoneMaps.find(index);
+        return it != zoneMaps.end() ? &it->second : nullptr;
+    }
+
+    // Sets the block statistics of a column, e.g. of a view, which must cover its rows.
+    void setZoneMap(const uint32_t index, ZoneMap zones) {
+        const std::size_t blocks = ZoneMap::blockCount(getRowCount());
+        if (index >= columns.size() || zones.min.size() != blocks || zones.max.size() != blocks ||
+            zones.distinct.size() != blocks || zones.hasNaN.size() != blocks) {
+            throw std::runtime_error("Zone map does not match the column");
+        }
+        zoneMaps[index] = std::move(zones);
+    }
+
+    // Range index of a column, built on first use and kept until rows are appended.
+    [[nodiscard]] const RangeIndex &getRangeIndex(const uint32_t index) const {
+        const ColumnView view = getColumnView(index);
+        std::lock_guard lock(*indexMutex);
+        auto it = rangeIndexes.find(index);
+        if (it == rangeIndexes.end()) {
+            it = rangeIndexes.emplace(index, std::visit([](const auto &span) { return RangeIndex(span); }, view)).first;
+        }
+        return it->second;
+    }
+
+    // Appends rows sampled after the last one: one DataColumn per column, in the order the columns were
+    // added, each of the column's type and all of the same length. Views and range indexes of the columns are
+    // invalidated.
+    void appendRows(const std::vector<DataColumn> &rows) {
+        if (rows.size() != columns.size()) {
+            throw std::runtime_error("Row data does not match the columns");
+        }
+        if (!columnViews.empty() || !runLengthColumns.empty()) {
+            throw std::runtime_error("Cannot append to columns stored outside the frame");
+        }
+        const std::size_t count = rows.empty() ? 0 : std::visit([](const auto &vec) { return vec.size(); }, rows[0]);
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            const std::size_t size = std::visit([](const auto &vec) { return vec.size(); }, rows[i]);
+            if (rows[i].index() != columns[i].index() || size != count) {
+                throw std::runtime_error("Row data does not match the columns");
+            }
+        }
+        const std::size_t from = getRowCount();
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            std::visit([&](auto &vec) {
+                const auto &tail = std::get<std::decay_t<decltype(vec)> >(rows[i]);
+                vec.insert(vec.end(), tail.begin(), tail.end());
+                zoneMaps[static_cast<uint32_t>(i)].update(std::span(std::as_const(vec)), from);
+            }, columns[i]);
+        }
+        rangeIndexes.clear();
+        rowCount += count;
+    }
+
+    [[nodiscard]] uint32_t getColumnIndex(const std::string &name) const {
+        const auto it = nameMap.find(name);
+        if (it == nameMap.end()) {
             throw std::runtime_error("Column does not exist: " + name);
         }
+        return it->second;
+    }
 
-        auto index = nameMap.at(name);
-        return columns[index];
+    [[nodiscard]] const DataColumn &getColumn(const uint32_t index) const {
+        if (columnViews.contains(index)) {
+            throw std::runtime_error("Column is stored outside the frame: " + columnNames.at(index));
+        }
+        if (runLengthColumns.contains(index)) {
+            return expandedColumn(index);
+        }
+        return columns.at(index);
     }
 
-    int64_t getSamplingIntervalNs() const {
-        return 1e8; // 100ms
+    [[nodiscard]] ColumnView getColumnView(const uint32_t index) const {
+        if (const auto it = columnViews.find(index); it != columnViews.end()) {
+            return it->second;
+        }
+        const DataColumn &column = runLengthColumns.contains(index) ? expandedColumn(index) : columns.at(index);
+        return std::visit([](const auto &vec) -> ColumnView { return std::span(vec); }, column);
+    }
+
+    [[nodiscard]] const DataColumn &getColumn(const std::string &name) const {
+        return getColumn(getColumnIndex(name));
+    }
+
+    [[nodiscard]] std::size_t getColumnCount() const {
+        return columns.size();
+    }
+
+    [[nodiscard]] const std::string &getColumnName(const uint32_t index) const {
+        return columnNames.at(index);
+    }
+
+    // Index of the column's type in DataColumn.
+    [[nodiscard]] std::size_t getColumnType(const uint32_t index) const {
+        return columns.at(index).index();
+    }
+
+    [[nodiscard]] int64_t getStartTimestamp() const {
+        return startTimestamp;
+    }
+
+    [[nodiscard]] int64_t getSamplingIntervalNs() const {
+        return samplingInterval;
     }
 
 private:
+    const DataColumn &expandedColumn(const uint32_t index) const {
+        std::lock_guard lock(*expandMutex);
+        auto it = expandedColumns.find(index);
+        if (it == expandedColumns.end()) {
+            it = expandedColumns.emplace(index, runLengthColumns.at(index).decode()).first;
+        }
+        return it->second;
+    }
+
     std::unordered_map<std::string, uint32_t> nameMap{};
     std::vector<std::string> columnNames{};
-    std::vector<int64_t> timestamps{};
     std::vector<DataColumn> columns{};
+    std::unordered_map<uint32_t, ColumnView> columnViews{};
+    std::unordered_map<uint32_t, RunLengthColumn> runLengthColumns{};
+    std::unordered_map<uint32_t, ZoneMap> zoneMaps{};
+    // Run-length encoded columns expanded so far. The mutex is held by pointer to keep frames copyable.
+    std::shared_ptr<std::mutex> expandMutex{std::make_shared<std::mutex>()};
+    mutable std::unordered_map<uint32_t, DataColumn> expandedColumns{};
+    // Range indexes built so far, see getRangeIndex.
+    std::shared_ptr<std::mutex> indexMutex{std::make_shared<std::mutex>()};
+    mutable std::unordered_map<uint32_t, RangeIndex> rangeIndexes{};
+    std::vector<std::shared_ptr<const void> > storageOwners{};
+    // Row i was sampled at startTimestamp + i * samplingInterval, so timestamps are not stored.
+    int64_t samplingInterval{0};
+    int64_t startTimestamp{0};
+    std::size_t rowCount{0};
 };
 
 
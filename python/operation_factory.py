@@ -156,28 +156,65 @@ class LogicalOp(BaseOp):
         return self
 
 
+class NotOp(BaseOp):
+    def __init__(self, operation: str, **kwargs):
+        self._operation = operation
+        self._value = self.parse(kwargs.pop("value"))
+
+    def build_query(self):
+        return {
+            "type": "operation",
+            "operation": self._operation,
+            "value": self._value.build_query()
+        }
+
+    def set_input(self, operations: List[BaseOp]):
+        self._value = self._set_input_helper(self._value, operations)
+        return self
+
+    def replace_variable(self, variable_dict: Dict[str, Any]):
+        self._value = self._replace_variable_helper(self._value, variable_dict)
+        return self
+
+
 class CountOp(BaseOp):
     def __init__(self, operation: str, **kwargs):
         self._operation = operation
         self._value = self.parse(kwargs.pop("value"))
         self._initial_value = self.parse(kwargs.pop("initial_value"))
         self._unit = self.parse(kwargs.pop("unit"))
+        # Optional range, in seconds since the first row.
+        self._start = self.parse(kwargs.pop("start")) if "start" in kwargs else None
+        self._end = self.parse(kwargs.pop("end")) if "end" in kwargs else None
+        # Optional bool[] condition picking the rows to aggregate.
+        self._where = self.parse(kwargs.pop("where")) if "where" in kwargs else None
 
     def build_query(self):
-        return {
+        query = {
             "type": "operation",
             "operation": self._operation,
             "value": self._value.build_query(),
             "initial_value": self._initial_value.build_query(),
             "unit": self._unit.build_query()
         }
+        if self._start is not None:
+            query["start"] = self._start.build_query()
+        if self._end is not None:
+            query["end"] = self._end.build_query()
+        if self._where is not None:
+            query["where"] = self._where.build_query()
+        return query
 
     def set_input(self, operations: List[BaseOp]):
         self._value = self._set_input_helper(self._value, operations)
+        if self._where is not None:
+            self._where = self._set_input_helper(self._where, operations)
         return self
 
     def replace_variable(self, variable_dict: Dict[str, Any]):
         self._value = self._replace_variable_helper(self._value, variable_dict)
+        if self._where is not None:
+            self._where = self._replace_variable_helper(self._where, variable_dict)
         return self
 
 
@@ -185,16 +222,30 @@ class AggregateOp(BaseOp):
     def __init__(self, operation: str, **kwargs):
         self._operation = operation
         self._value = self.parse(kwargs.pop("value"))
+        # Optional range, in seconds since the first row.
+        self._start = self.parse(kwargs.pop("start")) if "start" in kwargs else None
+        self._end = self.parse(kwargs.pop("end")) if "end" in kwargs else None
+        # Optional bool[] condition picking the rows to aggregate.
+        self._where = self.parse(kwargs.pop("where")) if "where" in kwargs else None
 
     def build_query(self):
-        return {
+        query = {
             "type": "operation",
             "operation": self._operation,
             "value": self._value.build_query()
         }
+        if self._start is not None:
+            query["start"] = self._start.build_query()
+        if self._end is not None:
+            query["end"] = self._end.build_query()
+        if self._where is not None:
+            query["where"] = self._where.build_query()
+        return query
 
     def replace_variable(self, variable_dict: Dict[str, Any]):
         self._value = self._replace_variable_helper(self._value, variable_dict)
+        if self._where is not None:
+            self._where = self._replace_variable_helper(self._where, variable_dict)
         return self
 
 
@@ -261,6 +312,54 @@ class DurationOp(BaseOp):
         return self
 
 
+class RollingOp(BaseOp):
+    def __init__(self, operation: str, **kwargs):
+        self._operation = operation
+        self._value = self.parse(kwargs.pop("value"))
+        self._duration = self.parse(kwargs.pop("duration"))
+
+    def build_query(self):
+        return {
+            "type": "operation",
+            "operation": self._operation,
+            "value": self._value.build_query(),
+            "duration": self._duration.build_query()
+        }
+
+    def set_input(self, operations: List[BaseOp]):
+        self._value = self._set_input_helper(self._value, operations)
+        return self
+
+    def replace_variable(self, variable_dict: Dict[str, Any]):
+        self._value = self._replace_variable_helper(self._value, variable_dict)
+        return self
+
+
+class SegmentAggOp(BaseOp):
+    # One row of [start, end, duration, max, min, avg] per TRUE run of value, flattened.
+    def __init__(self, operation: str, **kwargs):
+        self._operation = operation
+        self._value = self.parse(kwargs.pop("value"))
+        self._target = self.parse(kwargs.pop("target"))
+
+    def build_query(self):
+        return {
+            "type": "operation",
+            "operation": self._operation,
+            "value": self._value.build_query(),
+            "target": self._target.build_query()
+        }
+
+    def set_input(self, operations: List[BaseOp]):
+        self._value = self._set_input_helper(self._value, operations)
+        return self
+
+    def replace_variable(self, variable_dict: Dict[str, Any]):
+        self._value = self._replace_variable_helper(self._value, variable_dict)
+        self._target = self._replace_variable_helper(self._target, variable_dict)
+        return self
+
+
 class SelectOp(BaseOp):
     def __init__(self, operation: str, **kwargs):
         self._operation = operation
@@ -329,8 +428,9 @@ class DeclareOp(BaseOp):
 
 
 FinalResult = (DeclareOp, JudgeOp)
-AllowInput = (LogicalOp, JudgeOp, CountOp, DeclareOp, DurationOp)
-AllowVariable = (CompareOp, MathOp, AbsOp, LogicalOp, CountOp, AggregateOp, JudgeOp, TrendOp, JudgeOp, DeclareOp)
+AllowInput = (LogicalOp, NotOp, JudgeOp, CountOp, DeclareOp, DurationOp, RollingOp, SegmentAggOp)
+AllowVariable = (CompareOp, MathOp, AbsOp, LogicalOp, NotOp, CountOp, AggregateOp, RollingOp, SegmentAggOp, JudgeOp,
+                 TrendOp, JudgeOp, DeclareOp)
 
 op_map = {
     "EQ": CompareOp,
@@ -347,10 +447,18 @@ op_map = {
     "ABS": AbsOp,
     "AND": LogicalOp,
     "OR": LogicalOp,
+    "NOT": NotOp,
     "COUNT": CountOp,
     "MAX": AggregateOp,
     "MIN": AggregateOp,
     "AVG": AggregateOp,
+    "SUM": AggregateOp,
+    "ROLLING_MAX": RollingOp,
+    "ROLLING_MIN": RollingOp,
+    "ROLLING_AVG": RollingOp,
+    "ROLLING_SUM": RollingOp,
+    "ROLLING_COUNT": RollingOp,
+    "SEGMENT_AGG": SegmentAggOp,
     "JUMP": JumpOp,
     "BEFORE": TrendOp,
     "AFTER": TrendOp,
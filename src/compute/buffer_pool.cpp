@@ -0,0 +1,129 @@
+#include "buffer_pool.h"
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace ComputeLib;
+
+template<typename T>
+static std::size_t bytesOf(const std::vector<T> &buffer) {
+    return buffer.capacity() * sizeof(T);
+}
+
+template<typename T>
+std::vector<T> BufferPool::take(std::vector<std::vector<T>> &buffers, const std::size_t size) {
+    auto best = buffers.end();
+    for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+        if (it->capacity() >= size && (best == buffers.end() || it->capacity() < best->capacity())) {
+            best = it;
+        }
+    }
+    if (best == buffers.end()) {
+        return {};
+    }
+    std::vector<T> buffer = std::move(*best);
+    buffers.erase(best);
+    bytes_ -= bytesOf(buffer);
+    ++reused_;
+    return buffer;
+}
+
+template<typename T, typename Other>
+void BufferPool::put(std::vector<std::vector<T>> &buffers, std::vector<T> &&buffer,
+                     std::vector<std::vector<Other>> &others) {
+    if (buffer.capacity() == 0 || bytesOf(buffer) > MAX_BYTES) {
+        return;
+    }
+    bytes_ += bytesOf(buffer);
+    buffers.emplace_back(std::move(buffer));
+    // Buffers are kept in the order they came back, so the oldest go first.
+    while (buffers.size() > MAX_BUFFERS || (bytes_ > MAX_BYTES && buffers.size() > 1)) {
+        bytes_ -= bytesOf(buffers.front());
+        buffers.erase(buffers.begin());
+    }
+    // Only the new buffer is left of its type, and it fits on its own.
+    while (bytes_ > MAX_BYTES) {
+        bytes_ -= bytesOf(others.front());
+        others.erase(others.begin());
+    }
+}
+
+NumericVectorType BufferPool::acquireNumeric(const std::size_t size, const NumericType value) {
+    NumericVectorType buffer;
+    {
+        std::lock_guard lock(mutex_);
+        buffer = take(numeric_, size);
+    }
+    buffer.assign(size, value);
+    return buffer;
+}
+
+BoolVectorType BufferPool::acquireBits(const std::size_t size, const uint8_t value) {
+    std::vector<BitVector::Word> storage;
+    {
+        std::lock_guard lock(mutex_);
+        storage = take(words_, BitVector::wordCount(size));
+    }
+    return {size, value, std::move(storage)};
+}
+
+void BufferPool::release(GenericValue &&value) {
+    std::lock_guard lock(mutex_);
+    if (std::holds_alternative<NumericVectorType>(value)) {
+        put(numeric_, std::move(std::get<NumericVectorType>(value)), words_);
+    } else if (std::holds_alternative<BoolVectorType>(value)) {
+        put(words_, std::get<BoolVectorType>(value).releaseWords(), numeric_);
+    }
+}
+
+GenericValue BufferPool::fit(GenericValue &&value) {
+    if (std::holds_alternative<NumericVectorType>(value)) {
+        auto &vec = std::get<NumericVectorType>(value);
+        if (vec.capacity() > vec.size()) {
+            NumericVectorType result(vec.begin(), vec.end());
+            std::lock_guard lock(mutex_);
+            put(numeric_, std::move(vec), words_);
+            return result;
+        }
+    } else if (std::holds_alternative<BoolVectorType>(value)) {
+        auto &vec = std::get<BoolVectorType>(value);
+        if (vec.wordCapacity() > vec.words().size()) {
+            BoolVectorType result(vec.size(), 0);
+            std::ranges::copy(vec.words(), result.words().begin());
+            std::lock_guard lock(mutex_);
+            put(words_, vec.releaseWords(), numeric_);
+            return result;
+        }
+    }
+    return std::move(value);
+}
+
+void BufferPool::clear() {
+    std::lock_guard lock(mutex_);
+    numeric_.clear();
+    words_.clear();
+    bytes_ = 0;
+}
+
+std::size_t BufferPool::pooledBytes() const {
+    std::lock_guard lock(mutex_);
+    return bytes_;
+}
+
+std::size_t BufferPool::reuseCount() const {
+    std::lock_guard lock(mutex_);
+    return reused_;
+}
+
+std::size_t ComputeLib::storageBytes(const GenericValue &value) {
+    if (std::holds_alternative<NumericVectorType>(value)) {
+        return std::get<NumericVectorType>(value).capacity() * sizeof(NumericType);
+    }
+    if (std::holds_alternative<BoolVectorType>(value)) {
+        return std::get<BoolVectorType>(value).wordCapacity() * sizeof(BitVector::Word);
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include "cost_model.h"
+#include "data_frame.h"
+#include "operator.h"
+#include "plan.h"
+#include "profile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+using namespace ComputeLib;
+
+double CostModel::operatorCost(const OperatorEnum op) {
+    switch (op) {
+        case OperatorEnum::EQ:
+        case OperatorEnum::NE:
+        case OperatorEnum::LT:
+        case OperatorEnum::LE:
+        case OperatorEnum::GT:
+        case OperatorEnum::GE:
+        case OperatorEnum::ADD:
+        case OperatorEnum::SUB:
+        case OperatorEnum::MUL:
+        case OperatorEnum::MAX:
+        case OperatorEnum::MIN:
+        case OperatorEnum::AVG:
+        case OperatorEnum::SUM:
+            return 1;
+        case OperatorEnum::DIV:
+            return 4;
+        case OperatorEnum::POW:
+            return 20;
+        case OperatorEnum::ABS:
+        case OperatorEnum::NOT:
+            return 0.5;
+        // Word-wise on bool[].
+        case OperatorEnum::AND:
+        case OperatorEnum::OR:
+            return 0.1;
+        case OperatorEnum::COUNT:
+        case OperatorEnum::DURATION:
+        case OperatorEnum::ROLLING_AVG:
+        case OperatorEnum::ROLLING_SUM:
+        case OperatorEnum::ROLLING_COUNT:
+        case OperatorEnum::SEGMENT_AGG:
+            return 2;
+        // A deque push and pop per row.
+        case OperatorEnum::ROLLING_MAX:
+        case OperatorEnum::ROLLING_MIN:
+            return 4;
+        // Per-row state machines with a set lookup per row.
+        case OperatorEnum::JUMP:
+            return 4;
+        case OperatorEnum::AFTER:
+        case OperatorEnum::HOLD:
+            return 8;
+        // A scalar, or a view of the column.
+        case OperatorEnum::BEFORE:
+        case OperatorEnum::SELECT:
+            return 0;
+    }
+    return 1;
+}
+
+void CostModel::observe(const DataFrame &frame) {
+    const std::size_t rows = frame.getRowCount();
+    const std::size_t count = std::min(rows, SAMPLE_ROWS);
+    for (uint32_t i = 0; i < frame.getColumnCount(); ++i) {
+        // Evenly spaced rows; run-length encoded columns are sampled without expanding them.
+        std::vector<NumericType> sample(count);
+        if (const RunLengthColumn *runs = frame.getRunLengthColumn(i); runs != nullptr) {
+            std::visit([&](const auto &values) {
+                for (std::size_t j = 0; j < count; ++j) {
+                    const std::size_t row = j * rows / count;
+                    const auto run = std::ranges::upper_bound(runs->ends, row) - runs->ends.begin();
+                    sample[j] = static_cast<NumericType>(values[static_cast<std::size_t>(run)]);
+                }
+            }, runs->values);
+        } else {
+            std::visit([&](const auto &view) {
+                for (std::size_t j = 0; j < count; ++j) {
+                    sample[j] = static_cast<NumericType>(view[j * rows / count]);
+                }
+            }, frame.getColumnView(i));
+        }
+        samples_[frame.getColumnName(i)] = std::move(sample);
+        if (const ZoneMap *zones = frame.getZoneMap(i); zones != nullptr) {
+            zones_[frame.getColumnName(i)] = *zones;
+        } else {
+            zones_.erase(frame.getColumnName(i));
+        }
+    }
+}
+
+void CostModel::observe(const QueryProfile &profile) {
+    const CompiledQuery &plan = profile.plan();
+    for (uint32_t i = 0; i < plan.nodes().size(); ++i) {
+        const NodeProfile &node = profile.node(i);
+        if (node.boolRows && node.rowsOut > 0) {
+            Observed &observed = observed_[plan.fingerprint(i)];
+            observed.trueRows += node.trueRows;
+            observed.rows += node.rowsOut;
+        }
+    }
+}
+
+double CostModel::cost(const CompiledQuery &plan, const uint32_t node) const {
+    // Nodes the subtree reads more than once are only evaluated once.
+    double total = 0;
+    std::unordered_set<uint32_t> seen{node};
+    std::vector<uint32_t> pending{node};
+    while (!pending.empty()) {
+        const PlanNode &current = plan.node(pending.back());
+        pending.pop_back();
+        if (current.kind == NodeKind::OPERATION) {
+            total += operatorCost(current.op);
+        }
+        for (const uint32_t input: current.inputs) {
+            if (seen.insert(input).second) {
+                pending.emplace_back(input);
+            }
+        }
+    }
+    return total;
+}
+
+double CostModel::selectivity(const CompiledQuery &plan, const uint32_t node) const {
+    const PlanNode &current = plan.node(node);
+    if (current.kind == NodeKind::CONSTANT) {
+        return std::holds_alternative<BoolType>(current.constant) && std::get<BoolType>(current.constant) == 0 ? 0 : 1;
+    }
+    if (const auto it = observed_.find(plan.fingerprint(node)); it != observed_.end()) {
+        return static_cast<double>(it->second.trueRows) / static_cast<double>(it->second.rows);
+    }
+    switch (current.op) {
+        case OperatorEnum::EQ:
+        case OperatorEnum::NE:
+        case OperatorEnum::LT:
+        case OperatorEnum::LE:
+        case OperatorEnum::GT:
+        case OperatorEnum::GE: {
+            if (const double estimate = columnSelectivity(plan, node); !std::isnan(estimate)) {
+                return estimate;
+            }
+            // The textbook defaults for an equality and a range predicate.
+            if (current.op == OperatorEnum::EQ) {
+                return 0.1;
+            }
+            return current.op == OperatorEnum::NE ? 0.9 : 1.0 / 3;
+        }
+        case OperatorEnum::NOT:
+            return 1 - selectivity(plan, current.inputs[0]);
+        case OperatorEnum::AND: {
+            double result = 1;
+            for (const uint32_t input: current.inputs) {
+                result *= selectivity(plan, input);
+            }
+            return result;
+        }
+        case OperatorEnum::OR: {
+            double none = 1;
+            for (const uint32_t input: current.inputs) {
+                none *= 1 - selectivity(plan, input);
+            }
+            return 1 - none;
+        }
+        // State changes are rare next to the rows a state lasts.
+        case OperatorEnum::JUMP:
+            return 0.01;
+        case OperatorEnum::AFTER:
+        case OperatorEnum::HOLD:
+        case OperatorEnum::DURATION:
+            return 0.2;
+        default:
+            return 1;
+    }
+}
+
+double CostModel::columnSelectivity(const CompiledQuery &plan, const uint32_t node) const {
+    const PlanNode &compare = plan.node(node);
+    const auto isSelect = [&](const uint32_t input) {
+        return plan.node(input).kind == NodeKind::OPERATION && plan.node(input).op == OperatorEnum::SELECT;
+    };
+    const auto isNumber = [&](const uint32_t input) {
+        return plan.node(input).kind == NodeKind::CONSTANT &&
+               std::holds_alternative<NumericType>(plan.node(input).constant);
+    };
+    const uint32_t left = compare.inputs[0];
+    const uint32_t right = compare.inputs[1];
+    if (!(isSelect(left) && isNumber(right)) && !(isNumber(left) && isSelect(right))) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    const bool swapped = isNumber(left);
+    const std::string &column = plan.columns()[plan.node(swapped ? right : left).column];
+    const NumericType constant = std::get<NumericType>(plan.node(swapped ? left : right).constant);
+
+    // A block holds the constant on about one row per distinct value if it lies within the block's range.
+    const auto zones = zones_.find(column);
+    if ((compare.op == OperatorEnum::EQ || compare.op == OperatorEnum::NE) && zones != zones_.end() &&
+        zones->second.blockCount() > 0) {
+        const ZoneMap &zoneMap = zones->second;
+        double equal = 0;
+        for (std::size_t b = 0; b < zoneMap.blockCount(); ++b) {
+            if (zoneMap.min[b] <= constant && constant <= zoneMap.max[b]) {
+                equal += 1.0 / std::max(zoneMap.distinct[b], uint32_t{1});
+            }
+        }
+        equal /= static_cast<double>(zoneMap.blockCount());
+        return compare.op == OperatorEnum::EQ ? equal : 1 - equal;
+    }
+
+    const auto sample = samples_.find(column);
+    if (sample == samples_.end() || sample->second.empty()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    const auto keeps = [&](const NumericType row) {
+        const NumericType a = swapped ? constant : row;
+        const NumericType b = swapped ? row : constant;
+        switch (compare.op) {
+            case OperatorEnum::EQ:
+                return a == b;
+            case OperatorEnum::NE:
+                return a != b;
+            case OperatorEnum::LT:
+                return a < b;
+            case OperatorEnum::LE:
+                return a <= b;
+            case OperatorEnum::GT:
+                return a > b;
+            default:
+                return a >= b;
+        }
+    };
+    const auto kept = std::ranges::count_if(sample->second, keeps);
+    return static_cast<double>(kept) / static_cast<double>(sample->second.size());
+}
@@ -1,12 +1,25 @@
 #include "executor.h"
+#include "kernels.h"
 #include "operator.h"
+#include "plan.h"
+#include "state_machine.h"
+#include "value_set.h"
 #include "rapidjson/document.h"
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
-#include <unordered_set>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -15,160 +28,205 @@ using namespace ComputeLib;
 static constexpr uint8_t TRUE = 1;
 static constexpr uint8_t FALSE = 0;
 
-#define REGISTER_OPERATION(opName, opFunc) \
-    operationMap_[opName] = [this](const Query &query) { return opFunc(query); }
+// Morsels start on word boundaries, so threads writing bool[] results never share a BitVector word.
+static_assert(MORSEL_SIZE % BitVector::WORD_BITS == 0);
 
 #define GET_BOOL(var) get<BoolType>(var)
 #define GET_NUMERIC(var) get<NumericType>(var)
 #define GET_BOOL_VECTOR(var) get<BoolVectorType>(var)
 #define GET_NUMERIC_VECTOR(var) get<NumericVectorType>(var)
+#define GET_NUMERIC_VIEW(var) get<NumericViewType>(var)
 
-static void holdOpVecToAny(const NumericVectorType &valueVec,
-                           const std::unordered_set<NumericType> &fromValues,
-                           const uint32_t threshold,
-                           BoolVectorType &result) {
-    bool findFlag = false;
-    uint32_t cnt = 0;
-    for (std::size_t i = 1; i < valueVec.size(); ++i) {
-        if (!findFlag) {
-            if (!fromValues.contains(valueVec[i]) && fromValues.contains(valueVec[i - 1])) {
-                findFlag = true;
-                cnt++;
-            }
-        } else {
-            if (!fromValues.contains(valueVec[i])) {
-                cnt++;
-                if (cnt >= threshold) {
-                    result[i] = TRUE;
-                }
-            } else {
-                cnt = 0;
-                findFlag = false;
-            }
+// Rows per kernel call: a whole number of BitVector words, with NumericType scratch that stays in L1.
+static constexpr std::size_t KERNEL_BLOCK = 1024;
+
+// Calls func(block, length) for consecutive blocks of at most KERNEL_BLOCK rows covering [begin, end).
+template<typename Func>
+static void forEachBlock(const std::size_t begin, const std::size_t end, Func &&func) {
+    for (std::size_t block = begin; block < end; block += KERNEL_BLOCK) {
+        func(block, std::min(KERNEL_BLOCK, end - block));
+    }
+}
+
+// values[begin, begin + length) as NumericType: in place for double columns, otherwise widened into
+// scratch, which must hold KERNEL_BLOCK values.
+template<typename T>
+static const NumericType *asNumeric(const std::span<const T> values, const std::size_t begin,
+                                    const std::size_t length, NumericType *scratch) {
+    if constexpr (std::is_same_v<T, NumericType>) {
+        return values.data() + begin;
+    } else {
+        for (std::size_t i = 0; i < length; ++i) {
+            scratch[i] = static_cast<NumericType>(values[begin + i]);
         }
+        return scratch;
     }
 }
 
-static void holdOpAnyToVec(const NumericVectorType &valueVec,
-                           const std::unordered_set<NumericType> &toValues,
-                           const uint32_t threshold,
-                           BoolVectorType &result) {
-    bool findFlag = false;
-    uint32_t cnt = 0;
-    for (std::size_t i = 1; i < valueVec.size(); ++i) {
-        if (!findFlag) {
-            if (toValues.contains(valueVec[i]) && !toValues.contains(valueVec[i - 1])) {
-                findFlag = true;
-                cnt++;
+static bool isCompare(const OperatorEnum op) {
+    return op == OperatorEnum::EQ || op == OperatorEnum::NE || op == OperatorEnum::LT || op == OperatorEnum::LE ||
+           op == OperatorEnum::GT || op == OperatorEnum::GE;
+}
+
+// MAX/MIN/AVG/SUM over a range of rows of its value.
+static bool isRangeAggregate(const PlanNode &node) {
+    return (node.op == OperatorEnum::MAX || node.op == OperatorEnum::MIN || node.op == OperatorEnum::AVG ||
+            node.op == OperatorEnum::SUM) && node.inputs.size() == 3;
+}
+
+/*
+ * The result of compare op of every row of zone block b with constant, if the block's min and max
+ * decide it. NaN rows, and a NaN constant, compare FALSE except with NE.
+ */
+static std::optional<bool> zoneVerdict(const ZoneMap &zones, const std::size_t b, const OperatorEnum op,
+                                       const NumericType constant) {
+    const double low = zones.min[b];
+    const double high = zones.max[b];
+    const bool nan = zones.hasNaN[b] != 0;
+    if (std::isnan(constant) || low > high) {
+        // Every row compares with NaN, or is NaN.
+        return op == OperatorEnum::NE;
+    }
+    const auto decide = [&](const bool never, const bool always) -> std::optional<bool> {
+        if (never) {
+            return false;
+        }
+        if (always && !nan) {
+            return true;
+        }
+        return std::nullopt;
+    };
+    switch (op) {
+        case OperatorEnum::EQ:
+            return decide(constant < low || constant > high, low == constant && high == constant);
+        case OperatorEnum::NE: {
+            // NaN rows are TRUE here, so the block is only FALSE without them.
+            if (constant < low || constant > high) {
+                return true;
             }
-        } else {
-            if (toValues.contains(valueVec[i])) {
-                cnt++;
-                if (cnt >= threshold) {
-                    result[i] = TRUE;
-                }
-            } else {
-                cnt = 0;
-                findFlag = false;
+            if (low == constant && high == constant && !nan) {
+                return false;
             }
+            return std::nullopt;
         }
+        case OperatorEnum::LT:
+            return decide(low >= constant, high < constant);
+        case OperatorEnum::LE:
+            return decide(low > constant, high <= constant);
+        case OperatorEnum::GT:
+            return decide(high <= constant, low > constant);
+        default:
+            return decide(high < constant, low >= constant);
     }
 }
 
-static void holdOpVecToVec(const NumericVectorType &valueVec,
-                           const std::unordered_set<NumericType> &fromValues,
-                           const std::unordered_set<NumericType> &toValues,
-                           const uint32_t threshold,
-                           BoolVectorType &result) {
-    bool findFlag = false;
-    uint32_t cnt = 0;
-    for (std::size_t i = 1; i < valueVec.size(); ++i) {
-        if (!findFlag) {
-            if (toValues.contains(valueVec[i]) && fromValues.contains(valueVec[i - 1])) {
-                findFlag = true;
-                cnt++;
-            }
+// Sets the length rows of a block of a bool[] to value, leaving the padding of a partial last word zero.
+static void fillBlock(BitVector::Word *out, const std::size_t length, const bool value) {
+    const std::size_t words = BitVector::wordCount(length);
+    std::fill_n(out, words, value ? ~BitVector::Word{0} : BitVector::Word{0});
+    if (value && length % BitVector::WORD_BITS != 0) {
+        out[words - 1] = (BitVector::Word{1} << (length % BitVector::WORD_BITS)) - 1;
+    }
+}
+
+static NumericVectorType toNumericVector(const GenericValue &value) {
+    return std::visit([](const auto &view) { return NumericVectorType(view.begin(), view.end()); },
+                      GET_NUMERIC_VIEW(value));
+}
+
+template<typename Machine>
+void Executor::parallelScan(const Machine &machine, const std::size_t size, BoolVectorType &result) const {
+    using State = typename Machine::State;
+    const std::size_t chunks = ThreadPool::morselCount(size, MORSEL_SIZE);
+    if (pool_->size() == 1 || chunks <= 1) {
+        machine.scan(1, size, State{}, &result);
+        return;
+    }
+
+    // Pass 1: rows after a chunk's first sync row do not depend on earlier chunks and are final.
+    // Chunks without a sync row are summarized as a transfer function instead.
+    std::vector<std::size_t> syncRow(chunks);
+    std::vector<State> chunkEnd(chunks);
+    std::vector<typename Machine::Transfer> transfer(chunks);
+    parallelFor(size, [&](std::size_t begin, const std::size_t end) {
+        const std::size_t chunk = begin / MORSEL_SIZE;
+        begin = std::max<std::size_t>(begin, 1);
+        std::size_t sync = begin;
+        while (sync < end && !machine.isSync(sync)) {
+            ++sync;
+        }
+        syncRow[chunk] = sync;
+        if (sync < end) {
+            chunkEnd[chunk] = machine.scan(sync + 1, end, State{}, &result);
         } else {
-            if (toValues.contains(valueVec[i])) {
-                cnt++;
-                if (cnt >= threshold) {
-                    result[i] = TRUE;
-                }
-            } else {
-                cnt = 0;
-                findFlag = false;
-            }
-        }
-    }
-}
-
-Executor::Executor(uint32_t num_threads) : num_threads_(num_threads) {
-    REGISTER_OPERATION("EQ", compareOp);
-    REGISTER_OPERATION("NE", compareOp);
-    REGISTER_OPERATION("LT", compareOp);
-    REGISTER_OPERATION("LE", compareOp);
-    REGISTER_OPERATION("GT", compareOp);
-    REGISTER_OPERATION("GE", compareOp);
-    REGISTER_OPERATION("ADD", mathOp);
-    REGISTER_OPERATION("SUB", mathOp);
-    REGISTER_OPERATION("MUL", mathOp);
-    REGISTER_OPERATION("DIV", mathOp);
-    REGISTER_OPERATION("POW", mathOp);
-    REGISTER_OPERATION("ABS", absOp);
-    REGISTER_OPERATION("AND", logicalOp);
-    REGISTER_OPERATION("OR", logicalOp);
-    REGISTER_OPERATION("COUNT", countOp);
-    REGISTER_OPERATION("MAX", aggregateOp);
-    REGISTER_OPERATION("MIN", aggregateOp);
-    REGISTER_OPERATION("AVG", aggregateOp);
-    REGISTER_OPERATION("JUMP", jumpOp);
-    REGISTER_OPERATION("BEFORE", beforeOp);
-    REGISTER_OPERATION("AFTER", afterOp);
-    REGISTER_OPERATION("HOLD", holdOp);
-    REGISTER_OPERATION("DURATION", durationOp);
-    REGISTER_OPERATION("SELECT", selectOp);
-}
-
-bool Executor::isSameType(const std::vector<GenericValue> &vector, const ValueType type) {
+            transfer[chunk] = machine.summarize(begin, end);
+        }
+    });
+
+    // Pass 2: carry the state across chunk boundaries, O(number of chunks).
+    std::vector<State> carry(chunks);
+    for (std::size_t chunk = 0; chunk + 1 < chunks; ++chunk) {
+        const std::size_t end = std::min((chunk + 1) * MORSEL_SIZE, size);
+        carry[chunk + 1] = syncRow[chunk] < end ? chunkEnd[chunk] : Machine::apply(transfer[chunk], carry[chunk]);
+    }
+
+    // Pass 3: rescan each chunk up to and including its first sync row from the real carry-in.
+    parallelFor(size, [&](std::size_t begin, const std::size_t end) {
+        const std::size_t chunk = begin / MORSEL_SIZE;
+        begin = std::max<std::size_t>(begin, 1);
+        machine.scan(begin, std::min(syncRow[chunk] + 1, end), carry[chunk], &result);
+    });
+}
+
+Executor::Executor(uint32_t num_threads)
+    : num_threads_(num_threads), pool_(std::make_unique<ThreadPool>(num_threads)),
+      buffers_(std::make_unique<BufferPool>()) {
+}
+
+bool Executor::isSameType(const std::vector<const GenericValue *> &vector, const ValueType type) {
     switch (type) {
         case ValueType::BOOL_TYPE:
-            return std::ranges::all_of(vector, [](const GenericValue &val) {
-                return holdsBool(val);
+            return std::ranges::all_of(vector, [](const GenericValue *val) {
+                return holdsBool(*val);
             });
         case ValueType::NUMERIC_TYPE:
-            return std::ranges::all_of(vector, [](const GenericValue &val) {
-                return holdsNumeric(val);
+            return std::ranges::all_of(vector, [](const GenericValue *val) {
+                return holdsNumeric(*val);
             });
         case ValueType::BOOL_VECTOR_TYPE:
-            return std::ranges::all_of(vector, [](const GenericValue &val) {
-                return holdsBoolVector(val);
+            return std::ranges::all_of(vector, [](const GenericValue *val) {
+                return holdsBoolVector(*val);
             });
         case ValueType::NUMERIC_VECTOR_TYPE:
-            return std::ranges::all_of(vector, [](const GenericValue &val) {
-                return holdsNumericVector(val);
+            return std::ranges::all_of(vector, [](const GenericValue *val) {
+                return holdsNumericVector(*val);
+            });
+        case ValueType::NUMERIC_VIEW_TYPE:
+            return std::ranges::all_of(vector, [](const GenericValue *val) {
+                return holdsNumericView(*val);
             });
         default:
             throw std::runtime_error("Unknown ValueType");
     }
 }
 
-bool Executor::isSameLength(const std::vector<GenericValue> &vector) {
+bool Executor::isSameLength(const std::vector<const GenericValue *> &vector) {
     if (vector.size() <= 1) {
         return true;
     }
     bool result = true;
     if (isSameType(vector, ValueType::BOOL_VECTOR_TYPE)) {
-        const std::size_t size = GET_BOOL_VECTOR(vector[0]).size();
-        for (const auto &elem: vector) {
-            if (GET_BOOL_VECTOR(elem).size() != size) {
+        const std::size_t size = GET_BOOL_VECTOR(*vector[0]).size();
+        for (const auto *elem: vector) {
+            if (GET_BOOL_VECTOR(*elem).size() != size) {
                 result = false;
                 break;
             }
         }
     } else if (isSameType(vector, ValueType::NUMERIC_VECTOR_TYPE)) {
-        const std::size_t size = GET_NUMERIC_VECTOR(vector[0]).size();
-        for (const auto &elem: vector) {
-            if (GET_NUMERIC_VECTOR(elem).size() != size) {
+        const std::size_t size = GET_NUMERIC_VECTOR(*vector[0]).size();
+        for (const auto *elem: vector) {
+            if (GET_NUMERIC_VECTOR(*elem).size() != size) {
                 result = false;
                 break;
             }
@@ -180,38 +238,704 @@ bool Executor::isSameLength(const std::vector<GenericValue> &vector) {
 }
 
 GenericValue Executor::run(const Query &query) {
-    const std::string type = getQueryType(query);
+    return run(CompiledQuery::compile(query));
+}
+
+GenericValue Executor::run(const CompiledQuery &plan) {
+    return std::move(runBatch(plan).front());
+}
+
+std::vector<GenericValue> Executor::runBatch(const std::span<const Query *const> queries) {
+    return runBatch(CompiledQuery::compileBatch(queries));
+}
+
+std::vector<GenericValue> Executor::runBatch(const CompiledQuery &plan) {
+    return execute(plan, nullptr, nullptr);
+}
 
-    if (type == "operation") {
-        const std::string operatorString = getQueryOperation(query);
-        if (!operationMap_.contains(operatorString)) {
-            throw std::runtime_error("Unknown operation: " + operatorString);
+std::vector<GenericValue> Executor::runProfiled(QueryProfile &profile) {
+    if (!profile.countsHardwareEvents()) {
+        return execute(profile.plan(), &profile, nullptr);
+    }
+    // Operators run on the calling thread and the pool workers.
+    std::vector<int64_t> threads = {currentSystemThreadId()};
+    threads.insert(threads.end(), pool_->workerThreadIds().begin(), pool_->workerThreadIds().end());
+    const HardwareCounters counters(threads);
+    for (std::size_t k = 0; k < COUNTER_EVENTS; ++k) {
+        profile.counted_[k] = counters.counts(static_cast<CounterEvent>(k));
+    }
+    return execute(profile.plan(), &profile, &counters);
+}
+
+// Rows of a bool[] or numeric[] value, 1 for a scalar.
+static std::size_t rowsOf(const GenericValue &value) {
+    if (Executor::holdsBoolVector(value)) {
+        return std::get<BoolVectorType>(value).size();
+    }
+    if (Executor::holdsNumericArray(value)) {
+        return Executor::visitNumericArray(value, [](const auto &vec) { return vec.size(); });
+    }
+    return 1;
+}
+
+std::vector<GenericValue> Executor::execute(const CompiledQuery &plan, QueryProfile *profile,
+                                            const HardwareCounters *counters) {
+    const auto &nodes = plan.nodes();
+    const std::vector<uint32_t> columnBinding = bindColumns(plan);
+
+    // Constants are referenced straight from the plan, only operation results are owned here.
+    std::vector<GenericValue> results(nodes.size());
+    std::vector<const GenericValue *> values(nodes.size(), nullptr);
+    std::size_t liveBytes = 0;
+    peakBytes_ = 0;
+    using Clock = std::chrono::steady_clock;
+
+    // Adds what evaluating node i from started and before on cost to the profile; inputs are the operands
+    // it read.
+    const auto record = [&](const uint32_t i, const Clock::time_point started, const CounterValues &before,
+                            const std::vector<uint32_t> &inputs) {
+        NodeProfile &stats = profile->node(i);
+        stats.nanoseconds += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started).count());
+        if (counters != nullptr) {
+            const CounterValues after = counters->read();
+            for (std::size_t k = 0; k < COUNTER_EVENTS; ++k) {
+                stats.counters[k] += after[k] - before[k];
+            }
+        }
+        ++stats.executions;
+        std::size_t rowsIn = 0;
+        for (const uint32_t input: inputs) {
+            if (nodes[input].kind == NodeKind::OPERATION) {
+                // Run-length encoded columns are not expanded, see runLengthOp, but span the data source.
+                rowsIn = std::max(rowsIn, values[input] != nullptr ? rowsOf(*values[input]) : data->getRowCount());
+            }
+        }
+        const GenericValue &result = results[i];
+        stats.rowsIn += nodes[i].op == OperatorEnum::SELECT ? rowsOf(result) : rowsIn;
+        stats.rowsOut += rowsOf(result);
+        stats.bytes += storageBytes(result);
+        if (holdsBoolVector(result)) {
+            stats.boolRows = true;
+            stats.trueRows += std::get<BoolVectorType>(result).count();
+        }
+    };
+
+    // Deferred nodes are evaluated by the AND/OR they feed, and only if it still needs them.
+    std::vector<bool> evaluated(nodes.size(), false);
+    std::function<void(uint32_t)> evaluateNode;
+    const auto ensureOperand = [&](const uint32_t i, const std::size_t k) {
+        for (const uint32_t deferred: plan.deferredFor(i, k)) {
+            if (!evaluated[deferred]) {
+                evaluateNode(deferred);
+            }
+        }
+    };
+
+    evaluateNode = [&](const uint32_t i) {
+        const PlanNode &node = nodes[i];
+        evaluated[i] = true;
+        const CounterValues before = counters != nullptr ? counters->read() : CounterValues{};
+        const Clock::time_point started = profile != nullptr ? Clock::now() : Clock::time_point{};
+        const std::function<void(std::size_t)> ensure = [&](const std::size_t k) { ensureOperand(i, k); };
+        if (node.kind == NodeKind::CONSTANT) {
+            values[i] = &node.constant;
+        } else if (node.group != NO_GROUP) {
+            // Inner nodes of a fused group are computed block-wise together with its root.
+            const FusedGroup &group = plan.groups()[node.group];
+            if (group.nodes.back() == i) {
+                results[i] = evaluateFused(plan, group, results, values, columnBinding, ensure);
+                values[i] = &results[i];
+                // Inner nodes only hold results when the group fell back to per-operator evaluation.
+                for (const uint32_t member: group.nodes) {
+                    liveBytes += storageBytes(results[member]);
+                }
+                if (profile != nullptr) {
+                    for (const uint32_t member: group.nodes) {
+                        if (member != i) {
+                            ++profile->node(member).executions;
+                        }
+                    }
+                    record(i, started, before, group.inputs);
+                }
+            }
+        } else if (node.op == OperatorEnum::SELECT && plan.readsRuns(i) &&
+                   data->getRunLengthColumn(columnBinding[node.column]) != nullptr) {
+            // Left unexpanded, its consumers read the runs.
+            return;
+        } else {
+            const bool readsRuns = !node.inputs.empty() && values[node.inputs[0]] == nullptr;
+            bool deferring = false;
+            for (std::size_t k = 0; k < node.inputs.size(); ++k) {
+                deferring = deferring || !plan.deferredFor(i, k).empty();
+            }
+            if (readsRuns) {
+                results[i] = runLengthOp(node, *data->getRunLengthColumn(columnBinding[nodes[node.inputs[0]].column]),
+                                         values);
+            } else if (deferring) {
+                results[i] = logicalShortCircuit(node, values, ensure);
+            } else if (const ZoneMap *zones = isCompare(node.op) ? columnZones(plan, node.inputs[0], columnBinding)
+                                                                : nullptr; zones != nullptr) {
+                results[i] = compareOp(node.op, *values[node.inputs[0]], *values[node.inputs[1]], zones);
+            } else if (const RangeIndex *index = isRangeAggregate(node)
+                                                     ? columnRangeIndex(plan, node.inputs[0], columnBinding)
+                                                     : nullptr; index != nullptr) {
+                results[i] = aggregateOp(node.op, *values[node.inputs[0]], *values[node.inputs[1]],
+                                         *values[node.inputs[2]], index);
+            } else {
+                results[i] = evaluate(node, values, columnBinding);
+            }
+            values[i] = &results[i];
+            liveBytes += storageBytes(results[i]);
+            if (profile != nullptr) {
+                record(i, started, before, node.inputs);
+            }
+        }
+        peakBytes_ = std::max(peakBytes_, liveBytes);
+    };
+
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        if (plan.isDeferred(i)) {
+            continue;
+        }
+        evaluateNode(i);
+
+        // Intermediates that no later node reads go back to the pool for the operators that follow.
+        for (const uint32_t dead: plan.releases(i)) {
+            liveBytes -= storageBytes(results[dead]);
+            buffers_->release(std::move(results[dead]));
+            results[dead] = GenericValue{};
+            values[dead] = nullptr;
         }
-        GenericValue returnValue = operationMap_[operatorString](query);
-        return returnValue;
     }
 
-    if (type == "value") {
-        if (query["value"].IsNumber()) {
-            NumericType returnValue = query["value"].GetDouble();
-            return returnValue;
+    // Identical queries share a root, whose result is copied for all but the last of them.
+    std::vector<uint32_t> pending(nodes.size(), 0);
+    for (const uint32_t root: plan.roots()) {
+        ++pending[root];
+    }
+    std::vector<GenericValue> outputs;
+    outputs.reserve(plan.roots().size());
+    for (const uint32_t root: plan.roots()) {
+        if (nodes[root].kind == NodeKind::CONSTANT) {
+            outputs.emplace_back(nodes[root].constant);
+        } else if (holdsNumericView(results[root])) {
+            // Views must not outlive the data source, so a bare SELECT result is copied out as numeric[].
+            outputs.emplace_back(toNumericVector(results[root]));
+        } else if (--pending[root] > 0) {
+            outputs.emplace_back(results[root]);
+        } else {
+            // Pooled storage leaves with the result and is never handed back, so it is cut to size.
+            outputs.emplace_back(buffers_->fit(std::move(results[root])));
         }
-        if (query["value"].IsArray()) {
-            NumericVectorType returnValue;
-            for (const auto &elem: query["value"].GetArray()) {
-                returnValue.emplace_back(elem.GetDouble());
+    }
+    return outputs;
+}
+
+GenericValue Executor::evaluate(const PlanNode &node, const std::vector<const GenericValue *> &values,
+                                const std::vector<uint32_t> &columnBinding) const {
+    const auto arg = [&](const std::size_t pos) -> const GenericValue & {
+        return *values[node.inputs[pos]];
+    };
+
+    switch (node.op) {
+        case OperatorEnum::EQ:
+        case OperatorEnum::NE:
+        case OperatorEnum::LT:
+        case OperatorEnum::LE:
+        case OperatorEnum::GT:
+        case OperatorEnum::GE:
+            return compareOp(node.op, arg(0), arg(1));
+        case OperatorEnum::ADD:
+        case OperatorEnum::SUB:
+        case OperatorEnum::MUL:
+        case OperatorEnum::DIV:
+        case OperatorEnum::POW:
+            return mathOp(node.op, arg(0), arg(1));
+        case OperatorEnum::ABS:
+            return absOp(arg(0));
+        case OperatorEnum::AND:
+        case OperatorEnum::OR: {
+            std::vector<const GenericValue *> operands;
+            operands.reserve(node.inputs.size());
+            for (const uint32_t input: node.inputs) {
+                operands.emplace_back(values[input]);
             }
-            return returnValue;
+            return logicalOp(node.op, operands);
         }
+        case OperatorEnum::NOT:
+            return notOp(arg(0));
+        case OperatorEnum::COUNT:
+            if (node.inputs.size() == 6) {
+                return countOp(arg(0), arg(1), arg(2), arg(3), arg(4), arg(5));
+            }
+            if (node.inputs.size() == 5) {
+                return countOp(arg(0), arg(1), arg(2), arg(3), arg(4));
+            }
+            return countOp(arg(0), arg(1), arg(2));
+        case OperatorEnum::MAX:
+        case OperatorEnum::MIN:
+        case OperatorEnum::AVG:
+        case OperatorEnum::SUM:
+            if (node.inputs.size() == 4) {
+                return aggregateOp(node.op, arg(0), arg(1), arg(2), arg(3));
+            }
+            if (node.inputs.size() == 3) {
+                return aggregateOp(node.op, arg(0), arg(1), arg(2));
+            }
+            return aggregateOp(node.op, arg(0));
+        case OperatorEnum::ROLLING_MAX:
+        case OperatorEnum::ROLLING_MIN:
+        case OperatorEnum::ROLLING_AVG:
+        case OperatorEnum::ROLLING_SUM:
+        case OperatorEnum::ROLLING_COUNT:
+            return rollingOp(node.op, arg(0), arg(1));
+        case OperatorEnum::SEGMENT_AGG:
+            return segmentOp(arg(0), arg(1));
+        case OperatorEnum::JUMP:
+            return jumpOp(arg(0), arg(1), arg(2));
+        case OperatorEnum::BEFORE:
+            return beforeOp();
+        case OperatorEnum::AFTER:
+            return afterOp(arg(0), arg(1), arg(2), arg(3));
+        case OperatorEnum::HOLD:
+            return holdOp(arg(0), arg(1), arg(2), arg(3));
+        case OperatorEnum::DURATION:
+            return durationOp(arg(0), arg(1));
+        case OperatorEnum::SELECT:
+            return selectOp(columnBinding[node.column]);
+    }
+
+    throw std::runtime_error("Unknown operation");
+}
 
-        throw std::runtime_error("Invalid type inside value");
+// Per-block view of a value inside a fused group.
+enum class FusedShape {
+    NUMERIC, // numeric constant, used for every row
+    NUMERIC_ARRAY,
+    BOOL_ARRAY,
+    UNSUPPORTED
+};
+
+struct FusedRegister {
+    FusedShape shape{FusedShape::UNSUPPORTED};
+    NumericType scalar{0};
+    const NumericType *numeric{nullptr};
+    const BitVector::Word *bits{nullptr};
+    std::size_t scratch{0}; // slot in the morsel's numeric or bit scratch
+    const ZoneMap *zones{nullptr}; // of the column, for an input that is a SELECT
+};
+
+static constexpr std::size_t KERNEL_BLOCK_WORDS = KERNEL_BLOCK / BitVector::WORD_BITS;
+
+static FusedShape fusedShapeOf(const GenericValue &value) {
+    if (Executor::holdsNumeric(value)) {
+        return FusedShape::NUMERIC;
     }
+    if (Executor::holdsNumericArray(value)) {
+        return FusedShape::NUMERIC_ARRAY;
+    }
+    if (Executor::holdsBoolVector(value)) {
+        return FusedShape::BOOL_ARRAY;
+    }
+    return FusedShape::UNSUPPORTED;
+}
 
-    throw std::runtime_error("Unknown type: " + type);
+// Result shape of a fused node, UNSUPPORTED where the operator would reject its operands.
+static FusedShape fusedResultShape(const OperatorEnum op, const std::vector<FusedShape> &operands) {
+    const auto all = [&](const FusedShape shape) {
+        return !operands.empty() && std::ranges::all_of(operands, [&](const FusedShape s) { return s == shape; });
+    };
+    const bool numericOperands = operands.size() == 2 && operands[0] == FusedShape::NUMERIC_ARRAY &&
+                                 (operands[1] == FusedShape::NUMERIC || operands[1] == FusedShape::NUMERIC_ARRAY);
+    switch (op) {
+        case OperatorEnum::EQ:
+        case OperatorEnum::NE:
+        case OperatorEnum::LT:
+        case OperatorEnum::LE:
+        case OperatorEnum::GT:
+        case OperatorEnum::GE:
+            return numericOperands ? FusedShape::BOOL_ARRAY : FusedShape::UNSUPPORTED;
+        case OperatorEnum::ADD:
+        case OperatorEnum::SUB:
+        case OperatorEnum::MUL:
+        case OperatorEnum::DIV:
+        case OperatorEnum::POW:
+            return numericOperands ? FusedShape::NUMERIC_ARRAY : FusedShape::UNSUPPORTED;
+        case OperatorEnum::ABS:
+            return operands.size() == 1 && all(FusedShape::NUMERIC_ARRAY)
+                       ? FusedShape::NUMERIC_ARRAY
+                       : FusedShape::UNSUPPORTED;
+        case OperatorEnum::NOT:
+            return operands.size() == 1 && all(FusedShape::BOOL_ARRAY)
+                       ? FusedShape::BOOL_ARRAY
+                       : FusedShape::UNSUPPORTED;
+        case OperatorEnum::AND:
+        case OperatorEnum::OR:
+            return all(FusedShape::BOOL_ARRAY) ? FusedShape::BOOL_ARRAY : FusedShape::UNSUPPORTED;
+        default:
+            return FusedShape::UNSUPPORTED;
+    }
 }
 
+// Runs one bool[] producing node of a fused group over a block, writing wordCount(length) words.
+static void runFusedBool(const OperatorEnum op, const std::vector<FusedRegister> &registers,
+                         const std::vector<uint32_t> &operands, const std::size_t length, BitVector::Word *out) {
+    const std::size_t words = BitVector::wordCount(length);
+    switch (op) {
+        case OperatorEnum::NOT: {
+            const BitVector::Word *in = registers[operands[0]].bits;
+            for (std::size_t w = 0; w < words; ++w) {
+                out[w] = ~in[w];
+            }
+            // Only the last block of a vector can be partial; its padding bits must stay zero.
+            if (length % BitVector::WORD_BITS != 0) {
+                out[words - 1] &= (BitVector::Word{1} << (length % BitVector::WORD_BITS)) - 1;
+            }
+            return;
+        }
+        case OperatorEnum::AND:
+        case OperatorEnum::OR: {
+            std::copy_n(registers[operands[0]].bits, words, out);
+            for (std::size_t k = 1; k < operands.size(); ++k) {
+                const BitVector::Word *in = registers[operands[k]].bits;
+                for (std::size_t w = 0; w < words; ++w) {
+                    out[w] = op == OperatorEnum::AND ? logicalAnd(out[w], in[w]) : logicalOr(out[w], in[w]);
+                }
+            }
+            return;
+        }
+        default: {
+            const FusedRegister &left = registers[operands[0]];
+            const FusedRegister &right = registers[operands[1]];
+            compareKernel(op, left.numeric, right.shape == FusedShape::NUMERIC ? nullptr : right.numeric,
+                          right.scalar, length, out);
+        }
+    }
+}
+
+// Runs one numeric[] producing node of a fused group over a block.
+static void runFusedNumeric(const OperatorEnum op, const std::vector<FusedRegister> &registers,
+                            const std::vector<uint32_t> &operands, const std::size_t length, NumericType *out) {
+    if (op == OperatorEnum::ABS) {
+        absKernel(registers[operands[0]].numeric, length, out);
+        return;
+    }
+    const FusedRegister &left = registers[operands[0]];
+    const FusedRegister &right = registers[operands[1]];
+    mathKernel(op, left.numeric, right.shape == FusedShape::NUMERIC ? nullptr : right.numeric, right.scalar,
+               length, out);
+}
+
+// A compare of a column with a constant on a block of rows that the column's zone map decides.
+static std::optional<bool> fusedZoneVerdict(const OperatorEnum op, const std::vector<FusedRegister> &registers,
+                                            const std::vector<uint32_t> &operands, const std::size_t block) {
+    if (!isCompare(op) || registers[operands[0]].zones == nullptr ||
+        registers[operands[1]].shape != FusedShape::NUMERIC) {
+        return std::nullopt;
+    }
+    return zoneVerdict(*registers[operands[0]].zones, block / ZoneMap::BLOCK_ROWS, op, registers[operands[1]].scalar);
+}
+
+// True if every row of a block of an AND result is FALSE, or of an OR result TRUE, so the operands
+// that follow cannot change it.
+static bool blockDecided(const OperatorEnum op, const BitVector::Word *words, const std::size_t length) {
+    const std::size_t full = length / BitVector::WORD_BITS;
+    const BitVector::Word decided = op == OperatorEnum::AND ? 0 : ~BitVector::Word{0};
+    for (std::size_t w = 0; w < full; ++w) {
+        if (words[w] != decided) {
+            return false;
+        }
+    }
+    const std::size_t rest = length % BitVector::WORD_BITS;
+    return rest == 0 || words[full] == (decided & ((BitVector::Word{1} << rest) - 1));
+}
+
+GenericValue Executor::evaluateFused(const CompiledQuery &plan, const FusedGroup &group,
+                                     std::vector<GenericValue> &results, std::vector<const GenericValue *> &values,
+                                     const std::vector<uint32_t> &columnBinding,
+                                     const std::function<void(std::size_t)> &ensure) const {
+    const auto &nodes = plan.nodes();
+    const std::size_t inputCount = group.inputs.size();
+    const uint32_t root = group.nodes.back();
+    const OperatorEnum rootOp = nodes[root].op;
+
+    // One register per group input followed by one per group node. Intermediate results live in
+    // block-sized scratch slots; the root writes straight into the result.
+    std::vector<FusedRegister> registers(inputCount + group.nodes.size());
+    std::unordered_map<uint32_t, std::size_t> registerOf;
+    std::vector<std::vector<uint32_t>> operands(group.nodes.size());
+    for (std::size_t k = 0; k < inputCount; ++k) {
+        registerOf.emplace(group.inputs[k], k);
+    }
+    for (std::size_t j = 0; j < group.nodes.size(); ++j) {
+        registerOf.emplace(group.nodes[j], inputCount + j);
+        for (const uint32_t input: nodes[group.nodes[j]].inputs) {
+            operands[j].emplace_back(static_cast<uint32_t>(registerOf.at(input)));
+        }
+    }
+
+    /*
+     * An AND/OR root short-circuits: its operands are evaluated one after another in each block, and
+     * the ones after a block whose result is decided are skipped there. Operands that read deferred
+     * nodes start a new pass over the rows, which only runs if the result so far is not decided
+     * everywhere. Other roots run as a single operand, the root itself.
+     */
+    const bool shortCircuit = rootOp == OperatorEnum::AND || rootOp == OperatorEnum::OR;
+    struct Operand {
+        std::size_t reg{0};
+        std::vector<std::size_t> members{}; // positions in group.nodes of its subtree, in plan order
+    };
+    std::vector<std::vector<Operand>> passes(1);
+    if (shortCircuit) {
+        for (std::size_t k = 0; k < nodes[root].inputs.size(); ++k) {
+            Operand operand{registerOf.at(nodes[root].inputs[k])};
+            std::vector<bool> reached(group.nodes.size(), false);
+            if (operand.reg >= inputCount) {
+                reached[operand.reg - inputCount] = true;
+            }
+            for (std::size_t j = group.nodes.size(); j-- > 0;) {
+                if (reached[j]) {
+                    for (const uint32_t reg: operands[j]) {
+                        if (reg >= inputCount) {
+                            reached[reg - inputCount] = true;
+                        }
+                    }
+                }
+            }
+            for (std::size_t j = 0; j < group.nodes.size(); ++j) {
+                if (reached[j]) {
+                    operand.members.emplace_back(j);
+                }
+            }
+            if (k > 0 && !plan.deferredFor(root, k).empty()) {
+                passes.emplace_back();
+            }
+            passes.back().emplace_back(std::move(operand));
+        }
+    } else {
+        Operand operand{inputCount + group.nodes.size() - 1};
+        for (std::size_t j = 0; j < group.nodes.size(); ++j) {
+            operand.members.emplace_back(j);
+        }
+        passes.back().emplace_back(std::move(operand));
+    }
+
+    std::size_t length = 0;
+    bool hasLength = false;
+    std::size_t numericSlots = 0;
+    std::size_t bitSlots = 0;
+    std::vector<std::size_t> passInputs;
+
+    // Sets up the registers of the inputs and nodes pass reads; false if the fused kernels do not cover them.
+    const auto prepare = [&](const std::vector<Operand> &pass) {
+        numericSlots = 0;
+        bitSlots = 0;
+        passInputs.clear();
+        std::vector<bool> used(registers.size(), false);
+        for (const Operand &operand: pass) {
+            used[operand.reg] = true;
+            for (const std::size_t j: operand.members) {
+                used[inputCount + j] = true;
+                for (const uint32_t reg: operands[j]) {
+                    used[reg] = true;
+                }
+            }
+        }
+        bool supported = true;
+        for (std::size_t k = 0; k < inputCount; ++k) {
+            if (!used[k]) {
+                continue;
+            }
+            passInputs.emplace_back(k);
+            const GenericValue &value = *values[group.inputs[k]];
+            FusedRegister &reg = registers[k];
+            reg.shape = fusedShapeOf(value);
+            reg.zones = columnZones(plan, group.inputs[k], columnBinding);
+            if (reg.shape == FusedShape::NUMERIC) {
+                reg.scalar = GET_NUMERIC(value);
+            } else if (reg.shape != FusedShape::UNSUPPORTED) {
+                const std::size_t size = reg.shape == FusedShape::BOOL_ARRAY
+                                             ? GET_BOOL_VECTOR(value).size()
+                                             : visitNumericArray(value, [](const auto &vec) { return vec.size(); });
+                supported = supported && (!hasLength || size == length);
+                length = size;
+                hasLength = true;
+                reg.scratch = reg.shape == FusedShape::NUMERIC_ARRAY ? numericSlots++ : 0;
+            }
+        }
+        for (std::size_t j = 0; j < group.nodes.size(); ++j) {
+            if (!used[inputCount + j]) {
+                continue;
+            }
+            std::vector<FusedShape> shapes;
+            for (const uint32_t reg: operands[j]) {
+                shapes.emplace_back(registers[reg].shape);
+            }
+            FusedRegister &reg = registers[inputCount + j];
+            reg.shape = fusedResultShape(nodes[group.nodes[j]].op, shapes);
+            supported = supported && reg.shape != FusedShape::UNSUPPORTED;
+            if (group.nodes[j] != root) {
+                reg.scratch = reg.shape == FusedShape::BOOL_ARRAY ? bitSlots++ : numericSlots++;
+            }
+        }
+        if (shortCircuit) {
+            for (const Operand &operand: pass) {
+                supported = supported && registers[operand.reg].shape == FusedShape::BOOL_ARRAY;
+            }
+        }
+        return supported;
+    };
+
+    BoolVectorType bitResult;
+    NumericVectorType numericResult;
+
+    // Runs the operands of pass over every block, into the root result.
+    const auto run = [&](const std::vector<Operand> &pass, const bool first) {
+        const auto resultWords = bitResult.words();
+        parallelFor(length, [&](const std::size_t begin, const std::size_t end) {
+            std::vector<NumericType> numericScratch(numericSlots * KERNEL_BLOCK);
+            std::vector<BitVector::Word> bitScratch(bitSlots * KERNEL_BLOCK_WORDS);
+            std::vector<FusedRegister> regs = registers;
+            std::vector<bool> done(group.nodes.size());
+            std::vector<bool> loaded(inputCount);
+            forEachBlock(begin, end, [&](const std::size_t block, const std::size_t blockLength) {
+                BitVector::Word *resultBlock = resultWords.data() + block / BitVector::WORD_BITS;
+                const std::size_t words = BitVector::wordCount(blockLength);
+                if (shortCircuit && !first && blockDecided(rootOp, resultBlock, blockLength)) {
+                    return;
+                }
+                // Inputs are only read for the nodes that run on this block.
+                const auto load = [&](const std::size_t k) {
+                    FusedRegister &reg = regs[k];
+                    const GenericValue &value = *values[group.inputs[k]];
+                    if (reg.shape == FusedShape::NUMERIC_ARRAY) {
+                        NumericType *scratch = numericScratch.data() + reg.scratch * KERNEL_BLOCK;
+                        reg.numeric = visitNumericArray(value, [&]<typename T>(const std::span<const T> vec) {
+                            return asNumeric(vec, block, blockLength, scratch);
+                        });
+                    } else if (reg.shape == FusedShape::BOOL_ARRAY) {
+                        reg.bits = GET_BOOL_VECTOR(value).words().data() + block / BitVector::WORD_BITS;
+                    }
+                    loaded[k] = true;
+                };
+                std::fill(loaded.begin(), loaded.end(), false);
+                std::fill(done.begin(), done.end(), false);
+                for (std::size_t o = 0; o < pass.size(); ++o) {
+                    if (shortCircuit && (!first || o > 0) && blockDecided(rootOp, resultBlock, blockLength)) {
+                        return;
+                    }
+                    for (const std::size_t j: pass[o].members) {
+                        if (done[j]) {
+                            continue;
+                        }
+                        done[j] = true;
+                        FusedRegister &reg = regs[inputCount + j];
+                        const OperatorEnum op = nodes[group.nodes[j]].op;
+                        const bool isRoot = group.nodes[j] == root;
+                        const std::optional<bool> verdict = fusedZoneVerdict(op, regs, operands[j], block);
+                        for (const uint32_t operand: operands[j]) {
+                            if (operand < inputCount && !loaded[operand] && !verdict.has_value()) {
+                                load(operand);
+                            }
+                        }
+                        if (reg.shape == FusedShape::BOOL_ARRAY) {
+                            BitVector::Word *out = isRoot
+                                                       ? resultBlock
+                                                       : bitScratch.data() + reg.scratch * KERNEL_BLOCK_WORDS;
+                            if (verdict.has_value()) {
+                                fillBlock(out, blockLength, *verdict);
+                            } else {
+                                runFusedBool(op, regs, operands[j], blockLength, out);
+                            }
+                            reg.bits = out;
+                        } else {
+                            NumericType *out = isRoot
+                                                   ? numericResult.data() + block
+                                                   : numericScratch.data() + reg.scratch * KERNEL_BLOCK;
+                            runFusedNumeric(op, regs, operands[j], blockLength, out);
+                            reg.numeric = out;
+                        }
+                    }
+                    if (!shortCircuit) {
+                        continue;
+                    }
+                    if (pass[o].reg < inputCount && !loaded[pass[o].reg]) {
+                        load(pass[o].reg);
+                    }
+                    const BitVector::Word *in = regs[pass[o].reg].bits;
+                    if (first && o == 0) {
+                        std::copy_n(in, words, resultBlock);
+                    } else {
+                        for (std::size_t w = 0; w < words; ++w) {
+                            resultBlock[w] = rootOp == OperatorEnum::AND
+                                                 ? logicalAnd(resultBlock[w], in[w])
+                                                 : logicalOr(resultBlock[w], in[w]);
+                        }
+                    }
+                }
+            });
+        });
+    };
+
+    for (std::size_t p = 0; p < passes.size(); ++p) {
+        if (p > 0) {
+            const std::size_t trueRows = bitResult.count();
+            if (trueRows == (rootOp == OperatorEnum::AND ? 0 : bitResult.size())) {
+                // Decided for every row: the deferred operands are never evaluated.
+                break;
+            }
+            for (std::size_t k = 0; k < nodes[root].inputs.size(); ++k) {
+                ensure(k);
+            }
+        }
+        if (!prepare(passes[p])) {
+            // Let the per-operator path produce the result, or the error it reports for these operands.
+            buffers_->release(std::move(bitResult));
+            for (std::size_t k = 0; k < nodes[root].inputs.size(); ++k) {
+                ensure(k);
+            }
+            for (const uint32_t index: group.nodes) {
+                if (index == root) {
+                    break;
+                }
+                results[index] = evaluate(nodes[index], values, columnBinding);
+                values[index] = &results[index];
+            }
+            return evaluate(nodes[root], values, columnBinding);
+        }
+        if (p == 0) {
+            const bool boolResult = registers.back().shape == FusedShape::BOOL_ARRAY || shortCircuit;
+            bitResult = newBoolVector(boolResult ? length : 0, FALSE);
+            numericResult = newNumericVector(boolResult ? 0 : length, 0);
+        }
+        run(passes[p], p == 0);
+    }
+
+    if (!numericResult.empty() || (!shortCircuit && registers.back().shape == FusedShape::NUMERIC_ARRAY)) {
+        return numericResult;
+    }
+    return bitResult;
+}
+
+static CompareFunction compareFunction(const OperatorEnum op) {
+    static const std::unordered_map<OperatorEnum, CompareFunction> functionMap = {
+        {OperatorEnum::EQ, &compareEqual<NumericType>},
+        {OperatorEnum::NE, &compareNotEqual<NumericType>},
+        {OperatorEnum::LT, &compareLess<NumericType>},
+        {OperatorEnum::GT, &compareGreater<NumericType>},
+        {OperatorEnum::LE, &compareLessEqual<NumericType>},
+        {OperatorEnum::GE, &compareGreaterEqual<NumericType>}
+    };
+
+    if (!functionMap.contains(op)) {
+        throw std::runtime_error("Unknown compare operator");
+    }
+    return functionMap.at(op);
+}
 
-GenericValue Executor::compareOp(const Query &query) {
+GenericValue Executor::compareOp(const OperatorEnum op, const GenericValue &left, const GenericValue &right,
+                                 const ZoneMap *zones) const {
     /*
      * Query format:
      * "type": "operation"
@@ -219,55 +943,62 @@ GenericValue Executor::compareOp(const Query &query) {
      * "left": <left operand>
      * "right": <right operand>
      */
-    static const std::unordered_map<std::string, CompareFunction> functionMap = {
-        {"EQ", &compareEqual<NumericType>},
-        {"NE", &compareNotEqual<NumericType>},
-        {"LT", &compareLess<NumericType>},
-        {"GT", &compareGreater<NumericType>},
-        {"LE", &compareLessEqual<NumericType>},
-        {"GE", &compareGreaterEqual<NumericType>}
-    };
-
-    const std::string op = getQueryOperation(query);
-    if (!functionMap.contains(op)) {
-        throw std::runtime_error("Unknown operator: " + op);
-    }
-    auto &cmp = functionMap.at(op);
-    const GenericValue left = run(query["left"]);
-    const GenericValue right = run(query["right"]);
+    const CompareFunction cmp = compareFunction(op);
 
     if (holdsNumeric(left) && holdsNumeric(right)) {
         BoolType result = cmp(GET_NUMERIC(left), GET_NUMERIC(right)) ? TRUE : FALSE;
         return result;
     }
 
-    if (holdsNumericVector(left) && holdsNumeric(right)) {
-        const auto &leftVector = GET_NUMERIC_VECTOR(left);
+    if (holdsNumericArray(left) && holdsNumeric(right)) {
         const auto rightValue = GET_NUMERIC(right);
-        BoolVectorType result(leftVector.size(), FALSE);
-        for (std::size_t i = 0; i < leftVector.size(); ++i) {
-            result[i] = cmp(leftVector[i], rightValue) ? TRUE : FALSE;
-        }
-        return result;
+        return visitNumericArray(left, [&]<typename T>(const std::span<const T> leftVector) -> GenericValue {
+            BoolVectorType result = newBoolVector(leftVector.size(), FALSE);
+            const auto mask = result.words();
+            parallelFor(leftVector.size(), [&](const std::size_t begin, const std::size_t end) {
+                std::array<NumericType, KERNEL_BLOCK> leftScratch;
+                forEachBlock(begin, end, [&](const std::size_t block, const std::size_t length) {
+                    BitVector::Word *out = mask.data() + block / BitVector::WORD_BITS;
+                    if (zones != nullptr) {
+                        if (const auto verdict = zoneVerdict(*zones, block / ZoneMap::BLOCK_ROWS, op, rightValue)) {
+                            fillBlock(out, length, *verdict);
+                            return;
+                        }
+                    }
+                    compareKernel(op, asNumeric(leftVector, block, length, leftScratch.data()), nullptr, rightValue,
+                                  length, out);
+                });
+            });
+            return result;
+        });
     }
 
-    if (holdsNumericVector(left) && holdsNumericVector(right)) {
-        const auto &leftVector = GET_NUMERIC_VECTOR(left);
-        const auto &rightVector = GET_NUMERIC_VECTOR(right);
-        if (leftVector.size() != rightVector.size()) {
-            throw std::runtime_error("Vector size mismatch");
-        }
-        BoolVectorType result(leftVector.size(), FALSE);
-        for (std::size_t i = 0; i < leftVector.size(); ++i) {
-            result[i] = cmp(leftVector[i], rightVector[i]) ? TRUE : FALSE;
-        }
-        return result;
+    if (holdsNumericArray(left) && holdsNumericArray(right)) {
+        return visitNumericArray(left, [&]<typename L>(const std::span<const L> leftVector) -> GenericValue {
+            return visitNumericArray(right, [&]<typename R>(const std::span<const R> rightVector) -> GenericValue {
+                if (leftVector.size() != rightVector.size()) {
+                    throw std::runtime_error("Vector size mismatch");
+                }
+                BoolVectorType result = newBoolVector(leftVector.size(), FALSE);
+                const auto mask = result.words();
+                parallelFor(leftVector.size(), [&](const std::size_t begin, const std::size_t end) {
+                    std::array<NumericType, KERNEL_BLOCK> leftScratch;
+                    std::array<NumericType, KERNEL_BLOCK> rightScratch;
+                    forEachBlock(begin, end, [&](const std::size_t block, const std::size_t length) {
+                        compareKernel(op, asNumeric(leftVector, block, length, leftScratch.data()),
+                                      asNumeric(rightVector, block, length, rightScratch.data()), 0, length,
+                                      mask.data() + block / BitVector::WORD_BITS);
+                    });
+                });
+                return result;
+            });
+        });
     }
 
     throw std::runtime_error("Unsupported type for compare operator");
 }
 
-GenericValue Executor::mathOp(const Query &query) {
+GenericValue Executor::mathOp(const OperatorEnum op, const GenericValue &left, const GenericValue &right) const {
     /*
      * Query format:
      * "type": "operation"
@@ -275,55 +1006,64 @@ GenericValue Executor::mathOp(const Query &query) {
      * "left": <left operand>
      * "right": <right operand>
      */
-    static const std::unordered_map<std::string, MathFunction> functionMap = {
-        {"ADD", &mathAdd<NumericType>},
-        {"SUB", &mathSub<NumericType>},
-        {"MUL", &mathMul<NumericType>},
-        {"DIV", &mathDiv<NumericType>},
-        {"POW", &mathPow<NumericType>},
+    static const std::unordered_map<OperatorEnum, MathFunction> functionMap = {
+        {OperatorEnum::ADD, &mathAdd<NumericType>},
+        {OperatorEnum::SUB, &mathSub<NumericType>},
+        {OperatorEnum::MUL, &mathMul<NumericType>},
+        {OperatorEnum::DIV, &mathDiv<NumericType>},
+        {OperatorEnum::POW, &mathPow<NumericType>},
     };
 
-    const std::string op = getQueryOperation(query);
     if (!functionMap.contains(op)) {
-        throw std::runtime_error("Unknown operator: " + op);
+        throw std::runtime_error("Unknown math operator");
     }
     auto &func = functionMap.at(op);
 
-    const GenericValue left = run(query["left"]);
-    const GenericValue right = run(query["right"]);
-
     if (holdsNumeric(left) && holdsNumeric(right)) {
         NumericType result = func(GET_NUMERIC(left), GET_NUMERIC(right));
         return result;
     }
 
-    if (holdsNumericVector(left) && holdsNumeric(right)) {
-        const auto &leftVector = GET_NUMERIC_VECTOR(left);
+    if (holdsNumericArray(left) && holdsNumeric(right)) {
         const auto rightValue = GET_NUMERIC(right);
-        NumericVectorType result(leftVector.size(), FALSE);
-        for (std::size_t i = 0; i < leftVector.size(); ++i) {
-            result[i] = func(leftVector[i], rightValue);
-        }
-        return result;
+        return visitNumericArray(left, [&]<typename T>(const std::span<const T> leftVector) -> GenericValue {
+            NumericVectorType result = newNumericVector(leftVector.size(), FALSE);
+            parallelFor(leftVector.size(), [&](const std::size_t begin, const std::size_t end) {
+                std::array<NumericType, KERNEL_BLOCK> leftScratch;
+                forEachBlock(begin, end, [&](const std::size_t block, const std::size_t length) {
+                    mathKernel(op, asNumeric(leftVector, block, length, leftScratch.data()), nullptr, rightValue,
+                               length, result.data() + block);
+                });
+            });
+            return result;
+        });
     }
 
-    if (holdsNumericVector(left) && holdsNumericVector(right)) {
-        const auto &leftVector = GET_NUMERIC_VECTOR(left);
-        const auto &rightVector = GET_NUMERIC_VECTOR(right);
-        if (leftVector.size() != rightVector.size()) {
-            throw std::runtime_error("Vector size mismatch");
-        }
-        NumericVectorType result(leftVector.size(), FALSE);
-        for (std::size_t i = 0; i < leftVector.size(); ++i) {
-            result[i] = func(leftVector[i], rightVector[i]);
-        }
-        return result;
+    if (holdsNumericArray(left) && holdsNumericArray(right)) {
+        return visitNumericArray(left, [&]<typename L>(const std::span<const L> leftVector) -> GenericValue {
+            return visitNumericArray(right, [&]<typename R>(const std::span<const R> rightVector) -> GenericValue {
+                if (leftVector.size() != rightVector.size()) {
+                    throw std::runtime_error("Vector size mismatch");
+                }
+                NumericVectorType result = newNumericVector(leftVector.size(), FALSE);
+                parallelFor(leftVector.size(), [&](const std::size_t begin, const std::size_t end) {
+                    std::array<NumericType, KERNEL_BLOCK> leftScratch;
+                    std::array<NumericType, KERNEL_BLOCK> rightScratch;
+                    forEachBlock(begin, end, [&](const std::size_t block, const std::size_t length) {
+                        mathKernel(op, asNumeric(leftVector, block, length, leftScratch.data()),
+                                   asNumeric(rightVector, block, length, rightScratch.data()), 0, length,
+                                   result.data() + block);
+                    });
+                });
+                return result;
+            });
+        });
     }
 
     throw std::runtime_error("Unsupported type for numeric operation");
 }
 
-GenericValue Executor::absOp(const Query &query) {
+GenericValue Executor::absOp(const GenericValue &value) const {
     /*
      * Query format:
      * "type": "operation"
@@ -331,57 +1071,55 @@ GenericValue Executor::absOp(const Query &query) {
      * "value": <operand>
      */
 
-    const auto value = run(query["value"]);
-
     if (holdsNumeric(value)) {
         NumericType result = std::abs(GET_NUMERIC(value));
         return result;
     }
 
-    if (holdsNumericVector(value)) {
-        const auto &vec = GET_NUMERIC_VECTOR(value);
-        NumericVectorType result(vec.size(), 0);
-        for (std::size_t i = 0; i < vec.size(); ++i) {
-            result[i] = std::abs(vec[i]);
-        }
-        return result;
+    if (holdsNumericArray(value)) {
+        return visitNumericArray(value, [&]<typename T>(const std::span<const T> vec) -> GenericValue {
+            NumericVectorType result = newNumericVector(vec.size(), 0);
+            parallelFor(vec.size(), [&](const std::size_t begin, const std::size_t end) {
+                std::array<NumericType, KERNEL_BLOCK> scratch;
+                forEachBlock(begin, end, [&](const std::size_t block, const std::size_t length) {
+                    absKernel(asNumeric(vec, block, length, scratch.data()), length, result.data() + block);
+                });
+            });
+            return result;
+        });
     }
 
     throw std::runtime_error("Unsupported type for ABS operation");
 }
 
-
-GenericValue Executor::logicalOp(const Query &query) {
+GenericValue Executor::logicalOp(const OperatorEnum op, const std::vector<const GenericValue *> &operands) const {
     /*
      * Query format:
      * "type": "operation"
      * "operation": "AND"/"OR".
      * "operands": [<operand>, <operand>, ...]
      */
-    static const std::unordered_map<std::string, LogicalFunction> functionMap = {
-        {"AND", &logicalAnd<BoolType>},
-        {"OR", &logicalOr<BoolType>}
+    static const std::unordered_map<OperatorEnum, LogicalFunction> functionMap = {
+        {OperatorEnum::AND, &logicalAnd<BoolType>},
+        {OperatorEnum::OR, &logicalOr<BoolType>}
     };
 
-    const auto op = getQueryOperation(query);
     if (!functionMap.contains(op)) {
-        throw std::runtime_error("Unknown operator: " + op);
+        throw std::runtime_error("Unknown logical operator");
     }
     auto &func = functionMap.at(op);
 
-    std::vector<GenericValue> operands;
-    for (const auto &elem: query["operands"].GetArray()) {
-        operands.emplace_back(run(elem));
-    }
-
     if (operands.empty()) {
         throw std::runtime_error("No operands for logical operator");
     }
 
+    // Identity element: TRUE for AND, FALSE for OR.
+    const BoolType identity = op == OperatorEnum::AND ? TRUE : FALSE;
+
     if (isSameType(operands, ValueType::BOOL_TYPE)) {
-        BoolType result = TRUE;
-        for (const auto &operand: operands) {
-            result = func(result, GET_BOOL(operand));
+        BoolType result = identity;
+        for (const auto *operand: operands) {
+            result = func(result, GET_BOOL(*operand));
         }
         return result;
     }
@@ -390,13 +1128,26 @@ GenericValue Executor::logicalOp(const Query &query) {
         if (!isSameLength(operands)) {
             throw std::runtime_error("Operands must have the same length");
         }
-        const std::size_t size = GET_BOOL_VECTOR(operands[0]).size();
-        BoolVectorType result(size, TRUE);
-        for (const auto &elem: operands) {
-            const auto &vec = GET_BOOL_VECTOR(elem);
-            for (std::size_t i = 0; i < size; ++i) {
-                result[i] = func(result[i], vec[i]);
-            }
+        const std::size_t size = GET_BOOL_VECTOR(*operands[0]).size();
+        BoolVectorType result = newBoolVector(size, identity);
+        const auto combine = [&](auto &&wordFunc) {
+            const auto resultWords = result.words();
+            parallelFor(size, [&](const std::size_t begin, const std::size_t end) {
+                const std::size_t first = begin / BitVector::WORD_BITS;
+                const std::size_t last = BitVector::wordCount(end);
+                for (const auto *elem: operands) {
+                    const auto words = GET_BOOL_VECTOR(*elem).words();
+                    for (std::size_t w = first; w < last; ++w) {
+                        resultWords[w] = wordFunc(resultWords[w], words[w]);
+                    }
+                }
+            });
+        };
+        // 64 rows per step; padding bits stay zero because they are zero in every operand.
+        if (op == OperatorEnum::AND) {
+            combine(&logicalAnd<BitVector::Word>);
+        } else {
+            combine(&logicalOr<BitVector::Word>);
         }
         return result;
     }
@@ -404,7 +1155,80 @@ GenericValue Executor::logicalOp(const Query &query) {
     throw std::runtime_error("Operands of logical operators must be of type bool or bool[]");
 }
 
-GenericValue Executor::countOp(const Query &query) {
+GenericValue Executor::logicalShortCircuit(const PlanNode &node, const std::vector<const GenericValue *> &values,
+                                           const std::function<void(std::size_t)> &ensure) const {
+    const BoolType identity = node.op == OperatorEnum::AND ? TRUE : FALSE;
+    BoolVectorType result;
+    for (std::size_t k = 0; k < node.inputs.size(); ++k) {
+        ensure(k);
+        const GenericValue &value = *values[node.inputs[k]];
+        if (!holdsBoolVector(value) || (k > 0 && GET_BOOL_VECTOR(value).size() != result.size())) {
+            // Evaluated in full, for logicalOp to combine or reject.
+            buffers_->release(std::move(result));
+            std::vector<const GenericValue *> operands;
+            for (std::size_t rest = k + 1; rest < node.inputs.size(); ++rest) {
+                ensure(rest);
+            }
+            for (const uint32_t input: node.inputs) {
+                operands.emplace_back(values[input]);
+            }
+            return logicalOp(node.op, operands);
+        }
+        const auto &vec = GET_BOOL_VECTOR(value);
+        if (k == 0) {
+            result = newBoolVector(vec.size(), identity);
+        }
+        const auto words = vec.words();
+        const auto resultWords = result.words();
+        parallelFor(vec.size(), [&](const std::size_t begin, const std::size_t end) {
+            for (std::size_t w = begin / BitVector::WORD_BITS; w < BitVector::wordCount(end); ++w) {
+                resultWords[w] = node.op == OperatorEnum::AND ? logicalAnd(resultWords[w], words[w])
+                                                              : logicalOr(resultWords[w], words[w]);
+            }
+        });
+        if (result.count() == (node.op == OperatorEnum::AND ? 0 : result.size())) {
+            break;
+        }
+    }
+    return result;
+}
+
+GenericValue Executor::notOp(const GenericValue &value) const {
+    /*
+     * Query format:
+     * "type": "operation"
+     * "operation": "NOT"
+     * "value": <operand>
+     */
+    if (holdsBool(value)) {
+        BoolType result = GET_BOOL(value) == TRUE ? FALSE : TRUE;
+        return result;
+    }
+
+    if (holdsBoolVector(value)) {
+        const auto &vec = GET_BOOL_VECTOR(value);
+        BoolVectorType result = newBoolVector(vec.size(), TRUE);
+        const auto words = vec.words();
+        const auto resultWords = result.words();
+        parallelFor(vec.size(), [&](const std::size_t begin, const std::size_t end) {
+            // result starts all TRUE with zero padding, so clearing the input bits keeps the padding zero.
+            for (std::size_t w = begin / BitVector::WORD_BITS; w < BitVector::wordCount(end); ++w) {
+                resultWords[w] &= ~words[w];
+            }
+        });
+        return result;
+    }
+
+    throw std::runtime_error("Operand of NOT must be of type bool or bool[]");
+}
+
+GenericValue Executor::countOp(const GenericValue &value, const GenericValue &initialValue,
+                              const GenericValue &unit) const {
+    return countOp(value, initialValue, unit, NumericType{0}, std::numeric_limits<NumericType>::infinity());
+}
+
+GenericValue Executor::countOp(const GenericValue &value, const GenericValue &initialValue, const GenericValue &unit,
+                               const GenericValue &start, const GenericValue &end) const {
     /*
      * Query format:
      * "type": "operation"
@@ -412,107 +1236,422 @@ GenericValue Executor::countOp(const Query &query) {
      * "value": <operand>
      * "initialValue": <value>
      * "unit": <value>
+     * "start": <value>, optional
+     * "end": <value>, optional
      */
-    const GenericValue value = run(query["value"]);
-    const GenericValue initialValue = run(query["initialValue"]);
-    const GenericValue unit = run(query["unit"]);
-
     if (holdsBoolVector(value) && holdsNumeric(initialValue) && holdsNumeric(unit)) {
         const auto &vec = GET_BOOL_VECTOR(value);
         const auto iVal = GET_NUMERIC(initialValue);
         const auto uVal = GET_NUMERIC(unit);
-        auto result = static_cast<NumericType>(std::ranges::count(vec, TRUE)) * uVal + iVal;
+        const auto [first, last] = rowRange(start, end, vec.size());
+        const auto count = reduceMorsels<std::size_t>(
+            last - first, 0,
+            [&](const std::size_t begin, const std::size_t stop) {
+                return vec.count(first + begin, first + stop);
+            },
+            std::plus<>());
+        auto result = static_cast<NumericType>(count) * uVal + iVal;
         return result;
     }
 
     throw std::runtime_error("Operand of COUNT must be of type bool[]");
 }
 
-GenericValue Executor::aggregateOp(const Query &query) {
+GenericValue Executor::countOp(const GenericValue &value, const GenericValue &initialValue, const GenericValue &unit,
+                               const GenericValue &start, const GenericValue &end, const GenericValue &where) const {
     /*
      * Query format:
      * "type": "operation"
-     * "operation": "MAX"/"MIN"/"AVG"
+     * "operation": "COUNT"
      * "value": <operand>
+     * "initialValue": <value>
+     * "unit": <value>
+     * "start": <value>, optional
+     * "end": <value>, optional
+     * "where": <operand>
      */
-    static const std::unordered_map<std::string, AggregateFunction> functionMap = {
-        {"MAX", &aggregateMax<NumericType>},
-        {"MIN", &aggregateMin<NumericType>},
-        {"AVG", &aggregateAvg<NumericType>},
-    };
+    if (holdsBool(where)) {
+        return GET_BOOL(where) != 0 ? countOp(value, initialValue, unit, start, end)
+                                    : countOp(value, initialValue, unit, start, NumericType{0});
+    }
+    if (!holdsBoolVector(where)) {
+        throw std::runtime_error("Condition of aggregate functions must be of type bool[]");
+    }
+    if (holdsBoolVector(value) && holdsNumeric(initialValue) && holdsNumeric(unit)) {
+        const auto &vec = GET_BOOL_VECTOR(value);
+        const auto &mask = GET_BOOL_VECTOR(where);
+        if (mask.size() != vec.size()) {
+            throw std::runtime_error("Vector size mismatch");
+        }
+        const auto [first, last] = rowRange(start, end, vec.size());
+        const auto count = reduceMorsels<std::size_t>(
+            last - first, 0,
+            [&](const std::size_t begin, const std::size_t stop) {
+                return vec.countAnd(mask, first + begin, first + stop);
+            },
+            std::plus<>());
+        return static_cast<NumericType>(count) * GET_NUMERIC(unit) + GET_NUMERIC(initialValue);
+    }
 
-    const std::string op = getQueryOperation(query);
-    if (!functionMap.contains(op)) {
-        throw std::runtime_error("Unknown operator: " + op);
+    throw std::runtime_error("Operand of COUNT must be of type bool[]");
+}
+
+GenericValue Executor::aggregateOp(const OperatorEnum op, const GenericValue &value) const {
+    /*
+     * Query format:
+     * "type": "operation"
+     * "operation": "MAX"/"MIN"/"AVG"/"SUM"
+     * "value": <operand>
+     */
+    if (op != OperatorEnum::MAX && op != OperatorEnum::MIN && op != OperatorEnum::AVG && op != OperatorEnum::SUM) {
+        throw std::runtime_error("Unknown aggregate operator");
     }
-    auto &func = functionMap.at(op);
 
-    const GenericValue value = run(query["value"]);
-    if (holdsNumericVector(value)) {
-        NumericType result = func(GET_NUMERIC_VECTOR(value));
-        return result;
+    if (holdsNumericArray(value)) {
+        return visitNumericArray(value, [&]<typename T>(const std::span<const T> vec) -> GenericValue {
+            if (vec.empty()) {
+                throw std::runtime_error("Cannot aggregate an empty vector");
+            }
+            // Each morsel is reduced on its own and the partials are combined in morsel order, so the
+            // result does not depend on the number of threads.
+            const auto reduce = [&](auto &&partial, auto &&combine) {
+                return reduceMorsels<NumericType>(
+                    vec.size(), 0,
+                    [&](const std::size_t begin, const std::size_t end) {
+                        return static_cast<NumericType>(partial(vec.subspan(begin, end - begin)));
+                    },
+                    combine);
+            };
+
+            // A NaN first row makes MAX and MIN NaN. Any other NaN row is passed over, also at the start of
+            // a morsel, where ranges::max/min would take it.
+            const auto extreme = [&](auto &&aggregate, auto &&fold) -> NumericType {
+                if constexpr (std::is_floating_point_v<T>) {
+                    if (std::isnan(vec[0])) {
+                        return std::numeric_limits<NumericType>::quiet_NaN();
+                    }
+                    return reduce([&](const std::span<const T> rows) {
+                        NumericType partial = rows[0];
+                        for (const T row: rows.subspan(1)) {
+                            partial = fold(partial, row);
+                        }
+                        return partial;
+                    }, fold);
+                } else {
+                    return reduce(aggregate, fold);
+                }
+            };
+
+            NumericType result;
+            switch (op) {
+                case OperatorEnum::MAX:
+                    result = extreme(&aggregateMax<T>, &foldMax);
+                    break;
+                case OperatorEnum::MIN:
+                    result = extreme(&aggregateMin<T>, &foldMin);
+                    break;
+                case OperatorEnum::SUM:
+                    result = reduce(&aggregateSum<T>, &mathAdd<NumericType>);
+                    break;
+                default:
+                    result = reduce(&aggregateSum<T>, &mathAdd<NumericType>) / static_cast<NumericType>(vec.size());
+                    break;
+            }
+            return result;
+        });
     }
 
     throw std::runtime_error("Operand of aggregate functions must be of type numeric[]");
 }
 
-GenericValue Executor::jumpOp(const Query &query) {
+GenericValue Executor::aggregateOp(const OperatorEnum op, const GenericValue &value, const GenericValue &start,
+                                   const GenericValue &end, const RangeIndex *index) const {
     /*
      * Query format:
      * "type": "operation"
-     * "operation": "JUMP"
+     * "operation": "MAX"/"MIN"/"AVG"/"SUM"
      * "value": <operand>
-     * "from": [<value>, <value>, ...]
-     * "to": [<value>, <value>, ...]
+     * "start": <value>, optional
+     * "end": <value>, optional
      */
-    const GenericValue value = run(query["value"]);
-    const GenericValue from = run(query["from"]);
-    const GenericValue to = run(query["to"]);
-
-    if (holdsNumericVector(value) && holdsNumericVector(from) && holdsNumericVector(to)) {
-        const auto &valueVec = GET_NUMERIC_VECTOR(value);
-        const auto &fromVec = GET_NUMERIC_VECTOR(from);
-        const auto &toVec = GET_NUMERIC_VECTOR(to);
+    if (!holdsNumericArray(value)) {
+        throw std::runtime_error("Operand of aggregate functions must be of type numeric[]");
+    }
+    return visitNumericArray(value, [&]<typename T>(const std::span<const T> vec) -> GenericValue {
+        const auto [first, last] = rowRange(start, end, vec.size());
+        // NaN rows are left to the scan, which also decides how they combine with the others.
+        if (index == nullptr || first == last || index->nanCount(first, last) > 0) {
+            return aggregateOp(op, NumericViewType(vec.subspan(first, last - first)));
+        }
+        switch (op) {
+            case OperatorEnum::MAX:
+                return index->max(vec, first, last);
+            case OperatorEnum::MIN:
+                return index->min(vec, first, last);
+            case OperatorEnum::AVG:
+                return index->sum(vec, first, last) / static_cast<NumericType>(last - first);
+            case OperatorEnum::SUM:
+                return index->sum(vec, first, last);
+            default:
+                throw std::runtime_error("Unknown aggregate operator");
+        }
+    });
+}
 
-        std::unordered_set<NumericType> fromValues(fromVec.begin(), fromVec.end());
-        std::unordered_set<NumericType> toValues(toVec.begin(), toVec.end());
+GenericValue Executor::aggregateOp(const OperatorEnum op, const GenericValue &value, const GenericValue &start,
+                                   const GenericValue &end, const GenericValue &where) const {
+    /*
+     * Query format:
+     * "type": "operation"
+     * "operation": "MAX"/"MIN"/"AVG"/"SUM"
+     * "value": <operand>
+     * "start": <value>, optional
+     * "end": <value>, optional
+     * "where": <operand>
+     */
+    if (op != OperatorEnum::MAX && op != OperatorEnum::MIN && op != OperatorEnum::AVG && op != OperatorEnum::SUM) {
+        throw std::runtime_error("Unknown aggregate operator");
+    }
+    if (holdsBool(where)) {
+        return aggregateOp(op, value, start, GET_BOOL(where) != 0 ? end : GenericValue(NumericType{0}));
+    }
+    if (!holdsBoolVector(where)) {
+        throw std::runtime_error("Condition of aggregate functions must be of type bool[]");
+    }
+    if (!holdsNumericArray(value)) {
+        throw std::runtime_error("Operand of aggregate functions must be of type numeric[]");
+    }
+    const auto &mask = GET_BOOL_VECTOR(where);
+    return visitNumericArray(value, [&]<typename T>(const std::span<const T> vec) -> GenericValue {
+        if (mask.size() != vec.size()) {
+            throw std::runtime_error("Vector size mismatch");
+        }
+        const auto [first, last] = rowRange(start, end, vec.size());
+
+        // As for the unmasked scan, each morsel is reduced on its own and the partials are combined in
+        // morsel order; morsels without a TRUE row are left out. MAX and MIN pass over NaN rows and are
+        // only NaN if the first TRUE row is.
+        struct Partial {
+            NumericType value{0};
+            std::size_t rows{0};
+        };
+        const auto reduce = [&](const bool seeded, auto &&combine) {
+            return reduceMorsels<Partial>(
+                last - first, Partial{},
+                [&](const std::size_t begin, const std::size_t stop) {
+                    Partial partial;
+                    mask.forEachRun(first + begin, first + stop, [&](const std::size_t run, const std::size_t runEnd) {
+                        std::size_t row = run;
+                        if (seeded && partial.rows == 0) {
+                            partial.value = static_cast<NumericType>(vec[row++]);
+                        }
+                        for (; row < runEnd; ++row) {
+                            partial.value = combine(partial.value, static_cast<NumericType>(vec[row]));
+                        }
+                        partial.rows += runEnd - run;
+                    });
+                    return partial;
+                },
+                [&](const Partial &l, const Partial &r) {
+                    if (l.rows == 0 || r.rows == 0) {
+                        return l.rows == 0 ? r : l;
+                    }
+                    return Partial{combine(l.value, r.value), l.rows + r.rows};
+                });
+        };
+
+        Partial result;
+        switch (op) {
+            case OperatorEnum::MAX:
+                result = reduce(true, &foldMax);
+                break;
+            case OperatorEnum::MIN:
+                result = reduce(true, &foldMin);
+                break;
+            default:
+                result = reduce(false, &mathAdd<NumericType>);
+                break;
+        }
+        if (result.rows == 0) {
+            throw std::runtime_error("Cannot aggregate an empty vector");
+        }
+        if ((op == OperatorEnum::MAX || op == OperatorEnum::MIN) &&
+            std::isnan(static_cast<NumericType>(vec[mask.findNext(first, true, last)]))) {
+            return std::numeric_limits<NumericType>::quiet_NaN();
+        }
+        return op == OperatorEnum::AVG ? result.value / static_cast<NumericType>(result.rows) : result.value;
+    });
+}
 
-        BoolVectorType result(valueVec.size(), FALSE);
+std::pair<std::size_t, std::size_t> Executor::rowRange(const GenericValue &start, const GenericValue &end,
+                                                       const std::size_t rows) const {
+    if (!holdsNumeric(start) || !holdsNumeric(end) || std::isnan(GET_NUMERIC(start)) ||
+        std::isnan(GET_NUMERIC(end))) {
+        throw std::runtime_error("Range of aggregate functions must be given in seconds");
+    }
+    // First row sampled at or after seconds; a bound within rounding error of a row's time includes the row.
+    const auto firstRow = [&](const NumericType seconds) {
+        const NumericType exact = seconds * 1e9 / static_cast<NumericType>(timeIntervalPerRow_);
+        const NumericType nearest = std::round(exact);
+        const NumericType row = std::abs(exact - nearest) < 1e-6 ? nearest : std::ceil(exact);
+        if (row <= 0) {
+            return std::size_t{0};
+        }
+        return row >= static_cast<NumericType>(rows) ? rows : static_cast<std::size_t>(row);
+    };
+    const std::size_t first = firstRow(GET_NUMERIC(start));
+    return {first, std::max(first, firstRow(GET_NUMERIC(end)))};
+}
 
-        if (fromValues.empty() && !toValues.empty()) {
-            // Any -> toVal
-            for (std::size_t i = 1; i < valueVec.size(); ++i) {
-                if (!toValues.contains(valueVec[i - 1]) && toValues.contains(valueVec[i])) {
-                    result[i] = TRUE;
-                }
+GenericValue Executor::rollingOp(const OperatorEnum op, const GenericValue &value,
+                                 const GenericValue &duration) const {
+    /*
+     * Query format:
+     * "type": "operation"
+     * "operation": "ROLLING_MAX"/"ROLLING_MIN"/"ROLLING_AVG"/"ROLLING_SUM"/"ROLLING_COUNT"
+     * "value": <operand>
+     * "duration": <value>
+     */
+    if (op != OperatorEnum::ROLLING_MAX && op != OperatorEnum::ROLLING_MIN && op != OperatorEnum::ROLLING_AVG &&
+        op != OperatorEnum::ROLLING_SUM && op != OperatorEnum::ROLLING_COUNT) {
+        throw std::runtime_error("Unknown rolling operator");
+    }
+    const std::size_t rows = rollingRows(duration);
+    const auto roll = [&](const std::size_t size, auto &&at) -> GenericValue {
+        NumericVectorType result = newNumericVector(size, 0);
+        const auto fill = [&](const std::size_t begin, const std::size_t end) {
+            const std::size_t first = RollingWindow::warmUpFrom(begin, rows);
+            RollingWindow window(op, rows, first);
+            for (std::size_t i = first; i < begin; ++i) {
+                window.push(at(i));
             }
-        } else if (!fromValues.empty() && toValues.empty()) {
-            // fromVal -> Any
-            for (std::size_t i = 1; i < valueVec.size(); ++i) {
-                if (fromValues.contains(valueVec[i - 1]) && !fromValues.contains(valueVec[i])) {
-                    result[i] = TRUE;
-                }
+            for (std::size_t i = begin; i < end; ++i) {
+                result[i] = window.push(at(i));
             }
+        };
+        // Each morsel first pushes up to two windows of earlier rows, which only pays off for short windows.
+        if (rows <= MORSEL_SIZE / 4) {
+            parallelFor(size, fill);
         } else {
-            // fromVal -> toVal
-            for (std::size_t i = 1; i < valueVec.size(); ++i) {
-                if (fromValues.contains(valueVec[i - 1]) && toValues.contains(valueVec[i])) {
-                    result[i] = TRUE;
-                }
-            }
+            fill(0, size);
         }
         return result;
+    };
+
+    if (op == OperatorEnum::ROLLING_COUNT) {
+        if (!holdsBoolVector(value)) {
+            throw std::runtime_error("Operand of ROLLING_COUNT must be of type bool[]");
+        }
+        const auto &vec = GET_BOOL_VECTOR(value);
+        return roll(vec.size(), [&](const std::size_t i) { return static_cast<NumericType>(vec[i]); });
+    }
+    if (!holdsNumericArray(value)) {
+        throw std::runtime_error("Operand of rolling functions must be of type numeric[]");
+    }
+    return visitNumericArray(value, [&]<typename T>(const std::span<const T> vec) {
+        return roll(vec.size(), [&](const std::size_t i) { return static_cast<NumericType>(vec[i]); });
+    });
+}
+
+std::size_t Executor::rollingRows(const GenericValue &duration) const {
+    if (!holdsNumeric(duration) || !(GET_NUMERIC(duration) >= 0)) {
+        throw std::runtime_error("Duration of rolling functions must be a number of seconds");
+    }
+    // A window always holds its own row.
+    return std::max<std::size_t>(1, calculateRowCount(GET_NUMERIC(duration)));
+}
+
+GenericValue Executor::segmentOp(const GenericValue &value, const GenericValue &target) const {
+    /*
+     * Query format:
+     * "type": "operation"
+     * "operation": "SEGMENT_AGG"
+     * "value": <operand>
+     * "target": <operand>
+     */
+    if (!holdsBoolVector(value)) {
+        throw std::runtime_error("Operand of SEGMENT_AGG must be of type bool[]");
+    }
+    if (!holdsNumericArray(target)) {
+        throw std::runtime_error("Target of SEGMENT_AGG must be of type numeric[]");
+    }
+    const auto &events = GET_BOOL_VECTOR(value);
+    return visitNumericArray(target, [&]<typename T>(const std::span<const T> vec) -> GenericValue {
+        if (vec.size() != events.size()) {
+            throw std::runtime_error("Vector size mismatch");
+        }
+        // The runs are cut at morsel boundaries, scanned in parallel and joined again in row order.
+        std::vector<std::vector<SegmentTable::Piece> > pieces(ThreadPool::morselCount(vec.size(), MORSEL_SIZE));
+        parallelFor(vec.size(), [&](const std::size_t begin, const std::size_t end) {
+            auto &morsel = pieces[begin / MORSEL_SIZE];
+            events.forEachRun(begin, end, [&](const std::size_t first, const std::size_t last) {
+                morsel.emplace_back(SegmentTable::scan(first, vec.subspan(first, last - first)));
+            });
+        });
+        SegmentTable table(timeIntervalPerRow_);
+        for (const auto &morsel: pieces) {
+            for (const auto &piece: morsel) {
+                table.add(piece);
+            }
+        }
+        table.close();
+        return table.take();
+    });
+}
+
+GenericValue Executor::jumpOp(const GenericValue &value, const GenericValue &from, const GenericValue &to) const {
+    /*
+     * Query format:
+     * "type": "operation"
+     * "operation": "JUMP"
+     * "value": <operand>
+     * "from": [<value>, <value>, ...]
+     * "to": [<value>, <value>, ...]
+     */
+    if (holdsNumericArray(value) && holdsNumericVector(from) && holdsNumericVector(to)) {
+        const auto &fromVec = GET_NUMERIC_VECTOR(from);
+        const auto &toVec = GET_NUMERIC_VECTOR(to);
+
+        const ValueSet fromValues(fromVec);
+        const ValueSet toValues(toVec);
+
+        return visitNumericArray(value, [&]<typename T>(const std::span<const T> valueVec) -> GenericValue {
+            BoolVectorType result = newBoolVector(valueVec.size(), FALSE);
+            const auto isFrom = [&](const T x) { return fromValues.contains(x); };
+            const auto isTo = [&](const T x) { return toValues.contains(x); };
+
+            const auto markTransitions = [&](auto &&isTransition) {
+                parallelFor(valueVec.size(), [&](const std::size_t begin, const std::size_t end) {
+                    result.assignBits(begin, end, [&](const std::size_t i) {
+                        return i > 0 && isTransition(valueVec[i - 1], valueVec[i]);
+                    });
+                });
+            };
+
+            if (fromValues.empty() && !toValues.empty()) {
+                // Any -> toVal
+                markTransitions([&](const T prev, const T cur) { return !isTo(prev) && isTo(cur); });
+            } else if (!fromValues.empty() && toValues.empty()) {
+                // fromVal -> Any
+                markTransitions([&](const T prev, const T cur) { return isFrom(prev) && !isFrom(cur); });
+            } else {
+                // fromVal -> toVal
+                markTransitions([&](const T prev, const T cur) { return isFrom(prev) && isTo(cur); });
+            }
+            return result;
+        });
     }
 
     throw std::runtime_error("Operand of jump functions must be of type numeric[]");
 }
 
-GenericValue Executor::beforeOp(const Query &query) {
+GenericValue Executor::beforeOp() const {
     BoolType result = 1;
     return result;
 }
 
-GenericValue Executor::afterOp(const Query &query) {
+GenericValue Executor::afterOp(const GenericValue &value, const GenericValue &from, const GenericValue &to,
+                              const GenericValue &duration) const {
     /*
      * Query format:
      * "type": "operation"
@@ -522,92 +1661,24 @@ GenericValue Executor::afterOp(const Query &query) {
      * "to": <value>
      * "duration": <value>
      */
-    const GenericValue value = run(query["value"]);
-    const GenericValue from = run(query["from"]);
-    const GenericValue to = run(query["to"]);
-    const GenericValue duration = run(query["duration"]);
-
-    if (holdsNumericVector(value) && holdsNumeric(from) && holdsNumeric(to) && holdsNumeric(duration)) {
-        const auto &valueVec = GET_NUMERIC_VECTOR(value);
+    if (holdsNumericArray(value) && holdsNumeric(from) && holdsNumeric(to) && holdsNumeric(duration)) {
         const auto fromVal = GET_NUMERIC(from);
         const auto toVal = GET_NUMERIC(to);
         const auto threshold = calculateRowCount(GET_NUMERIC(duration));
 
-        BoolVectorType result(valueVec.size(), FALSE);
-        bool findFromFlag = false;
-        bool findToFlag = false;
-        uint32_t cnt = 0;
-        if (fromVal < toVal) {
-            // e.g. 5 -> 10
-            for (size_t i = 1; i < valueVec.size(); i++) {
-                if (!findFromFlag) {
-                    if (valueVec[i] >= fromVal && valueVec[i - 1] < fromVal) {
-                        findFromFlag = true;
-                    }
-                } else {
-                    // findFromFlag = true;
-                    if (valueVec[i] < fromVal) {
-                        // value < fromVal < toVal
-                        findFromFlag = false;
-                        findToFlag = false;
-                        cnt = 0;
-                    } else if (valueVec[i] < toVal) {
-                        // fromVal <= value < toVal
-                        if (findToFlag) {
-                            findFromFlag = false;
-                            findToFlag = false;
-                            cnt = 0;
-                        }
-                    } else {
-                        // fromVal < toVal <= value
-                        if (!findToFlag) {
-                            findToFlag = true;
-                            cnt = 0;
-                        }
-                        cnt++;
-                        result[i] = cnt >= threshold ? TRUE : FALSE;
-                    }
-                }
-            }
-        } else {
-            // fromVal > toVal, e.g. 10 -> 5
-            for (size_t i = 1; i < valueVec.size(); i++) {
-                if (!findFromFlag) {
-                    if (valueVec[i] <= fromVal && valueVec[i - 1] > fromVal) {
-                        findFromFlag = true;
-                    }
-                } else {
-                    // findFromFlag = true;
-                    if (valueVec[i] > fromVal) {
-                        // toVal < fromVal < value
-                        findFromFlag = false;
-                        findToFlag = false;
-                        cnt = 0;
-                    } else if (valueVec[i] > toVal) {
-                        // toVal < value <= fromVal
-                        if (findToFlag) {
-                            findFromFlag = false;
-                            findToFlag = false;
-                            cnt = 0;
-                        }
-                    } else {
-                        // value <= toVal < fromVal
-                        if (!findToFlag) {
-                            findToFlag = true;
-                            cnt = 0;
-                        }
-                        cnt++;
-                        result[i] = cnt >= threshold ? TRUE : FALSE;
-                    }
-                }
-            }
-        }
-        return result;
+        return visitNumericArray(value, [&]<typename T>(const std::span<const T> valueVec) -> GenericValue {
+            BoolVectorType result = newBoolVector(valueVec.size(), FALSE);
+            withAfterMachine(valueVec, fromVal, toVal, threshold, [&](const auto &machine) {
+                parallelScan(machine, valueVec.size(), result);
+            });
+            return result;
+        });
     }
     throw std::runtime_error("Operand type not supported");
 }
 
-GenericValue Executor::holdOp(const Query &query) {
+GenericValue Executor::holdOp(const GenericValue &value, const GenericValue &from, const GenericValue &to,
+                             const GenericValue &duration) const {
     /*
      * Query format:
      * "type": "operation"
@@ -617,13 +1688,7 @@ GenericValue Executor::holdOp(const Query &query) {
      * "to": [<value>, <value>, ...]
      * "duration": <value>
      */
-    const GenericValue value = run(query["value"]);
-    const GenericValue from = run(query["from"]);
-    const GenericValue to = run(query["to"]);
-    const GenericValue duration = run(query["duration"]);
-
-    if (holdsNumericVector(value) && holdsNumericVector(from) && holdsNumericVector(to) && holdsNumeric(duration)) {
-        auto valueVec = GET_NUMERIC_VECTOR(value); // copy
+    if (holdsNumericArray(value) && holdsNumericVector(from) && holdsNumericVector(to) && holdsNumeric(duration)) {
         const auto &fromVec = GET_NUMERIC_VECTOR(from);
         const auto &toVec = GET_NUMERIC_VECTOR(to);
         const auto durationVal = GET_NUMERIC(duration);
@@ -631,36 +1696,165 @@ GenericValue Executor::holdOp(const Query &query) {
         const bool needReverse = durationVal < 0;
         const auto threshold = calculateRowCount(std::abs(durationVal));
 
-        std::unordered_set<NumericType> fromValues(fromVec.begin(), fromVec.end());
-        std::unordered_set<NumericType> toValues(toVec.begin(), toVec.end());
-        BoolVectorType result(valueVec.size(), FALSE);
+        const ValueSet fromValues(fromVec);
+        const ValueSet toValues(toVec);
 
-        if (needReverse) {
-            std::ranges::reverse(valueVec);
-        }
+        return visitNumericArray(value, [&]<typename T>(const std::span<const T> valueVec) -> GenericValue {
+            const std::size_t size = valueVec.size();
+            BoolVectorType result = newBoolVector(size, FALSE);
 
-        if (!fromValues.empty() && toValues.empty()) {
-            // fromVal -> Any
-            holdOpVecToAny(valueVec, fromValues, threshold, result);
-        } else if (fromValues.empty() && !toValues.empty()) {
-            // Any -> toVal
-            holdOpAnyToVec(valueVec, toValues, threshold, result);
-        } else {
-            // fromVal -> toVal
-            holdOpVecToVec(valueVec, fromValues, toValues, threshold, result);
-        }
-
-        if (needReverse) {
-            std::ranges::reverse(result);
-        }
+            // A negative duration holds backwards in time: the rows are scanned in reverse order
+            // through the accessor instead of copying the column.
+            const auto scan = [&](auto &&at) {
+                withHoldMachine(fromValues, toValues, threshold, at, [&](const auto &machine) {
+                    parallelScan(machine, size, result);
+                });
+            };
 
-        return result;
+            if (needReverse) {
+                scan([&](const std::size_t i) { return valueVec[size - 1 - i]; });
+                result.reverse();
+            } else {
+                scan([&](const std::size_t i) { return valueVec[i]; });
+            }
+            return result;
+        });
     }
 
     throw std::runtime_error("Operand type not supported");
 }
 
-GenericValue Executor::durationOp(const Query &query) {
+GenericValue Executor::runLengthOp(const PlanNode &node, const RunLengthColumn &column,
+                                   const std::vector<const GenericValue *> &values) const {
+    const auto arg = [&](const std::size_t pos) -> const GenericValue & {
+        return *values[node.inputs[pos]];
+    };
+    const std::size_t size = column.size();
+    BoolVectorType result = newBoolVector(size, FALSE);
+
+    std::visit([&]<typename T>(const std::vector<T> &runValues) {
+        const std::size_t runs = runValues.size();
+        const auto runLength = [&](const std::size_t k) { return column.ends[k] - (k > 0 ? column.ends[k - 1] : 0); };
+
+        /*
+         * JUMP, HOLD and AFTER look one row back, so each run stands for two rows: its first row, which
+         * follows the previous run, and one for the rest of it, which follows its own value. Calls
+         * visit(j, row, count) for these rows in scan order, j indexing the doubled run values; row 0 is
+         * skipped as in the row-wise scans.
+         */
+        const auto forEachRow = [&](const bool reversed, auto &&visit) {
+            std::vector<T> doubled(2 * runs);
+            std::vector<std::size_t> lengths(runs);
+            for (std::size_t r = 0; r < runs; ++r) {
+                const std::size_t k = reversed ? runs - 1 - r : r;
+                doubled[2 * r] = doubled[2 * r + 1] = runValues[k];
+                lengths[r] = runLength(k);
+            }
+            std::size_t row = 0;
+            for (std::size_t r = 0; r < runs; ++r) {
+                if (row > 0) {
+                    visit(doubled, 2 * r, row, std::size_t{1});
+                }
+                visit(doubled, 2 * r + 1, row + 1, lengths[r] - 1);
+                row += lengths[r];
+            }
+        };
+
+        switch (node.op) {
+            case OperatorEnum::JUMP: {
+                if (!holdsNumericVector(arg(1)) || !holdsNumericVector(arg(2))) {
+                    throw std::runtime_error("Operand of jump functions must be of type numeric[]");
+                }
+                const auto &fromVec = GET_NUMERIC_VECTOR(arg(1));
+                const auto &toVec = GET_NUMERIC_VECTOR(arg(2));
+                const ValueSet fromValues(fromVec);
+                const ValueSet toValues(toVec);
+                const auto isFrom = [&](const T x) { return fromValues.contains(x); };
+                const auto isTo = [&](const T x) { return toValues.contains(x); };
+                forEachRow(false, [&](const std::vector<T> &doubled, const std::size_t j, const std::size_t row,
+                                      const std::size_t count) {
+                    const T prev = doubled[j - 1];
+                    const T cur = doubled[j];
+                    bool transition;
+                    if (fromValues.empty() && !toValues.empty()) {
+                        transition = !isTo(prev) && isTo(cur);
+                    } else if (!fromValues.empty() && toValues.empty()) {
+                        transition = isFrom(prev) && !isFrom(cur);
+                    } else {
+                        transition = isFrom(prev) && isTo(cur);
+                    }
+                    if (transition) {
+                        result.fill(row, row + count, true);
+                    }
+                });
+                return;
+            }
+            case OperatorEnum::HOLD: {
+                if (!holdsNumericVector(arg(1)) || !holdsNumericVector(arg(2)) || !holdsNumeric(arg(3))) {
+                    throw std::runtime_error("Operand type not supported");
+                }
+                const auto &fromVec = GET_NUMERIC_VECTOR(arg(1));
+                const auto &toVec = GET_NUMERIC_VECTOR(arg(2));
+                const auto durationVal = GET_NUMERIC(arg(3));
+                const ValueSet fromValues(fromVec);
+                const ValueSet toValues(toVec);
+                const uint32_t threshold = calculateRowCount(std::abs(durationVal));
+                // A negative duration holds backwards in time, as in holdOp.
+                const bool reversed = durationVal < 0;
+                forEachRow(reversed, [&, state = HoldState{}](const std::vector<T> &doubled, const std::size_t j,
+                                                              const std::size_t row, const std::size_t count) mutable {
+                    withHoldMachine(fromValues, toValues, threshold,
+                                    [&](const std::size_t k) { return doubled[k]; },
+                                    [&](const auto &machine) {
+                                        state = machine.repeat(j, count, state, [&](const std::size_t b,
+                                                                                    const std::size_t e) {
+                                            result.fill(row + b, row + e, true);
+                                        });
+                                    });
+                });
+                if (reversed) {
+                    result.reverse();
+                }
+                return;
+            }
+            case OperatorEnum::AFTER: {
+                if (!holdsNumeric(arg(1)) || !holdsNumeric(arg(2)) || !holdsNumeric(arg(3))) {
+                    throw std::runtime_error("Operand type not supported");
+                }
+                const auto fromVal = GET_NUMERIC(arg(1));
+                const auto toVal = GET_NUMERIC(arg(2));
+                const uint32_t threshold = calculateRowCount(GET_NUMERIC(arg(3)));
+                forEachRow(false, [&, state = AfterState{}](const std::vector<T> &doubled, const std::size_t j,
+                                                            const std::size_t row, const std::size_t count) mutable {
+                    withAfterMachine(std::span<const T>(doubled), fromVal, toVal, threshold,
+                                     [&](const auto &machine) {
+                                         state = machine.repeat(j, count, state, [&](const std::size_t b,
+                                                                                     const std::size_t e) {
+                                             result.fill(row + b, row + e, true);
+                                         });
+                                     });
+                });
+                return;
+            }
+            default: {
+                // Compare with a constant, decided once per run.
+                if (!holdsNumeric(arg(1))) {
+                    throw std::runtime_error("Unsupported type for compare operator");
+                }
+                const auto rightValue = GET_NUMERIC(arg(1));
+                const CompareFunction cmp = compareFunction(node.op);
+                for (std::size_t k = 0; k < runs; ++k) {
+                    if (cmp(static_cast<NumericType>(runValues[k]), rightValue)) {
+                        result.fill(column.ends[k] - runLength(k), column.ends[k], true);
+                    }
+                }
+            }
+        }
+    }, column.values);
+    return result;
+}
+
+GenericValue Executor::durationOp(const GenericValue &value, const GenericValue &minDuration) const {
     /*
      * Query format:
      * "type": "operation"
@@ -669,47 +1863,69 @@ GenericValue Executor::durationOp(const Query &query) {
      * "minDuration": <value>
      */
 
-    const GenericValue value = run(query["value"]);
-    const GenericValue minDuration = run(query["minDuration"]);
-
     if (holdsBoolVector(value) && holdsNumeric(minDuration)) {
         const auto &valueVec = GET_BOOL_VECTOR(value);
-        const auto minDurationVal = GET_NUMERIC(minDuration);
-        BoolVectorType result(valueVec);
-
-        const auto cntThreshold = calculateRowCount(minDurationVal);
-        uint32_t cnt = 0;
-        bool inSequence = false;
-        for (std::size_t i = 0; i < result.size(); i++) {
-            if (inSequence) {
-                if (result[i] == FALSE) {
-                    if (cnt < cntThreshold) {
-                        std::fill_n(result.begin() + i - cnt, cnt, FALSE);
-                    }
-                    cnt = 0;
-                    inSequence = false;
-                }
-            } else {
-                if (result[i] == TRUE) {
-                    inSequence = true;
-                    cnt++;
+        const auto cntThreshold = calculateRowCount(GET_NUMERIC(minDuration));
+        const std::size_t size = valueVec.size();
+        const std::size_t chunks = ThreadPool::morselCount(size, MORSEL_SIZE);
+        BoolVectorType result = newBoolVector(size, FALSE);
+
+        // Pass 1: TRUE rows at the head and tail of every chunk.
+        std::vector<std::size_t> leading(chunks);
+        std::vector<std::size_t> trailing(chunks);
+        parallelFor(size, [&](const std::size_t begin, const std::size_t end) {
+            const std::size_t chunk = begin / MORSEL_SIZE;
+            const std::size_t head = valueVec.findNext(begin, false, end);
+            const std::size_t lastFalse = valueVec.findLast(begin, false, end);
+            leading[chunk] = head - begin;
+            trailing[chunk] = lastFalse == end ? end - begin : end - lastFalse - 1;
+        });
+
+        // Pass 2: length of the TRUE run crossing into each chunk from the left and from the right.
+        std::vector<std::size_t> runBefore(chunks, 0);
+        std::vector<std::size_t> runAfter(chunks, 0);
+        for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+            const std::size_t length = std::min(MORSEL_SIZE, size - (chunk - 1) * MORSEL_SIZE);
+            runBefore[chunk] = leading[chunk - 1] == length ? runBefore[chunk - 1] + length : trailing[chunk - 1];
+        }
+        for (std::size_t chunk = chunks; chunk-- > 1;) {
+            const std::size_t length = std::min(MORSEL_SIZE, size - chunk * MORSEL_SIZE);
+            runAfter[chunk - 1] = leading[chunk] == length ? runAfter[chunk] + length : leading[chunk];
+        }
+
+        // Pass 3: keep the runs that last at least cntThreshold rows in total.
+        parallelFor(size, [&](const std::size_t begin, const std::size_t end) {
+            const std::size_t chunk = begin / MORSEL_SIZE;
+            // Runs are found a word at a time and written back as whole words where possible.
+            std::size_t runStart = valueVec.findNext(begin, true, end);
+            while (runStart < end) {
+                const std::size_t runEnd = valueVec.findNext(runStart, false, end);
+                std::size_t runLength = runEnd - runStart;
+                runLength += runStart == begin ? runBefore[chunk] : 0;
+                runLength += runEnd == end ? runAfter[chunk] : 0;
+                if (runLength >= cntThreshold) {
+                    result.fill(runStart, runEnd, true);
                 }
+                runStart = valueVec.findNext(runEnd, true, end);
             }
-        }
+        });
+        return result;
     }
 
-    return value;
+    throw std::runtime_error("Operand type not supported");
 }
 
-GenericValue Executor::selectOp(const Query &query) {
+GenericValue Executor::selectOp(const uint32_t columnIndex) const {
     /*
      * Query format:
      * "type": "operation"
      * "operation": "SELECT"
      * "value": string
      */
+    if (data == nullptr) {
+        throw std::runtime_error("No input data");
+    }
 
-    const std::string name = query["value"].GetString();
-    NumericVectorType result = getData(name);
+    NumericViewType result = data->getColumnView(columnIndex);
     return result;
 }
@@ -0,0 +1,155 @@
+#include "hardware_counters.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+using namespace ComputeLib;
+
+const char *ComputeLib::getCounterEventName(const CounterEvent event) {
+    switch (event) {
+        case CounterEvent::CYCLES:
+            return "cycles";
+        case CounterEvent::INSTRUCTIONS:
+            return "instructions";
+        case CounterEvent::L1D_READ_MISSES:
+            return "l1dReadMisses";
+        case CounterEvent::LLC_MISSES:
+            return "llcMisses";
+        case CounterEvent::BRANCH_MISSES:
+            return "branchMisses";
+        case CounterEvent::TASK_CLOCK_NS:
+            return "taskClockNs";
+    }
+    throw std::runtime_error("Unknown counter event");
+}
+
+#ifdef __linux__
+
+static perf_event_attr eventAttributes(const CounterEvent event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (event) {
+        case CounterEvent::CYCLES:
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case CounterEvent::INSTRUCTIONS:
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case CounterEvent::L1D_READ_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                          PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+            break;
+        case CounterEvent::LLC_MISSES:
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case CounterEvent::BRANCH_MISSES:
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case CounterEvent::TASK_CLOCK_NS:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_TASK_CLOCK;
+            break;
+    }
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return attr;
+}
+
+static int openEvent(const CounterEvent event, const int64_t threadId, const int leader) {
+    perf_event_attr attr = eventAttributes(event);
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, static_cast<pid_t>(threadId), -1, leader, 0));
+}
+
+HardwareCounters::HardwareCounters(const std::span<const int64_t> threadIds) {
+    for (const int64_t threadId: threadIds) {
+        int leader = -1;
+        const bool first = leaders_.empty();
+        for (std::size_t i = 0; i < COUNTER_EVENTS; ++i) {
+            const auto event = static_cast<CounterEvent>(i);
+            // The first thread decides which events are available; the others must open the same ones.
+            if (!first && !counted_[i]) {
+                continue;
+            }
+            const int fd = openEvent(event, threadId, leader);
+            if (fd < 0) {
+                if (first) {
+                    continue;
+                }
+                for (const int open: fds_) {
+                    close(open);
+                }
+                throw std::runtime_error("Cannot open hardware counters on every thread");
+            }
+            fds_.emplace_back(fd);
+            if (leader < 0) {
+                leader = fd;
+            }
+            if (first) {
+                counted_[i] = true;
+                order_.emplace_back(event);
+            }
+        }
+        if (leader < 0) {
+            throw std::runtime_error("Hardware counters are not available");
+        }
+        leaders_.emplace_back(leader);
+    }
+}
+
+HardwareCounters::~HardwareCounters() {
+    for (const int fd: fds_) {
+        close(fd);
+    }
+}
+
+CounterValues HardwareCounters::read() const {
+    CounterValues total{};
+    // nr, time enabled, time running, then one value per event.
+    std::vector<uint64_t> buffer(3 + order_.size());
+    for (const int leader: leaders_) {
+        const auto bytes = static_cast<ssize_t>(buffer.size() * sizeof(uint64_t));
+        if (::read(leader, buffer.data(), static_cast<std::size_t>(bytes)) != bytes || buffer[0] != order_.size()) {
+            throw std::runtime_error("Cannot read hardware counters");
+        }
+        // Scaled up if the kernel had to multiplex the group with other events.
+        const uint64_t enabled = buffer[1];
+        const uint64_t running = buffer[2];
+        for (std::size_t k = 0; k < order_.size(); ++k) {
+            uint64_t value = buffer[3 + k];
+            if (running > 0 && running < enabled) {
+                value = static_cast<uint64_t>(static_cast<double>(value) * static_cast<double>(enabled) /
+                                              static_cast<double>(running));
+            }
+            total[static_cast<std::size_t>(order_[k])] += value;
+        }
+    }
+    return total;
+}
+
+#else
+
+HardwareCounters::HardwareCounters(std::span<const int64_t>) {
+    throw std::runtime_error("Hardware counters need Linux perf events");
+}
+
+HardwareCounters::~HardwareCounters() = default;
+
+CounterValues HardwareCounters::read() const {
+    return {};
+}
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef CPP_BIT_VECTOR_H
+#define CPP_BIT_VECTOR_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ComputeLib {
+    /*
+     * Packed boolean vector, 64 rows per word, row i in bit (i % 64) of word (i / 64). Bits past
+     * size() in the last word are always zero, so words can be compared and counted directly.
+     * Element access mirrors std::vector<uint8_t> for reading; writers use set/fill/assignBits.
+     */
+    class BitVector {
+    public:
+        using Word = uint64_t;
+        using value_type = uint8_t;
+        static constexpr std::size_t WORD_BITS = 64;
+
+        class ConstIterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = uint8_t;
+            using difference_type = std::ptrdiff_t;
+            using reference = uint8_t;
+            using pointer = void;
+
+            ConstIterator() = default;
+
+            ConstIterator(const BitVector *vector, const std::size_t index) : vector_(vector), index_(index) {
+            }
+
+            uint8_t operator*() const {
+                return (*vector_)[index_];
+            }
+
+            ConstIterator &operator++() {
+                ++index_;
+                return *this;
+            }
+
+            ConstIterator operator++(int) {
+                ConstIterator copy = *this;
+                ++index_;
+                return copy;
+            }
+
+            bool operator==(const ConstIterator &other) const {
+                return index_ == other.index_;
+            }
+
+        private:
+            const BitVector *vector_{nullptr};
+            std::size_t index_{0};
+        };
+
+        BitVector() = default;
+
+        BitVector(const std::size_t size, const uint8_t value)
+            : size_(size), words_(wordCount(size), value != 0 ? ~Word{0} : Word{0}) {
+            clearTail();
+        }
+
+        BitVector(const std::initializer_list<uint8_t> values) : size_(values.size()), words_(wordCount(size_), 0) {
+            std::size_t i = 0;
+            for (const uint8_t value: values) {
+                set(i++, value != 0);
+            }
+        }
+
+        // Same as BitVector(size, value), reusing the capacity of storage, whose contents are overwritten.
+        BitVector(const std::size_t size, const uint8_t value, std::vector<Word> &&storage)
+            : size_(size), words_(std::move(storage)) {
+            words_.assign(wordCount(size), value != 0 ? ~Word{0} : Word{0});
+            clearTail();
+        }
+
+        static std::size_t wordCount(const std::size_t bits) {
+            return (bits + WORD_BITS - 1) / WORD_BITS;
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return size_;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return size_ == 0;
+        }
+
+        uint8_t operator[](const std::size_t i) const {
+            return static_cast<uint8_t>(words_[i / WORD_BITS] >> (i % WORD_BITS) & 1);
+        }
+
+        void set(const std::size_t i, const bool value = true) {
+            const Word mask = Word{1} << (i % WORD_BITS);
+            Word &word = words_[i / WORD_BITS];
+            word = value ? word | mask : word & ~mask;
+        }
+
+        [[nodiscard]] std::span<Word> words() {
+            return words_;
+        }
+
+        [[nodiscard]] std::span<const Word> words() const {
+            return words_;
+        }
+
+        // Words the storage holds room for, at least words().size().
+        [[nodiscard]] std::size_t wordCapacity() const {
+            return words_.capacity();
+        }
+
+        // Hands the word storage over for reuse and leaves the vector empty.
+        [[nodiscard]] std::vector<Word> releaseWords() {
+            std::vector<Word> storage = std::move(words_);
+            words_.clear();
+            size_ = 0;
+            return storage;
+        }
+
+        [[nodiscard]] ConstIterator begin() const {
+            return {this, 0};
+        }
+
+        [[nodiscard]] ConstIterator end() const {
+            return {this, size_};
+        }
+
+        bool operator==(const BitVector &other) const {
+            return size_ == other.size_ && words_ == other.words_;
+        }
+
+        // Number of set bits in [begin, end).
+        [[nodiscard]] std::size_t count(const std::size_t begin, const std::size_t end) const {
+            std::size_t result = 0;
+            forEachWord(begin, end, [&](const Word word, const Word mask) {
+                result += static_cast<std::size_t>(std::popcount(word & mask));
+                return false;
+            });
+            return result;
+        }
+
+        [[nodiscard]] std::size_t count() const {
+            return count(0, size_);
+        }
+
+        // First index in [from, limit) whose bit equals value, or limit.
+        [[nodiscard]] std::size_t findNext(const std::size_t from, const bool value, const std::size_t limit) const {
+            std::size_t found = limit;
+            std::size_t base = from - from % WORD_BITS;
+            forEachWord(from, limit, [&](const Word word, const Word mask) {
+                const Word hits = (value ? word : ~word) & mask;
+                if (hits != 0) {
+                    found = base + static_cast<std::size_t>(std::countr_zero(hits));
+                    return true;
+                }
+                base += WORD_BITS;
+                return false;
+            });
+            return found;
+        }
+
+        // Last index in [begin, end) whose bit equals value, or end.
+        [[nodiscard]] std::size_t findLast(const std::size_t begin, const bool value, const std::size_t end) const {
+            for (std::size_t i = end; i > begin;) {
+                const std::size_t wordIndex = (i - 1) / WORD_BITS;
+                const std::size_t base = wordIndex * WORD_BITS;
+                Word hits = value ? words_[wordIndex] : ~words_[wordIndex];
+                hits &= rangeMask(std::max(begin, base) - base, i - base);
+                if (hits != 0) {
+                    return base + WORD_BITS - 1 - static_cast<std::size_t>(std::countl_zero(hits));
+                }
+                i = base;
+            }
+            return end;
+        }
+
+        // Number of indices in [begin, end) set in both this and other, which must be at least end long.
+        [[nodiscard]] std::size_t countAnd(const BitVector &other, const std::size_t begin,
+                                           const std::size_t end) const {
+            std::size_t result = 0;
+            std::size_t wordIndex = begin / WORD_BITS;
+            forEachWord(begin, end, [&](const Word word, const Word mask) {
+                result += static_cast<std::size_t>(std::popcount(word & other.words_[wordIndex++] & mask));
+                return false;
+            });
+            return result;
+        }
+
+        /*
+         * Calls func(first, last) for each maximal run [first, last) of set bits within [begin, end), in
+         * order. Clear words are skipped whole and a run spanning full words costs one test per word, so
+         * sparse and dense vectors are both walked in about as many steps as they have runs.
+         */
+        template<typename Func>
+        void forEachRun(const std::size_t begin, const std::size_t end, Func &&func) const {
+            std::size_t base = begin - begin % WORD_BITS;
+            std::size_t first = 0;
+            bool open = false;
+            forEachWord(begin, end, [&](const Word word, const Word mask) {
+                const std::size_t limit = WORD_BITS - static_cast<std::size_t>(std::countl_zero(mask));
+                for (std::size_t pos = static_cast<std::size_t>(std::countr_zero(mask)); pos < limit;) {
+                    // The next bit that ends the open run, or starts a new one.
+                    const Word hits = (open ? ~word : word) & mask & ~((Word{1} << pos) - 1);
+                    if (hits == 0) {
+                        break;
+                    }
+                    pos = static_cast<std::size_t>(std::countr_zero(hits));
+                    if (open) {
+                        func(first, base + pos);
+                    } else {
+                        first = base + pos;
+                    }
+                    open = !open;
+                }
+                base += WORD_BITS;
+                return false;
+            });
+            if (open) {
+                func(first, end);
+            }
+        }
+
+        void fill(const std::size_t begin, const std::size_t end, const bool value) {
+            for (std::size_t i = begin; i < end;) {
+                const std::size_t base = i - i % WORD_BITS;
+                const std::size_t stop = std::min(end, base + WORD_BITS);
+                const Word mask = rangeMask(i - base, stop - base);
+                Word &word = words_[i / WORD_BITS];
+                word = value ? word | mask : word & ~mask;
+                i = stop;
+            }
+        }
+
+        /*
+         * Packs predicate(i) for i in [begin, end) 64 rows at a time. begin must be word aligned and
+         * end must be word aligned or size(), so concurrent callers on disjoint morsels never share a word.
+         */
+        template<typename Predicate>
+        void assignBits(const std::size_t begin, const std::size_t end, Predicate &&predicate) {
+            for (std::size_t base = begin; base < end; base += WORD_BITS) {
+                const std::size_t count = std::min(WORD_BITS, end - base);
+                Word bits = 0;
+                for (std::size_t j = 0; j < count; ++j) {
+                    bits |= static_cast<Word>(predicate(base + j) ? 1 : 0) << j;
+                }
+                words_[base / WORD_BITS] = bits;
+            }
+        }
+
+        // Bits [begin, end) as a new vector; begin need not be word aligned.
+        [[nodiscard]] BitVector slice(const std::size_t begin, const std::size_t end) const {
+            BitVector result(end - begin, 0);
+            const std::size_t first = begin / WORD_BITS;
+            const std::size_t shift = begin % WORD_BITS;
+            for (std::size_t w = 0; w < result.words_.size(); ++w) {
+                Word word = words_[first + w] >> shift;
+                if (shift != 0 && first + w + 1 < words_.size()) {
+                    word |= words_[first + w + 1] << (WORD_BITS - shift);
+                }
+                result.words_[w] = word;
+            }
+            result.clearTail();
+            return result;
+        }
+
+        void append(const BitVector &other) {
+            const std::size_t first = size_ / WORD_BITS;
+            const std::size_t shift = size_ % WORD_BITS;
+            size_ += other.size_;
+            words_.resize(wordCount(size_), 0);
+            for (std::size_t w = 0; w < other.words_.size(); ++w) {
+                words_[first + w] |= other.words_[w] << shift;
+                // The high part is only padding of other when it does not fit into words_.
+                if (shift != 0 && first + w + 1 < words_.size()) {
+                    words_[first + w + 1] |= other.words_[w] >> (WORD_BITS - shift);
+                }
+            }
+        }
+
+        // Appends count copies of value.
+        void append(const std::size_t count, const bool value) {
+            const std::size_t begin = size_;
+            size_ += count;
+            words_.resize(wordCount(size_), 0);
+            if (value) {
+                fill(begin, size_, true);
+            }
+        }
+
+        void reverse() {
+            if (size_ == 0) {
+                return;
+            }
+            std::ranges::reverse(words_);
+            for (Word &word: words_) {
+                word = reverseBits(word);
+            }
+            // The padding of the old last word is now at the bottom of the first word.
+            const std::size_t shift = words_.size() * WORD_BITS - size_;
+            if (shift != 0) {
+                for (std::size_t i = 0; i + 1 < words_.size(); ++i) {
+                    words_[i] = words_[i] >> shift | words_[i + 1] << (WORD_BITS - shift);
+                }
+                words_.back() >>= shift;
+            }
+        }
+
+    private:
+        std::size_t size_{0};
+        std::vector<Word> words_{};
+
+        // Bits [low, high) of a word, 0 <= low < high <= 64.
+        static Word rangeMask(const std::size_t low, const std::size_t high) {
+            const Word upper = high == WORD_BITS ? ~Word{0} : (Word{1} << high) - 1;
+            return upper & ~((Word{1} << low) - 1);
+        }
+
+        static Word reverseBits(Word word) {
+            word = (word >> 1 & 0x5555555555555555ULL) | (word & 0x5555555555555555ULL) << 1;
+            word = (word >> 2 & 0x3333333333333333ULL) | (word & 0x3333333333333333ULL) << 2;
+            word = (word >> 4 & 0x0F0F0F0F0F0F0F0FULL) | (word & 0x0F0F0F0F0F0F0F0FULL) << 4;
+            return std::byteswap(word);
+        }
+
+        void clearTail() {
+            if (size_ % WORD_BITS != 0) {
+                words_.back() &= rangeMask(0, size_ % WORD_BITS);
+            }
+        }
+
+        // Calls func(word, mask) for each word overlapping [begin, end) until it returns true.
+        template<typename Func>
+        void forEachWord(const std::size_t begin, const std::size_t end, Func &&func) const {
+            for (std::size_t i = begin; i < end;) {
+                const std::size_t base = i - i % WORD_BITS;
+                const std::size_t stop = std::min(end, base + WORD_BITS);
+                if (func(words_[i / WORD_BITS], rangeMask(i - base, stop - base))) {
+                    return;
+                }
+                i = stop;
+            }
+        }
+    };
+}
+
+#endif //CPP_BIT_VECTOR_H
@@ -0,0 +1,63 @@
+#ifndef CPP_BUFFER_POOL_H
+#define CPP_BUFFER_POOL_H
+
+#include "bit_vector.h"
+#include "operator.h"
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace ComputeLib {
+    /*
+     * Free lists of result storage, owned by an Executor and kept across runs. Executor::run hands an
+     * intermediate back once its last consumer in the plan is done, and operators take their output
+     * buffers from here, so a repeated query stops allocating for its intermediates.
+     */
+    class BufferPool {
+    public:
+        // Buffers kept per element type and bytes kept in all; beyond either the oldest buffers are freed,
+        // and a buffer larger than MAX_BYTES is not kept at all.
+        static constexpr std::size_t MAX_BUFFERS = 16;
+        static constexpr std::size_t MAX_BYTES = std::size_t{64} << 20;
+
+        // A numeric[] of size elements set to value, in the smallest pooled buffer that fits.
+        NumericVectorType acquireNumeric(std::size_t size, NumericType value);
+
+        // A bool[] of size rows set to value, in the smallest pooled buffer that fits.
+        BoolVectorType acquireBits(std::size_t size, uint8_t value);
+
+        // Takes the storage of an owned numeric[] or bool[]; other values are dropped.
+        void release(GenericValue &&value);
+
+        // value with storage of exactly its size, for results that leave the executor: storage with spare
+        // capacity, e.g. a large pooled buffer holding a small result, is copied from and taken back.
+        GenericValue fit(GenericValue &&value);
+
+        void clear();
+
+        [[nodiscard]] std::size_t pooledBytes() const;
+
+        // Acquisitions served from the pool so far.
+        [[nodiscard]] std::size_t reuseCount() const;
+
+    private:
+        mutable std::mutex mutex_{};
+        std::vector<NumericVectorType> numeric_{};
+        std::vector<std::vector<BitVector::Word>> words_{};
+        std::size_t bytes_{0};
+        std::size_t reused_{0};
+
+        template<typename T>
+        std::vector<T> take(std::vector<std::vector<T>> &buffers, std::size_t size);
+
+        // Keeps buffer in buffers, evicting the oldest of buffers and then of others to stay within MAX_BYTES.
+        template<typename T, typename Other>
+        void put(std::vector<std::vector<T>> &buffers, std::vector<T> &&buffer,
+                 std::vector<std::vector<Other>> &others);
+    };
+
+    // Bytes held by the storage of a value; views into the data source own none.
+    std::size_t storageBytes(const GenericValue &value);
+}
+
+#endif //CPP_BUFFER_POOL_H
@@ -0,0 +1,63 @@
+#ifndef CPP_COST_MODEL_H
+#define CPP_COST_MODEL_H
+
+#include "data_frame.h"
+#include "operator.h"
+#include "plan.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ComputeLib {
+    class QueryProfile;
+
+    /*
+     * Estimates what a subtree of a plan costs per row and which fraction of rows a bool[] subtree
+     * keeps, for CompiledQuery to order the operands of AND/OR so the predicates that eliminate the
+     * most rows per unit of work run first, and short-circuit the rest.
+     *
+     * Costs are fixed per-operator estimates, relative to one compare. Selectivities come, in order of
+     * preference, from earlier runs of structurally identical subtrees (observe(QueryProfile)), from the
+     * column a compare with a constant reads (observe(DataFrame)): the distinct values of its zone map
+     * blocks for EQ/NE and a sample of its rows otherwise, and else from per-operator defaults. A
+     * default constructed model only knows the defaults.
+     */
+    class CostModel {
+    public:
+        // Rows of each column kept by observe(DataFrame).
+        static constexpr std::size_t SAMPLE_ROWS = 1024;
+
+        // Work per row of op alone, relative to one compare.
+        [[nodiscard]] static double operatorCost(OperatorEnum op);
+
+        // Samples the columns of frame and keeps their zone maps, replacing what it kept of columns with
+        // the same name.
+        void observe(const DataFrame &frame);
+
+        // Adds the TRUE rows of every bool[] node the profiled runs materialized.
+        void observe(const QueryProfile &profile);
+
+        // Work per row of evaluating node and every node below it once.
+        [[nodiscard]] double cost(const CompiledQuery &plan, uint32_t node) const;
+
+        // Estimated fraction of TRUE rows of node, 1 for nodes that do not produce bool[].
+        [[nodiscard]] double selectivity(const CompiledQuery &plan, uint32_t node) const;
+
+    private:
+        struct Observed {
+            std::size_t trueRows{0};
+            std::size_t rows{0};
+        };
+
+        std::unordered_map<std::string, std::vector<NumericType>> samples_{};
+        std::unordered_map<std::string, ZoneMap> zones_{};
+        std::unordered_map<std::size_t, Observed> observed_{};
+
+        // Fraction of the rows of node's column that the compare node keeps, by its statistics, or NaN.
+        [[nodiscard]] double columnSelectivity(const CompiledQuery &plan, uint32_t node) const;
+    };
+}
+
+#endif //CPP_COST_MODEL_H
@@ -1,15 +1,22 @@
 #ifndef CPP_EXECUTOR_H
 #define CPP_EXECUTOR_H
 
+#include "buffer_pool.h"
 #include "operator.h"
 #include "data_frame.h"
+#include "plan.h"
+#include "profile.h"
+#include "thread_pool.h"
 #include "rapidjson/document.h"
 #include <algorithm>
 #include <cmath>
 #include <functional>
 #include <numeric>
+#include <memory>
 #include <queue>
+#include <span>
 #include <thread>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -17,7 +24,6 @@ namespace ComputeLib {
     using CompareFunction = std::function<bool(const NumericType &, const NumericType &)>;
     using LogicalFunction = std::function<BoolType(const BoolType &, const BoolType &)>;
     using MathFunction = std::function<NumericType(const NumericType &, const NumericType &)>;
-    using AggregateFunction = std::function<NumericType(const std::vector<NumericType> &)>;
 
     // CompareFunction
     template<typename T>
@@ -51,13 +57,14 @@ namespace ComputeLib {
     }
 
     // LogicalFunction
+    // Also applied to whole BitVector words, so the result keeps the operand type.
     template<typename T>
-    BoolType logicalAnd(const T &left, const T &right) {
+    T logicalAnd(const T &left, const T &right) {
         return left & right;
     }
 
     template<typename T>
-    BoolType logicalOr(const T &left, const T &right) {
+    T logicalOr(const T &left, const T &right) {
         return left | right;
     }
 
@@ -89,26 +96,31 @@ namespace ComputeLib {
 
     // AggregateFunction
     template<typename T>
-    T aggregateMax(const std::vector<T> &vec) {
+    T aggregateMax(std::span<const T> vec) {
         return std::ranges::max(vec);
     }
 
     template<typename T>
-    T aggregateMin(const std::vector<T> &vec) {
+    T aggregateMin(std::span<const T> vec) {
         return std::ranges::min(vec);
     }
 
     template<typename T>
-    T aggregateSum(const std::vector<T> &vec) {
-        return std::accumulate(vec.begin(), vec.end(), 0);
+    NumericType aggregateSum(std::span<const T> vec) {
+        return std::accumulate(vec.begin(), vec.end(), NumericType{0});
     }
 
     template<typename T>
-    T aggregateAvg(const std::vector<T> &vec) {
-        double sum = aggregateSum<T>(vec);
-        return sum / vec.size();
+    NumericType aggregateAvg(std::span<const T> vec) {
+        return aggregateSum<T>(vec) / static_cast<NumericType>(vec.size());
     }
 
+    class Pipeline;
+    class StreamingQuery;
+
+    // Rows per batch of Executor::runPipelined: a batch of every intermediate stays within L2.
+    static constexpr std::size_t PIPELINE_BATCH_SIZE = 4 * 1024;
+
     class Executor {
     public:
         explicit Executor(uint32_t num_threads);
@@ -122,29 +134,99 @@ namespace ComputeLib {
 
         GenericValue run(const Query &query);
 
-        GenericValue compareOp(const Query &query);
+        // Result of the first query of plan.
+        GenericValue run(const CompiledQuery &plan);
+
+        // Results of a batch of queries, in order, from one merged plan that evaluates the columns and
+        // subexpressions they share once.
+        std::vector<GenericValue> runBatch(std::span<const Query *const> queries);
+
+        std::vector<GenericValue> runBatch(const CompiledQuery &plan);
+
+        // Same results as runBatch(profile.plan()), adding the time, rows and storage of every node to
+        // profile, and its hardware events if the profile asks for them. When profiling is off, runs only
+        // pay a null check per node.
+        std::vector<GenericValue> runProfiled(QueryProfile &profile);
+
+        // Same result as run(plan), computed batchSize rows at a time through a Pipeline, so intermediates
+        // stay cache-resident. Aggregates read by other operators end a pass over the data source.
+        GenericValue runPipelined(const CompiledQuery &plan, std::size_t batchSize = PIPELINE_BATCH_SIZE);
+
+        // Bytes of the intermediate results, the result included, that were alive at once during the last run.
+        [[nodiscard]] std::size_t peakBytes() const {
+            return peakBytes_;
+        }
+
+        // Storage of released intermediates, reused by the following operators and runs.
+        [[nodiscard]] const BufferPool &bufferPool() const {
+            return *buffers_;
+        }
+
+        // Frees the pooled storage, e.g. after a query on an unusually large frame.
+        void releaseBuffers() {
+            buffers_->clear();
+        }
+
+        // With zones, the zone map of left's column, blocks that it decides are filled without reading left.
+        GenericValue compareOp(OperatorEnum op, const GenericValue &left, const GenericValue &right,
+                               const ZoneMap *zones = nullptr) const;
+
+        GenericValue mathOp(OperatorEnum op, const GenericValue &left, const GenericValue &right) const;
 
-        GenericValue mathOp(const Query &query);
+        GenericValue absOp(const GenericValue &value) const;
 
-        GenericValue absOp(const Query &query);
+        GenericValue logicalOp(OperatorEnum op, const std::vector<const GenericValue *> &operands) const;
 
-        GenericValue logicalOp(const Query &query);
+        // AND/OR of node's operands in order, stopping once the result is decided for every row; ensure(k)
+        // evaluates what operand k reads. Operands other than bool[] are all evaluated and go to logicalOp.
+        GenericValue logicalShortCircuit(const PlanNode &node, const std::vector<const GenericValue *> &values,
+                                         const std::function<void(std::size_t)> &ensure) const;
 
-        GenericValue countOp(const Query &query);
+        GenericValue notOp(const GenericValue &value) const;
 
-        GenericValue aggregateOp(const Query &query);
+        GenericValue countOp(const GenericValue &value, const GenericValue &initialValue,
+                             const GenericValue &unit) const;
 
-        GenericValue jumpOp(const Query &query);
+        // COUNT of the rows from start to end, in seconds since the first row.
+        GenericValue countOp(const GenericValue &value, const GenericValue &initialValue, const GenericValue &unit,
+                             const GenericValue &start, const GenericValue &end) const;
 
-        GenericValue beforeOp(const Query &query);
+        // COUNT of the rows from start to end where both value and where are TRUE, without materializing
+        // their AND.
+        GenericValue countOp(const GenericValue &value, const GenericValue &initialValue, const GenericValue &unit,
+                             const GenericValue &start, const GenericValue &end, const GenericValue &where) const;
 
-        GenericValue afterOp(const Query &query);
+        GenericValue aggregateOp(OperatorEnum op, const GenericValue &value) const;
 
-        GenericValue holdOp(const Query &query);
+        // Aggregate of the rows from start to end, in seconds since the first row. With index, the range index
+        // of value's column, ranges without NaN rows are answered without scanning them.
+        GenericValue aggregateOp(OperatorEnum op, const GenericValue &value, const GenericValue &start,
+                                 const GenericValue &end, const RangeIndex *index = nullptr) const;
 
-        GenericValue durationOp(const Query &query);
+        // Aggregate of the rows from start to end where where is TRUE. The rows are read in place, one run
+        // of TRUE rows at a time, and runs of FALSE rows are skipped a word at a time.
+        GenericValue aggregateOp(OperatorEnum op, const GenericValue &value, const GenericValue &start,
+                                 const GenericValue &end, const GenericValue &where) const;
 
-        GenericValue selectOp(const Query &query);
+        // Aggregate of each row and the rows before it within duration, as numeric[].
+        GenericValue rollingOp(OperatorEnum op, const GenericValue &value, const GenericValue &duration) const;
+
+        // One row of SegmentTable::FIELDS numbers per run of TRUE rows of value, with MAX/MIN/AVG of target.
+        GenericValue segmentOp(const GenericValue &value, const GenericValue &target) const;
+
+        GenericValue jumpOp(const GenericValue &value, const GenericValue &from, const GenericValue &to) const;
+
+        GenericValue beforeOp() const;
+
+        GenericValue afterOp(const GenericValue &value, const GenericValue &from, const GenericValue &to,
+                             const GenericValue &duration) const;
+
+        GenericValue holdOp(const GenericValue &value, const GenericValue &from, const GenericValue &to,
+                            const GenericValue &duration) const;
+
+        GenericValue durationOp(const GenericValue &value, const GenericValue &minDuration) const;
+
+        GenericValue selectOp(uint32_t columnIndex) const;
 
         static bool holdsBool(const GenericValue &value) {
             return std::holds_alternative<BoolType>(value);
@@ -162,45 +244,150 @@ namespace ComputeLib {
             return std::holds_alternative<NumericVectorType>(value);
         }
 
-        static std::string getQueryType(const Query &query) {
-            if (!query.IsObject() || !query.HasMember("type") || !query["type"].IsString()) {
-                throw std::runtime_error("Could not find query type, invalid query format");
-            }
-            return query["type"].GetString();
+        static bool holdsNumericView(const GenericValue &value) {
+            return std::holds_alternative<NumericViewType>(value);
+        }
+
+        // numeric[] is either an owned NumericVectorType or a NumericViewType into the data source.
+        static bool holdsNumericArray(const GenericValue &value) {
+            return holdsNumericVector(value) || holdsNumericView(value);
         }
 
-        static std::string getQueryOperation(const Query &query) {
-            if (!query.IsObject() || !query.HasMember("operation") || !query["operation"].IsString()) {
-                throw std::runtime_error("Could not find query operation, invalid query format");
+        // Calls func with a std::span<const T> over a numeric[] value, T being its native element type, so
+        // kernels only widen single elements to NumericType instead of copying whole columns.
+        template<typename Func>
+        static auto visitNumericArray(const GenericValue &value, Func &&func) {
+            if (holdsNumericVector(value)) {
+                return func(std::span<const NumericType>(std::get<NumericVectorType>(value)));
             }
-            return query["operation"].GetString();
+            return std::visit(func, std::get<NumericViewType>(value));
         }
 
-        static bool isSameType(const std::vector<GenericValue> &vector, ValueType type);
+        static bool isSameType(const std::vector<const GenericValue *> &vector, ValueType type);
 
-        static bool isSameLength(const std::vector<GenericValue> &vector);
+        static bool isSameLength(const std::vector<const GenericValue *> &vector);
 
     private:
+        friend class Pipeline;
+        friend class StreamingQuery;
+
         uint32_t num_threads_;
+        std::unique_ptr<ThreadPool> pool_;
+        std::unique_ptr<BufferPool> buffers_;
+        std::size_t peakBytes_{0};
         int64_t timeIntervalPerRow_{100'000'000};
         const DataFrame *data{nullptr};
 
-        std::unordered_map<std::string, std::function<GenericValue(const Query &)> > operationMap_;
+        // Output buffers of the operators, recycled from earlier results where possible.
+        [[nodiscard]] BoolVectorType newBoolVector(const std::size_t size, const uint8_t value) const {
+            return buffers_->acquireBits(size, value);
+        }
 
-        [[nodiscard]] uint32_t calculateRowCount(NumericType totalTimeSeconds) const {
-            auto rowCount = static_cast<uint32_t>(totalTimeSeconds * 1e9 / timeIntervalPerRow_);
-            return rowCount;
+        [[nodiscard]] NumericVectorType newNumericVector(const std::size_t size, const NumericType value) const {
+            return buffers_->acquireNumeric(size, value);
+        }
+
+        // Runs func over [0, count) in MORSEL_SIZE pieces across the thread pool.
+        void parallelFor(const std::size_t count, const ThreadPool::RangeFunction &func) const {
+            pool_->parallelFor(count, MORSEL_SIZE, func);
+        }
+
+        // Deterministic reduction: partial(begin, end) per morsel, folded with combine in morsel order.
+        template<typename T, typename Partial, typename Combine>
+        T reduceMorsels(const std::size_t count, const T init, Partial &&partial, Combine &&combine) const {
+            std::vector<T> partials(ThreadPool::morselCount(count, MORSEL_SIZE), init);
+            parallelFor(count, [&](const std::size_t begin, const std::size_t end) {
+                partials[begin / MORSEL_SIZE] = partial(begin, end);
+            });
+            if (partials.empty()) {
+                return init;
+            }
+            T result = partials[0];
+            for (std::size_t i = 1; i < partials.size(); ++i) {
+                result = combine(result, partials[i]);
+            }
+            return result;
+        }
+
+        /*
+         * Runs a stateful row-by-row operator over rows [1, size) in chunks. Machine provides
+         *   State                     its state; State{} must be the state after any sync row
+         *   isSync(i)                 true if the state after row i does not depend on the state before it
+         *   scan(begin, end, s, out)  sequential reference over [begin, end), returns the final state
+         *   summarize(begin, end)     Transfer describing a chunk that has no sync rows
+         *   apply(transfer, s)        state after such a chunk when entering it in state s
+         * The output is bit-identical to a single sequential scan, whatever the thread count.
+         */
+        template<typename Machine>
+        void parallelScan(const Machine &machine, std::size_t size, BoolVectorType &result) const;
+
+        std::vector<GenericValue> execute(const CompiledQuery &plan, QueryProfile *profile,
+                                          const HardwareCounters *counters);
+
+        GenericValue evaluate(const PlanNode &node, const std::vector<const GenericValue *> &values,
+                              const std::vector<uint32_t> &columnBinding) const;
+
+        // Compare with a constant, JUMP, HOLD or AFTER over a run-length encoded value operand, in time
+        // linear in the number of runs plus the packed result. See CompiledQuery::readsRuns.
+        GenericValue runLengthOp(const PlanNode &node, const RunLengthColumn &column,
+                                 const std::vector<const GenericValue *> &values) const;
+
+        // Evaluates a fused group in one blocked pass and returns its root's value; an AND/OR root skips
+        // the blocks its first operands decide, and ensure(k) evaluates the deferred nodes operand k reads.
+        // Groups whose operand types the fused kernels do not cover are evaluated node by node instead.
+        GenericValue evaluateFused(const CompiledQuery &plan, const FusedGroup &group,
+                                   std::vector<GenericValue> &results, std::vector<const GenericValue *> &values,
+                                   const std::vector<uint32_t> &columnBinding,
+                                   const std::function<void(std::size_t)> &ensure) const;
+
+        // Zone map of the column that node reads if it is a SELECT, otherwise nullptr.
+        [[nodiscard]] const ZoneMap *columnZones(const CompiledQuery &plan, const uint32_t node,
+                                                 const std::vector<uint32_t> &columnBinding) const {
+            const PlanNode &select = plan.node(node);
+            if (select.kind != NodeKind::OPERATION || select.op != OperatorEnum::SELECT) {
+                return nullptr;
+            }
+            return data->getZoneMap(columnBinding[select.column]);
+        }
+
+        // Range index of the column that node reads if it is a SELECT, otherwise nullptr.
+        [[nodiscard]] const RangeIndex *columnRangeIndex(const CompiledQuery &plan, const uint32_t node,
+                                                         const std::vector<uint32_t> &columnBinding) const {
+            const PlanNode &select = plan.node(node);
+            if (select.kind != NodeKind::OPERATION || select.op != OperatorEnum::SELECT) {
+                return nullptr;
+            }
+            return &data->getRangeIndex(columnBinding[select.column]);
         }
 
-        [[nodiscard]] NumericVectorType getData(const std::string &name) const {
+        [[nodiscard]] std::vector<uint32_t> bindColumns(const CompiledQuery &plan) const {
+            std::vector<uint32_t> binding;
+            if (plan.columns().empty()) {
+                return binding;
+            }
             if (data == nullptr) {
                 throw std::runtime_error("No input data");
             }
-            const auto &column = data->getColumn(name);
-            NumericVectorType result = std::visit(
-                    [](const auto &vec) { return NumericVectorType(vec.begin(), vec.end()); }, column);
-            return result;
+            binding.reserve(plan.columns().size());
+            for (const auto &name: plan.columns()) {
+                binding.emplace_back(data->getColumnIndex(name));
+            }
+            return binding;
         }
+
+        // Rows [first, last) of the first rows rows whose time since the first row lies in [start, end)
+        // seconds.
+        [[nodiscard]] std::pair<std::size_t, std::size_t> rowRange(const GenericValue &start, const GenericValue &end,
+                                                                   std::size_t rows) const;
+
+        // Rows of the window of a rolling operator of duration seconds.
+        [[nodiscard]] std::size_t rollingRows(const GenericValue &duration) const;
+
+        [[nodiscard]] uint32_t calculateRowCount(NumericType totalTimeSeconds) const {
+            auto rowCount = static_cast<uint32_t>(totalTimeSeconds * 1e9 / timeIntervalPerRow_);
+            return rowCount;
+        }
+
     };
 }
 
@@ -0,0 +1,60 @@
+#ifndef CPP_HARDWARE_COUNTERS_H
+#define CPP_HARDWARE_COUNTERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ComputeLib {
+    // Events HardwareCounters counts, in the order of CounterValues.
+    enum class CounterEvent {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_READ_MISSES,
+        LLC_MISSES,
+        BRANCH_MISSES,
+        TASK_CLOCK_NS
+    };
+
+    static constexpr std::size_t COUNTER_EVENTS = 6;
+
+    using CounterValues = std::array<uint64_t, COUNTER_EVENTS>;
+
+    // Name of event in profiles, e.g. "branchMisses".
+    const char *getCounterEventName(CounterEvent event);
+
+    /*
+     * Linux perf_event_open counters, one group per thread, counting user-space events only. Groups are
+     * attached to the given threads (kernel ids, see currentSystemThreadId) and read from any thread, so
+     * an operator's events on the pool workers are summed with those of the calling thread. Events the
+     * CPU or the virtual machine does not expose are left out; the constructor throws if none can be
+     * opened, e.g. with perf_event_paranoid above 2 or outside Linux.
+     */
+    class HardwareCounters {
+    public:
+        explicit HardwareCounters(std::span<const int64_t> threadIds);
+
+        ~HardwareCounters();
+
+        HardwareCounters(const HardwareCounters &) = delete;
+
+        HardwareCounters &operator=(const HardwareCounters &) = delete;
+
+        [[nodiscard]] bool counts(const CounterEvent event) const {
+            return counted_[static_cast<std::size_t>(event)];
+        }
+
+        // Events so far, summed over the threads; events that are not counted stay 0.
+        [[nodiscard]] CounterValues read() const;
+
+    private:
+        std::array<bool, COUNTER_EVENTS> counted_{};
+        std::vector<CounterEvent> order_{}; // events of each group, in read order
+        std::vector<int> leaders_{};
+        std::vector<int> fds_{};
+    };
+}
+
+#endif //CPP_HARDWARE_COUNTERS_H
@@ -0,0 +1,44 @@
+#ifndef CPP_KERNELS_H
+#define CPP_KERNELS_H
+
+#include "bit_vector.h"
+#include "operator.h"
+#include <cstddef>
+
+namespace ComputeLib {
+    // Instruction sets with dedicated kernels, in increasing order of width.
+    enum class SimdLevel {
+        SCALAR,
+        SSE42,
+        AVX2,
+        AVX512
+    };
+
+    // Widest level supported by this CPU and OS, probed once with CPUID.
+    SimdLevel detectSimdLevel();
+
+    // Level the kernels dispatch to; starts out as detectSimdLevel().
+    SimdLevel getSimdLevel();
+
+    // Selects a level for the following kernel calls, clamped to detectSimdLevel(). Returns the level in effect.
+    SimdLevel setSimdLevel(SimdLevel level);
+
+    const char *getSimdLevelName(SimdLevel level);
+
+    /*
+     * Element-wise kernels over NumericType arrays of count elements. right is either an array of count
+     * elements or nullptr, in which case scalar is used as the right operand of every element.
+     * compareKernel writes BitVector::wordCount(count) whole words to mask, bit i holding
+     * op(left[i], right[i]); the bits past count in the last word are zero.
+     * POW has no vector instruction and always runs the scalar kernel.
+     */
+    void compareKernel(OperatorEnum op, const NumericType *left, const NumericType *right, NumericType scalar,
+                       std::size_t count, BitVector::Word *mask);
+
+    void mathKernel(OperatorEnum op, const NumericType *left, const NumericType *right, NumericType scalar,
+                    std::size_t count, NumericType *out);
+
+    void absKernel(const NumericType *value, std::size_t count, NumericType *out);
+}
+
+#endif //CPP_KERNELS_H
@@ -1,6 +1,8 @@
 #ifndef CPP_OPERATOR_H
 #define CPP_OPERATOR_H
 
+#include "bit_vector.h"
+#include "data_frame.h"
 #include "rapidjson/document.h"
 #include <vector>
 #include <variant>
@@ -23,10 +25,18 @@ namespace ComputeLib {
         ABS,
         AND,
         OR,
+        NOT,
         COUNT,
         MAX,
         MIN,
         AVG,
+        SUM,
+        ROLLING_MAX,
+        ROLLING_MIN,
+        ROLLING_AVG,
+        ROLLING_SUM,
+        ROLLING_COUNT,
+        SEGMENT_AGG,
         JUMP,
         BEFORE,
         AFTER,
@@ -39,18 +49,25 @@ namespace ComputeLib {
         BOOL_TYPE,
         NUMERIC_TYPE,
         BOOL_VECTOR_TYPE,
-        NUMERIC_VECTOR_TYPE
+        NUMERIC_VECTOR_TYPE,
+        NUMERIC_VIEW_TYPE
     };
 
     using Query = rapidjson::Value;
     using BoolType = uint8_t;
     using NumericType = double;
-    using BoolVectorType = std::vector<BoolType>;
+    // bool[]: one bit per row, see BitVector.
+    using BoolVectorType = BitVector;
     using NumericVectorType = std::vector<NumericType>;
+    // SELECT result: a view into DataFrame storage in the column's native element type.
+    using NumericViewType = ColumnView;
 
-    using GenericValue = std::variant<BoolType, NumericType, BoolVectorType, NumericVectorType>;
+    using GenericValue = std::variant<BoolType, NumericType, BoolVectorType, NumericVectorType, NumericViewType>;
 
     OperatorEnum getOperatorEnum(const std::string &str);
+
+    // Name of op in queries, e.g. "GT".
+    const char *getOperatorName(OperatorEnum op);
 }
 
 
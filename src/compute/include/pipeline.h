@@ -0,0 +1,168 @@
+#ifndef CPP_PIPELINE_H
+#define CPP_PIPELINE_H
+
+#include "executor.h"
+#include "operator.h"
+#include "plan.h"
+#include "state_machine.h"
+#include "value_set.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace ComputeLib {
+    /*
+     * Streams the rows of the data source through the part of a plan that a set of target nodes
+     * depends on, one batch at a time. A row-valued operator only buffers the rows its consumers have
+     * not read yet and keeps the state that carries across batches: the HOLD and AFTER machine state,
+     * the previous JUMP sample, the open DURATION run, the rolling windows and the running aggregates.
+     * DURATION and HOLD with a negative duration publish a row once later rows have settled it, so
+     * their consumers may lag behind the source.
+     *
+     * Targets are either COUNT/MAX/MIN/AVG/SUM/SEGMENT_AGG nodes, whose value is known after finish(),
+     * or row-valued nodes, whose rows are kept until they are taken or drained. Aggregates may only feed
+     * other nodes once they are known, see Executor::runPipelined. Drained, SEGMENT_AGG gives the runs
+     * that have ended so far.
+     */
+    class Pipeline {
+    public:
+        /*
+         * How a plan splits into passes over the data source. A streamed node is row-valued and depends
+         * on the data source. An aggregate over streamed rows is only known once its pass has seen every
+         * row, so the nodes reading it are streamed in a later pass: pass[i] is the pass that streams
+         * node i, or the first pass in which a scalar node i is known.
+         */
+        struct PassPlan {
+            std::vector<bool> streamed{};
+            std::vector<bool> aggregated{};
+            std::vector<uint32_t> pass{};
+        };
+
+        static PassPlan planPasses(const CompiledQuery &plan);
+
+        // Evaluates the nodes that only depend on constants and known aggregates, up to the root.
+        static void evaluateScalars(const Executor &executor, const CompiledQuery &plan, const PassPlan &passes,
+                                    std::vector<GenericValue> &results, std::vector<const GenericValue *> &values,
+                                    const std::vector<uint32_t> &columnBinding);
+
+        // known[i] is the value of node i when an earlier pass computed it, nullptr otherwise.
+        Pipeline(const Executor &executor, const CompiledQuery &plan, const std::vector<uint32_t> &targets,
+                 const std::vector<const GenericValue *> &known, const std::vector<uint32_t> &columnBinding);
+
+        // Evaluates the source rows up to rowCount that earlier calls have not seen.
+        void advance(std::size_t rowCount);
+
+        // Settles the rows held back by DURATION and reverse HOLD and the aggregates at the end of the source.
+        void finish();
+
+        // Value of a target, after finish().
+        GenericValue take(uint32_t node);
+
+        // Rows of a row-valued target published since the last drain, or the value of an aggregate
+        // target over the rows seen so far.
+        GenericValue drain(uint32_t node);
+
+        // Whether operand k of node is read row by row; the others are per-query parameters.
+        static bool isRowInput(const PlanNode &node, std::size_t k);
+
+        static bool isAggregate(OperatorEnum op);
+
+    private:
+        enum class Role {
+            UNUSED,
+            VALUE,     // known before streaming: constants, earlier results, operators over those
+            SOURCE,    // SELECT, read straight from the data source
+            STREAM,    // row-valued operator over source rows
+            AGGREGATE  // COUNT/MAX/MIN/AVG/SUM/SEGMENT_AGG over source rows
+        };
+
+        struct NodeState {
+            Role role{Role::UNUSED};
+            bool target{false};
+            std::vector<uint32_t> consumers{};
+
+            // Buffered output rows [begin, end); rows before begin were read by every consumer.
+            std::size_t begin{0};
+            std::size_t end{0};
+            bool boolRows{false};
+            BoolVectorType bits{};
+            NumericVectorType numbers{};
+
+            // Rows of the row inputs read so far.
+            std::size_t consumed{0};
+
+            // Parameters, decoded once.
+            uint32_t threshold{0};
+            NumericType fromVal{0};
+            NumericType toVal{0};
+            ValueSet fromValues{};
+            ValueSet toValues{};
+            bool reverse{false};
+
+            // Cross-batch state.
+            HoldState hold{};
+            AfterState after{};
+            std::size_t unsettled{0};   // HOLD with a negative duration: first row not published yet
+            std::size_t runLength{0};   // DURATION: length of the open TRUE run
+            std::size_t pendingRows{0}; // DURATION: rows of the open run not published yet
+            std::size_t count{0};       // COUNT: TRUE rows, MAX/MIN/AVG/SUM: rows read
+            std::size_t rangeBegin{0};  // aggregates: the rows they read
+            std::size_t rangeEnd{std::numeric_limits<std::size_t>::max()};
+            std::optional<RollingWindow> rolling{}; // ROLLING_MAX..COUNT
+            std::optional<SegmentTable> segments{}; // SEGMENT_AGG: the runs seen so far
+            std::optional<SegmentTable::Piece> piece{}; // SEGMENT_AGG: rows of the open run in the current morsel
+            NumericType partial{0};     // MAX/MIN/AVG/SUM of the open morsel
+            bool partialOpen{false};
+            bool nanFirst{false};       // MAX/MIN: the first row read is NaN, which makes the result NaN
+            NumericType total{0};       // partials of the finished morsels, combined in morsel order
+            bool hasTotal{false};
+            GenericValue value{};
+        };
+
+        const Executor &executor_;
+        const CompiledQuery &plan_;
+        const std::vector<uint32_t> &columnBinding_;
+        std::vector<NodeState> states_{};
+        std::vector<GenericValue> results_{};
+        std::vector<const GenericValue *> values_{};
+        std::vector<GenericValue> windows_{};
+        std::vector<const GenericValue *> operands_{};
+        std::size_t rowCount_{0};
+
+        void prepare(uint32_t index);
+
+        void step(uint32_t index, bool finishing);
+
+        void stepStateful(uint32_t index, std::size_t from, std::size_t to);
+
+        void stepRolling(uint32_t index, std::size_t from, std::size_t to);
+
+        void stepSegments(uint32_t index, std::size_t from, std::size_t to, bool finishing);
+
+        void stepReverseHold(uint32_t index, std::size_t to, bool finishing);
+
+        void stepDuration(uint32_t index, std::size_t from, std::size_t to, bool finishing);
+
+        void stepAggregate(uint32_t index, std::size_t from, std::size_t to, bool finishing);
+
+        // MAX/MIN/AVG/SUM or COUNT over the rows read so far.
+        [[nodiscard]] NumericType aggregateValue(uint32_t index) const;
+
+        void trim();
+
+        // Rows [from, to) of a row input, as the operators expect them.
+        [[nodiscard]] GenericValue window(uint32_t index, std::size_t from, std::size_t to) const;
+
+        // Rows a node can read from its row inputs.
+        [[nodiscard]] std::size_t available(uint32_t index) const;
+
+        // First row of its row inputs that a node still needs.
+        [[nodiscard]] std::size_t keepFrom(uint32_t index) const;
+
+        static void appendRows(NodeState &state, GenericValue &&rows);
+    };
+}
+
+#endif //CPP_PIPELINE_H
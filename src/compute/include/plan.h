@@ -0,0 +1,188 @@
+#ifndef CPP_PLAN_H
+#define CPP_PLAN_H
+
+#include "operator.h"
+#include "rapidjson/document.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ComputeLib {
+    class CostModel;
+
+    // PlanNode::group of nodes that are not part of a fused group.
+    static constexpr uint32_t NO_GROUP = UINT32_MAX;
+
+    // No node, e.g. the AND/OR a node that is not deferred is deferred to.
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+    enum class NodeKind {
+        CONSTANT,
+        OPERATION
+    };
+
+    /*
+     * One node of a compiled query. Operands are stored as indices into the
+     * owning plan and always precede the node itself, in a fixed per-operator
+     * order:
+     *   EQ..GE, ADD..POW         [left, right]
+     *   ABS, NOT                 [value]
+     *   MAX, MIN, AVG, SUM       [value], [value, start, end] or [value, start, end, where]
+     *   AND, OR                  [operand, operand, ...]
+     *   COUNT                    [value, initialValue, unit], [..., start, end] or [..., start, end, where]
+     *   JUMP                     [value, from, to]
+     *   AFTER, HOLD              [value, from, to, duration]
+     *   DURATION                 [value, minDuration]
+     *   ROLLING_MAX..COUNT       [value, duration]
+     *   SEGMENT_AGG              [value, target]
+     *   BEFORE, SELECT           []
+     * start and end of an aggregate are seconds since the first row; a bound the query leaves out is a
+     * constant 0 or infinity. where is a bool[] condition, or a bool, that picks the rows of the range
+     * the aggregate reads.
+     */
+    struct PlanNode {
+        NodeKind kind{NodeKind::CONSTANT};
+        OperatorEnum op{OperatorEnum::SELECT};
+        std::vector<uint32_t> inputs{};
+        GenericValue constant{};
+        uint32_t column{0}; // SELECT only: index into CompiledQuery::columns()
+        uint32_t group{NO_GROUP}; // index into CompiledQuery::groups()
+    };
+
+    /*
+     * A subtree of element-wise operators (compare, math, ABS, NOT, AND, OR)
+     * whose inner nodes are only consumed inside the subtree. The executor
+     * runs it block by block in one pass and only materializes the root.
+     */
+    struct FusedGroup {
+        std::vector<uint32_t> nodes{};  // topological order, the root last
+        std::vector<uint32_t> inputs{}; // nodes outside the group that it reads
+    };
+
+    /*
+     * A query parsed once into a flat, topologically ordered node list.
+     * Constants are pre-parsed and SELECT names are interned into a column
+     * table, so a plan can be run any number of times against different
+     * data sources without touching the JSON again. Structurally identical
+     * subtrees are merged while compiling, so each is evaluated once per run.
+     *
+     * A batch of queries compiles into one plan with a root per query, so the
+     * columns and subexpressions the queries share are also evaluated once.
+     *
+     * Commutative operands are put into a canonical order, so they do not
+     * keep identical subtrees apart: compares get the constant on the right,
+     * and AND/OR operands are ordered by what costs predicts they cost per
+     * row they decide, so the executor short-circuits the expensive ones.
+     */
+    class CompiledQuery {
+    public:
+        static CompiledQuery compile(const Query &query, const CostModel *costs = nullptr);
+
+        static CompiledQuery compileBatch(std::span<const Query *const> queries, const CostModel *costs = nullptr);
+
+        [[nodiscard]] const std::vector<PlanNode> &nodes() const {
+            return nodes_;
+        }
+
+        [[nodiscard]] const PlanNode &node(uint32_t index) const {
+            return nodes_[index];
+        }
+
+        [[nodiscard]] const std::vector<std::string> &columns() const {
+            return columns_;
+        }
+
+        // Hash of the subtree below node that is the same for structurally identical subtrees of any plan.
+        [[nodiscard]] std::size_t fingerprint(const uint32_t node) const {
+            return fingerprints_[node];
+        }
+
+        // Root of the first query.
+        [[nodiscard]] uint32_t root() const {
+            return roots_.front();
+        }
+
+        // Root of each query, in the order they were compiled; identical queries share a root.
+        [[nodiscard]] const std::vector<uint32_t> &roots() const {
+            return roots_;
+        }
+
+        [[nodiscard]] const std::vector<FusedGroup> &groups() const {
+            return groups_;
+        }
+
+        // True for a SELECT whose consumers all read its column run by run (compare with a constant, JUMP,
+        // HOLD, AFTER), so a run-length encoded column need not be expanded for it.
+        [[nodiscard]] bool readsRuns(const uint32_t node) const {
+            return runReaders_[node];
+        }
+
+        /*
+         * True for a node that only operand k >= 1 of a short-circuiting AND/OR (one that is not an inner
+         * node of a fused group) reads, directly or through other such nodes. The executor skips it in
+         * plan order and evaluates deferredFor(and, k) only once the operands before it leave the result
+         * undecided.
+         */
+        [[nodiscard]] bool isDeferred(const uint32_t node) const {
+            return deferredTo_[node] != NO_NODE;
+        }
+
+        // Nodes, in plan order, that have to be evaluated before operand k of node can be read.
+        [[nodiscard]] std::span<const uint32_t> deferredFor(const uint32_t node, const std::size_t k) const {
+            const auto &operands = deferred_[node];
+            return k < operands.size() ? std::span<const uint32_t>(operands[k]) : std::span<const uint32_t>();
+        }
+
+        // Operation nodes whose last consumer is node: their results can be recycled once it is evaluated.
+        [[nodiscard]] const std::vector<uint32_t> &releases(uint32_t node) const {
+            return releases_[node];
+        }
+
+    private:
+        std::vector<PlanNode> nodes_{};
+        std::vector<std::string> columns_{};
+        std::vector<std::size_t> fingerprints_{};
+        std::vector<FusedGroup> groups_{};
+        std::vector<std::vector<uint32_t>> releases_{};
+        std::vector<bool> runReaders_{};
+        std::vector<uint32_t> deferredTo_{};
+        std::vector<std::vector<std::vector<uint32_t>>> deferred_{};
+        std::unordered_map<std::string, uint32_t> columnIndex_{};
+        std::unordered_multimap<std::size_t, uint32_t> nodeIndex_{};
+        std::vector<uint32_t> roots_{};
+        const CostModel *costs_{nullptr}; // only while compiling
+
+        uint32_t compileNode(const Query &query);
+
+        uint32_t compileConstant(const Query &value);
+
+        uint32_t compileOperation(const Query &query);
+
+        // Appends the "start" and "end" of an aggregate to its operands if the query has either or a
+        // "where", and then the "where".
+        void compileRange(const Query &query, PlanNode &node);
+
+        // Puts the operands of a commutative node into canonical order.
+        void orderOperands(PlanNode &node) const;
+
+        uint32_t addNode(PlanNode &&node);
+
+        uint32_t internColumn(const std::string &name);
+
+        // isRoot[i] for every node i.
+        [[nodiscard]] std::vector<bool> rootMask() const;
+
+        void fuseElementWise();
+
+        void planShortCircuits();
+
+        void planLifetimes();
+
+        void planRunReaders();
+    };
+}
+
+#endif //CPP_PLAN_H
@@ -0,0 +1,77 @@
+#ifndef CPP_PROFILE_H
+#define CPP_PROFILE_H
+
+#include "hardware_counters.h"
+#include "operator.h"
+#include "plan.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ComputeLib {
+    // What one node of a plan cost, summed over the runs it was recorded in.
+    struct NodeProfile {
+        uint64_t nanoseconds{0};  // wall time; the root of a fused group carries the whole group
+        std::size_t executions{0};
+        std::size_t rowsIn{0};    // rows of the longest row-valued operand, or of the column for SELECT
+        std::size_t rowsOut{0};   // rows of a bool[] or numeric[] result, 1 for a scalar
+        std::size_t trueRows{0};  // TRUE rows of bool[] results
+        std::size_t bytes{0};     // result storage allocated
+        bool boolRows{false};
+        CounterValues counters{}; // events of QueryProfile::counts, on all threads
+
+        // Fraction of TRUE rows in the bool[] results, NaN for other results.
+        [[nodiscard]] double selectivity() const;
+    };
+
+    /*
+     * EXPLAIN ANALYZE of a plan. Executor::runProfiled adds what each node costs to its NodeProfile, and
+     * the plan tree can then be printed with the profile next to every operator, as text or as JSON.
+     * Subtrees shared by several consumers are printed in full once and referred to by node index after
+     * that; the inner nodes of a fused group refer to the group root, which carries their time.
+     *
+     * With hardwareCounters, runs also count CPU events per node through HardwareCounters, which makes
+     * runProfiled throw where perf events are not available.
+     */
+    class QueryProfile {
+    public:
+        explicit QueryProfile(CompiledQuery plan, bool hardwareCounters = false);
+
+        [[nodiscard]] const CompiledQuery &plan() const {
+            return plan_;
+        }
+
+        [[nodiscard]] const NodeProfile &node(const uint32_t index) const {
+            return nodes_[index];
+        }
+
+        [[nodiscard]] NodeProfile &node(const uint32_t index) {
+            return nodes_[index];
+        }
+
+        [[nodiscard]] bool countsHardwareEvents() const {
+            return hardwareCounters_;
+        }
+
+        // True for the events NodeProfile::counters holds, once a run counted them.
+        [[nodiscard]] bool counts(const CounterEvent event) const {
+            return counted_[static_cast<std::size_t>(event)];
+        }
+
+        [[nodiscard]] std::string toText() const;
+
+        [[nodiscard]] std::string toJson() const;
+
+    private:
+        friend class Executor;
+
+        CompiledQuery plan_;
+        std::vector<NodeProfile> nodes_;
+        bool hardwareCounters_;
+        std::array<bool, COUNTER_EVENTS> counted_{};
+    };
+}
+
+#endif //CPP_PROFILE_H
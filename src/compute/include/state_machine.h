@@ -0,0 +1,522 @@
+#ifndef CPP_STATE_MACHINE_H
+#define CPP_STATE_MACHINE_H
+
+#include "operator.h"
+#include "value_set.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ComputeLib {
+    /*
+     * HOLD: a run starts on a row where start(i) holds and goes on while keep(i) holds; rows that are
+     * at least threshold rows into the run are TRUE. start(i) implies keep(i), so a row failing keep(i)
+     * leaves the machine idle whatever state it entered the row in, which makes it a sync row for
+     * Executor::parallelScan.
+     */
+    struct HoldState {
+        bool findFlag{false};
+        uint32_t cnt{0};
+    };
+
+    template<typename Start, typename Keep>
+    struct HoldMachine {
+        using State = HoldState;
+
+        // Effect of a chunk without sync rows: every row satisfies keep(i).
+        struct Transfer {
+            State fromIdle{};
+            std::size_t length{0};
+        };
+
+        Start start;
+        Keep keep;
+        uint32_t threshold;
+
+        [[nodiscard]] bool isSync(const std::size_t i) const {
+            return !keep(i);
+        }
+
+        State scan(const std::size_t begin, const std::size_t end, State state, BoolVectorType *result) const {
+            for (std::size_t i = begin; i < end; ++i) {
+                if (!state.findFlag) {
+                    if (start(i)) {
+                        state.findFlag = true;
+                        state.cnt++;
+                    }
+                } else {
+                    if (keep(i)) {
+                        state.cnt++;
+                        if (state.cnt >= threshold && result != nullptr) {
+                            result->set(i);
+                        }
+                    } else {
+                        state.cnt = 0;
+                        state.findFlag = false;
+                    }
+                }
+            }
+            return state;
+        }
+
+        [[nodiscard]] Transfer summarize(const std::size_t begin, const std::size_t end) const {
+            return {scan(begin, end, State{}, nullptr), end - begin};
+        }
+
+        /*
+         * Same as scan over count rows that each read what row i reads, for a run of equal values. The
+         * TRUE rows are reported as mark(begin, end), offsets into the count rows.
+         */
+        template<typename Mark>
+        State repeat(const std::size_t i, const std::size_t count, State state, Mark &&mark) const {
+            if (count == 0) {
+                return state;
+            }
+            std::size_t first = 0;
+            if (!state.findFlag) {
+                if (!start(i)) {
+                    return state;
+                }
+                state.findFlag = true;
+                state.cnt++;
+                first = 1;
+            } else if (!keep(i)) {
+                // start(i) implies keep(i), so the rows after the one that ends the run stay idle.
+                return State{};
+            }
+            // Every other row keeps the run going; after j + 1 of them cnt has grown by j + 1.
+            const std::size_t rest = count - first;
+            const std::size_t before = threshold > state.cnt ? threshold - state.cnt - 1 : 0;
+            if (before < rest) {
+                mark(first + before, count);
+            }
+            state.cnt += static_cast<uint32_t>(rest);
+            return state;
+        }
+
+        static State apply(const Transfer &transfer, const State &carry) {
+            if (carry.findFlag) {
+                return {true, carry.cnt + static_cast<uint32_t>(transfer.length)};
+            }
+            return transfer.fromIdle;
+        }
+    };
+
+    /*
+     * AFTER: arms when the value crosses into the from side, then counts rows once it reaches the to
+     * side. beforeFrom(x) is "x has not reached fromVal", reachedFrom(x) "x has reached fromVal" and
+     * beforeTo(x) "x has not reached toVal", with the direction of the comparison depending on whether
+     * fromVal < toVal. All three are plain comparisons, so a NaN row satisfies none of them: it neither
+     * arms nor disarms the machine, and an armed machine counts it. A row where beforeFrom holds always
+     * disarms the machine, so it is a sync row.
+     */
+    struct AfterState {
+        bool findFromFlag{false};
+        bool findToFlag{false};
+        uint32_t cnt{0};
+    };
+
+    template<typename T, typename BeforeFrom, typename ReachedFrom, typename BeforeTo>
+    struct AfterMachine {
+        using State = AfterState;
+
+        // Effect of a chunk without sync rows for each kind of carry-in state. A counting carry-in only
+        // differs from fromCounting in cnt until it stops counting.
+        struct Transfer {
+            State fromIdle{};
+            State fromArmed{};
+            State fromCounting{};
+            bool countingStopped{false};
+            std::size_t length{0};
+        };
+
+        std::span<const T> valueVec;
+        BeforeFrom beforeFrom;
+        ReachedFrom reachedFrom;
+        BeforeTo beforeTo;
+        uint32_t threshold;
+
+        [[nodiscard]] bool isSync(const std::size_t i) const {
+            return beforeFrom(valueVec[i]);
+        }
+
+        State scan(const std::size_t begin, const std::size_t end, State state, BoolVectorType *result) const {
+            for (std::size_t i = begin; i < end; ++i) {
+                if (!state.findFromFlag) {
+                    if (reachedFrom(valueVec[i]) && beforeFrom(valueVec[i - 1])) {
+                        state.findFromFlag = true;
+                    }
+                } else if (beforeFrom(valueVec[i])) {
+                    state = State{};
+                } else if (beforeTo(valueVec[i])) {
+                    // between fromVal and toVal
+                    if (state.findToFlag) {
+                        state = State{};
+                    }
+                } else {
+                    if (!state.findToFlag) {
+                        state.findToFlag = true;
+                        state.cnt = 0;
+                    }
+                    state.cnt++;
+                    if (result != nullptr) {
+                        result->set(i, state.cnt >= threshold);
+                    }
+                }
+            }
+            return state;
+        }
+
+        [[nodiscard]] Transfer summarize(const std::size_t begin, const std::size_t end) const {
+            Transfer transfer;
+            transfer.length = end - begin;
+            transfer.fromIdle = scan(begin, end, State{}, nullptr);
+            transfer.fromArmed = scan(begin, end, State{true, false, 0}, nullptr);
+            // Without sync rows, a counting machine only stops on a row between fromVal and toVal and is idle after it.
+            std::size_t stop = begin;
+            while (stop < end && !beforeTo(valueVec[stop])) {
+                ++stop;
+            }
+            transfer.countingStopped = stop < end;
+            transfer.fromCounting = transfer.countingStopped
+                                        ? scan(stop + 1, end, State{}, nullptr)
+                                        : State{true, true, static_cast<uint32_t>(transfer.length)};
+            return transfer;
+        }
+
+        /*
+         * Same as scan over count rows with the value of row i, the first of them preceded by row i - 1
+         * and the others by a row of the same value. The TRUE rows are reported as mark(begin, end),
+         * offsets into the count rows.
+         */
+        template<typename Mark>
+        State repeat(const std::size_t i, const std::size_t count, State state, Mark &&mark) const {
+            if (count == 0) {
+                return state;
+            }
+            const T x = valueVec[i];
+            std::size_t first = 0;
+            if (!state.findFromFlag) {
+                // Only a row preceded by another value can arm the machine.
+                if (!reachedFrom(x) || !beforeFrom(valueVec[i - 1])) {
+                    return state;
+                }
+                state.findFromFlag = true;
+                first = 1;
+                if (count == 1) {
+                    return state;
+                }
+            }
+            if (beforeFrom(x)) {
+                return State{};
+            }
+            if (beforeTo(x)) {
+                // between fromVal and toVal
+                return state.findToFlag ? State{} : state;
+            }
+            if (!state.findToFlag) {
+                state.findToFlag = true;
+                state.cnt = 0;
+            }
+            const std::size_t rest = count - first;
+            const std::size_t before = threshold > state.cnt ? threshold - state.cnt - 1 : 0;
+            if (before < rest) {
+                mark(first + before, count);
+            }
+            state.cnt += static_cast<uint32_t>(rest);
+            return state;
+        }
+
+        static State apply(const Transfer &transfer, const State &carry) {
+            if (!carry.findFromFlag) {
+                return transfer.fromIdle;
+            }
+            if (!carry.findToFlag) {
+                return transfer.fromArmed;
+            }
+            if (transfer.countingStopped) {
+                return transfer.fromCounting;
+            }
+            return {true, true, carry.cnt + transfer.fromCounting.cnt};
+        }
+    };
+
+    template<typename T, typename BeforeFrom, typename ReachedFrom, typename BeforeTo>
+    AfterMachine(std::span<const T>, BeforeFrom, ReachedFrom, BeforeTo, uint32_t)
+        -> AfterMachine<T, BeforeFrom, ReachedFrom, BeforeTo>;
+
+    /*
+     * ROLLING_MAX/MIN/AVG/SUM/COUNT: the aggregate of each row and the rows before it, rows rows in all,
+     * with rows pushed one at a time in amortized O(1). MAX and MIN keep a monotonic deque of the rows
+     * that can still be the extreme of a later window. SUM, AVG and COUNT keep a running sum of the
+     * finite rows, summed afresh from the window after every row i with (i + 1) % rows == 0 so rounding
+     * errors cannot pile up, and after a row leaves that dwarfs what is left of the sum, which it may
+     * have absorbed on the way in. Infinite rows are only tracked like NaN rows, so their leaving cannot
+     * turn the sum into NaN. A window holding a NaN row, or both an inf and a -inf row, is NaN.
+     */
+    class RollingWindow {
+    public:
+        // A window whose next row is first.
+        RollingWindow(const OperatorEnum op, const std::size_t rows, const std::size_t first)
+            : op_(op), rows_(rows), next_(first), ring_(isExtreme(op) ? 0 : rows, 0) {
+        }
+
+        /*
+         * First row to push for the results from row begin on to match, bit for bit, those of a window
+         * that was pushed every row: the rows of begin's window and those since the last fresh sum.
+         */
+        [[nodiscard]] static std::size_t warmUpFrom(const std::size_t begin, const std::size_t rows) {
+            return begin < rows ? 0 : (begin / rows - 1) * rows;
+        }
+
+        // Pushes the next row and returns the aggregate of the window that ends with it.
+        NumericType push(const NumericType value) {
+            const std::size_t row = next_++;
+            const bool nan = std::isnan(value);
+            if (nan) {
+                nanEnd_ = row + rows_;
+            }
+            if (isExtreme(op_)) {
+                const bool max = op_ == OperatorEnum::ROLLING_MAX;
+                if (!nan) {
+                    while (!extremes_.empty() && (max ? extremes_.back().second <= value
+                                                      : extremes_.back().second >= value)) {
+                        extremes_.pop_back();
+                    }
+                    extremes_.emplace_back(row, value);
+                }
+                while (!extremes_.empty() && extremes_.front().first + rows_ <= row) {
+                    extremes_.pop_front();
+                }
+                return row < nanEnd_ ? std::numeric_limits<NumericType>::quiet_NaN() : extremes_.front().second;
+            }
+
+            if (std::isinf(value)) {
+                (value > 0 ? infEnd_ : negInfEnd_) = row + rows_;
+            }
+            NumericType &slot = ring_[row % rows_];
+            const NumericType removed = slot;
+            const NumericType added = std::isfinite(value) ? value : 0;
+            sum_ = sum_ + added - removed;
+            slot = added;
+            if ((row + 1) % rows_ == 0 || std::abs(removed) > DOMINANCE * std::abs(sum_)) {
+                resum(row);
+            }
+            if (row < nanEnd_ || (row < infEnd_ && row < negInfEnd_)) {
+                return std::numeric_limits<NumericType>::quiet_NaN();
+            }
+            if (row < infEnd_ || row < negInfEnd_) {
+                return row < infEnd_ ? std::numeric_limits<NumericType>::infinity()
+                                     : -std::numeric_limits<NumericType>::infinity();
+            }
+            if (op_ == OperatorEnum::ROLLING_AVG) {
+                return sum_ / static_cast<NumericType>(std::min(row + 1, rows_));
+            }
+            return sum_;
+        }
+
+    private:
+        // A row leaving the sum is said to dwarf it past this ratio, losing a few bits of the sum at most.
+        static constexpr NumericType DOMINANCE = 1 << 16;
+
+        OperatorEnum op_;
+        std::size_t rows_;
+        std::size_t next_;
+        std::size_t nanEnd_{0}; // first row whose window holds no NaN row pushed so far
+        std::size_t infEnd_{0}; // same for inf rows
+        std::size_t negInfEnd_{0}; // same for -inf rows
+        std::deque<std::pair<std::size_t, NumericType> > extremes_{}; // MAX/MIN: rows and values, by row
+        std::vector<NumericType> ring_{}; // SUM/AVG/COUNT: the window, row i in slot i % rows, NaN and inf as 0
+        NumericType sum_{0};
+
+        // Sums the window that ends with row afresh, in row order.
+        void resum(const std::size_t row) {
+            const auto oldest = ring_.begin() + static_cast<std::ptrdiff_t>((row + 1) % rows_);
+            sum_ = std::accumulate(ring_.begin(), oldest, std::accumulate(oldest, ring_.end(), NumericType{0}));
+        }
+
+        static bool isExtreme(const OperatorEnum op) {
+            return op == OperatorEnum::ROLLING_MAX || op == OperatorEnum::ROLLING_MIN;
+        }
+    };
+
+    /*
+     * One step of MAX and MIN over rows in order, passing over a NaN row on either side. Folded from the
+     * first row this is ranges::max and ranges::min, except that those are NaN when the first row is,
+     * which callers check on its own. Unlike theirs, the steps can fold morsels on their own and then
+     * combine the partials.
+     */
+    inline NumericType foldMax(const NumericType a, const NumericType b) {
+        return a < b || std::isnan(a) ? b : a;
+    }
+
+    inline NumericType foldMin(const NumericType a, const NumericType b) {
+        return b < a || std::isnan(a) ? b : a;
+    }
+
+    /*
+     * SEGMENT_AGG: one table row of FIELDS numbers per run of TRUE event rows, the start and exclusive
+     * end of the run in seconds since the first row, its duration in seconds and MAX, MIN and AVG of
+     * the target rows in it. Runs are fed in row order as pieces that do not cross a morsel boundary.
+     * A piece is reduced row by row and the pieces of a run are combined in morsel order, as
+     * Executor::aggregateOp reduces a column, so the table does not depend on how the morsels are
+     * scheduled.
+     */
+    class SegmentTable {
+    public:
+        static constexpr std::size_t FIELDS = 6;
+
+        // Rows [begin, end) of a run, all within one morsel.
+        struct Piece {
+            std::size_t begin{0};
+            std::size_t end{0};
+            NumericType max{0};
+            NumericType min{0};
+            NumericType sum{0};
+            bool nanFirst{false}; // the first row is NaN, so MAX and MIN of a run it starts are NaN
+        };
+
+        explicit SegmentTable(const int64_t intervalNs) : intervalNs_(static_cast<NumericType>(intervalNs)) {
+        }
+
+        // Piece of the non-empty rows from row first on.
+        template<typename T>
+        [[nodiscard]] static Piece scan(const std::size_t first, const std::span<const T> rows) {
+            const auto seed = static_cast<NumericType>(rows[0]);
+            Piece piece{first, first, seed, seed, 0, std::isnan(seed)};
+            extend(piece, rows);
+            return piece;
+        }
+
+        // Adds the rows that follow piece within its morsel.
+        template<typename T>
+        static void extend(Piece &piece, const std::span<const T> rows) {
+            for (const T row: rows) {
+                const auto x = static_cast<NumericType>(row);
+                piece.max = foldMax(piece.max, x);
+                piece.min = foldMin(piece.min, x);
+                piece.sum = piece.sum + x;
+            }
+            piece.end += rows.size();
+        }
+
+        // Adds the next piece, which continues the open run if it starts where the run ends.
+        void add(const Piece &piece) {
+            if (open_ && run_.end == piece.begin) {
+                run_.max = foldMax(run_.max, piece.max);
+                run_.min = foldMin(run_.min, piece.min);
+                run_.sum = run_.sum + piece.sum;
+                run_.end = piece.end;
+                return;
+            }
+            close();
+            run_ = piece;
+            open_ = true;
+        }
+
+        // Closes the open run if it ends before row, that is, if row is past a FALSE row.
+        void settle(const std::size_t row) {
+            if (open_ && run_.end < row) {
+                close();
+            }
+        }
+
+        // Appends the open run to the table.
+        void close() {
+            if (!open_) {
+                return;
+            }
+            const NumericType start = static_cast<NumericType>(run_.begin) * intervalNs_ / 1e9;
+            const NumericType end = static_cast<NumericType>(run_.end) * intervalNs_ / 1e9;
+            const NumericType nan = std::numeric_limits<NumericType>::quiet_NaN();
+            table_.insert(table_.end(), {start, end, end - start, run_.nanFirst ? nan : run_.max,
+                                         run_.nanFirst ? nan : run_.min,
+                                         run_.sum / static_cast<NumericType>(run_.end - run_.begin)});
+            open_ = false;
+        }
+
+        // The closed runs, FIELDS numbers each.
+        [[nodiscard]] const NumericVectorType &rows() const {
+            return table_;
+        }
+
+        NumericVectorType take() {
+            return std::move(table_);
+        }
+
+    private:
+        NumericType intervalNs_;
+        Piece run_{};
+        bool open_{false};
+        NumericVectorType table_{};
+    };
+
+    /*
+     * Calls func with the HOLD machine over the values at(i), picking start and keep from which of
+     * fromValues and toValues are given. at may read the rows in either direction, and returns them in
+     * the column's own type so integer rows are looked up without conversion.
+     */
+    template<typename At, typename Func>
+    void withHoldMachine(const ValueSet &fromValues, const ValueSet &toValues, const uint32_t threshold, At &&at,
+                         Func &&func) {
+        const auto isFrom = [&](const std::size_t i) { return fromValues.contains(at(i)); };
+        const auto isTo = [&](const std::size_t i) { return toValues.contains(at(i)); };
+
+        if (!fromValues.empty() && toValues.empty()) {
+            // fromVal -> Any
+            func(HoldMachine{
+                [&](const std::size_t i) { return !isFrom(i) && isFrom(i - 1); },
+                [&](const std::size_t i) { return !isFrom(i); },
+                threshold
+            });
+        } else if (fromValues.empty() && !toValues.empty()) {
+            // Any -> toVal
+            func(HoldMachine{
+                [&](const std::size_t i) { return isTo(i) && !isTo(i - 1); },
+                isTo,
+                threshold
+            });
+        } else {
+            // fromVal -> toVal
+            func(HoldMachine{
+                [&](const std::size_t i) { return isTo(i) && isFrom(i - 1); },
+                isTo,
+                threshold
+            });
+        }
+    }
+
+    // Calls func with the AFTER machine over valueVec for the direction given by fromVal and toVal.
+    template<typename T, typename Func>
+    void withAfterMachine(const std::span<const T> valueVec, const NumericType fromVal, const NumericType toVal,
+                          const uint32_t threshold, Func &&func) {
+        if (fromVal < toVal) {
+            // e.g. 5 -> 10
+            func(AfterMachine{
+                valueVec,
+                [fromVal](const T x) { return static_cast<NumericType>(x) < fromVal; },
+                [fromVal](const T x) { return static_cast<NumericType>(x) >= fromVal; },
+                [toVal](const T x) { return static_cast<NumericType>(x) < toVal; },
+                threshold
+            });
+        } else {
+            // fromVal > toVal, e.g. 10 -> 5
+            func(AfterMachine{
+                valueVec,
+                [fromVal](const T x) { return static_cast<NumericType>(x) > fromVal; },
+                [fromVal](const T x) { return static_cast<NumericType>(x) <= fromVal; },
+                [toVal](const T x) { return static_cast<NumericType>(x) > toVal; },
+                threshold
+            });
+        }
+    }
+}
+
+#endif //CPP_STATE_MACHINE_H
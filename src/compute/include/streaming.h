@@ -0,0 +1,61 @@
+#ifndef CPP_STREAMING_H
+#define CPP_STREAMING_H
+
+#include "executor.h"
+#include "operator.h"
+#include "pipeline.h"
+#include "plan.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ComputeLib {
+    /*
+     * Evaluates a query over a data source that grows with DataFrame::appendRows. Each update() only
+     * runs the operators over the rows appended since the previous one; the operator state that carries
+     * across rows is kept by a Pipeline, so an update costs time in the number of new rows rather than in
+     * the length of the history.
+     *
+     * A row-valued query returns the result rows settled by each update. DURATION and HOLD with a
+     * negative duration settle a row only once later rows decide it, so the result may lag behind the
+     * source; finish() settles the rest at the end of the stream. A query whose result is a scalar
+     * returns its value over all rows so far. Aggregates may not feed row-valued operators, since every
+     * new row would change their earlier output.
+     */
+    class StreamingQuery {
+    public:
+        // executor's data source is the growing frame; both must outlive the query.
+        StreamingQuery(const Executor &executor, const CompiledQuery &plan);
+
+        StreamingQuery(const StreamingQuery &) = delete;
+
+        StreamingQuery &operator=(const StreamingQuery &) = delete;
+
+        // Evaluates the rows appended since the last call, see the class comment for the result.
+        GenericValue update();
+
+        // Settles the rows held back at the end of the stream. The query cannot be updated afterwards.
+        GenericValue finish();
+
+        // Rows of a row-valued result returned so far.
+        [[nodiscard]] std::size_t settledRows() const {
+            return settledRows_;
+        }
+
+    private:
+        const Executor &executor_;
+        const CompiledQuery &plan_;
+        std::vector<uint32_t> columnBinding_{};
+        Pipeline::PassPlan passes_{};
+        std::vector<const GenericValue *> constants_{};
+        std::vector<uint32_t> aggregates_{};
+        std::unique_ptr<Pipeline> pipeline_{};
+        std::size_t settledRows_{0};
+        bool finished_{false};
+
+        GenericValue collect();
+    };
+}
+
+#endif //CPP_STREAMING_H
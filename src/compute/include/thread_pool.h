@@ -0,0 +1,86 @@
+#ifndef CPP_THREAD_POOL_H
+#define CPP_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ComputeLib {
+    // Rows per morsel: 16K doubles is 128KB, which keeps a morsel and its output within L2.
+    static constexpr std::size_t MORSEL_SIZE = 16 * 1024;
+
+    // Kernel id of the calling thread (gettid on Linux), 0 where there is none.
+    int64_t currentSystemThreadId();
+
+    /*
+     * Fixed-size pool that splits a row range into morsels and hands them out
+     * to the workers and the calling thread. Morsel boundaries only depend on
+     * the row count and the morsel size, never on the number of threads, so
+     * per-morsel partial results can be combined deterministically.
+     */
+    class ThreadPool {
+    public:
+        using RangeFunction = std::function<void(std::size_t begin, std::size_t end)>;
+
+        // numThreads includes the calling thread; 0 picks the hardware concurrency.
+        explicit ThreadPool(uint32_t numThreads);
+
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        [[nodiscard]] uint32_t size() const {
+            return static_cast<uint32_t>(workers_.size()) + 1;
+        }
+
+        // currentSystemThreadId() of each worker, for tools that attach to threads such as HardwareCounters.
+        [[nodiscard]] const std::vector<int64_t> &workerThreadIds() const {
+            return workerThreadIds_;
+        }
+
+        static std::size_t morselCount(const std::size_t count, const std::size_t grainSize) {
+            return (count + grainSize - 1) / grainSize;
+        }
+
+        // Calls func once per morsel [k * grainSize, min((k + 1) * grainSize, count)) and blocks until all
+        // morsels are done. The first exception thrown by func is rethrown here.
+        void parallelFor(std::size_t count, std::size_t grainSize, const RangeFunction &func);
+
+    private:
+        struct Job {
+            const RangeFunction *func{nullptr};
+            std::size_t count{0};
+            std::size_t grainSize{0};
+            std::size_t morsels{0};
+            std::atomic<std::size_t> next{0};
+            std::atomic<std::size_t> done{0};
+            std::exception_ptr error{};
+            std::mutex errorMutex{};
+        };
+
+        std::vector<std::thread> workers_{};
+        std::vector<int64_t> workerThreadIds_{};
+        std::mutex mutex_{};
+        std::mutex submitMutex_{};
+        std::condition_variable wake_{};
+        std::condition_variable finished_{};
+        Job *job_{nullptr};
+        uint64_t generation_{0};
+        uint32_t activeWorkers_{0};
+        bool stop_{false};
+
+        void workerLoop();
+
+        static void runMorsels(Job &job);
+    };
+}
+
+#endif //CPP_THREAD_POOL_H
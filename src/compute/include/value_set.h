@@ -0,0 +1,87 @@
+#ifndef CPP_VALUE_SET_H
+#define CPP_VALUE_SET_H
+
+#include "operator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+namespace ComputeLib {
+    /*
+     * Membership test for the from/to lists of JUMP and HOLD. The lists mostly name states such as
+     * gears or modes, so small non-negative integers are kept in a bit table that an integer row
+     * indexes directly, without widening it to NumericType or hashing it. Other members (negative,
+     * fractional, NaN or too large for the table) go to a hash set that rows outside the table fall
+     * back to. Matches as NumericType equality does: -0.0 is 0 and NaN is never a member.
+     */
+    class ValueSet {
+    public:
+        // The table always covers uint8_t, and grows to the largest small member beyond that.
+        static constexpr std::size_t MIN_TABLE_SIZE = 256;
+        static constexpr std::size_t MAX_TABLE_SIZE = std::size_t{1} << 16;
+
+        ValueSet() : ValueSet(std::span<const NumericType>{}) {}
+
+        explicit ValueSet(const std::span<const NumericType> values) : empty_(values.empty()) {
+            std::size_t size = MIN_TABLE_SIZE;
+            for (const NumericType value: values) {
+                if (inTable(value, MAX_TABLE_SIZE)) {
+                    size = std::max(size, static_cast<std::size_t>(value) + 1);
+                }
+            }
+            tableSize_ = (size + WORD_BITS - 1) / WORD_BITS * WORD_BITS;
+            table_.assign(tableSize_ / WORD_BITS, 0);
+            for (const NumericType value: values) {
+                if (inTable(value, tableSize_)) {
+                    const auto index = static_cast<std::size_t>(value);
+                    table_[index / WORD_BITS] |= uint64_t{1} << (index % WORD_BITS);
+                } else {
+                    others_.insert(value);
+                }
+            }
+        }
+
+        [[nodiscard]] bool empty() const {
+            return empty_;
+        }
+
+        template<typename T>
+        [[nodiscard]] bool contains(const T x) const {
+            if constexpr (std::is_integral_v<T>) {
+                // Negative values wrap around past the table.
+                const auto index = static_cast<std::make_unsigned_t<T>>(x);
+                if (std::numeric_limits<decltype(index)>::max() < MIN_TABLE_SIZE || index < tableSize_) {
+                    return test(index);
+                }
+            } else if (inTable(x, tableSize_)) {
+                return test(static_cast<std::size_t>(x));
+            }
+            return !others_.empty() && others_.contains(static_cast<NumericType>(x));
+        }
+
+    private:
+        static constexpr std::size_t WORD_BITS = 64;
+
+        template<typename T>
+        static bool inTable(const T value, const std::size_t size) {
+            return value >= 0 && value < static_cast<T>(size) && std::trunc(value) == value;
+        }
+
+        [[nodiscard]] bool test(const std::size_t index) const {
+            return (table_[index / WORD_BITS] >> (index % WORD_BITS) & 1) != 0;
+        }
+
+        std::vector<uint64_t> table_{};
+        std::size_t tableSize_{0};
+        std::unordered_set<NumericType> others_{};
+        bool empty_{true};
+    };
+}
+
+#endif //CPP_VALUE_SET_H
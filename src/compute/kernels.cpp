@@ -0,0 +1,478 @@
+#include "kernels.h"
+#include "executor.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define COMPUTE_X86_KERNELS
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit instructions of the ISA a function is compiled for; MSVC accepts any intrinsic.
+#if defined(__GNUC__) || defined(__clang__)
+#define COMPUTE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define COMPUTE_TARGET(isa)
+#endif
+
+using namespace ComputeLib;
+
+using Word = BitVector::Word;
+static constexpr std::size_t WORD_BITS = BitVector::WORD_BITS;
+
+template<OperatorEnum Op>
+static bool compareValues(const NumericType left, const NumericType right) {
+    if constexpr (Op == OperatorEnum::EQ) {
+        return compareEqual(left, right);
+    } else if constexpr (Op == OperatorEnum::NE) {
+        return compareNotEqual(left, right);
+    } else if constexpr (Op == OperatorEnum::LT) {
+        return compareLess(left, right);
+    } else if constexpr (Op == OperatorEnum::LE) {
+        return compareLessEqual(left, right);
+    } else if constexpr (Op == OperatorEnum::GT) {
+        return compareGreater(left, right);
+    } else {
+        return compareGreaterEqual(left, right);
+    }
+}
+
+template<OperatorEnum Op>
+static NumericType mathValues(const NumericType left, const NumericType right) {
+    if constexpr (Op == OperatorEnum::ADD) {
+        return mathAdd(left, right);
+    } else if constexpr (Op == OperatorEnum::SUB) {
+        return mathSub(left, right);
+    } else if constexpr (Op == OperatorEnum::MUL) {
+        return mathMul(left, right);
+    } else if constexpr (Op == OperatorEnum::DIV) {
+        return mathDiv(left, right);
+    } else {
+        return mathPow(left, right);
+    }
+}
+
+// Mask words for elements [begin, count), begin being a multiple of 64, one element at a time.
+template<OperatorEnum Op, bool HasRight>
+static void compareTail(const NumericType *left, const NumericType *right, const NumericType scalar,
+                        const std::size_t begin, const std::size_t count, Word *mask) {
+    for (std::size_t base = begin; base < count; base += WORD_BITS) {
+        const std::size_t end = std::min(count, base + WORD_BITS);
+        Word word = 0;
+        for (std::size_t i = base; i < end; ++i) {
+            const bool bit = compareValues<Op>(left[i], HasRight ? right[i] : scalar);
+            word |= static_cast<Word>(bit ? 1 : 0) << (i - base);
+        }
+        mask[base / WORD_BITS] = word;
+    }
+}
+
+template<OperatorEnum Op, bool HasRight>
+static void mathTail(const NumericType *left, const NumericType *right, const NumericType scalar,
+                     const std::size_t begin, const std::size_t count, NumericType *out) {
+    for (std::size_t i = begin; i < count; ++i) {
+        out[i] = mathValues<Op>(left[i], HasRight ? right[i] : scalar);
+    }
+}
+
+static void absTail(const NumericType *value, const std::size_t begin, const std::size_t count, NumericType *out) {
+    for (std::size_t i = begin; i < count; ++i) {
+        out[i] = std::abs(value[i]);
+    }
+}
+
+/*
+ * One struct per instruction set, all with the same static interface:
+ *   compare<Op, HasRight>(left, right, scalar, count, mask)
+ *   math<Op, HasRight>(left, right, scalar, count, out)
+ *   abs(value, count, out)
+ * The vector loops cover whole mask words / whole registers and leave the rest to the *Tail helpers.
+ * Intrinsics are kept out of lambdas and helper functions, which would not inherit the target attribute.
+ */
+struct ScalarKernels {
+    template<OperatorEnum Op, bool HasRight>
+    static void compare(const NumericType *left, const NumericType *right, const NumericType scalar,
+                        const std::size_t count, Word *mask) {
+        compareTail<Op, HasRight>(left, right, scalar, 0, count, mask);
+    }
+
+    template<OperatorEnum Op, bool HasRight>
+    static void math(const NumericType *left, const NumericType *right, const NumericType scalar,
+                     const std::size_t count, NumericType *out) {
+        mathTail<Op, HasRight>(left, right, scalar, 0, count, out);
+    }
+
+    static void abs(const NumericType *value, const std::size_t count, NumericType *out) {
+        absTail(value, 0, count, out);
+    }
+};
+
+#ifdef COMPUTE_X86_KERNELS
+// Ordered predicates, except NE which must hold for NaN like the scalar operator!= does.
+template<OperatorEnum Op>
+static constexpr int comparePredicate() {
+    if constexpr (Op == OperatorEnum::EQ) {
+        return _CMP_EQ_OQ;
+    } else if constexpr (Op == OperatorEnum::NE) {
+        return _CMP_NEQ_UQ;
+    } else if constexpr (Op == OperatorEnum::LT) {
+        return _CMP_LT_OQ;
+    } else if constexpr (Op == OperatorEnum::LE) {
+        return _CMP_LE_OQ;
+    } else if constexpr (Op == OperatorEnum::GT) {
+        return _CMP_GT_OQ;
+    } else {
+        return _CMP_GE_OQ;
+    }
+}
+
+struct Sse42Kernels {
+    template<OperatorEnum Op, bool HasRight>
+    COMPUTE_TARGET("sse4.2") static void compare(const NumericType *left, const NumericType *right,
+                                                 const NumericType scalar, const std::size_t count, Word *mask) {
+        const __m128d broadcast = _mm_set1_pd(scalar);
+        const std::size_t full = count - count % WORD_BITS;
+        for (std::size_t base = 0; base < full; base += WORD_BITS) {
+            Word word = 0;
+            for (std::size_t j = 0; j < WORD_BITS; j += 2) {
+                const __m128d l = _mm_loadu_pd(left + base + j);
+                const __m128d r = HasRight ? _mm_loadu_pd(right + base + j) : broadcast;
+                __m128d bits;
+                if constexpr (Op == OperatorEnum::EQ) {
+                    bits = _mm_cmpeq_pd(l, r);
+                } else if constexpr (Op == OperatorEnum::NE) {
+                    bits = _mm_cmpneq_pd(l, r);
+                } else if constexpr (Op == OperatorEnum::LT) {
+                    bits = _mm_cmplt_pd(l, r);
+                } else if constexpr (Op == OperatorEnum::LE) {
+                    bits = _mm_cmple_pd(l, r);
+                } else if constexpr (Op == OperatorEnum::GT) {
+                    bits = _mm_cmpgt_pd(l, r);
+                } else {
+                    bits = _mm_cmpge_pd(l, r);
+                }
+                word |= static_cast<Word>(static_cast<unsigned>(_mm_movemask_pd(bits))) << j;
+            }
+            mask[base / WORD_BITS] = word;
+        }
+        compareTail<Op, HasRight>(left, right, scalar, full, count, mask);
+    }
+
+    template<OperatorEnum Op, bool HasRight>
+    COMPUTE_TARGET("sse4.2") static void math(const NumericType *left, const NumericType *right,
+                                              const NumericType scalar, const std::size_t count, NumericType *out) {
+        const __m128d broadcast = _mm_set1_pd(scalar);
+        const std::size_t full = count - count % 2;
+        for (std::size_t i = 0; i < full; i += 2) {
+            const __m128d l = _mm_loadu_pd(left + i);
+            const __m128d r = HasRight ? _mm_loadu_pd(right + i) : broadcast;
+            if constexpr (Op == OperatorEnum::ADD) {
+                _mm_storeu_pd(out + i, _mm_add_pd(l, r));
+            } else if constexpr (Op == OperatorEnum::SUB) {
+                _mm_storeu_pd(out + i, _mm_sub_pd(l, r));
+            } else if constexpr (Op == OperatorEnum::MUL) {
+                _mm_storeu_pd(out + i, _mm_mul_pd(l, r));
+            } else {
+                _mm_storeu_pd(out + i, _mm_div_pd(l, r));
+            }
+        }
+        mathTail<Op, HasRight>(left, right, scalar, full, count, out);
+    }
+
+    COMPUTE_TARGET("sse4.2") static void abs(const NumericType *value, const std::size_t count, NumericType *out) {
+        const __m128d sign = _mm_set1_pd(-0.0);
+        const std::size_t full = count - count % 2;
+        for (std::size_t i = 0; i < full; i += 2) {
+            _mm_storeu_pd(out + i, _mm_andnot_pd(sign, _mm_loadu_pd(value + i)));
+        }
+        absTail(value, full, count, out);
+    }
+};
+
+struct Avx2Kernels {
+    template<OperatorEnum Op, bool HasRight>
+    COMPUTE_TARGET("avx2") static void compare(const NumericType *left, const NumericType *right,
+                                               const NumericType scalar, const std::size_t count, Word *mask) {
+        const __m256d broadcast = _mm256_set1_pd(scalar);
+        const std::size_t full = count - count % WORD_BITS;
+        for (std::size_t base = 0; base < full; base += WORD_BITS) {
+            Word word = 0;
+            for (std::size_t j = 0; j < WORD_BITS; j += 4) {
+                const __m256d l = _mm256_loadu_pd(left + base + j);
+                const __m256d r = HasRight ? _mm256_loadu_pd(right + base + j) : broadcast;
+                const __m256d bits = _mm256_cmp_pd(l, r, comparePredicate<Op>());
+                word |= static_cast<Word>(static_cast<unsigned>(_mm256_movemask_pd(bits))) << j;
+            }
+            mask[base / WORD_BITS] = word;
+        }
+        compareTail<Op, HasRight>(left, right, scalar, full, count, mask);
+    }
+
+    template<OperatorEnum Op, bool HasRight>
+    COMPUTE_TARGET("avx2") static void math(const NumericType *left, const NumericType *right,
+                                            const NumericType scalar, const std::size_t count, NumericType *out) {
+        const __m256d broadcast = _mm256_set1_pd(scalar);
+        const std::size_t full = count - count % 4;
+        for (std::size_t i = 0; i < full; i += 4) {
+            const __m256d l = _mm256_loadu_pd(left + i);
+            const __m256d r = HasRight ? _mm256_loadu_pd(right + i) : broadcast;
+            if constexpr (Op == OperatorEnum::ADD) {
+                _mm256_storeu_pd(out + i, _mm256_add_pd(l, r));
+            } else if constexpr (Op == OperatorEnum::SUB) {
+                _mm256_storeu_pd(out + i, _mm256_sub_pd(l, r));
+            } else if constexpr (Op == OperatorEnum::MUL) {
+                _mm256_storeu_pd(out + i, _mm256_mul_pd(l, r));
+            } else {
+                _mm256_storeu_pd(out + i, _mm256_div_pd(l, r));
+            }
+        }
+        mathTail<Op, HasRight>(left, right, scalar, full, count, out);
+    }
+
+    COMPUTE_TARGET("avx2") static void abs(const NumericType *value, const std::size_t count, NumericType *out) {
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        const std::size_t full = count - count % 4;
+        for (std::size_t i = 0; i < full; i += 4) {
+            _mm256_storeu_pd(out + i, _mm256_andnot_pd(sign, _mm256_loadu_pd(value + i)));
+        }
+        absTail(value, full, count, out);
+    }
+};
+
+struct Avx512Kernels {
+    template<OperatorEnum Op, bool HasRight>
+    COMPUTE_TARGET("avx512f") static void compare(const NumericType *left, const NumericType *right,
+                                                  const NumericType scalar, const std::size_t count, Word *mask) {
+        const __m512d broadcast = _mm512_set1_pd(scalar);
+        const std::size_t full = count - count % WORD_BITS;
+        for (std::size_t base = 0; base < full; base += WORD_BITS) {
+            Word word = 0;
+            for (std::size_t j = 0; j < WORD_BITS; j += 8) {
+                const __m512d l = _mm512_loadu_pd(left + base + j);
+                const __m512d r = HasRight ? _mm512_loadu_pd(right + base + j) : broadcast;
+                word |= static_cast<Word>(_mm512_cmp_pd_mask(l, r, comparePredicate<Op>())) << j;
+            }
+            mask[base / WORD_BITS] = word;
+        }
+        compareTail<Op, HasRight>(left, right, scalar, full, count, mask);
+    }
+
+    template<OperatorEnum Op, bool HasRight>
+    COMPUTE_TARGET("avx512f") static void math(const NumericType *left, const NumericType *right,
+                                               const NumericType scalar, const std::size_t count, NumericType *out) {
+        const __m512d broadcast = _mm512_set1_pd(scalar);
+        const std::size_t full = count - count % 8;
+        for (std::size_t i = 0; i < full; i += 8) {
+            const __m512d l = _mm512_loadu_pd(left + i);
+            const __m512d r = HasRight ? _mm512_loadu_pd(right + i) : broadcast;
+            if constexpr (Op == OperatorEnum::ADD) {
+                _mm512_storeu_pd(out + i, _mm512_add_pd(l, r));
+            } else if constexpr (Op == OperatorEnum::SUB) {
+                _mm512_storeu_pd(out + i, _mm512_sub_pd(l, r));
+            } else if constexpr (Op == OperatorEnum::MUL) {
+                _mm512_storeu_pd(out + i, _mm512_mul_pd(l, r));
+            } else {
+                _mm512_storeu_pd(out + i, _mm512_div_pd(l, r));
+            }
+        }
+        mathTail<Op, HasRight>(left, right, scalar, full, count, out);
+    }
+
+    COMPUTE_TARGET("avx512f") static void abs(const NumericType *value, const std::size_t count, NumericType *out) {
+        const std::size_t full = count - count % 8;
+        for (std::size_t i = 0; i < full; i += 8) {
+            _mm512_storeu_pd(out + i, _mm512_abs_pd(_mm512_loadu_pd(value + i)));
+        }
+        absTail(value, full, count, out);
+    }
+};
+#endif
+
+template<typename Kernels, OperatorEnum Op>
+static void compareWith(const NumericType *left, const NumericType *right, const NumericType scalar,
+                        const std::size_t count, Word *mask) {
+    if (right != nullptr) {
+        Kernels::template compare<Op, true>(left, right, scalar, count, mask);
+    } else {
+        Kernels::template compare<Op, false>(left, right, scalar, count, mask);
+    }
+}
+
+template<typename Kernels, OperatorEnum Op>
+static void mathWith(const NumericType *left, const NumericType *right, const NumericType scalar,
+                     const std::size_t count, NumericType *out) {
+    if (right != nullptr) {
+        Kernels::template math<Op, true>(left, right, scalar, count, out);
+    } else {
+        Kernels::template math<Op, false>(left, right, scalar, count, out);
+    }
+}
+
+template<typename Kernels>
+static void dispatchCompare(const OperatorEnum op, const NumericType *left, const NumericType *right,
+                            const NumericType scalar, const std::size_t count, Word *mask) {
+    switch (op) {
+        case OperatorEnum::EQ:
+            return compareWith<Kernels, OperatorEnum::EQ>(left, right, scalar, count, mask);
+        case OperatorEnum::NE:
+            return compareWith<Kernels, OperatorEnum::NE>(left, right, scalar, count, mask);
+        case OperatorEnum::LT:
+            return compareWith<Kernels, OperatorEnum::LT>(left, right, scalar, count, mask);
+        case OperatorEnum::LE:
+            return compareWith<Kernels, OperatorEnum::LE>(left, right, scalar, count, mask);
+        case OperatorEnum::GT:
+            return compareWith<Kernels, OperatorEnum::GT>(left, right, scalar, count, mask);
+        case OperatorEnum::GE:
+            return compareWith<Kernels, OperatorEnum::GE>(left, right, scalar, count, mask);
+        default:
+            throw std::runtime_error("Unknown compare operator");
+    }
+}
+
+template<typename Kernels>
+static void dispatchMath(const OperatorEnum op, const NumericType *left, const NumericType *right,
+                         const NumericType scalar, const std::size_t count, NumericType *out) {
+    switch (op) {
+        case OperatorEnum::ADD:
+            return mathWith<Kernels, OperatorEnum::ADD>(left, right, scalar, count, out);
+        case OperatorEnum::SUB:
+            return mathWith<Kernels, OperatorEnum::SUB>(left, right, scalar, count, out);
+        case OperatorEnum::MUL:
+            return mathWith<Kernels, OperatorEnum::MUL>(left, right, scalar, count, out);
+        case OperatorEnum::DIV:
+            return mathWith<Kernels, OperatorEnum::DIV>(left, right, scalar, count, out);
+        case OperatorEnum::POW:
+            return mathWith<ScalarKernels, OperatorEnum::POW>(left, right, scalar, count, out);
+        default:
+            throw std::runtime_error("Unknown math operator");
+    }
+}
+
+static SimdLevel probeSimdLevel() {
+#if defined(COMPUTE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    // Also checks that the OS saves the wider registers (XGETBV).
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return SimdLevel::SSE42;
+    }
+    return SimdLevel::SCALAR;
+#elif defined(COMPUTE_X86_KERNELS)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse42 = (info[2] & (1 << 20)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx2 = false;
+    bool avx512 = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+        avx512 = (info[1] & (1 << 16)) != 0;
+    }
+    // XCR0: SSE and AVX state (bits 1-2), AVX-512 opmask and upper registers (bits 5-7).
+    if (avx && avx512 && (xcr0 & 0xE6) == 0xE6) {
+        return SimdLevel::AVX512;
+    }
+    if (avx && avx2 && (xcr0 & 0x6) == 0x6) {
+        return SimdLevel::AVX2;
+    }
+    return sse42 ? SimdLevel::SSE42 : SimdLevel::SCALAR;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+static std::atomic<SimdLevel> &activeSimdLevel() {
+    static std::atomic<SimdLevel> level{detectSimdLevel()};
+    return level;
+}
+
+SimdLevel ComputeLib::detectSimdLevel() {
+    static const SimdLevel level = probeSimdLevel();
+    return level;
+}
+
+SimdLevel ComputeLib::getSimdLevel() {
+    return activeSimdLevel().load(std::memory_order_relaxed);
+}
+
+SimdLevel ComputeLib::setSimdLevel(const SimdLevel level) {
+    const SimdLevel clamped = std::min(level, detectSimdLevel());
+    activeSimdLevel().store(clamped, std::memory_order_relaxed);
+    return clamped;
+}
+
+const char *ComputeLib::getSimdLevelName(const SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE42:
+            return "SSE4.2";
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::AVX512:
+            return "AVX-512";
+        default:
+            return "scalar";
+    }
+}
+
+void ComputeLib::compareKernel(const OperatorEnum op, const NumericType *left, const NumericType *right,
+                               const NumericType scalar, const std::size_t count, Word *mask) {
+    switch (getSimdLevel()) {
+#ifdef COMPUTE_X86_KERNELS
+        case SimdLevel::AVX512:
+            return dispatchCompare<Avx512Kernels>(op, left, right, scalar, count, mask);
+        case SimdLevel::AVX2:
+            return dispatchCompare<Avx2Kernels>(op, left, right, scalar, count, mask);
+        case SimdLevel::SSE42:
+            return dispatchCompare<Sse42Kernels>(op, left, right, scalar, count, mask);
+#endif
+        default:
+            return dispatchCompare<ScalarKernels>(op, left, right, scalar, count, mask);
+    }
+}
+
+void ComputeLib::mathKernel(const OperatorEnum op, const NumericType *left, const NumericType *right,
+                            const NumericType scalar, const std::size_t count, NumericType *out) {
+    switch (getSimdLevel()) {
+#ifdef COMPUTE_X86_KERNELS
+        case SimdLevel::AVX512:
+            return dispatchMath<Avx512Kernels>(op, left, right, scalar, count, out);
+        case SimdLevel::AVX2:
+            return dispatchMath<Avx2Kernels>(op, left, right, scalar, count, out);
+        case SimdLevel::SSE42:
+            return dispatchMath<Sse42Kernels>(op, left, right, scalar, count, out);
+#endif
+        default:
+            return dispatchMath<ScalarKernels>(op, left, right, scalar, count, out);
+    }
+}
+
+void ComputeLib::absKernel(const NumericType *value, const std::size_t count, NumericType *out) {
+    switch (getSimdLevel()) {
+#ifdef COMPUTE_X86_KERNELS
+        case SimdLevel::AVX512:
+            return Avx512Kernels::abs(value, count, out);
+        case SimdLevel::AVX2:
+            return Avx2Kernels::abs(value, count, out);
+        case SimdLevel::SSE42:
+            return Sse42Kernels::abs(value, count, out);
+#endif
+        default:
+            return ScalarKernels::abs(value, count, out);
+    }
+}
@@ -22,10 +22,18 @@ OperatorEnum ComputeLib::getOperatorEnum(const std::string &str) {
             {"ABS", OperatorEnum::ABS},
             {"AND", OperatorEnum::AND},
             {"OR", OperatorEnum::OR},
+            {"NOT", OperatorEnum::NOT},
             {"COUNT", OperatorEnum::COUNT},
             {"MAX", OperatorEnum::MAX},
             {"MIN", OperatorEnum::MIN},
             {"AVG", OperatorEnum::AVG},
+            {"SUM", OperatorEnum::SUM},
+            {"ROLLING_MAX", OperatorEnum::ROLLING_MAX},
+            {"ROLLING_MIN", OperatorEnum::ROLLING_MIN},
+            {"ROLLING_AVG", OperatorEnum::ROLLING_AVG},
+            {"ROLLING_SUM", OperatorEnum::ROLLING_SUM},
+            {"ROLLING_COUNT", OperatorEnum::ROLLING_COUNT},
+            {"SEGMENT_AGG", OperatorEnum::SEGMENT_AGG},
             {"JUMP", OperatorEnum::JUMP},
             {"BEFORE", OperatorEnum::BEFORE},
             {"AFTER", OperatorEnum::AFTER},
@@ -38,3 +46,73 @@ OperatorEnum ComputeLib::getOperatorEnum(const std::string &str) {
     }
     return typeMap.at(str);
 }
+
+const char *ComputeLib::getOperatorName(const OperatorEnum op) {
+    switch (op) {
+        case OperatorEnum::EQ:
+            return "EQ";
+        case OperatorEnum::NE:
+            return "NE";
+        case OperatorEnum::LT:
+            return "LT";
+        case OperatorEnum::LE:
+            return "LE";
+        case OperatorEnum::GT:
+            return "GT";
+        case OperatorEnum::GE:
+            return "GE";
+        case OperatorEnum::ADD:
+            return "ADD";
+        case OperatorEnum::SUB:
+            return "SUB";
+        case OperatorEnum::MUL:
+            return "MUL";
+        case OperatorEnum::DIV:
+            return "DIV";
+        case OperatorEnum::POW:
+            return "POW";
+        case OperatorEnum::ABS:
+            return "ABS";
+        case OperatorEnum::AND:
+            return "AND";
+        case OperatorEnum::OR:
+            return "OR";
+        case OperatorEnum::NOT:
+            return "NOT";
+        case OperatorEnum::COUNT:
+            return "COUNT";
+        case OperatorEnum::MAX:
+            return "MAX";
+        case OperatorEnum::MIN:
+            return "MIN";
+        case OperatorEnum::AVG:
+            return "AVG";
+        case OperatorEnum::SUM:
+            return "SUM";
+        case OperatorEnum::ROLLING_MAX:
+            return "ROLLING_MAX";
+        case OperatorEnum::ROLLING_MIN:
+            return "ROLLING_MIN";
+        case OperatorEnum::ROLLING_AVG:
+            return "ROLLING_AVG";
+        case OperatorEnum::ROLLING_SUM:
+            return "ROLLING_SUM";
+        case OperatorEnum::ROLLING_COUNT:
+            return "ROLLING_COUNT";
+        case OperatorEnum::SEGMENT_AGG:
+            return "SEGMENT_AGG";
+        case OperatorEnum::JUMP:
+            return "JUMP";
+        case OperatorEnum::BEFORE:
+            return "BEFORE";
+        case OperatorEnum::AFTER:
+            return "AFTER";
+        case OperatorEnum::HOLD:
+            return "HOLD";
+        case OperatorEnum::DURATION:
+            return "DURATION";
+        case OperatorEnum::SELECT:
+            return "SELECT";
+    }
+    throw std::runtime_error("Unknown operator");
+}
@@ -0,0 +1,863 @@
+#include "pipeline.h"
+#include "executor.h"
+#include "operator.h"
+#include "plan.h"
+#include "state_machine.h"
+#include "value_set.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace ComputeLib;
+
+static constexpr uint8_t FALSE = 0;
+
+// Rows of a source that is still growing, for ranges that reach past the rows seen so far.
+static constexpr std::size_t UNBOUNDED = std::numeric_limits<std::size_t>::max();
+
+// Operators whose row i only depends on row i of their operands.
+static bool isElementWise(const OperatorEnum op) {
+    switch (op) {
+        case OperatorEnum::EQ:
+        case OperatorEnum::NE:
+        case OperatorEnum::LT:
+        case OperatorEnum::LE:
+        case OperatorEnum::GT:
+        case OperatorEnum::GE:
+        case OperatorEnum::ADD:
+        case OperatorEnum::SUB:
+        case OperatorEnum::MUL:
+        case OperatorEnum::DIV:
+        case OperatorEnum::POW:
+        case OperatorEnum::ABS:
+        case OperatorEnum::AND:
+        case OperatorEnum::OR:
+        case OperatorEnum::NOT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Aggregates that only read the rows where their last operand is TRUE.
+static bool hasCondition(const PlanNode &node) {
+    if (node.op == OperatorEnum::COUNT) {
+        return node.inputs.size() == 6;
+    }
+    return Pipeline::isAggregate(node.op) && node.inputs.size() == 4;
+}
+
+bool Pipeline::isRowInput(const PlanNode &node, const std::size_t k) {
+    if (node.kind == NodeKind::CONSTANT || k >= node.inputs.size()) {
+        return false;
+    }
+    return k == 0 || isElementWise(node.op) || node.op == OperatorEnum::SEGMENT_AGG ||
+           (hasCondition(node) && k + 1 == node.inputs.size());
+}
+
+bool Pipeline::isAggregate(const OperatorEnum op) {
+    return op == OperatorEnum::COUNT || op == OperatorEnum::MAX || op == OperatorEnum::MIN || op == OperatorEnum::AVG ||
+           op == OperatorEnum::SUM || op == OperatorEnum::SEGMENT_AGG;
+}
+
+Pipeline::PassPlan Pipeline::planPasses(const CompiledQuery &plan) {
+    const auto &nodes = plan.nodes();
+    PassPlan passes{std::vector<bool>(nodes.size(), false), std::vector<bool>(nodes.size(), false),
+                    std::vector<uint32_t>(nodes.size(), 0)};
+    auto &[streamed, aggregated, pass] = passes;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        const PlanNode &node = nodes[i];
+        if (node.kind == NodeKind::CONSTANT) {
+            continue;
+        }
+        if (node.op == OperatorEnum::SELECT) {
+            streamed[i] = true;
+            continue;
+        }
+        for (const uint32_t input: node.inputs) {
+            pass[i] = std::max(pass[i], pass[input]);
+        }
+        bool rowsStreamed = false;
+        uint32_t rowsPass = 0;
+        for (std::size_t k = 0; k < node.inputs.size(); ++k) {
+            if (isRowInput(node, k) && streamed[node.inputs[k]]) {
+                rowsStreamed = true;
+                rowsPass = std::max(rowsPass, pass[node.inputs[k]]);
+            }
+        }
+        if (isAggregate(node.op) && rowsStreamed) {
+            aggregated[i] = true;
+            pass[i] = std::max(pass[i], rowsPass + 1);
+        } else {
+            streamed[i] = rowsStreamed;
+        }
+    }
+    return passes;
+}
+
+void Pipeline::evaluateScalars(const Executor &executor, const CompiledQuery &plan, const PassPlan &passes,
+                               std::vector<GenericValue> &results, std::vector<const GenericValue *> &values,
+                               const std::vector<uint32_t> &columnBinding) {
+    const auto &nodes = plan.nodes();
+    const uint32_t root = plan.root();
+    for (std::size_t i = 0; values[root] == nullptr && i < nodes.size(); ++i) {
+        if (values[i] != nullptr || passes.streamed[i]) {
+            continue;
+        }
+        if (std::ranges::any_of(nodes[i].inputs, [&](const uint32_t input) { return values[input] == nullptr; })) {
+            throw std::runtime_error("Operand type not supported");
+        }
+        results[i] = executor.evaluate(nodes[i], values, columnBinding);
+        values[i] = &results[i];
+    }
+}
+
+Pipeline::Pipeline(const Executor &executor, const CompiledQuery &plan, const std::vector<uint32_t> &targets,
+                   const std::vector<const GenericValue *> &known, const std::vector<uint32_t> &columnBinding)
+    : executor_(executor), plan_(plan), columnBinding_(columnBinding), states_(plan.nodes().size()),
+      results_(plan.nodes().size()), values_(known), windows_(plan.nodes().size()),
+      operands_(plan.nodes().size(), nullptr) {
+    const auto &nodes = plan.nodes();
+    std::vector<bool> needed(nodes.size(), false);
+    for (const uint32_t target: targets) {
+        needed[target] = true;
+        states_[target].target = true;
+    }
+    for (std::size_t i = nodes.size(); i-- > 0;) {
+        if (needed[i] && values_[i] == nullptr) {
+            for (const uint32_t input: nodes[i].inputs) {
+                needed[input] = true;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        const PlanNode &node = nodes[i];
+        NodeState &state = states_[i];
+        if (!needed[i]) {
+            continue;
+        }
+        if (values_[i] != nullptr || node.kind == NodeKind::CONSTANT) {
+            state.role = Role::VALUE;
+            values_[i] = values_[i] != nullptr ? values_[i] : &node.constant;
+            continue;
+        }
+        if (node.op == OperatorEnum::SELECT) {
+            state.role = Role::SOURCE;
+            continue;
+        }
+
+        bool streamed = false;
+        for (std::size_t k = 0; k < node.inputs.size(); ++k) {
+            const Role role = states_[node.inputs[k]].role;
+            if (role == Role::AGGREGATE) {
+                throw std::runtime_error("Aggregate result read before the end of its pass");
+            }
+            if (role == Role::SOURCE || role == Role::STREAM) {
+                if (!isRowInput(node, k)) {
+                    throw std::runtime_error("Operand type not supported");
+                }
+                streamed = true;
+            }
+        }
+        if (!streamed) {
+            results_[i] = executor_.evaluate(node, values_, columnBinding_);
+            values_[i] = &results_[i];
+            state.role = Role::VALUE;
+            continue;
+        }
+
+        state.role = isAggregate(node.op) ? Role::AGGREGATE : Role::STREAM;
+        prepare(i);
+        for (std::size_t k = 0; k < node.inputs.size(); ++k) {
+            auto &consumers = states_[node.inputs[k]].consumers;
+            if (isRowInput(node, k) && states_[node.inputs[k]].role == Role::STREAM &&
+                std::ranges::find(consumers, i) == consumers.end()) {
+                consumers.emplace_back(i);
+            }
+        }
+    }
+}
+
+void Pipeline::prepare(const uint32_t index) {
+    const PlanNode &node = plan_.node(index);
+    NodeState &state = states_[index];
+    const auto param = [&](const std::size_t pos) -> const GenericValue & {
+        return *values_[node.inputs[pos]];
+    };
+
+    switch (node.op) {
+        case OperatorEnum::COUNT:
+            if (!Executor::holdsNumeric(param(1)) || !Executor::holdsNumeric(param(2))) {
+                throw std::runtime_error("Operand of COUNT must be of type bool[]");
+            }
+            if (node.inputs.size() >= 5) {
+                std::tie(state.rangeBegin, state.rangeEnd) = executor_.rowRange(param(3), param(4), UNBOUNDED);
+            }
+            break;
+        case OperatorEnum::MAX:
+        case OperatorEnum::MIN:
+        case OperatorEnum::AVG:
+        case OperatorEnum::SUM:
+            if (node.inputs.size() >= 3) {
+                std::tie(state.rangeBegin, state.rangeEnd) = executor_.rowRange(param(1), param(2), UNBOUNDED);
+            }
+            break;
+        case OperatorEnum::AFTER:
+            if (!Executor::holdsNumeric(param(1)) || !Executor::holdsNumeric(param(2)) ||
+                !Executor::holdsNumeric(param(3))) {
+                throw std::runtime_error("Operand type not supported");
+            }
+            state.fromVal = std::get<NumericType>(param(1));
+            state.toVal = std::get<NumericType>(param(2));
+            state.threshold = executor_.calculateRowCount(std::get<NumericType>(param(3)));
+            break;
+        case OperatorEnum::HOLD: {
+            if (!Executor::holdsNumericVector(param(1)) || !Executor::holdsNumericVector(param(2)) ||
+                !Executor::holdsNumeric(param(3))) {
+                throw std::runtime_error("Operand type not supported");
+            }
+            const auto &fromVec = std::get<NumericVectorType>(param(1));
+            const auto &toVec = std::get<NumericVectorType>(param(2));
+            const auto durationVal = std::get<NumericType>(param(3));
+            state.fromValues = ValueSet(fromVec);
+            state.toValues = ValueSet(toVec);
+            state.reverse = durationVal < 0;
+            state.threshold = executor_.calculateRowCount(std::abs(durationVal));
+            break;
+        }
+        case OperatorEnum::DURATION:
+            if (!Executor::holdsNumeric(param(1))) {
+                throw std::runtime_error("Operand type not supported");
+            }
+            state.threshold = executor_.calculateRowCount(std::get<NumericType>(param(1)));
+            break;
+        case OperatorEnum::ROLLING_MAX:
+        case OperatorEnum::ROLLING_MIN:
+        case OperatorEnum::ROLLING_AVG:
+        case OperatorEnum::ROLLING_SUM:
+        case OperatorEnum::ROLLING_COUNT:
+            state.rolling.emplace(node.op, executor_.rollingRows(param(1)), 0);
+            break;
+        case OperatorEnum::SEGMENT_AGG:
+            state.segments.emplace(executor_.timeIntervalPerRow_);
+            break;
+        default:
+            break;
+    }
+}
+
+void Pipeline::advance(const std::size_t rowCount) {
+    rowCount_ = std::max(rowCount_, rowCount);
+    for (uint32_t i = 0; i < states_.size(); ++i) {
+        if (states_[i].role == Role::STREAM || states_[i].role == Role::AGGREGATE) {
+            step(i, false);
+        }
+    }
+    trim();
+}
+
+void Pipeline::finish() {
+    for (uint32_t i = 0; i < states_.size(); ++i) {
+        if (states_[i].role == Role::STREAM || states_[i].role == Role::AGGREGATE) {
+            step(i, true);
+        }
+    }
+}
+
+GenericValue Pipeline::take(const uint32_t node) {
+    NodeState &state = states_[node];
+    switch (state.role) {
+        case Role::AGGREGATE:
+            if (state.segments.has_value()) {
+                return state.segments->take();
+            }
+            return std::move(state.value);
+        case Role::STREAM:
+            if (state.boolRows) {
+                return std::move(state.bits);
+            }
+            return std::move(state.numbers);
+        case Role::SOURCE:
+            // Views must not outlive the data source, so a bare SELECT is copied out as numeric[].
+            return Executor::visitNumericArray(window(node, 0, rowCount_), [](const auto &view) -> GenericValue {
+                return NumericVectorType(view.begin(), view.end());
+            });
+        default:
+            return *values_[node];
+    }
+}
+
+GenericValue Pipeline::drain(const uint32_t node) {
+    NodeState &state = states_[node];
+    switch (state.role) {
+        case Role::AGGREGATE:
+            if (state.segments.has_value()) {
+                return state.segments->rows();
+            }
+            return aggregateValue(node);
+        case Role::STREAM: {
+            GenericValue rows = state.boolRows ? GenericValue(std::move(state.bits)) : std::move(state.numbers);
+            state.bits = BoolVectorType{};
+            state.numbers = NumericVectorType{};
+            state.begin = state.end;
+            return rows;
+        }
+        case Role::SOURCE: {
+            GenericValue rows = Executor::visitNumericArray(window(node, state.begin, rowCount_),
+                                                            [](const auto &view) -> GenericValue {
+                                                                return NumericVectorType(view.begin(), view.end());
+                                                            });
+            state.begin = rowCount_;
+            return rows;
+        }
+        default:
+            return *values_[node];
+    }
+}
+
+void Pipeline::step(const uint32_t index, const bool finishing) {
+    const PlanNode &node = plan_.node(index);
+    NodeState &state = states_[index];
+    std::size_t to = std::numeric_limits<std::size_t>::max();
+    for (std::size_t k = 0; k < node.inputs.size(); ++k) {
+        if (isRowInput(node, k)) {
+            to = std::min(to, available(node.inputs[k]));
+        }
+    }
+    const std::size_t from = state.consumed;
+
+    if (state.segments.has_value()) {
+        stepSegments(index, from, to, finishing);
+    } else if (state.role == Role::AGGREGATE) {
+        stepAggregate(index, from, to, finishing);
+    } else if (node.op == OperatorEnum::DURATION) {
+        stepDuration(index, from, to, finishing);
+    } else if (node.op == OperatorEnum::HOLD && state.reverse) {
+        stepReverseHold(index, to, finishing);
+    } else if (to > from && state.rolling.has_value()) {
+        stepRolling(index, from, to);
+    } else if (to > from) {
+        if (isElementWise(node.op)) {
+            for (const uint32_t input: node.inputs) {
+                windows_[input] = window(input, from, to);
+                operands_[input] = &windows_[input];
+            }
+            appendRows(state, executor_.evaluate(node, operands_, columnBinding_));
+        } else {
+            stepStateful(index, from, to);
+        }
+    }
+    state.consumed = to;
+
+    if (finishing) {
+        // A constant array used as rows has to cover the source exactly, as it does for Executor::run.
+        for (std::size_t k = 0; k < node.inputs.size(); ++k) {
+            const uint32_t input = node.inputs[k];
+            if (!isRowInput(node, k) || states_[input].role != Role::VALUE) {
+                continue;
+            }
+            const GenericValue &value = *values_[input];
+            const std::size_t size = Executor::holdsBoolVector(value)
+                                         ? std::get<BoolVectorType>(value).size()
+                                         : Executor::holdsNumericArray(value)
+                                               ? Executor::visitNumericArray(value, [](const auto &vec) {
+                                                   return vec.size();
+                                               })
+                                               : rowCount_;
+            if (size != rowCount_) {
+                throw std::runtime_error("Vector size mismatch");
+            }
+        }
+    }
+}
+
+void Pipeline::stepStateful(const uint32_t index, const std::size_t from, const std::size_t to) {
+    const PlanNode &node = plan_.node(index);
+    NodeState &state = states_[index];
+    // JUMP, AFTER and HOLD look one row back, so every batch but the first starts on the last row of the
+    // previous one. Its output was published with the previous batch and is dropped here.
+    const std::size_t history = from > 0 ? 1 : 0;
+    const GenericValue rows = window(node.inputs[0], from - history, to);
+
+    BoolVectorType result;
+    if (node.op == OperatorEnum::JUMP) {
+        result = std::get<BoolVectorType>(executor_.jumpOp(rows, *values_[node.inputs[1]],
+                                                           *values_[node.inputs[2]]));
+    } else {
+        if (!Executor::holdsNumericArray(rows)) {
+            throw std::runtime_error("Operand type not supported");
+        }
+        result = Executor::visitNumericArray(rows, [&]<typename T>(const std::span<const T> valueVec) {
+            BoolVectorType out(valueVec.size(), FALSE);
+            if (node.op == OperatorEnum::AFTER) {
+                withAfterMachine(valueVec, state.fromVal, state.toVal, state.threshold, [&](const auto &machine) {
+                    state.after = machine.scan(1, valueVec.size(), state.after, &out);
+                });
+            } else {
+                withHoldMachine(state.fromValues, state.toValues, state.threshold,
+                                [&](const std::size_t i) { return valueVec[i]; },
+                                [&](const auto &machine) {
+                                    state.hold = machine.scan(1, valueVec.size(), state.hold, &out);
+                                });
+            }
+            return out;
+        });
+    }
+    appendRows(state, history != 0 ? result.slice(1, result.size()) : std::move(result));
+}
+
+void Pipeline::stepRolling(const uint32_t index, const std::size_t from, const std::size_t to) {
+    const PlanNode &node = plan_.node(index);
+    NodeState &state = states_[index];
+    // The window carries the rows it still needs across batches, so every row is pushed once.
+    const GenericValue rows = window(node.inputs[0], from, to);
+    NumericVectorType out(to - from);
+    if (node.op == OperatorEnum::ROLLING_COUNT) {
+        if (!Executor::holdsBoolVector(rows)) {
+            throw std::runtime_error("Operand of ROLLING_COUNT must be of type bool[]");
+        }
+        const auto &bits = std::get<BoolVectorType>(rows);
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            out[i] = state.rolling->push(static_cast<NumericType>(bits[i]));
+        }
+    } else {
+        if (!Executor::holdsNumericArray(rows)) {
+            throw std::runtime_error("Operand of rolling functions must be of type numeric[]");
+        }
+        Executor::visitNumericArray(rows, [&]<typename T>(const std::span<const T> vec) {
+            for (std::size_t i = 0; i < out.size(); ++i) {
+                out[i] = state.rolling->push(static_cast<NumericType>(vec[i]));
+            }
+        });
+    }
+    appendRows(state, std::move(out));
+}
+
+void Pipeline::stepSegments(const uint32_t index, const std::size_t from, const std::size_t to,
+                            const bool finishing) {
+    const PlanNode &node = plan_.node(index);
+    NodeState &state = states_[index];
+    // Same pieces as Executor::segmentOp: the rows of a run within one morsel are reduced row by row, in
+    // one piece however many batches they span, and only handed to the table once the piece is complete.
+    if (to > from) {
+        const GenericValue events = window(node.inputs[0], from, to);
+        const GenericValue target = window(node.inputs[1], from, to);
+        if (!Executor::holdsBoolVector(events)) {
+            throw std::runtime_error("Operand of SEGMENT_AGG must be of type bool[]");
+        }
+        if (!Executor::holdsNumericArray(target)) {
+            throw std::runtime_error("Target of SEGMENT_AGG must be of type numeric[]");
+        }
+        const auto &bits = std::get<BoolVectorType>(events);
+        Executor::visitNumericArray(target, [&]<typename T>(const std::span<const T> vec) {
+            for (std::size_t k = 0; k < vec.size();) {
+                const std::size_t stop = k + std::min(vec.size() - k, MORSEL_SIZE - (from + k) % MORSEL_SIZE);
+                bits.forEachRun(k, stop, [&](const std::size_t first, const std::size_t last) {
+                    const auto rows = vec.subspan(first, last - first);
+                    if (state.piece.has_value() && state.piece->end == from + first) {
+                        SegmentTable::extend(*state.piece, rows);
+                        return;
+                    }
+                    if (state.piece.has_value()) {
+                        state.segments->add(*state.piece);
+                    }
+                    state.piece = SegmentTable::scan(from + first, rows);
+                });
+                k = stop;
+                // A piece is complete at the end of its morsel.
+                if (state.piece.has_value() && state.piece->end == from + k && (from + k) % MORSEL_SIZE == 0) {
+                    state.segments->add(*state.piece);
+                    state.piece.reset();
+                }
+            }
+        });
+    }
+    if (state.piece.has_value() && (finishing || state.piece->end < to)) {
+        state.segments->add(*state.piece);
+        state.piece.reset();
+    }
+    if (finishing) {
+        state.segments->close();
+    } else if (!state.piece.has_value()) {
+        state.segments->settle(to);
+    }
+}
+
+void Pipeline::stepReverseHold(const uint32_t index, const std::size_t to, const bool finishing) {
+    const PlanNode &node = plan_.node(index);
+    NodeState &state = states_[index];
+    if (to <= state.unsettled) {
+        return;
+    }
+
+    /*
+     * Scanned backwards, the machine is idle after a sync row whatever follows it, so every row up to
+     * the last sync row is settled and the rows after it wait for the next one. The end of the source
+     * is where the backward scan of Executor::holdOp starts, which settles the rest.
+     */
+    const GenericValue rows = window(node.inputs[0], state.unsettled, to);
+    if (!Executor::holdsNumericArray(rows)) {
+        throw std::runtime_error("Operand type not supported");
+    }
+    Executor::visitNumericArray(rows, [&]<typename T>(const std::span<const T> valueVec) {
+        const std::size_t length = valueVec.size();
+        std::size_t last = finishing ? length - 1 : length;
+        if (!finishing) {
+            // Rows before the new ones were checked by earlier batches and are not sync rows.
+            const std::size_t fresh = state.consumed - state.unsettled;
+            withHoldMachine(state.fromValues, state.toValues, state.threshold,
+                            [&](const std::size_t i) { return valueVec[length - 1 - i]; },
+                            [&](const auto &machine) {
+                                for (std::size_t j = length; j-- > fresh;) {
+                                    if (machine.isSync(length - 1 - j)) {
+                                        last = j;
+                                        break;
+                                    }
+                                }
+                            });
+        }
+        if (last == length) {
+            return;
+        }
+
+        BoolVectorType settled(last + 1, FALSE);
+        withHoldMachine(state.fromValues, state.toValues, state.threshold,
+                        [&](const std::size_t i) { return valueVec[last - i]; },
+                        [&](const auto &machine) { machine.scan(1, last + 1, HoldState{}, &settled); });
+        settled.reverse();
+        appendRows(state, std::move(settled));
+        state.unsettled += last + 1;
+    });
+}
+
+void Pipeline::stepDuration(const uint32_t index, const std::size_t from, const std::size_t to,
+                            const bool finishing) {
+    const PlanNode &node = plan_.node(index);
+    NodeState &state = states_[index];
+    // Rows of the open TRUE run are held back until it reaches the threshold or ends short of it.
+    BoolVectorType settled;
+    const auto closeRun = [&] {
+        settled.append(state.pendingRows, false);
+        state.pendingRows = 0;
+        state.runLength = 0;
+    };
+
+    if (to > from) {
+        const GenericValue rows = window(node.inputs[0], from, to);
+        if (!Executor::holdsBoolVector(rows)) {
+            throw std::runtime_error("Operand type not supported");
+        }
+        const auto &bits = std::get<BoolVectorType>(rows);
+        for (std::size_t i = 0; i < bits.size();) {
+            const bool value = bits[i] != 0;
+            const std::size_t next = bits.findNext(i, !value, bits.size());
+            if (value) {
+                state.runLength += next - i;
+                state.pendingRows += next - i;
+                if (state.runLength >= state.threshold) {
+                    settled.append(state.pendingRows, true);
+                    state.pendingRows = 0;
+                }
+            } else {
+                closeRun();
+                settled.append(next - i, false);
+            }
+            i = next;
+        }
+    }
+    if (finishing) {
+        closeRun();
+    }
+    if (!settled.empty()) {
+        appendRows(state, std::move(settled));
+    }
+}
+
+void Pipeline::stepAggregate(const uint32_t index, const std::size_t from, const std::size_t to,
+                             const bool finishing) {
+    const PlanNode &node = plan_.node(index);
+    NodeState &state = states_[index];
+    const OperatorEnum op = node.op;
+
+    // Same order of evaluation as Executor::aggregateOp: foldMax/foldMin or a running sum within each
+    // morsel, and the morsel partials combined in morsel order, so the result does not depend on the
+    // batch size. Morsels start at the first row of the range; with a condition, morsels without a
+    // TRUE row are left out.
+    const auto closeMorsel = [&] {
+        if (!state.hasTotal) {
+            state.total = state.partial;
+        } else if (op == OperatorEnum::MAX) {
+            state.total = foldMax(state.total, state.partial);
+        } else if (op == OperatorEnum::MIN) {
+            state.total = foldMin(state.total, state.partial);
+        } else {
+            state.total = state.total + state.partial;
+        }
+        state.hasTotal = true;
+        state.partialOpen = false;
+    };
+
+    const std::size_t begin = std::clamp(from, state.rangeBegin, state.rangeEnd);
+    std::size_t end = std::clamp(to, state.rangeBegin, state.rangeEnd);
+    GenericValue where;
+    const BoolVectorType *mask = nullptr;
+    if (hasCondition(node) && end > begin) {
+        where = window(node.inputs.back(), begin, end);
+        if (Executor::holdsBool(where)) {
+            end = std::get<BoolType>(where) != FALSE ? end : begin;
+        } else if (Executor::holdsBoolVector(where)) {
+            mask = &std::get<BoolVectorType>(where);
+        } else {
+            throw std::runtime_error("Condition of aggregate functions must be of type bool[]");
+        }
+    }
+    if (end > begin) {
+        const GenericValue rows = window(node.inputs[0], begin, end);
+        if (op == OperatorEnum::COUNT) {
+            if (!Executor::holdsBoolVector(rows)) {
+                throw std::runtime_error("Operand of COUNT must be of type bool[]");
+            }
+            const auto &bits = std::get<BoolVectorType>(rows);
+            state.count += mask != nullptr ? bits.countAnd(*mask, 0, bits.size()) : bits.count();
+        } else {
+            if (!Executor::holdsNumericArray(rows)) {
+                throw std::runtime_error("Operand of aggregate functions must be of type numeric[]");
+            }
+            Executor::visitNumericArray(rows, [&]<typename T>(const std::span<const T> vec) {
+                const auto take = [&](std::size_t k, const std::size_t stop) {
+                    state.count += stop - k;
+                    if (!state.partialOpen) {
+                        const bool sum = op == OperatorEnum::AVG || op == OperatorEnum::SUM;
+                        state.partial = sum ? NumericType{0} : static_cast<NumericType>(vec[k++]);
+                        if (!state.hasTotal) {
+                            state.nanFirst = std::isnan(state.partial);
+                        }
+                        state.partialOpen = true;
+                    }
+                    for (; k < stop; ++k) {
+                        const auto x = static_cast<NumericType>(vec[k]);
+                        if (op == OperatorEnum::MAX) {
+                            state.partial = foldMax(state.partial, x);
+                        } else if (op == OperatorEnum::MIN) {
+                            state.partial = foldMin(state.partial, x);
+                        } else {
+                            state.partial = state.partial + x;
+                        }
+                    }
+                };
+                for (std::size_t k = 0; k < vec.size();) {
+                    const std::size_t row = begin + k - state.rangeBegin;
+                    const std::size_t stop = k + std::min(vec.size() - k, MORSEL_SIZE - row % MORSEL_SIZE);
+                    if (mask != nullptr) {
+                        mask->forEachRun(k, stop, take);
+                    } else {
+                        take(k, stop);
+                    }
+                    k = stop;
+                    if ((begin + k - state.rangeBegin) % MORSEL_SIZE == 0 && state.partialOpen) {
+                        closeMorsel();
+                    }
+                }
+            });
+        }
+    }
+
+    if (finishing) {
+        state.value = aggregateValue(index);
+    }
+}
+
+NumericType Pipeline::aggregateValue(const uint32_t index) const {
+    const PlanNode &node = plan_.node(index);
+    const NodeState &state = states_[index];
+    const OperatorEnum op = node.op;
+    if (op == OperatorEnum::COUNT) {
+        const auto iVal = std::get<NumericType>(*values_[node.inputs[1]]);
+        const auto uVal = std::get<NumericType>(*values_[node.inputs[2]]);
+        return static_cast<NumericType>(state.count) * uVal + iVal;
+    }
+    if (!state.hasTotal && !state.partialOpen) {
+        throw std::runtime_error("Cannot aggregate an empty vector");
+    }
+    if (state.nanFirst) {
+        return std::numeric_limits<NumericType>::quiet_NaN();
+    }
+
+    // The open morsel is combined last, as stepAggregate does when it closes.
+    NumericType total = state.total;
+    if (!state.hasTotal) {
+        total = state.partial;
+    } else if (state.partialOpen) {
+        if (op == OperatorEnum::MAX) {
+            total = foldMax(total, state.partial);
+        } else if (op == OperatorEnum::MIN) {
+            total = foldMin(total, state.partial);
+        } else {
+            total = total + state.partial;
+        }
+    }
+    return op == OperatorEnum::AVG ? total / static_cast<NumericType>(state.count) : total;
+}
+
+void Pipeline::trim() {
+    for (uint32_t i = 0; i < states_.size(); ++i) {
+        NodeState &state = states_[i];
+        if (state.role != Role::STREAM || state.target) {
+            continue;
+        }
+        std::size_t keep = state.end;
+        for (const uint32_t consumer: state.consumers) {
+            keep = std::min(keep, keepFrom(consumer));
+        }
+        if (keep <= state.begin) {
+            continue;
+        }
+        const std::size_t drop = keep - state.begin;
+        if (state.boolRows) {
+            state.bits = drop == state.bits.size() ? BoolVectorType{} : state.bits.slice(drop, state.bits.size());
+        } else {
+            state.numbers.erase(state.numbers.begin(), state.numbers.begin() + static_cast<std::ptrdiff_t>(drop));
+        }
+        state.begin = keep;
+    }
+}
+
+GenericValue Pipeline::window(const uint32_t index, const std::size_t from, const std::size_t to) const {
+    const NodeState &state = states_[index];
+    if (state.role == Role::SOURCE) {
+        const ColumnView column = executor_.data->getColumnView(columnBinding_[plan_.node(index).column]);
+        return std::visit([&](const auto &view) -> GenericValue {
+            return NumericViewType(view.subspan(from, to - from));
+        }, column);
+    }
+    if (state.role == Role::STREAM) {
+        if (state.boolRows) {
+            return state.bits.slice(from - state.begin, to - state.begin);
+        }
+        return NumericViewType(std::span<const NumericType>(state.numbers).subspan(from - state.begin, to - from));
+    }
+
+    const GenericValue &value = *values_[index];
+    if (Executor::holdsBoolVector(value)) {
+        const auto &bits = std::get<BoolVectorType>(value);
+        if (bits.size() < to) {
+            throw std::runtime_error("Vector size mismatch");
+        }
+        return bits.slice(from, to);
+    }
+    if (Executor::holdsNumericArray(value)) {
+        return Executor::visitNumericArray(value, [&](const auto &vec) -> GenericValue {
+            if (vec.size() < to) {
+                throw std::runtime_error("Vector size mismatch");
+            }
+            return NumericViewType(vec.subspan(from, to - from));
+        });
+    }
+    return value;
+}
+
+std::size_t Pipeline::available(const uint32_t index) const {
+    switch (states_[index].role) {
+        case Role::SOURCE:
+            return rowCount_;
+        case Role::STREAM:
+            return states_[index].end;
+        default:
+            return std::numeric_limits<std::size_t>::max();
+    }
+}
+
+std::size_t Pipeline::keepFrom(const uint32_t index) const {
+    const PlanNode &node = plan_.node(index);
+    const NodeState &state = states_[index];
+    if (node.op == OperatorEnum::HOLD && state.reverse) {
+        return state.unsettled;
+    }
+    if (node.op == OperatorEnum::JUMP || node.op == OperatorEnum::AFTER || node.op == OperatorEnum::HOLD) {
+        return state.consumed > 0 ? state.consumed - 1 : 0;
+    }
+    return state.consumed;
+}
+
+void Pipeline::appendRows(NodeState &state, GenericValue &&rows) {
+    if (Executor::holdsBoolVector(rows)) {
+        auto &bits = std::get<BoolVectorType>(rows);
+        state.boolRows = true;
+        state.end += bits.size();
+        if (state.bits.empty()) {
+            state.bits = std::move(bits);
+        } else {
+            state.bits.append(bits);
+        }
+        return;
+    }
+    if (!Executor::holdsNumericArray(rows)) {
+        throw std::runtime_error("Operand type not supported");
+    }
+    Executor::visitNumericArray(rows, [&](const auto &vec) {
+        state.numbers.insert(state.numbers.end(), vec.begin(), vec.end());
+        state.end += vec.size();
+    });
+}
+
+GenericValue Executor::runPipelined(const CompiledQuery &plan, const std::size_t batchSize) {
+    if (batchSize == 0) {
+        throw std::runtime_error("Batch size must be positive");
+    }
+    const auto &nodes = plan.nodes();
+    const std::vector<uint32_t> columnBinding = bindColumns(plan);
+    const std::size_t rowCount = data != nullptr ? data->getRowCount() : 0;
+    if (rowCount == 0) {
+        // Nothing to stream, and without a batch the operand types are never checked.
+        return run(plan);
+    }
+
+    const Pipeline::PassPlan passPlan = Pipeline::planPasses(plan);
+    const auto &[streamed, aggregated, pass] = passPlan;
+
+    const uint32_t root = plan.root();
+    std::vector<GenericValue> results(nodes.size());
+    std::vector<const GenericValue *> values(nodes.size(), nullptr);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].kind == NodeKind::CONSTANT) {
+            values[i] = &nodes[i].constant;
+        }
+    }
+
+    const uint32_t passes = streamed[root] ? pass[root] + 1 : pass[root];
+    for (uint32_t p = 0; p < passes; ++p) {
+        std::vector<uint32_t> targets;
+        for (uint32_t i = 0; i < nodes.size(); ++i) {
+            if (aggregated[i] && pass[i] == p + 1) {
+                targets.emplace_back(i);
+            }
+        }
+        if (streamed[root] && pass[root] == p) {
+            targets.emplace_back(root);
+        }
+
+        Pipeline pipeline(*this, plan, targets, values, columnBinding);
+        for (std::size_t begin = 0; begin < rowCount; begin += batchSize) {
+            pipeline.advance(std::min(rowCount, begin + batchSize));
+        }
+        pipeline.finish();
+        for (const uint32_t target: targets) {
+            results[target] = pipeline.take(target);
+            values[target] = &results[target];
+        }
+    }
+
+    // What is left only depends on constants and aggregates.
+    Pipeline::evaluateScalars(*this, plan, passPlan, results, values, columnBinding);
+    if (values[root] == &results[root]) {
+        return std::move(results[root]);
+    }
+    return *values[root];
+}
@@ -0,0 +1,621 @@
+#include "plan.h"
+#include "cost_model.h"
+#include "operator.h"
+#include "rapidjson/document.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace ComputeLib;
+
+static std::string getQueryType(const Query &query) {
+    if (!query.IsObject() || !query.HasMember("type") || !query["type"].IsString()) {
+        throw std::runtime_error("Could not find query type, invalid query format");
+    }
+    return query["type"].GetString();
+}
+
+static std::string getQueryOperation(const Query &query) {
+    if (!query.HasMember("operation") || !query["operation"].IsString()) {
+        throw std::runtime_error("Could not find query operation, invalid query format");
+    }
+    return query["operation"].GetString();
+}
+
+static const Query &getMember(const Query &query, const char *name) {
+    if (!query.HasMember(name)) {
+        throw std::runtime_error(std::string("Missing field: ") + name);
+    }
+    return query[name];
+}
+
+CompiledQuery CompiledQuery::compile(const Query &query, const CostModel *costs) {
+    const Query *queries[] = {&query};
+    return compileBatch(queries, costs);
+}
+
+CompiledQuery CompiledQuery::compileBatch(const std::span<const Query *const> queries, const CostModel *costs) {
+    if (queries.empty()) {
+        throw std::runtime_error("No query to compile");
+    }
+    static const CostModel defaults;
+    CompiledQuery plan;
+    plan.costs_ = costs != nullptr ? costs : &defaults;
+    for (const Query *query: queries) {
+        plan.roots_.emplace_back(plan.compileNode(*query));
+    }
+    plan.costs_ = nullptr;
+    plan.fuseElementWise();
+    plan.planShortCircuits();
+    plan.planLifetimes();
+    plan.planRunReaders();
+    return plan;
+}
+
+uint32_t CompiledQuery::compileNode(const Query &query) {
+    // Bare literals (e.g. "unit": 0.1) are accepted as shorthand for {"type": "value", ...}.
+    if (query.IsNumber() || query.IsArray()) {
+        return compileConstant(query);
+    }
+
+    const std::string type = getQueryType(query);
+
+    if (type == "operation") {
+        return compileOperation(query);
+    }
+
+    if (type == "value") {
+        return compileConstant(getMember(query, "value"));
+    }
+
+    throw std::runtime_error("Unknown type: " + type);
+}
+
+uint32_t CompiledQuery::compileConstant(const Query &value) {
+    PlanNode node;
+    node.kind = NodeKind::CONSTANT;
+    if (value.IsNumber()) {
+        node.constant = value.GetDouble();
+        return addNode(std::move(node));
+    }
+    if (value.IsArray()) {
+        NumericVectorType vec;
+        vec.reserve(value.Size());
+        for (const auto &elem: value.GetArray()) {
+            if (!elem.IsNumber()) {
+                throw std::runtime_error("Invalid type inside value");
+            }
+            vec.emplace_back(elem.GetDouble());
+        }
+        node.constant = std::move(vec);
+        return addNode(std::move(node));
+    }
+
+    throw std::runtime_error("Invalid type inside value");
+}
+
+uint32_t CompiledQuery::compileOperation(const Query &query) {
+    const OperatorEnum op = getOperatorEnum(getQueryOperation(query));
+
+    PlanNode node;
+    node.kind = NodeKind::OPERATION;
+    node.op = op;
+
+    switch (op) {
+        case OperatorEnum::EQ:
+        case OperatorEnum::NE:
+        case OperatorEnum::LT:
+        case OperatorEnum::LE:
+        case OperatorEnum::GT:
+        case OperatorEnum::GE:
+        case OperatorEnum::ADD:
+        case OperatorEnum::SUB:
+        case OperatorEnum::MUL:
+        case OperatorEnum::DIV:
+        case OperatorEnum::POW:
+            node.inputs = {compileNode(getMember(query, "left")), compileNode(getMember(query, "right"))};
+            break;
+        case OperatorEnum::ABS:
+        case OperatorEnum::NOT:
+            node.inputs = {compileNode(getMember(query, "value"))};
+            break;
+        case OperatorEnum::MAX:
+        case OperatorEnum::MIN:
+        case OperatorEnum::AVG:
+        case OperatorEnum::SUM:
+            node.inputs = {compileNode(getMember(query, "value"))};
+            compileRange(query, node);
+            break;
+        case OperatorEnum::AND:
+        case OperatorEnum::OR: {
+            const Query &operands = getMember(query, "operands");
+            if (!operands.IsArray()) {
+                throw std::runtime_error("Operands of logical operators must be an array");
+            }
+            for (const auto &elem: operands.GetArray()) {
+                node.inputs.emplace_back(compileNode(elem));
+            }
+            break;
+        }
+        case OperatorEnum::COUNT:
+            node.inputs = {
+                compileNode(getMember(query, "value")),
+                compileNode(getMember(query, "initialValue")),
+                compileNode(getMember(query, "unit"))
+            };
+            compileRange(query, node);
+            break;
+        case OperatorEnum::JUMP:
+            node.inputs = {
+                compileNode(getMember(query, "value")),
+                compileNode(getMember(query, "from")),
+                compileNode(getMember(query, "to"))
+            };
+            break;
+        case OperatorEnum::AFTER:
+        case OperatorEnum::HOLD:
+            node.inputs = {
+                compileNode(getMember(query, "value")),
+                compileNode(getMember(query, "from")),
+                compileNode(getMember(query, "to")),
+                compileNode(getMember(query, "duration"))
+            };
+            break;
+        case OperatorEnum::DURATION:
+            node.inputs = {compileNode(getMember(query, "value")), compileNode(getMember(query, "minDuration"))};
+            break;
+        case OperatorEnum::ROLLING_MAX:
+        case OperatorEnum::ROLLING_MIN:
+        case OperatorEnum::ROLLING_AVG:
+        case OperatorEnum::ROLLING_SUM:
+        case OperatorEnum::ROLLING_COUNT:
+            node.inputs = {compileNode(getMember(query, "value")), compileNode(getMember(query, "duration"))};
+            break;
+        case OperatorEnum::SEGMENT_AGG:
+            node.inputs = {compileNode(getMember(query, "value")), compileNode(getMember(query, "target"))};
+            break;
+        case OperatorEnum::BEFORE:
+            break;
+        case OperatorEnum::SELECT: {
+            const Query &name = getMember(query, "value");
+            if (!name.IsString()) {
+                throw std::runtime_error("Operand of SELECT must be a column name");
+            }
+            node.column = internColumn(name.GetString());
+            break;
+        }
+    }
+
+    orderOperands(node);
+    return addNode(std::move(node));
+}
+
+void CompiledQuery::compileRange(const Query &query, PlanNode &node) {
+    if (!query.HasMember("start") && !query.HasMember("end") && !query.HasMember("where")) {
+        return;
+    }
+    const auto bound = [&](const char *name, const NumericType open) {
+        if (query.HasMember(name)) {
+            return compileNode(query[name]);
+        }
+        PlanNode constant;
+        constant.constant = open;
+        return addNode(std::move(constant));
+    };
+    node.inputs.emplace_back(bound("start", 0));
+    node.inputs.emplace_back(bound("end", std::numeric_limits<NumericType>::infinity()));
+    if (query.HasMember("where")) {
+        node.inputs.emplace_back(compileNode(query["where"]));
+    }
+}
+
+void CompiledQuery::orderOperands(PlanNode &node) const {
+    const auto isConstant = [&](const uint32_t input) { return nodes_[input].kind == NodeKind::CONSTANT; };
+    auto &inputs = node.inputs;
+    switch (node.op) {
+        case OperatorEnum::EQ:
+        case OperatorEnum::NE:
+        case OperatorEnum::ADD:
+        case OperatorEnum::MUL:
+            if (isConstant(inputs[0]) != isConstant(inputs[1]) ? isConstant(inputs[0]) : inputs[0] > inputs[1]) {
+                std::swap(inputs[0], inputs[1]);
+            }
+            break;
+        case OperatorEnum::LT:
+        case OperatorEnum::LE:
+        case OperatorEnum::GT:
+        case OperatorEnum::GE:
+            // Mirrored, a compare with a constant reads its column as the value operand, e.g. run by run.
+            if (isConstant(inputs[0]) && !isConstant(inputs[1])) {
+                std::swap(inputs[0], inputs[1]);
+                node.op = node.op == OperatorEnum::LT ? OperatorEnum::GT
+                          : node.op == OperatorEnum::LE ? OperatorEnum::GE
+                          : node.op == OperatorEnum::GT ? OperatorEnum::LT
+                          : OperatorEnum::LE;
+            }
+            break;
+        case OperatorEnum::AND:
+        case OperatorEnum::OR: {
+            /*
+             * Cheapest per row decided first: an AND operand decides the rows it makes FALSE, an OR operand
+             * the rows it makes TRUE. Ties keep plan order, so reordered duplicates still share a node.
+             */
+            std::vector<std::pair<double, uint32_t>> ranked;
+            for (const uint32_t input: inputs) {
+                const double selectivity = costs_->selectivity(*this, input);
+                const double decided = node.op == OperatorEnum::AND ? 1 - selectivity : selectivity;
+                const double cost = costs_->cost(*this, input);
+                ranked.emplace_back(decided > 0 ? cost / decided : std::numeric_limits<double>::infinity(), input);
+            }
+            std::ranges::sort(ranked);
+            for (std::size_t k = 0; k < inputs.size(); ++k) {
+                inputs[k] = ranked[k].second;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void hashCombine(std::size_t &seed, const std::size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+/*
+ * Constants are told apart by their bits, so that 0.0 and -0.0, which compare equal but give different
+ * results under DIV, are never merged, and a NaN constant matches itself.
+ */
+template<typename T>
+static uint64_t constantBits(const T value) {
+    if constexpr (std::is_floating_point_v<T>) {
+        return std::bit_cast<uint64_t>(value);
+    } else {
+        return static_cast<uint64_t>(value);
+    }
+}
+
+// Hash of node with column standing for its column and inputHash(input) for each operand.
+template<typename InputHash>
+static std::size_t hashNode(const PlanNode &node, const std::size_t column, InputHash &&inputHash) {
+    std::size_t seed = std::hash<int>{}(static_cast<int>(node.kind));
+    hashCombine(seed, std::hash<int>{}(static_cast<int>(node.op)));
+    hashCombine(seed, column);
+    for (const uint32_t input: node.inputs) {
+        hashCombine(seed, inputHash(input));
+    }
+    hashCombine(seed, node.constant.index());
+    std::visit([&seed]<typename T>(const T &value) {
+        if constexpr (std::is_arithmetic_v<T>) {
+            hashCombine(seed, std::hash<uint64_t>{}(constantBits(value)));
+        } else if constexpr (!std::is_same_v<T, NumericViewType>) {
+            hashCombine(seed, value.size());
+            for (const auto elem: value) {
+                hashCombine(seed, std::hash<uint64_t>{}(constantBits(elem)));
+            }
+        }
+    }, node.constant);
+    return seed;
+}
+
+static bool isSameConstant(const GenericValue &left, const GenericValue &right) {
+    if (left.index() != right.index()) {
+        return false;
+    }
+    return std::visit([&right]<typename T>(const T &value) {
+        const auto &other = std::get<T>(right);
+        if constexpr (std::is_arithmetic_v<T>) {
+            return constantBits(value) == constantBits(other);
+        } else if constexpr (std::is_same_v<T, NumericViewType>) {
+            // Views only come from SELECT at run time, never from constants.
+            return false;
+        } else {
+            return std::ranges::equal(value, other, [](const auto a, const auto b) {
+                return constantBits(a) == constantBits(b);
+            });
+        }
+    }, left);
+}
+
+static bool isSameNode(const PlanNode &left, const PlanNode &right) {
+    // Operands are deduplicated before their parents, so comparing operand indices is enough
+    // to compare whole subtrees.
+    return left.kind == right.kind && left.op == right.op && left.column == right.column &&
+           left.inputs == right.inputs && isSameConstant(left.constant, right.constant);
+}
+
+uint32_t CompiledQuery::addNode(PlanNode &&node) {
+    // Common subexpression elimination: a structurally identical node is only stored, and
+    // therefore evaluated, once. Its result is shared by every consumer.
+    const std::size_t hash = hashNode(node, node.column, [](const uint32_t input) { return input; });
+    const auto [first, last] = nodeIndex_.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        if (isSameNode(nodes_[it->second], node)) {
+            return it->second;
+        }
+    }
+
+    // Unlike the hash above, the fingerprint does not depend on where the column and operands are stored.
+    const bool select = node.kind == NodeKind::OPERATION && node.op == OperatorEnum::SELECT;
+    fingerprints_.emplace_back(hashNode(node, select ? std::hash<std::string>{}(columns_[node.column]) : 0,
+                                        [this](const uint32_t input) { return fingerprints_[input]; }));
+    const auto index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back(std::move(node));
+    nodeIndex_.emplace(hash, index);
+    return index;
+}
+
+uint32_t CompiledQuery::internColumn(const std::string &name) {
+    if (const auto it = columnIndex_.find(name); it != columnIndex_.end()) {
+        return it->second;
+    }
+    const auto index = static_cast<uint32_t>(columns_.size());
+    columns_.emplace_back(name);
+    columnIndex_.emplace(name, index);
+    return index;
+}
+
+static bool isElementWise(const PlanNode &node) {
+    if (node.kind != NodeKind::OPERATION) {
+        return false;
+    }
+    switch (node.op) {
+        case OperatorEnum::EQ:
+        case OperatorEnum::NE:
+        case OperatorEnum::LT:
+        case OperatorEnum::LE:
+        case OperatorEnum::GT:
+        case OperatorEnum::GE:
+        case OperatorEnum::ADD:
+        case OperatorEnum::SUB:
+        case OperatorEnum::MUL:
+        case OperatorEnum::DIV:
+        case OperatorEnum::POW:
+        case OperatorEnum::ABS:
+        case OperatorEnum::NOT:
+        case OperatorEnum::AND:
+        case OperatorEnum::OR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::vector<bool> CompiledQuery::rootMask() const {
+    std::vector<bool> isRoot(nodes_.size(), false);
+    for (const uint32_t root: roots_) {
+        isRoot[root] = true;
+    }
+    return isRoot;
+}
+
+void CompiledQuery::fuseElementWise() {
+    const std::vector<bool> isRoot = rootMask();
+    std::vector<std::vector<uint32_t>> consumers(nodes_.size());
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        for (const uint32_t input: nodes_[i].inputs) {
+            consumers[input].emplace_back(i);
+        }
+    }
+
+    // Walk from the roots towards the leaves: an element-wise node joins the group of its consumers
+    // if they all belong to the same one, otherwise its result is needed on its own and it starts
+    // a new group. SELECTs are left out, the group reads the column directly.
+    std::vector<uint32_t> groupOf(nodes_.size(), NO_GROUP);
+    std::vector<FusedGroup> candidates;
+    for (auto i = static_cast<uint32_t>(nodes_.size()); i-- > 0;) {
+        if (!isElementWise(nodes_[i])) {
+            continue;
+        }
+        uint32_t group = NO_GROUP;
+        if (!isRoot[i] && !consumers[i].empty()) {
+            const uint32_t first = groupOf[consumers[i].front()];
+            if (std::ranges::all_of(consumers[i], [&](const uint32_t c) { return groupOf[c] == first; })) {
+                group = first;
+            }
+        }
+        if (group == NO_GROUP) {
+            group = static_cast<uint32_t>(candidates.size());
+            candidates.emplace_back();
+        }
+        groupOf[i] = group;
+        candidates[group].nodes.emplace_back(i);
+    }
+
+    // A single operator gains nothing from fusion, it already runs as one kernel pass.
+    for (uint32_t candidate = 0; candidate < candidates.size(); ++candidate) {
+        FusedGroup &group = candidates[candidate];
+        if (group.nodes.size() < 2) {
+            continue;
+        }
+        std::ranges::reverse(group.nodes);
+        for (const uint32_t node: group.nodes) {
+            nodes_[node].group = static_cast<uint32_t>(groups_.size());
+            for (const uint32_t input: nodes_[node].inputs) {
+                if (groupOf[input] != candidate && std::ranges::find(group.inputs, input) == group.inputs.end()) {
+                    group.inputs.emplace_back(input);
+                }
+            }
+        }
+        groups_.emplace_back(std::move(group));
+    }
+}
+
+void CompiledQuery::planShortCircuits() {
+    const std::vector<bool> isRoot = rootMask();
+    std::vector<std::vector<uint32_t>> consumers(nodes_.size());
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        for (const uint32_t input: nodes_[i].inputs) {
+            consumers[input].emplace_back(i);
+        }
+    }
+    deferredTo_.assign(nodes_.size(), NO_NODE);
+    std::vector<uint32_t> deferredOperand(nodes_.size(), 0);
+    deferred_.assign(nodes_.size(), {});
+
+    /*
+     * Outer AND/ORs come later in plan order, so walking backwards an inner one reassigns the nodes
+     * below its own deferred operands, which it then evaluates when its outer one evaluates it.
+     *
+     * A node can only be deferred if each of its consumers reads it for the AND/OR or is deferred
+     * itself, so each AND/OR only walks down from its operands through the nodes it defers. Nodes are
+     * visited in decreasing plan order, after all of their consumers. The per-node marks are stamped
+     * with the AND/OR they belong to, which keeps them valid across AND/ORs without clearing.
+     */
+    constexpr uint32_t unread = UINT32_MAX;
+    std::vector<uint32_t> firstOperand(nodes_.size(), unread);
+    std::vector<uint32_t> readStamp(nodes_.size(), NO_NODE);
+    std::vector<uint32_t> queuedStamp(nodes_.size(), NO_NODE);
+    std::priority_queue<uint32_t> pending;
+    for (auto and_ = static_cast<uint32_t>(nodes_.size()); and_-- > 0;) {
+        const PlanNode &node = nodes_[and_];
+        const bool fusedRoot = node.group != NO_GROUP && groups_[node.group].nodes.back() == and_;
+        if (node.kind != NodeKind::OPERATION || (node.op != OperatorEnum::AND && node.op != OperatorEnum::OR) ||
+            (node.group != NO_GROUP && !fusedRoot)) {
+            continue;
+        }
+
+        // First operand through which the AND/OR reads a node, for the nodes it reads directly and, if it
+        // is the root of a fused group, through the group.
+        const auto operandOf = [&](const uint32_t i) { return readStamp[i] == and_ ? firstOperand[i] : unread; };
+        const auto read = [&](const uint32_t i, const uint32_t k) {
+            firstOperand[i] = std::min(operandOf(i), k);
+            readStamp[i] = and_;
+        };
+        const auto enqueue = [&](const uint32_t i) {
+            if (queuedStamp[i] != and_) {
+                queuedStamp[i] = and_;
+                pending.push(i);
+            }
+        };
+        for (uint32_t k = 0; k < node.inputs.size(); ++k) {
+            read(node.inputs[k], k);
+            enqueue(node.inputs[k]);
+        }
+        const auto inGroup = [&](const uint32_t i) { return fusedRoot && nodes_[i].group == node.group; };
+        if (fusedRoot) {
+            const auto &members = groups_[node.group].nodes;
+            for (auto it = members.rbegin() + 1; it != members.rend(); ++it) {
+                for (const uint32_t input: nodes_[*it].inputs) {
+                    read(input, operandOf(*it));
+                    enqueue(input);
+                }
+            }
+        }
+
+        while (!pending.empty()) {
+            const uint32_t i = pending.top();
+            pending.pop();
+            if (nodes_[i].kind != NodeKind::OPERATION || isRoot[i] || inGroup(i) || consumers[i].empty()) {
+                continue;
+            }
+            uint32_t k = unread;
+            bool deferrable = true;
+            for (const uint32_t consumer: consumers[i]) {
+                if (consumer == and_ || inGroup(consumer)) {
+                    // Read by the AND/OR itself.
+                    const uint32_t operand = operandOf(i);
+                    deferrable = deferrable && operand != unread && operand > 0 && (k == unread || k == operand);
+                    k = operand;
+                } else if (deferredTo_[consumer] == and_) {
+                    deferrable = deferrable && (k == unread || k == deferredOperand[consumer]);
+                    k = deferredOperand[consumer];
+                } else {
+                    // Read outside the AND/OR, e.g. a SELECT shared by every rule of a batch.
+                    deferrable = false;
+                    break;
+                }
+            }
+            if (deferrable) {
+                deferredTo_[i] = and_;
+                deferredOperand[i] = k;
+                for (const uint32_t input: nodes_[i].inputs) {
+                    enqueue(input);
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        if (isDeferred(i)) {
+            auto &operands = deferred_[deferredTo_[i]];
+            operands.resize(nodes_[deferredTo_[i]].inputs.size());
+            operands[deferredOperand[i]].emplace_back(i);
+        }
+    }
+}
+
+void CompiledQuery::planLifetimes() {
+    // A node is last read by its last consumer; inside a fused group that is the group root, which is
+    // where the group is evaluated, and for a deferred node it is the AND/OR that evaluates it.
+    constexpr uint32_t unused = UINT32_MAX;
+    const std::vector<bool> isRoot = rootMask();
+    std::vector<uint32_t> lastUse(nodes_.size(), unused);
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        uint32_t reader = nodes_[i].group != NO_GROUP ? groups_[nodes_[i].group].nodes.back() : i;
+        while (isDeferred(reader)) {
+            reader = deferredTo_[reader];
+        }
+        for (const uint32_t input: nodes_[i].inputs) {
+            lastUse[input] = lastUse[input] == unused ? reader : std::max(lastUse[input], reader);
+        }
+    }
+
+    releases_.assign(nodes_.size(), {});
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        if (nodes_[i].kind == NodeKind::OPERATION && !isRoot[i] && lastUse[i] != unused) {
+            releases_[lastUse[i]].emplace_back(i);
+        }
+    }
+}
+
+void CompiledQuery::planRunReaders() {
+    const std::vector<bool> isRoot = rootMask();
+    const auto isConstant = [&](const uint32_t input) { return nodes_[input].kind == NodeKind::CONSTANT; };
+    // consumer reads the column of select as its value operand and only constants besides it.
+    const auto readsRuns = [&](const PlanNode &consumer, const uint32_t select) {
+        if (consumer.group != NO_GROUP || consumer.inputs.empty() || consumer.inputs[0] != select) {
+            return false;
+        }
+        const auto params = std::span(consumer.inputs).subspan(1);
+        switch (consumer.op) {
+            case OperatorEnum::EQ:
+            case OperatorEnum::NE:
+            case OperatorEnum::LT:
+            case OperatorEnum::LE:
+            case OperatorEnum::GT:
+            case OperatorEnum::GE:
+                return isConstant(params[0]) && std::holds_alternative<NumericType>(nodes_[params[0]].constant);
+            case OperatorEnum::JUMP:
+            case OperatorEnum::HOLD:
+            case OperatorEnum::AFTER:
+                return std::ranges::all_of(params, isConstant);
+            default:
+                return false;
+        }
+    };
+
+    runReaders_.assign(nodes_.size(), false);
+    for (uint32_t i = 0; i < nodes_.size(); ++i) {
+        if (nodes_[i].kind == NodeKind::OPERATION && nodes_[i].op == OperatorEnum::SELECT && !isRoot[i]) {
+            runReaders_[i] = true;
+        }
+    }
+    for (const PlanNode &node: nodes_) {
+        for (const uint32_t input: node.inputs) {
+            if (runReaders_[input] && !readsRuns(node, input)) {
+                runReaders_[input] = false;
+            }
+        }
+    }
+}
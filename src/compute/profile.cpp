@@ -0,0 +1,205 @@
+#include "profile.h"
+#include "hardware_counters.h"
+#include "operator.h"
+#include "plan.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace ComputeLib;
+
+double NodeProfile::selectivity() const {
+    if (!boolRows || rowsOut == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return static_cast<double>(trueRows) / static_cast<double>(rowsOut);
+}
+
+QueryProfile::QueryProfile(CompiledQuery plan, const bool hardwareCounters)
+    : plan_(std::move(plan)), nodes_(plan_.nodes().size()), hardwareCounters_(hardwareCounters) {
+}
+
+// Root of the fused group node belongs to, if node is one of its inner nodes.
+static bool fusedInto(const CompiledQuery &plan, const uint32_t node, uint32_t &root) {
+    const uint32_t group = plan.node(node).group;
+    if (group == NO_GROUP || plan.groups()[group].nodes.back() == node) {
+        return false;
+    }
+    root = plan.groups()[group].nodes.back();
+    return true;
+}
+
+static void printConstant(std::ostream &out, const GenericValue &constant) {
+    if (const auto *vec = std::get_if<NumericVectorType>(&constant)) {
+        out << '[';
+        for (std::size_t i = 0; i < vec->size(); ++i) {
+            out << (i > 0 ? ", " : "") << (*vec)[i];
+        }
+        out << ']';
+    } else if (const auto *value = std::get_if<NumericType>(&constant)) {
+        out << *value;
+    }
+}
+
+static void printNode(std::ostream &out, const QueryProfile &profile, const uint32_t index, const std::size_t depth,
+                      std::vector<bool> &printed) {
+    const CompiledQuery &plan = profile.plan();
+    const PlanNode &node = plan.node(index);
+    out << std::string(2 * depth, ' ') << '#' << index << ' ';
+    if (node.kind == NodeKind::CONSTANT) {
+        printConstant(out, node.constant);
+        out << '\n';
+        return;
+    }
+    out << getOperatorName(node.op);
+    if (node.op == OperatorEnum::SELECT) {
+        out << ' ' << plan.columns()[node.column];
+    }
+    if (printed[index]) {
+        out << "  (shown above)\n";
+        return;
+    }
+    printed[index] = true;
+
+    const NodeProfile &stats = profile.node(index);
+    uint32_t root;
+    if (fusedInto(plan, index, root)) {
+        out << "  fused into #" << root << "  runs=" << stats.executions << '\n';
+    } else {
+        out << "  time=" << std::fixed << std::setprecision(3) << static_cast<double>(stats.nanoseconds) / 1e6
+            << " ms  runs=" << stats.executions << "  rows=" << stats.rowsIn << " -> " << stats.rowsOut;
+        if (stats.boolRows && stats.rowsOut > 0) {
+            out << "  selectivity=" << std::setprecision(1) << 100.0 * stats.selectivity() << '%';
+        }
+        out << std::defaultfloat << "  bytes=" << stats.bytes;
+        for (std::size_t k = 0; k < COUNTER_EVENTS; ++k) {
+            if (profile.counts(static_cast<CounterEvent>(k))) {
+                out << "  " << getCounterEventName(static_cast<CounterEvent>(k)) << '=' << stats.counters[k];
+            }
+        }
+        const auto cycles = stats.counters[static_cast<std::size_t>(CounterEvent::CYCLES)];
+        if (profile.counts(CounterEvent::INSTRUCTIONS) && cycles > 0) {
+            const auto instructions = stats.counters[static_cast<std::size_t>(CounterEvent::INSTRUCTIONS)];
+            out << "  ipc=" << std::fixed << std::setprecision(2)
+                << static_cast<double>(instructions) / static_cast<double>(cycles) << std::defaultfloat;
+        }
+        out << '\n';
+    }
+    for (const uint32_t input: node.inputs) {
+        printNode(out, profile, input, depth + 1, printed);
+    }
+}
+
+std::string QueryProfile::toText() const {
+    std::ostringstream out;
+    out << std::setprecision(10);
+    std::vector<bool> printed(nodes_.size(), false);
+    for (std::size_t i = 0; i < plan_.roots().size(); ++i) {
+        if (plan_.roots().size() > 1) {
+            out << "query " << i << ":\n";
+        }
+        printNode(out, *this, plan_.roots()[i], 0, printed);
+    }
+    return out.str();
+}
+
+using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+static void writeNode(JsonWriter &writer, const QueryProfile &profile, const uint32_t index,
+                      std::vector<bool> &written) {
+    const CompiledQuery &plan = profile.plan();
+    const PlanNode &node = plan.node(index);
+    writer.StartObject();
+    writer.Key("id");
+    writer.Uint(index);
+    if (node.kind == NodeKind::CONSTANT) {
+        writer.Key("value");
+        if (const auto *vec = std::get_if<NumericVectorType>(&node.constant)) {
+            writer.StartArray();
+            for (const NumericType value: *vec) {
+                writer.Double(value);
+            }
+            writer.EndArray();
+        } else {
+            writer.Double(std::get<NumericType>(node.constant));
+        }
+        writer.EndObject();
+        return;
+    }
+    writer.Key("operation");
+    writer.String(getOperatorName(node.op));
+    if (node.op == OperatorEnum::SELECT) {
+        writer.Key("column");
+        writer.String(plan.columns()[node.column].c_str());
+    }
+    if (written[index]) {
+        writer.Key("shared");
+        writer.Bool(true);
+        writer.EndObject();
+        return;
+    }
+    written[index] = true;
+
+    const NodeProfile &stats = profile.node(index);
+    uint32_t root;
+    writer.Key("executions");
+    writer.Uint64(stats.executions);
+    if (fusedInto(plan, index, root)) {
+        writer.Key("fusedInto");
+        writer.Uint(root);
+    } else {
+        writer.Key("timeNs");
+        writer.Uint64(stats.nanoseconds);
+        writer.Key("rowsIn");
+        writer.Uint64(stats.rowsIn);
+        writer.Key("rowsOut");
+        writer.Uint64(stats.rowsOut);
+        if (stats.boolRows && stats.rowsOut > 0) {
+            writer.Key("selectivity");
+            writer.Double(stats.selectivity());
+        }
+        writer.Key("bytes");
+        writer.Uint64(stats.bytes);
+        if (profile.countsHardwareEvents()) {
+            writer.Key("counters");
+            writer.StartObject();
+            for (std::size_t k = 0; k < COUNTER_EVENTS; ++k) {
+                if (profile.counts(static_cast<CounterEvent>(k))) {
+                    writer.Key(getCounterEventName(static_cast<CounterEvent>(k)));
+                    writer.Uint64(stats.counters[k]);
+                }
+            }
+            writer.EndObject();
+        }
+    }
+    writer.Key("inputs");
+    writer.StartArray();
+    for (const uint32_t input: node.inputs) {
+        writeNode(writer, profile, input, written);
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
+
+std::string QueryProfile::toJson() const {
+    rapidjson::StringBuffer buffer;
+    JsonWriter writer(buffer);
+    std::vector<bool> written(nodes_.size(), false);
+    writer.StartObject();
+    writer.Key("queries");
+    writer.StartArray();
+    for (const uint32_t root: plan_.roots()) {
+        writeNode(writer, *this, root, written);
+    }
+    writer.EndArray();
+    writer.EndObject();
+    return buffer.GetString();
+}
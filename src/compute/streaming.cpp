@@ -0,0 +1,82 @@
+#include "streaming.h"
+#include "executor.h"
+#include "operator.h"
+#include "pipeline.h"
+#include "plan.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace ComputeLib;
+
+StreamingQuery::StreamingQuery(const Executor &executor, const CompiledQuery &plan)
+    : executor_(executor), plan_(plan), columnBinding_(executor.bindColumns(plan)),
+      passes_(Pipeline::planPasses(plan)), constants_(plan.nodes().size(), nullptr) {
+    if (executor.data == nullptr) {
+        throw std::runtime_error("No input data");
+    }
+    const auto &nodes = plan.nodes();
+    std::vector<uint32_t> targets;
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].kind == NodeKind::CONSTANT) {
+            constants_[i] = &nodes[i].constant;
+        }
+        // A second pass would have to rerun over the whole history on every update.
+        if (passes_.streamed[i] && passes_.pass[i] > 0) {
+            throw std::runtime_error("Aggregates cannot feed row-valued operators of a streaming query");
+        }
+        if (passes_.aggregated[i]) {
+            aggregates_.emplace_back(i);
+            targets.emplace_back(i);
+        }
+    }
+    if (passes_.streamed[plan.root()]) {
+        targets.emplace_back(plan.root());
+    }
+    pipeline_ = std::make_unique<Pipeline>(executor, plan_, targets, constants_, columnBinding_);
+}
+
+GenericValue StreamingQuery::update() {
+    if (finished_) {
+        throw std::runtime_error("Streaming query already finished");
+    }
+    pipeline_->advance(executor_.data->getRowCount());
+    return collect();
+}
+
+GenericValue StreamingQuery::finish() {
+    if (finished_) {
+        throw std::runtime_error("Streaming query already finished");
+    }
+    pipeline_->advance(executor_.data->getRowCount());
+    pipeline_->finish();
+    finished_ = true;
+    return collect();
+}
+
+GenericValue StreamingQuery::collect() {
+    const uint32_t root = plan_.root();
+    if (passes_.streamed[root]) {
+        GenericValue rows = pipeline_->drain(root);
+        settledRows_ += Executor::holdsBoolVector(rows)
+                            ? std::get<BoolVectorType>(rows).size()
+                            : std::get<NumericVectorType>(rows).size();
+        return rows;
+    }
+
+    // Scalars over the running aggregates are cheap, so they are evaluated afresh on every update.
+    std::vector<GenericValue> results(plan_.nodes().size());
+    std::vector<const GenericValue *> values = constants_;
+    for (const uint32_t aggregate: aggregates_) {
+        results[aggregate] = pipeline_->drain(aggregate);
+        values[aggregate] = &results[aggregate];
+    }
+    Pipeline::evaluateScalars(executor_, plan_, passes_, results, values, columnBinding_);
+    if (values[root] == &results[root]) {
+        return std::move(results[root]);
+    }
+    return *values[root];
+}
@@ -0,0 +1,133 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace ComputeLib;
+
+int64_t ComputeLib::currentSystemThreadId() {
+#ifdef __linux__
+    return syscall(SYS_gettid);
+#else
+    return 0;
+#endif
+}
+
+// Set on pool workers, so that a nested parallelFor runs inline instead of waiting on itself.
+static thread_local bool insideWorker = false;
+
+ThreadPool::ThreadPool(uint32_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(numThreads - 1);
+    for (uint32_t i = 1; i < numThreads; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+    // Workers report their ids as they start.
+    std::unique_lock lock(mutex_);
+    finished_.wait(lock, [&] { return workerThreadIds_.size() == workers_.size(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker: workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(const std::size_t count, const std::size_t grainSize, const RangeFunction &func) {
+    const std::size_t morsels = morselCount(count, grainSize);
+    if (workers_.empty() || morsels <= 1 || insideWorker) {
+        for (std::size_t begin = 0; begin < count; begin += grainSize) {
+            func(begin, std::min(begin + grainSize, count));
+        }
+        return;
+    }
+
+    std::lock_guard submitLock(submitMutex_);
+    Job job;
+    job.func = &func;
+    job.count = count;
+    job.grainSize = grainSize;
+    job.morsels = morsels;
+    {
+        std::lock_guard lock(mutex_);
+        job_ = &job;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    runMorsels(job);
+
+    {
+        std::unique_lock lock(mutex_);
+        finished_.wait(lock, [&] {
+            return activeWorkers_ == 0 && job.done.load(std::memory_order_acquire) == job.morsels;
+        });
+        job_ = nullptr;
+    }
+
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    insideWorker = true;
+    {
+        std::lock_guard lock(mutex_);
+        workerThreadIds_.emplace_back(currentSystemThreadId());
+    }
+    finished_.notify_all();
+    uint64_t seenGeneration = 0;
+    while (true) {
+        Job *job = nullptr;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || (job_ != nullptr && generation_ != seenGeneration); });
+            if (stop_) {
+                return;
+            }
+            seenGeneration = generation_;
+            job = job_;
+            ++activeWorkers_;
+        }
+
+        runMorsels(*job);
+
+        {
+            std::lock_guard lock(mutex_);
+            --activeWorkers_;
+        }
+        finished_.notify_all();
+    }
+}
+
+void ThreadPool::runMorsels(Job &job) {
+    std::size_t morsel;
+    while ((morsel = job.next.fetch_add(1, std::memory_order_relaxed)) < job.morsels) {
+        const std::size_t begin = morsel * job.grainSize;
+        const std::size_t end = std::min(begin + job.grainSize, job.count);
+        try {
+            (*job.func)(begin, end);
+        } catch (...) {
+            std::lock_guard lock(job.errorMutex);
+            if (!job.error) {
+                job.error = std::current_exception();
+            }
+        }
+        job.done.fetch_add(1, std::memory_order_release);
+    }
+}
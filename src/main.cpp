@@ -1,9 +1,12 @@
 #include "executor.h"
 #include "data_frame.h"
 #include <rapidjson/document.h>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <stdexcept>
 #include <variant>
+#include <vector>
 
 std::string test_data = R"({
   "type": "operation",
@@ -65,10 +68,21 @@ int main() {
     if (doc.HasParseError()) {
         throw std::runtime_error("Invalid json");
     }
+    constexpr int64_t interval = 100'000'000;
+    constexpr int64_t rowCount = 1'000'000;
+    DataFrame dataFrame(0, rowCount * interval, interval);
+    std::vector<uint8_t> b(rowCount);
+    for (std::size_t i = 0; i < b.size(); ++i) {
+        b[i] = static_cast<uint8_t>(i / 10 % 30);
+    }
+    dataFrame.addColumn("b", b);
+
     ComputeLib::Executor executor(1);
+    executor.setDataSource(&dataFrame);
     try {
+        const auto plan = ComputeLib::CompiledQuery::compile(doc);
         auto start = std::chrono::high_resolution_clock::now();
-        auto res = executor.run(doc);
+        auto res = executor.run(plan);
         auto end = std::chrono::high_resolution_clock::now();
         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 
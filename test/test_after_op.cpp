@@ -164,3 +164,29 @@ TEST(TrendOpTest, After7) {
         EXPECT_EQ(vec[i], expect[i]) << "Mismatch at index " << i;
     }
 }
+
+TEST(TrendOpTest, AfterNaN) {
+    ComputeLib::Executor executor(1);
+    // 0 / 0 makes row 1 NaN, which neither reached fromVal nor stays below it.
+    const std::string task = R"({
+      "type":"operation",
+      "operation":"AFTER",
+      "value":{"type":"operation","operation":"DIV",
+               "left":{"type":"value","value":[0,0,20,20,20,20]},
+               "right":{"type":"value","value":[1,0,1,1,1,1]}},
+      "from":{"type":"value","value":5},
+      "to":{"type":"value","value":10},
+      "duration":{"type":"value","value":0}
+    })";
+
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    ComputeLib::GenericValue result = executor.run(doc);
+    EXPECT_TRUE(executor.holdsBoolVector(result));
+    auto &vec = std::get<ComputeLib::BoolVectorType>(result);
+    ComputeLib::BoolVectorType expect = {0, 0, 0, 0, 0, 0};
+    EXPECT_EQ(vec.size(), expect.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(vec[i], expect[i]) << "Mismatch at index " << i;
+    }
+}
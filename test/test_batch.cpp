@@ -0,0 +1,147 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include "rapidjson/document.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = ComputeLib::MORSEL_SIZE + 1234;
+
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<uint8_t> gear(ROWS);
+    std::vector<double> speed(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        gear[i] = static_cast<uint8_t>(i / 11 % 6);
+        speed[i] = std::sin(static_cast<double>(i) * 0.003) * 80.0;
+    }
+    frame.addColumn("gear", gear);
+    frame.addColumn("speed", speed);
+    return frame;
+}
+
+static std::vector<std::string> makeRules() {
+    const std::string fast = compare("GT", SPEED, 60);
+    const std::vector<std::string> rules = {
+        fast,
+        logical("AND", {fast, compare("EQ", GEAR, 5)}),
+        R"({"type":"operation","operation":"DURATION","minDuration":{"type":"value","value":2},"value":)" + fast +
+        "}",
+        R"({"type":"operation","operation":"AVG","value":)" + SPEED + "}",
+        compare("LT", R"({"type":"operation","operation":"ABS","value":)" + SPEED + "}", 5),
+        SPEED,
+        value("3"),
+        fast,
+    };
+    return rules;
+}
+
+TEST(BatchTest, mergesSharedWork) {
+    const auto rules = makeRules();
+    std::vector<rapidjson::Document> docs(rules.size());
+    std::vector<const ComputeLib::Query *> queries;
+    std::size_t separateNodes = 0;
+    for (std::size_t i = 0; i < rules.size(); ++i) {
+        docs[i].Parse(rules[i].c_str());
+        queries.emplace_back(&docs[i]);
+        separateNodes += ComputeLib::CompiledQuery::compile(docs[i]).nodes().size();
+    }
+    const auto plan = ComputeLib::CompiledQuery::compileBatch(queries);
+
+    ASSERT_EQ(plan.roots().size(), rules.size());
+    EXPECT_EQ(plan.root(), plan.roots().front());
+    EXPECT_EQ(plan.columns().size(), 2);
+    EXPECT_LT(plan.nodes().size(), separateNodes);
+    // The first and the last rule are the same query, and it is also an operand of the second one.
+    EXPECT_EQ(plan.roots().front(), plan.roots().back());
+    std::size_t selects = 0;
+    for (const auto &node: plan.nodes()) {
+        selects += node.kind == ComputeLib::NodeKind::OPERATION && node.op == ComputeLib::OperatorEnum::SELECT;
+    }
+    EXPECT_EQ(selects, 2);
+    for (const uint32_t root: plan.roots()) {
+        EXPECT_TRUE(plan.node(root).group == ComputeLib::NO_GROUP || plan.groups()[plan.node(root).group].nodes.back()
+            == root);
+    }
+    EXPECT_THROW(ComputeLib::CompiledQuery::compileBatch({}), std::runtime_error);
+}
+
+TEST(BatchTest, matchesSeparateRuns) {
+    const DataFrame frame = makeFrame();
+    const auto rules = makeRules();
+    std::vector<rapidjson::Document> docs(rules.size());
+    std::vector<const ComputeLib::Query *> queries;
+    for (std::size_t i = 0; i < rules.size(); ++i) {
+        docs[i].Parse(rules[i].c_str());
+        queries.emplace_back(&docs[i]);
+    }
+
+    for (const uint32_t threads: {1U, 3U}) {
+        ComputeLib::Executor executor(threads);
+        executor.setDataSource(&frame);
+        const auto results = executor.runBatch(queries);
+        ASSERT_EQ(results.size(), rules.size());
+        for (std::size_t i = 0; i < rules.size(); ++i) {
+            const auto expect = executor.run(docs[i]);
+            ASSERT_EQ(results[i].index(), expect.index()) << rules[i];
+            if (ComputeLib::Executor::holdsBoolVector(expect)) {
+                EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(results[i]) ==
+                    std::get<ComputeLib::BoolVectorType>(expect)) << rules[i];
+            } else if (ComputeLib::Executor::holdsNumericVector(expect)) {
+                EXPECT_EQ(std::get<ComputeLib::NumericVectorType>(results[i]),
+                          std::get<ComputeLib::NumericVectorType>(expect)) << rules[i];
+            } else {
+                EXPECT_EQ(std::get<ComputeLib::NumericType>(results[i]), std::get<ComputeLib::NumericType>(expect))
+                    << rules[i];
+            }
+        }
+    }
+}
+
+// Thousands of rules, each an AND whose later operands are deferred: planning the short circuits walks
+// only the nodes under each AND, so the batch compiles in about the time of its rules one by one.
+TEST(BatchTest, compilesLargeBatches) {
+    constexpr std::size_t RULES = 5000;
+    const auto duration = [](const std::string &value, const double seconds) {
+        return R"({"type":"operation","operation":"DURATION","value":)" + value + R"(,"minDuration":)" +
+               ::value(seconds) + "}";
+    };
+    std::vector<std::string> rules;
+    for (std::size_t i = 0; i < RULES; ++i) {
+        const auto x = static_cast<double>(i);
+        rules.emplace_back(logical("AND", {compare("GT", SPEED, x), duration(compare("LT", SPEED, x + 0.5), x + 1),
+                                           duration(compare("NE", GEAR, x + 0.25), x + 2)}));
+    }
+    std::vector<rapidjson::Document> docs(rules.size());
+    std::vector<const ComputeLib::Query *> queries;
+    for (std::size_t i = 0; i < rules.size(); ++i) {
+        docs[i].Parse(rules[i].c_str());
+        queries.emplace_back(&docs[i]);
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    for (const ComputeLib::Query *query: queries) {
+        static_cast<void>(ComputeLib::CompiledQuery::compile(*query));
+    }
+    const auto separate = std::chrono::steady_clock::now() - begin;
+    const auto plan = ComputeLib::CompiledQuery::compileBatch(queries);
+    const auto merged = std::chrono::steady_clock::now() - begin - separate;
+    // Work that grows with rules times nodes takes many times longer instead.
+    EXPECT_LT(merged, 5 * separate);
+
+    ASSERT_EQ(plan.roots().size(), RULES);
+    for (const uint32_t root: plan.roots()) {
+        EXPECT_TRUE(plan.deferredFor(root, 0).empty());
+        for (const std::size_t k: {1UL, 2UL}) {
+            ASSERT_FALSE(plan.deferredFor(root, k).empty());
+            EXPECT_EQ(plan.node(plan.deferredFor(root, k).back()).op, ComputeLib::OperatorEnum::DURATION);
+        }
+    }
+}
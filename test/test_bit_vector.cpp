@@ -0,0 +1,177 @@
+#include "bit_vector.h"
+#include "executor.h"
+#include "data_frame.h"
+#include "test_util.h"
+#include "rapidjson/document.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Deterministic pseudo-random bits with runs of varying length.
+static std::vector<uint8_t> makeBits(const std::size_t size, uint32_t seed) {
+    std::vector<uint8_t> bits(size);
+    uint8_t value = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245U + 12345U;
+        if (seed >> 16 & 7) {
+            bits[i] = value;
+        } else {
+            value ^= 1;
+            bits[i] = value;
+        }
+    }
+    return bits;
+}
+
+static ComputeLib::BitVector toBitVector(const std::vector<uint8_t> &bits) {
+    ComputeLib::BitVector result(bits.size(), 0);
+    for (std::size_t i = 0; i < bits.size(); ++i) {
+        result.set(i, bits[i] != 0);
+    }
+    return result;
+}
+
+TEST(BitVectorTest, matchesByteVector) {
+    for (const std::size_t size: {0UL, 1UL, 63UL, 64UL, 65UL, 127UL, 200UL, 1000UL}) {
+        const auto bits = makeBits(size, static_cast<uint32_t>(size));
+        const auto vec = toBitVector(bits);
+        ASSERT_EQ(vec.size(), size);
+        EXPECT_EQ(vec.count(), static_cast<std::size_t>(std::ranges::count(bits, 1)));
+        EXPECT_TRUE(std::ranges::equal(vec, bits));
+
+        for (std::size_t from = 0; from < size; from += 7) {
+            for (const bool value: {false, true}) {
+                const auto next = std::find(bits.begin() + static_cast<std::ptrdiff_t>(from), bits.end(), value);
+                EXPECT_EQ(vec.findNext(from, value, size), static_cast<std::size_t>(next - bits.begin()));
+                const auto last = std::find(bits.rbegin(), bits.rend() - static_cast<std::ptrdiff_t>(from), value);
+                const std::size_t expectLast = last == bits.rend() - static_cast<std::ptrdiff_t>(from)
+                                                   ? size
+                                                   : static_cast<std::size_t>(bits.rend() - last) - 1;
+                EXPECT_EQ(vec.findLast(from, value, size), expectLast);
+            }
+        }
+
+        auto reversed = vec;
+        reversed.reverse();
+        EXPECT_TRUE(std::ranges::equal(reversed, std::vector<uint8_t>(bits.rbegin(), bits.rend()))) << size;
+        EXPECT_EQ(reversed.count(), vec.count());
+    }
+}
+
+TEST(BitVectorTest, fillKeepsNeighbours) {
+    auto vec = toBitVector(makeBits(300, 7));
+    auto expect = makeBits(300, 7);
+    vec.fill(5, 250, true);
+    std::fill(expect.begin() + 5, expect.begin() + 250, 1);
+    vec.fill(60, 70, false);
+    std::fill(expect.begin() + 60, expect.begin() + 70, 0);
+    EXPECT_TRUE(vec == toBitVector(expect));
+}
+
+TEST(BitVectorTest, runsAndCountAndMatchByteVector) {
+    for (const std::size_t size: {1UL, 64UL, 65UL, 200UL, 1000UL}) {
+        const auto bits = makeBits(size, static_cast<uint32_t>(size) + 3);
+        const auto other = makeBits(size, static_cast<uint32_t>(size) + 11);
+        const auto vec = toBitVector(bits);
+        for (const auto &[begin, end]: std::vector<std::pair<std::size_t, std::size_t> >{
+                 {0, size}, {size / 3, size}, {1, size / 2 + 1}, {size - 1, size}}) {
+            std::vector<uint8_t> covered(size, 0);
+            std::size_t previous = 0;
+            vec.forEachRun(begin, end, [&](const std::size_t first, const std::size_t last) {
+                // Maximal runs in order: neither touching nor overlapping the previous one.
+                EXPECT_LT(first, last);
+                EXPECT_TRUE(previous == 0 || first > previous);
+                std::fill(covered.begin() + static_cast<std::ptrdiff_t>(first),
+                          covered.begin() + static_cast<std::ptrdiff_t>(last), 1);
+                previous = last;
+            });
+            std::size_t both = 0;
+            for (std::size_t i = 0; i < size; ++i) {
+                EXPECT_EQ(covered[i], i >= begin && i < end ? bits[i] : 0) << size << " " << i;
+                both += i >= begin && i < end && bits[i] != 0 && other[i] != 0;
+            }
+            EXPECT_EQ(vec.countAnd(toBitVector(other), begin, end), both) << size;
+        }
+    }
+}
+
+TEST(BitVectorTest, notAndDurationMatchReference) {
+    const std::size_t rows = 3 * ComputeLib::MORSEL_SIZE + 77;
+    const auto bits = makeBits(rows, 42);
+    DataFrame frame(0, static_cast<int64_t>(rows) * INTERVAL, INTERVAL);
+    frame.addColumn("flag", bits);
+
+    rapidjson::Document doc;
+    doc.Parse(R"({"type":"operation","operation":"DURATION","minDuration":{"type":"value","value":0.5},
+        "value":{"type":"operation","operation":"NOT","value":
+            {"type":"operation","operation":"EQ","left":{"type":"operation","operation":"SELECT","value":"flag"},
+             "right":{"type":"value","value":0}}}})");
+
+    // NOT (flag == 0) is flag itself; DURATION keeps runs of at least 5 rows.
+    std::vector<uint8_t> expect(rows, 0);
+    for (std::size_t i = 0; i < rows;) {
+        std::size_t end = i;
+        while (end < rows && bits[end] == bits[i]) {
+            ++end;
+        }
+        if (bits[i] == 1 && end - i >= 5) {
+            std::fill(expect.begin() + static_cast<std::ptrdiff_t>(i),
+                      expect.begin() + static_cast<std::ptrdiff_t>(end), 1);
+        }
+        i = end;
+    }
+
+    for (const uint32_t threads: {1U, 4U}) {
+        ComputeLib::Executor executor(threads);
+        executor.setDataSource(&frame);
+        const auto result = executor.run(doc);
+        ASSERT_TRUE(ComputeLib::Executor::holdsBoolVector(result));
+        EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(result) == toBitVector(expect)) << threads;
+    }
+}
+
+// NOT on frames whose last word is partial: the padding bits stay zero, so COUNT only sees real rows.
+TEST(BitVectorTest, notKeepsPaddingOfPartialLastWord) {
+    const std::string flag = selectColumn("flag");
+    const auto negate = [](const std::string &value) {
+        return R"({"type":"operation","operation":"NOT","value":)" + value + "}";
+    };
+    const auto count = [](const std::string &value) {
+        return R"({"type":"operation","operation":"COUNT","value":)" + value + R"(,"initialValue":)" + ::value(0) +
+               R"(,"unit":)" + ::value(1) + "}";
+    };
+    const std::size_t morsel = ComputeLib::MORSEL_SIZE;
+    for (const std::size_t rows: {1UL, 63UL, 65UL, 130UL, morsel + 1, 2 * morsel + 77}) {
+        const auto bits = makeBits(rows, static_cast<uint32_t>(rows));
+        DataFrame frame(0, static_cast<int64_t>(rows) * INTERVAL, INTERVAL);
+        frame.addColumn("flag", bits);
+        std::vector<uint8_t> expect(rows);
+        std::ranges::transform(bits, expect.begin(), [](const uint8_t bit) { return static_cast<uint8_t>(bit == 0); });
+        const auto zeros = static_cast<double>(std::ranges::count(expect, 1));
+
+        // NOT of a compare runs fused; NOT of DURATION, which is not element-wise, runs on its own.
+        const std::string fused = negate(compare("NE", flag, "0"));
+        const std::string single = negate(R"({"type":"operation","operation":"DURATION","value":)" +
+                                          compare("NE", flag, "0") + R"(,"minDuration":)" + value(0) + "}");
+        for (const uint32_t threads: {1U, 4U}) {
+            ComputeLib::Executor executor(threads);
+            executor.setDataSource(&frame);
+            for (const auto &task: {fused, single}) {
+                const auto plan = compileTask(task);
+                const auto result = executor.run(plan);
+                ASSERT_TRUE(ComputeLib::Executor::holdsBoolVector(result)) << task;
+                const auto &vec = std::get<ComputeLib::BoolVectorType>(result);
+                EXPECT_TRUE(vec == toBitVector(expect)) << rows << " " << task;
+                EXPECT_EQ(static_cast<double>(vec.count()), zeros) << rows;
+                EXPECT_TRUE(isSameValue(executor.runPipelined(plan, 100), result)) << rows << " " << task;
+                EXPECT_EQ(std::get<ComputeLib::NumericType>(executor.run(compileTask(count(task)))), zeros) << rows;
+            }
+        }
+    }
+
+    ComputeLib::Executor executor(1);
+    EXPECT_EQ(std::get<ComputeLib::BoolType>(executor.run(compileTask(negate(compare("GT", value(1), "2"))))), 1);
+}
@@ -0,0 +1,153 @@
+#include "buffer_pool.h"
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 2 * ComputeLib::MORSEL_SIZE + 333;
+
+// DURATION(DURATION(DURATION(GT(a, 0)))): every intermediate is read once, by the next node.
+static const std::string CHAIN = R"({"type":"operation","operation":"DURATION","minDuration":{"type":"value",
+    "value":0.2},"value":{"type":"operation","operation":"DURATION","minDuration":{"type":"value","value":0.3},
+    "value":{"type":"operation","operation":"DURATION","minDuration":{"type":"value","value":0.1},
+    "value":{"type":"operation","operation":"GT","left":{"type":"operation","operation":"SELECT","value":"a"},
+    "right":{"type":"value","value":0}}}}})";
+
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<double> a(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        a[i] = std::sin(static_cast<double>(i) * 0.07);
+    }
+    frame.addColumn("a", a);
+    return frame;
+}
+
+TEST(BufferPoolTest, reusesReleasedStorage) {
+    ComputeLib::BufferPool pool;
+    auto numbers = pool.acquireNumeric(1000, 1.5);
+    const double *storage = numbers.data();
+    pool.release(std::move(numbers));
+    EXPECT_EQ(pool.pooledBytes(), 1000 * sizeof(double));
+
+    // A smaller request fits into the released buffer, which is reset to the requested value.
+    const auto reused = pool.acquireNumeric(600, 2.0);
+    EXPECT_EQ(reused.data(), storage);
+    EXPECT_EQ(reused, std::vector<double>(600, 2.0));
+    EXPECT_EQ(pool.reuseCount(), 1);
+    EXPECT_EQ(pool.pooledBytes(), 0);
+
+    pool.release(ComputeLib::BoolVectorType(200, 1));
+    const auto bits = pool.acquireBits(130, 0);
+    EXPECT_TRUE(bits == ComputeLib::BoolVectorType(130, 0));
+    EXPECT_EQ(pool.reuseCount(), 2);
+
+    for (std::size_t i = 0; i < 2 * ComputeLib::BufferPool::MAX_BUFFERS; ++i) {
+        pool.release(ComputeLib::NumericVectorType(i + 1));
+    }
+    EXPECT_LE(pool.pooledBytes(), ComputeLib::BufferPool::MAX_BUFFERS * 2 * ComputeLib::BufferPool::MAX_BUFFERS *
+                                  sizeof(double));
+    pool.clear();
+    EXPECT_EQ(pool.pooledBytes(), 0);
+}
+
+TEST(BufferPoolTest, releasesAtLastUse) {
+    const auto plan = compileTask(CHAIN);
+    const auto &nodes = plan.nodes();
+    std::size_t released = 0;
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        for (const uint32_t dead: plan.releases(i)) {
+            EXPECT_EQ(nodes[dead].kind, ComputeLib::NodeKind::OPERATION);
+            EXPECT_NE(dead, plan.root());
+            // The only reader of each intermediate is the DURATION above it.
+            EXPECT_EQ(nodes[i].inputs[0], dead);
+            ++released;
+        }
+    }
+    // SELECT, GT and the two inner DURATIONs.
+    EXPECT_EQ(released, 4);
+}
+
+TEST(BufferPoolTest, repeatedRunsMatchAndReuse) {
+    const DataFrame frame = makeFrame();
+    const auto plan = compileTask(CHAIN);
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+
+    const auto first = executor.run(plan);
+    const std::size_t reusedBefore = executor.bufferPool().reuseCount();
+    const auto second = executor.run(plan);
+    EXPECT_GT(executor.bufferPool().reuseCount(), reusedBefore);
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(first) == std::get<ComputeLib::BoolVectorType>(second));
+
+    ComputeLib::Executor fresh(1);
+    fresh.setDataSource(&frame);
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(fresh.run(plan)) ==
+        std::get<ComputeLib::BoolVectorType>(first));
+
+    // At most an operator's input and output are alive at once, not all four bool[] results.
+    const std::size_t bitmap = ComputeLib::BitVector::wordCount(ROWS) * sizeof(ComputeLib::BitVector::Word);
+    EXPECT_GT(executor.peakBytes(), 0);
+    EXPECT_LE(executor.peakBytes(), 2 * bitmap);
+
+    executor.releaseBuffers();
+    EXPECT_EQ(executor.bufferPool().pooledBytes(), 0);
+}
+
+TEST(BufferPoolTest, capsPooledBytes) {
+    ComputeLib::BufferPool pool;
+    // Six buffers of a quarter of the budget each: the oldest make way for the newest.
+    const std::size_t quarter = ComputeLib::BufferPool::MAX_BYTES / sizeof(double) / 4;
+    const double *newest = nullptr;
+    for (std::size_t i = 0; i < 6; ++i) {
+        auto buffer = pool.acquireNumeric(quarter + i, 0);
+        newest = buffer.data();
+        pool.release(std::move(buffer));
+        EXPECT_LE(pool.pooledBytes(), ComputeLib::BufferPool::MAX_BYTES);
+    }
+    const std::size_t kept = pool.pooledBytes();
+    EXPECT_GE(kept, 3 * quarter * sizeof(double));
+    // Bits push out numbers too, and a buffer over the whole budget is not kept.
+    pool.release(ComputeLib::BoolVectorType(quarter * 64, 1));
+    EXPECT_LE(pool.pooledBytes(), ComputeLib::BufferPool::MAX_BYTES);
+    pool.release(ComputeLib::NumericVectorType(ComputeLib::BufferPool::MAX_BYTES / sizeof(double) + 1));
+    EXPECT_LE(pool.pooledBytes(), ComputeLib::BufferPool::MAX_BYTES);
+    EXPECT_EQ(pool.acquireNumeric(quarter + 5, 1).data(), newest);
+}
+
+TEST(BufferPoolTest, fitsResultsToTheirSize) {
+    const DataFrame frame = makeFrame();
+    DataFrame small(0, 100 * INTERVAL, INTERVAL);
+    small.addColumn("a", std::vector<double>(100, 0.5));
+    const auto rolling = [](const std::string &value, const int seconds) {
+        return R"({"type":"operation","operation":"ROLLING_SUM","duration":)" + ::value(seconds) + R"(,"value":)" +
+               value + "}";
+    };
+    const std::string sum = rolling(selectColumn("a"), 1);
+    // Leaves two numeric[] and, with CHAIN, one bool[] of all rows in the pool.
+    const auto both = compileTask(binary("ADD", sum, rolling(selectColumn("a"), 2)));
+    const auto nested = compileTask(rolling(sum, 1));
+    const auto positive = compileTask(compare("GT", sum, 0));
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    static_cast<void>(executor.run(both));
+    static_cast<void>(executor.run(compileTask(CHAIN)));
+    const std::size_t pooled = executor.bufferPool().pooledBytes();
+    ASSERT_GE(pooled, 2 * ROWS * sizeof(double));
+
+    // The small results are computed in the large pooled buffers, which go back to the pool as they leave.
+    executor.setDataSource(&small);
+    const auto numbers = std::get<ComputeLib::NumericVectorType>(executor.run(nested));
+    EXPECT_EQ(numbers.size(), 100);
+    EXPECT_EQ(numbers.capacity(), numbers.size());
+    const auto bits = std::get<ComputeLib::BoolVectorType>(executor.run(positive));
+    EXPECT_EQ(bits.size(), 100);
+    EXPECT_EQ(bits.wordCapacity(), ComputeLib::BitVector::wordCount(100));
+    EXPECT_EQ(executor.bufferPool().pooledBytes(), pooled);
+}
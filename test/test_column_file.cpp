@@ -0,0 +1,166 @@
+#include "column_file.h"
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include "rapidjson/document.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 1000;
+
+static std::string tempPath(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static DataFrame makeFrame() {
+    DataFrame frame(5 * INTERVAL, (5 + static_cast<int64_t>(ROWS)) * INTERVAL, INTERVAL);
+    std::vector<uint8_t> gear(ROWS);
+    std::vector<int32_t> rpm(ROWS);
+    std::vector<uint32_t> odometer(ROWS);
+    std::vector<double> speed(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        gear[i] = static_cast<uint8_t>(i % 6);
+        rpm[i] = static_cast<int32_t>(i * 7 % 5000) - 300;
+        odometer[i] = static_cast<uint32_t>(i * 3);
+        speed[i] = static_cast<double>(i) * 0.25;
+    }
+    frame.addColumn("gear", gear);
+    frame.addColumn("rpm", rpm);
+    frame.addColumn("odometer", odometer);
+    frame.addColumn("speed", speed);
+    return frame;
+}
+
+TEST(ColumnFileTest, mapsColumnsWithoutCopy) {
+    const DataFrame frame = makeFrame();
+    const std::string path = tempPath("compute_engine_column_file_test.col");
+    writeColumnFile(frame, path);
+
+    const DataFrame mapped = openColumnFile(path);
+    ASSERT_EQ(mapped.getRowCount(), ROWS);
+    EXPECT_EQ(mapped.getStartTimestamp(), 5 * INTERVAL);
+    EXPECT_EQ(mapped.getSamplingIntervalNs(), INTERVAL);
+    ASSERT_EQ(mapped.getColumnCount(), 4);
+    for (uint32_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(mapped.getColumnName(i), frame.getColumnName(i));
+        EXPECT_EQ(mapped.getColumnType(i), frame.getColumnType(i));
+        std::visit([&](const auto &view) {
+            using Span = std::decay_t<decltype(view)>;
+            const auto expect = std::get<Span>(frame.getColumnView(i));
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(view.data()) % COLUMN_FILE_ALIGNMENT, 0);
+            EXPECT_TRUE(std::equal(view.begin(), view.end(), expect.begin(), expect.end()));
+        }, mapped.getColumnView(i));
+    }
+    // Mapped columns only exist as views.
+    EXPECT_THROW(static_cast<void>(mapped.getColumn("speed")), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST(ColumnFileTest, queriesMappedFrame) {
+    const DataFrame frame = makeFrame();
+    const std::string path = tempPath("compute_engine_column_file_query.col");
+    writeColumnFile(frame, path);
+    const DataFrame mapped = openColumnFile(path);
+
+    rapidjson::Document doc;
+    doc.Parse(R"({"type":"operation","operation":"AND","operands":[{"type":"operation","operation":"GT",
+        "left":{"type":"operation","operation":"SELECT","value":"speed"},"right":{"type":"value","value":100}},
+        {"type":"operation","operation":"EQ","left":{"type":"operation","operation":"SELECT","value":"gear"},
+        "right":{"type":"value","value":2}}]})");
+    const auto plan = ComputeLib::CompiledQuery::compile(doc);
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    const auto expect = executor.run(plan);
+    executor.setDataSource(&mapped);
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(executor.run(plan)) ==
+        std::get<ComputeLib::BoolVectorType>(expect));
+    std::filesystem::remove(path);
+}
+
+TEST(ColumnFileTest, rejectsInvalidFiles) {
+    EXPECT_THROW(openColumnFile(tempPath("compute_engine_missing.col")), std::runtime_error);
+
+    const DataFrame frame = makeFrame();
+    const std::string path = tempPath("compute_engine_column_file_truncated.col");
+    writeColumnFile(frame, path);
+    // The last block no longer fits.
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    EXPECT_THROW(openColumnFile(path), std::runtime_error);
+
+    // Row counts far past the file size or the last timestamp are rejected before the frame is sized by them.
+    for (const uint64_t rowCount: {uint64_t{1} << 40, ~uint64_t{0} / 2}) {
+        writeColumnFile(frame, path);
+        {
+            std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+            out.seekp(offsetof(ColumnFileHeader, rowCount));
+            out.write(reinterpret_cast<const char *>(&rowCount), sizeof(rowCount));
+        }
+        EXPECT_THROW(openColumnFile(path), std::runtime_error) << rowCount;
+    }
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "not a column file, but long enough to hold a header";
+    }
+    EXPECT_THROW(openColumnFile(path), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST(ColumnFileTest, keepsTheSamplingInterval) {
+    // 20 rows every 50 ms: seconds 0.1 to 0.3 are rows 2 to 5.
+    const int64_t interval = INTERVAL / 2;
+    DataFrame frame(0, 20 * interval, interval);
+    std::vector<double> speed(20);
+    for (std::size_t i = 0; i < speed.size(); ++i) {
+        speed[i] = static_cast<double>(i);
+    }
+    frame.addColumn("speed", speed);
+    const std::string path = tempPath("compute_engine_column_file_interval.col");
+    writeColumnFile(frame, path);
+    const DataFrame mapped = openColumnFile(path);
+    EXPECT_EQ(mapped.getRowCount(), 20);
+    EXPECT_EQ(mapped.getSamplingIntervalNs(), interval);
+
+    rapidjson::Document doc;
+    doc.Parse(R"({"type":"operation","operation":"MAX","value":{"type":"operation","operation":"SELECT",
+        "value":"speed"},"start":{"type":"value","value":0.1},"end":{"type":"value","value":0.3}})");
+    ComputeLib::Executor executor(1);
+    for (const DataFrame *source: std::vector<const DataFrame *>{&frame, &mapped}) {
+        executor.setDataSource(source);
+        EXPECT_EQ(std::get<ComputeLib::NumericType>(executor.run(doc)), 5);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(ColumnFileTest, emptyFrameNeedsAPositiveInterval) {
+    EXPECT_THROW(DataFrame(0, 0, 0), std::runtime_error);
+    EXPECT_THROW(DataFrame(0, 0, -INTERVAL), std::runtime_error);
+    EXPECT_THROW(DataFrame(0, 10 * INTERVAL, 0), std::runtime_error);
+
+    DataFrame frame(INTERVAL, 0, INTERVAL);
+    frame.addColumn("speed", std::vector<double>{});
+    EXPECT_EQ(frame.getRowCount(), 0);
+    const std::string path = tempPath("compute_engine_column_file_empty.col");
+    writeColumnFile(frame, path);
+    const DataFrame mapped = openColumnFile(path);
+    EXPECT_EQ(mapped.getRowCount(), 0);
+    EXPECT_EQ(mapped.getSamplingIntervalNs(), INTERVAL);
+
+    // Durations on no rows still convert to row counts.
+    const auto plan = compileTask(R"({"type":"operation","operation":"DURATION","value":)" +
+                                  compare("GT", selectColumn("speed"), "1") + R"(,"minDuration":)" + value(0.5) + "}");
+    ComputeLib::Executor executor(1);
+    for (const DataFrame *source: std::vector<const DataFrame *>{&frame, &mapped}) {
+        executor.setDataSource(source);
+        EXPECT_EQ(std::get<ComputeLib::BoolVectorType>(executor.run(plan)).size(), 0);
+    }
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,100 @@
+#include "cost_model.h"
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "profile.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 5000;
+
+static std::string hold(const std::string &from, const std::string &to) {
+    return R"({"type":"operation","operation":"HOLD","value":)" + GEAR + R"(,"from":{"type":"value","value":)" +
+           from + R"(},"to":{"type":"value","value":)" + to + R"(},"duration":{"type":"value","value":0.5}})";
+}
+
+// Speed is above 10 on one row in 20; gear is 2 on nine rows in ten.
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<uint8_t> gear(ROWS);
+    std::vector<double> speed(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        gear[i] = static_cast<uint8_t>(i / 7 % 10 == 0 ? 1 : 2);
+        speed[i] = i % 20 == 0 ? 50 : 5;
+    }
+    frame.addColumn("gear", gear);
+    frame.addColumn("speed", speed);
+    return frame;
+}
+
+// Operator of the k-th operand of the root.
+static ComputeLib::OperatorEnum operandOp(const ComputeLib::CompiledQuery &plan, const std::size_t k) {
+    return plan.node(plan.node(plan.root()).inputs[k]).op;
+}
+
+TEST(CostModelTest, putsCommutativeOperandsInCanonicalOrder) {
+    // The constant goes to the right, mirroring the compare.
+    const auto mirrored = compileTask(logical("AND", {binary("LT", value(60), SPEED), binary("GT", SPEED, value(60))}));
+    const auto &root = mirrored.node(mirrored.root());
+    EXPECT_EQ(root.inputs[0], root.inputs[1]);
+    EXPECT_EQ(operandOp(mirrored, 0), ComputeLib::OperatorEnum::GT);
+
+    const auto sum = compileTask(binary("EQ", binary("ADD", SPEED, GEAR), binary("ADD", GEAR, SPEED)));
+    EXPECT_EQ(sum.node(sum.root()).inputs[0], sum.node(sum.root()).inputs[1]);
+
+    // Structurally identical subtrees have the same fingerprint in any plan.
+    const auto single = compileTask(binary("GT", SPEED, value(60)));
+    EXPECT_EQ(single.fingerprint(single.root()), mirrored.fingerprint(root.inputs[0]));
+    EXPECT_NE(single.fingerprint(single.root()), compileTask(binary("GT", GEAR, value(60))).fingerprint(single.root()));
+}
+
+TEST(CostModelTest, ordersPredicatesByCostPerRowDecided) {
+    // HOLD costs more than a compare that is expected to remove as many rows.
+    const auto plan = compileTask(logical("AND", {hold("[1]", "[2]"), binary("GT", SPEED, value(10))}));
+    EXPECT_EQ(operandOp(plan, 0), ComputeLib::OperatorEnum::GT);
+
+    // Without statistics an equality is the more selective compare, the samples show the opposite.
+    const std::string task = logical("AND", {binary("GT", SPEED, value(10)), binary("EQ", GEAR, value(2))});
+    EXPECT_EQ(operandOp(compileTask(task), 0), ComputeLib::OperatorEnum::EQ);
+    const DataFrame frame = makeFrame();
+    ComputeLib::CostModel costs;
+    costs.observe(frame);
+    const auto sampled = compileTask(task, &costs);
+    EXPECT_NEAR(costs.selectivity(sampled, sampled.node(sampled.root()).inputs[0]), 0.05, 0.01);
+    EXPECT_EQ(operandOp(sampled, 0), ComputeLib::OperatorEnum::GT);
+    // An OR wants the operand that keeps the most rows first.
+    EXPECT_EQ(operandOp(compileTask(logical("OR", {binary("GT", SPEED, value(10)), binary("EQ", GEAR, value(2))}),
+                                    &costs), 0), ComputeLib::OperatorEnum::EQ);
+
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(executor.run(sampled)) ==
+        std::get<ComputeLib::BoolVectorType>(executor.run(compileTask(task))));
+}
+
+TEST(CostModelTest, learnsSelectivityFromProfiledRuns) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    const std::string rare = hold("[1]", "[2]");
+    const std::string common = hold("[2]", "[1]");
+    ComputeLib::CostModel costs;
+    for (const auto &task: {rare, common}) {
+        ComputeLib::QueryProfile profile(compileTask(task));
+        executor.runProfiled(profile);
+        costs.observe(profile);
+    }
+
+    // Gear stays 2 for 63 rows after each change from 1, and 1 for only 7 rows after each change from 2.
+    const auto plan = compileTask(logical("AND", {rare, common}), &costs);
+    EXPECT_LT(costs.selectivity(plan, plan.node(plan.root()).inputs[0]),
+              costs.selectivity(plan, plan.node(plan.root()).inputs[1]));
+    const auto &first = plan.node(plan.node(plan.root()).inputs[0]);
+    EXPECT_EQ(std::get<ComputeLib::NumericVectorType>(plan.node(first.inputs[1]).constant),
+              ComputeLib::NumericVectorType{2});
+    EXPECT_EQ(operandOp(compileTask(logical("OR", {rare, common}), &costs), 0), ComputeLib::OperatorEnum::HOLD);
+}
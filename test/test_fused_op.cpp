@@ -0,0 +1,143 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 2 * ComputeLib::MORSEL_SIZE + 1000 + 17;
+
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<uint8_t> gear(ROWS);
+    std::vector<double> speed(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        gear[i] = static_cast<uint8_t>(i / 7 % 6);
+        speed[i] = std::sin(static_cast<double>(i) * 0.01) * 50.0;
+    }
+    frame.addColumn("gear", gear);
+    frame.addColumn("speed", speed);
+    return frame;
+}
+
+TEST(FusedOpTest, groupsElementWiseSubtree) {
+    // AND(GT(ADD(b, b), 10), LT(b, 20)): everything but SELECT and the constants is one group.
+    const auto plan = compileTask(R"({"type":"operation","operation":"AND","operands":[
+        {"type":"operation","operation":"GT","left":{"type":"operation","operation":"ADD",
+            "left":{"type":"operation","operation":"SELECT","value":"b"},
+            "right":{"type":"operation","operation":"SELECT","value":"b"}},"right":{"type":"value","value":10}},
+        {"type":"operation","operation":"LT","left":{"type":"operation","operation":"SELECT","value":"b"},
+            "right":{"type":"value","value":20}}]})");
+
+    ASSERT_EQ(plan.groups().size(), 1);
+    const auto &group = plan.groups()[0];
+    EXPECT_EQ(group.nodes.size(), 4);
+    EXPECT_EQ(group.nodes.back(), plan.root());
+    EXPECT_EQ(group.inputs.size(), 3);
+    for (const uint32_t input: group.inputs) {
+        EXPECT_EQ(plan.node(input).group, ComputeLib::NO_GROUP);
+    }
+}
+
+TEST(FusedOpTest, sharedNodesStayMaterialized) {
+    // ADD(b, b) feeds both DURATION's subtree and the AND group, so it must be computed on its own.
+    const auto plan = compileTask(R"({"type":"operation","operation":"AND","operands":[
+        {"type":"operation","operation":"DURATION","minDuration":{"type":"value","value":0.2},
+            "value":{"type":"operation","operation":"GT","left":{"type":"operation","operation":"ADD",
+                "left":{"type":"operation","operation":"SELECT","value":"b"},
+                "right":{"type":"operation","operation":"SELECT","value":"b"}},"right":{"type":"value","value":10}}},
+        {"type":"operation","operation":"LT","left":{"type":"operation","operation":"ADD",
+            "left":{"type":"operation","operation":"SELECT","value":"b"},
+            "right":{"type":"operation","operation":"SELECT","value":"b"}},"right":{"type":"value","value":20}}]})");
+
+    ASSERT_EQ(plan.groups().size(), 1);
+    EXPECT_EQ(plan.groups()[0].nodes.size(), 2);
+    for (const auto &node: plan.nodes()) {
+        if (node.kind == ComputeLib::NodeKind::OPERATION && node.op == ComputeLib::OperatorEnum::ADD) {
+            EXPECT_EQ(node.group, ComputeLib::NO_GROUP);
+        }
+    }
+
+    DataFrame frame(0, 6 * INTERVAL, INTERVAL);
+    frame.addColumn("b", std::vector<int32_t>{1, 6, 7, 8, 3, 9});
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    const auto result = executor.run(plan);
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(result) == ComputeLib::BoolVectorType({0, 1, 1, 1, 0, 0}));
+}
+
+TEST(FusedOpTest, matchesPerOperatorResults) {
+    const DataFrame frame = makeFrame();
+    // OR(AND(GT(ABS(MUL(speed, gear)), 40), NOT(EQ(gear, 0))), LE(SUB(speed, gear), -45))
+    const auto plan = compileTask(R"({"type":"operation","operation":"OR","operands":[
+        {"type":"operation","operation":"AND","operands":[
+            {"type":"operation","operation":"GT","right":{"type":"value","value":40},
+                "left":{"type":"operation","operation":"ABS","value":{"type":"operation","operation":"MUL",
+                    "left":{"type":"operation","operation":"SELECT","value":"speed"},
+                    "right":{"type":"operation","operation":"SELECT","value":"gear"}}}},
+            {"type":"operation","operation":"NOT","value":{"type":"operation","operation":"EQ",
+                "left":{"type":"operation","operation":"SELECT","value":"gear"},"right":{"type":"value","value":0}}}]},
+        {"type":"operation","operation":"LE","right":{"type":"value","value":-45},
+            "left":{"type":"operation","operation":"SUB",
+                "left":{"type":"operation","operation":"SELECT","value":"speed"},
+                "right":{"type":"operation","operation":"SELECT","value":"gear"}}}]})");
+    ASSERT_EQ(plan.groups().size(), 1);
+
+    using ComputeLib::OperatorEnum;
+    ComputeLib::Executor reference(1);
+    reference.setDataSource(&frame);
+    const auto speed = reference.selectOp(frame.getColumnIndex("speed"));
+    const auto gear = reference.selectOp(frame.getColumnIndex("gear"));
+    const auto gt = reference.compareOp(OperatorEnum::GT,
+                                        reference.absOp(reference.mathOp(OperatorEnum::MUL, speed, gear)),
+                                        ComputeLib::NumericType{40});
+    const auto notZero = reference.notOp(reference.compareOp(OperatorEnum::EQ, gear, ComputeLib::NumericType{0}));
+    const auto both = reference.logicalOp(OperatorEnum::AND, {&gt, &notZero});
+    const auto le = reference.compareOp(OperatorEnum::LE, reference.mathOp(OperatorEnum::SUB, speed, gear),
+                                        ComputeLib::NumericType{-45});
+    const auto expect = reference.logicalOp(OperatorEnum::OR, {&both, &le});
+
+    for (const uint32_t threads: {1U, 3U}) {
+        ComputeLib::Executor executor(threads);
+        executor.setDataSource(&frame);
+        const auto result = executor.run(plan);
+        ASSERT_TRUE(ComputeLib::Executor::holdsBoolVector(result));
+        EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(result) == std::get<ComputeLib::BoolVectorType>(expect));
+    }
+}
+
+TEST(FusedOpTest, numericRootIsWrittenInPlace) {
+    const DataFrame frame = makeFrame();
+    const auto plan = compileTask(R"({"type":"operation","operation":"DIV","right":{"type":"value","value":4},
+        "left":{"type":"operation","operation":"ADD","left":{"type":"operation","operation":"SELECT","value":"gear"},
+            "right":{"type":"operation","operation":"SELECT","value":"speed"}}})");
+    ASSERT_EQ(plan.groups().size(), 1);
+
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    const auto result = executor.run(plan);
+    const auto &vec = std::get<ComputeLib::NumericVectorType>(result);
+    const auto &gear = std::get<std::vector<uint8_t>>(frame.getColumn("gear"));
+    const auto &speed = std::get<std::vector<double>>(frame.getColumn("speed"));
+    ASSERT_EQ(vec.size(), ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        ASSERT_EQ(vec[i], (static_cast<double>(gear[i]) + speed[i]) / 4) << i;
+    }
+}
+
+TEST(FusedOpTest, unsupportedOperandsReportSameError) {
+    // A numeric[] constant of another length cannot be fused; the per-operator path reports the mismatch.
+    const auto plan = compileTask(R"({"type":"operation","operation":"GT","right":{"type":"value","value":0},
+        "left":{"type":"operation","operation":"ADD","left":{"type":"operation","operation":"SELECT","value":"b"},
+            "right":{"type":"value","value":[1, 2]}}})");
+    DataFrame frame(0, 4 * INTERVAL, INTERVAL);
+    frame.addColumn("b", std::vector<double>{1, 2, 3, 4});
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    EXPECT_THROW(executor.run(plan), std::runtime_error);
+}
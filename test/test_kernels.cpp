@@ -0,0 +1,100 @@
+#include "kernels.h"
+#include "executor.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+static std::vector<double> makeValues(const std::size_t size, const double shift) {
+    std::vector<double> values(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        values[i] = static_cast<double>(static_cast<int>(i * 37 % 11) - 5) * 0.5 + shift;
+    }
+    if (size > 3) {
+        values[3] = std::numeric_limits<double>::quiet_NaN();
+    }
+    if (size > 70) {
+        values[70] = -0.0;
+    }
+    return values;
+}
+
+static bool isSameDouble(const double left, const double right) {
+    return std::memcmp(&left, &right, sizeof(double)) == 0 || (std::isnan(left) && std::isnan(right));
+}
+
+class KernelTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        ComputeLib::setSimdLevel(ComputeLib::detectSimdLevel());
+    }
+};
+
+TEST_F(KernelTest, everyLevelMatchesScalar) {
+    using ComputeLib::OperatorEnum;
+    const std::vector<OperatorEnum> compareOps = {
+        OperatorEnum::EQ, OperatorEnum::NE, OperatorEnum::LT, OperatorEnum::LE, OperatorEnum::GT, OperatorEnum::GE
+    };
+    const std::vector<OperatorEnum> mathOps = {
+        OperatorEnum::ADD, OperatorEnum::SUB, OperatorEnum::MUL, OperatorEnum::DIV, OperatorEnum::POW
+    };
+    const auto detected = ComputeLib::detectSimdLevel();
+
+    for (const std::size_t size: {std::size_t{0}, std::size_t{5}, std::size_t{64}, std::size_t{131}, std::size_t{1000}}) {
+        const auto left = makeValues(size, 0);
+        const auto right = makeValues(size, 0.5);
+        const double *rightOperands[] = {right.data(), nullptr};
+        for (const double *rightData: rightOperands) {
+            const auto rightAt = [&](const std::size_t i) { return rightData != nullptr ? rightData[i] : 1.0; };
+
+            for (auto level = ComputeLib::SimdLevel::SCALAR; level <= detected;
+                 level = static_cast<ComputeLib::SimdLevel>(static_cast<int>(level) + 1)) {
+                ASSERT_EQ(ComputeLib::setSimdLevel(level), level);
+                const char *name = ComputeLib::getSimdLevelName(level);
+
+                for (const auto op: compareOps) {
+                    std::vector<ComputeLib::BitVector::Word> mask(ComputeLib::BitVector::wordCount(size), ~0ULL);
+                    ComputeLib::compareKernel(op, left.data(), rightData, 1.0, size, mask.data());
+                    ComputeLib::BitVector expect(size, 0);
+                    for (std::size_t i = 0; i < size; ++i) {
+                        const bool bit = op == OperatorEnum::EQ ? left[i] == rightAt(i)
+                                         : op == OperatorEnum::NE ? left[i] != rightAt(i)
+                                         : op == OperatorEnum::LT ? left[i] < rightAt(i)
+                                         : op == OperatorEnum::LE ? left[i] <= rightAt(i)
+                                         : op == OperatorEnum::GT ? left[i] > rightAt(i)
+                                         : left[i] >= rightAt(i);
+                        expect.set(i, bit);
+                    }
+                    EXPECT_TRUE(std::ranges::equal(mask, expect.words())) << name << " size " << size;
+                }
+
+                for (const auto op: mathOps) {
+                    std::vector<double> out(size);
+                    ComputeLib::mathKernel(op, left.data(), rightData, 1.0, size, out.data());
+                    for (std::size_t i = 0; i < size; ++i) {
+                        const double expect = op == OperatorEnum::ADD ? left[i] + rightAt(i)
+                                              : op == OperatorEnum::SUB ? left[i] - rightAt(i)
+                                              : op == OperatorEnum::MUL ? left[i] * rightAt(i)
+                                              : op == OperatorEnum::DIV ? left[i] / rightAt(i)
+                                              : std::pow(left[i], rightAt(i));
+                        EXPECT_TRUE(isSameDouble(out[i], expect)) << name << " row " << i;
+                    }
+                }
+
+                std::vector<double> out(size);
+                ComputeLib::absKernel(left.data(), size, out.data());
+                for (std::size_t i = 0; i < size; ++i) {
+                    EXPECT_TRUE(isSameDouble(out[i], std::abs(left[i]))) << name << " row " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(KernelTest, levelIsClampedToDetected) {
+    EXPECT_LE(ComputeLib::setSimdLevel(ComputeLib::SimdLevel::AVX512), ComputeLib::detectSimdLevel());
+    EXPECT_EQ(ComputeLib::getSimdLevel(), std::min(ComputeLib::SimdLevel::AVX512, ComputeLib::detectSimdLevel()));
+    EXPECT_EQ(ComputeLib::setSimdLevel(ComputeLib::SimdLevel::SCALAR), ComputeLib::SimdLevel::SCALAR);
+}
@@ -0,0 +1,135 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 3 * ComputeLib::MORSEL_SIZE + 555;
+
+// op of value where the condition holds, over [start, end) seconds if start is given.
+static std::string masked(const std::string &op, const std::string &value, const std::string &where,
+                          const std::string &start = "", const std::string &end = "") {
+    std::string task = R"({"type":"operation","operation":")" + op + R"(","value":)" + value;
+    if (op == "COUNT") {
+        task += R"(,"initialValue":{"type":"value","value":2},"unit":{"type":"value","value":0.5})";
+    }
+    if (!start.empty()) {
+        task += R"(,"start":{"type":"value","value":)" + start + R"(},"end":{"type":"value","value":)" + end + "}";
+    }
+    return task + R"(,"where":)" + where + "}";
+}
+
+// Gear 4 is rare and comes in short runs, gear 1 and above covers most rows.
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<double> speed(ROWS);
+    std::vector<uint32_t> rpm(ROWS);
+    std::vector<uint8_t> gear(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        speed[i] = std::cos(static_cast<double>(i) * 0.002) * 70.0 + static_cast<double>(i % 13) * 0.25;
+        rpm[i] = static_cast<uint32_t>(800 + i * 6007 % 4000);
+        gear[i] = static_cast<uint8_t>(i % 997 < 5 ? 4 : i % 29 == 0 ? 0 : 1 + i / 700 % 3);
+    }
+    frame.addColumn("speed", speed);
+    frame.addColumn("rpm", rpm);
+    frame.addColumn("gear", gear);
+    return frame;
+}
+
+static double number(ComputeLib::Executor &executor, const std::string &task) {
+    return std::get<ComputeLib::NumericType>(executor.run(compileTask(task)));
+}
+
+TEST(MaskedAggregateTest, matchesFilteredRows) {
+    const DataFrame frame = makeFrame();
+    const auto &speed = std::get<std::vector<double> >(frame.getColumn(0));
+    const auto &rpm = std::get<std::vector<uint32_t> >(frame.getColumn(1));
+    const auto &gear = std::get<std::vector<uint8_t> >(frame.getColumn(2));
+    ComputeLib::Executor single(1);
+    single.setDataSource(&frame);
+    ComputeLib::Executor parallel(3);
+    parallel.setDataSource(&frame);
+
+    const std::vector<std::pair<std::string, uint8_t> > conditions = {{"4", 4}, {"1", 1}, {"0", 0}};
+    for (const auto &[constant, minGear]: conditions) {
+        const std::string where = compare("GE", GEAR, constant);
+        for (const auto &[start, end]: std::vector<std::pair<std::string, std::string> >{
+                 {"", ""}, {"12.3", "4000.1"}, {"1700", "1700.05"}}) {
+            const std::size_t first = start.empty() ? 0 : static_cast<std::size_t>(std::stod(start) * 10 + 0.999);
+            const std::size_t last = end.empty() ? ROWS : static_cast<std::size_t>(std::stod(end) * 10 + 0.999);
+            std::vector<double> kept;
+            std::size_t fast = 0;
+            for (std::size_t i = first; i < last; ++i) {
+                if (gear[i] >= minGear) {
+                    kept.emplace_back(speed[i]);
+                    fast += speed[i] > 30;
+                }
+            }
+
+            const std::string count = masked("COUNT", compare("GT", SPEED, "30"), where, start, end);
+            EXPECT_EQ(number(parallel, count), 2 + 0.5 * static_cast<double>(fast)) << count;
+            for (const std::string op: {"MAX", "MIN", "AVG", "SUM"}) {
+                const std::string task = masked(op, SPEED, where, start, end);
+                if (kept.empty()) {
+                    EXPECT_THROW(number(parallel, task), std::runtime_error) << task;
+                    continue;
+                }
+                double expect = 0;
+                if (op == "MAX") {
+                    expect = *std::ranges::max_element(kept);
+                } else if (op == "MIN") {
+                    expect = *std::ranges::min_element(kept);
+                } else {
+                    for (const double x: kept) {
+                        expect += x;
+                    }
+                    expect /= op == "AVG" ? static_cast<double>(kept.size()) : 1;
+                }
+                const double actual = number(parallel, task);
+                EXPECT_NEAR(actual, expect, 1e-9 * std::max(1.0, std::abs(expect))) << task;
+                // The same bits whatever the thread count.
+                EXPECT_EQ(actual, number(single, task)) << task;
+            }
+        }
+    }
+
+    // Integer columns, and a condition that holds everywhere, like no condition at all.
+    double sum = 0;
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        sum += gear[i] == 4 ? rpm[i] : 0;
+    }
+    EXPECT_EQ(number(parallel, masked("SUM", RPM, compare("EQ", GEAR, "4"))), sum);
+    const std::string always = compare("GT", R"({"type":"value","value":1})", "0");
+    for (const std::string op: {"MAX", "AVG"}) {
+        EXPECT_EQ(number(parallel, masked(op, SPEED, always)),
+                  number(parallel, R"({"type":"operation","operation":")" + op + R"(","value":)" + SPEED + "}"));
+    }
+    EXPECT_THROW(number(parallel, masked("MAX", SPEED, compare("GT", R"({"type":"value","value":0})", "1"))),
+                 std::runtime_error);
+    EXPECT_THROW(number(parallel, masked("MAX", SPEED, RPM)), std::runtime_error);
+}
+
+TEST(MaskedAggregateTest, pipelinedMatchesWholeColumn) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    const std::string rare = compare("EQ", GEAR, "4");
+    const std::string common = compare("GE", GEAR, "1");
+    for (const auto &task: {masked("AVG", SPEED, rare), masked("MIN", RPM, common, "100", "3000"),
+                            masked("SUM", SPEED, common), masked("COUNT", compare("GT", SPEED, "0"), rare, "5", "4500"),
+                            masked("MAX", SPEED, compare("GT", RPM, "4700"), "0", "1e9")}) {
+        const auto plan = compileTask(task);
+        const auto expect = std::get<ComputeLib::NumericType>(executor.run(plan));
+        for (const std::size_t batch: {1000UL, 4096UL, 70000UL}) {
+            EXPECT_EQ(std::get<ComputeLib::NumericType>(executor.runPipelined(plan, batch)), expect)
+                << task << " batch " << batch;
+        }
+    }
+}
@@ -0,0 +1,275 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include "rapidjson/document.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 5 * ComputeLib::MORSEL_SIZE + 123;
+
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<double> speed(ROWS);
+    std::vector<uint8_t> gear(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        speed[i] = std::sin(static_cast<double>(i) * 0.001) * 100.0 + 0.1 * static_cast<double>(i % 7);
+        gear[i] = static_cast<uint8_t>(i / 1000 % 6);
+    }
+    frame.addColumn("speed", speed);
+    frame.addColumn("gear", gear);
+    return frame;
+}
+
+static ComputeLib::GenericValue runWithThreads(const std::string &task, const DataFrame &frame, uint32_t threads) {
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    ComputeLib::Executor executor(threads);
+    executor.setDataSource(&frame);
+    return executor.run(doc);
+}
+
+TEST(ParallelOpTest, elementWiseMatchesSingleThread) {
+    const DataFrame frame = makeFrame();
+    const std::string task = R"({
+      "type":"operation",
+      "operation":"OR",
+      "operands":[
+        {
+          "type":"operation",
+          "operation":"GT",
+          "left":{
+            "type":"operation",
+            "operation":"ABS",
+            "value":{
+              "type":"operation",
+              "operation":"MUL",
+              "left":{"type":"operation","operation":"SELECT","value":"speed"},
+              "right":{"type":"operation","operation":"SELECT","value":"gear"}
+            }
+          },
+          "right":{"type":"value","value":250}
+        },
+        {
+          "type":"operation",
+          "operation":"EQ",
+          "left":{"type":"operation","operation":"SELECT","value":"gear"},
+          "right":{"type":"value","value":0}
+        }
+      ]
+    })";
+
+    const auto expect = runWithThreads(task, frame, 1);
+    const auto result = runWithThreads(task, frame, 4);
+    ASSERT_TRUE(ComputeLib::Executor::holdsBoolVector(result));
+    EXPECT_EQ(std::get<ComputeLib::BoolVectorType>(result).size(), ROWS);
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(result) == std::get<ComputeLib::BoolVectorType>(expect));
+}
+
+TEST(ParallelOpTest, reductionsAreDeterministic) {
+    const DataFrame frame = makeFrame();
+    for (const char *op: {"MAX", "MIN", "AVG"}) {
+        const std::string task = std::string(R"({"type":"operation","operation":")") + op +
+                                 R"(","value":{"type":"operation","operation":"SELECT","value":"speed"}})";
+        const auto expect = std::get<ComputeLib::NumericType>(runWithThreads(task, frame, 1));
+        for (const uint32_t threads: {2U, 3U, 8U}) {
+            const auto result = std::get<ComputeLib::NumericType>(runWithThreads(task, frame, threads));
+            // Bitwise equality, not just within tolerance.
+            EXPECT_EQ(result, expect) << op << " with " << threads << " threads";
+        }
+    }
+
+    const std::string count = R"({
+      "type":"operation",
+      "operation":"COUNT",
+      "initialValue":{"type":"value","value":0},
+      "unit":{"type":"value","value":1},
+      "value":{
+        "type":"operation",
+        "operation":"EQ",
+        "left":{"type":"operation","operation":"SELECT","value":"gear"},
+        "right":{"type":"value","value":3}
+      }
+    })";
+    std::size_t expectCount = 0;
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        expectCount += i / 1000 % 6 == 3 ? 1 : 0;
+    }
+    EXPECT_EQ(std::get<ComputeLib::NumericType>(runWithThreads(count, frame, 1)), expectCount);
+    EXPECT_EQ(std::get<ComputeLib::NumericType>(runWithThreads(count, frame, 4)), expectCount);
+}
+
+TEST(ParallelOpTest, onlyTheFirstRowMakesMaxAndMinNaN) {
+    // Rows of 1 with NaN opening the second morsel and the extremes after it, as ranges::max/min fold them.
+    const std::size_t rows = 40000;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<double> speed(rows, 1);
+    speed[ComputeLib::MORSEL_SIZE] = nan;
+    speed[20000] = 5;
+    speed[30000] = -3;
+    const std::string gear = R"({"type":"operation","operation":"EQ","right":{"type":"value","value":1},
+        "left":{"type":"operation","operation":"SELECT","value":"gear"}})";
+    for (const bool nanFirst: {false, true}) {
+        speed[0] = nanFirst ? nan : 1;
+        DataFrame frame(0, static_cast<int64_t>(rows) * INTERVAL, INTERVAL);
+        frame.addColumn("speed", speed);
+        frame.addColumn("gear", std::vector<uint8_t>(rows, 1));
+        for (const std::string op: {"MAX", "MIN"}) {
+            const double expect = nanFirst ? nan : op == "MAX" ? 5 : -3;
+            const std::string task = R"({"type":"operation","operation":")" + op + R"(","value":)" + SPEED;
+            for (const auto &query: {task + "}", task + R"(,"where":)" + gear + "}"}) {
+                rapidjson::Document doc;
+                doc.Parse(query.c_str());
+                const auto plan = ComputeLib::CompiledQuery::compile(doc);
+                for (const uint32_t threads: {1U, 4U}) {
+                    ComputeLib::Executor executor(threads);
+                    executor.setDataSource(&frame);
+                    const auto result = std::get<ComputeLib::NumericType>(executor.run(plan));
+                    EXPECT_TRUE(result == expect || (std::isnan(result) && std::isnan(expect))) << query;
+                    const auto pipelined = std::get<ComputeLib::NumericType>(executor.runPipelined(plan, 5000));
+                    EXPECT_TRUE(pipelined == expect || (std::isnan(pipelined) && std::isnan(expect))) << query;
+                }
+            }
+        }
+
+        // The same for the single run of a SEGMENT_AGG.
+        const std::string segments = R"({"type":"operation","operation":"SEGMENT_AGG","value":)" + gear +
+                                     R"(,"target":)" + SPEED + "}";
+        rapidjson::Document doc;
+        doc.Parse(segments.c_str());
+        const auto plan = ComputeLib::CompiledQuery::compile(doc);
+        ComputeLib::Executor executor(4);
+        executor.setDataSource(&frame);
+        for (const auto &result: {executor.run(plan), executor.runPipelined(plan, 5000)}) {
+            const auto &table = std::get<ComputeLib::NumericVectorType>(result);
+            ASSERT_EQ(table.size(), 6);
+            EXPECT_EQ(std::isnan(table[3]), nanFirst);
+            EXPECT_EQ(std::isnan(table[4]), nanFirst);
+            if (!nanFirst) {
+                EXPECT_EQ(table[3], 5);
+                EXPECT_EQ(table[4], -3);
+            }
+        }
+    }
+}
+
+TEST(ParallelOpTest, logicalOr) {
+    ComputeLib::Executor executor(1);
+    const std::string task = R"({
+      "type":"operation",
+      "operation":"OR",
+      "operands":[
+        {"type":"operation","operation":"GT","left":{"type":"value","value":[1,5,2,7]},"right":{"type":"value","value":4}},
+        {"type":"operation","operation":"LT","left":{"type":"value","value":[1,5,2,7]},"right":{"type":"value","value":2}}
+      ]
+    })";
+    ComputeLib::BoolVectorType expect = {1, 1, 0, 1};
+
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    ComputeLib::GenericValue result = executor.run(doc);
+    EXPECT_TRUE(executor.holdsBoolVector(result));
+    auto &vec = std::get<ComputeLib::BoolVectorType>(result);
+    EXPECT_EQ(vec.size(), expect.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(vec[i], expect[i]) << "Mismatch at index " << i;
+    }
+}
+
+// Piecewise constant signal whose runs are short, long, and longer than a morsel, so that runs
+// start, end and span across chunk boundaries.
+static DataFrame makeStateFrame() {
+    std::vector<double> state;
+    std::vector<double> level;
+    uint64_t seed = 42;
+    const auto next = [&seed] {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+    while (state.size() < 6 * ComputeLib::MORSEL_SIZE) {
+        const auto value = static_cast<double>(next() % 4);
+        const std::size_t length = next() % 8 == 0 ? ComputeLib::MORSEL_SIZE + next() % 5000 : 1 + next() % 40;
+        state.insert(state.end(), length, value);
+        level.insert(level.end(), length, value * 3.0 + static_cast<double>(next() % 3));
+    }
+    const auto rows = static_cast<int64_t>(state.size());
+    DataFrame frame(0, rows * INTERVAL, INTERVAL);
+    frame.addColumn("state", state);
+    frame.addColumn("level", level);
+    return frame;
+}
+
+TEST(ParallelOpTest, temporalOperatorsAreBitIdentical) {
+    const DataFrame frame = makeStateFrame();
+    const std::vector<std::string> tasks = {
+        R"({"type":"operation","operation":"HOLD","value":{"type":"operation","operation":"SELECT","value":"state"},
+            "from":{"type":"value","value":[1]},"to":{"type":"value","value":[2,3]},"duration":{"type":"value","value":1.5}})",
+        R"({"type":"operation","operation":"HOLD","value":{"type":"operation","operation":"SELECT","value":"state"},
+            "from":{"type":"value","value":[0,1]},"to":{"type":"value","value":[]},"duration":{"type":"value","value":0.3}})",
+        R"({"type":"operation","operation":"HOLD","value":{"type":"operation","operation":"SELECT","value":"state"},
+            "from":{"type":"value","value":[]},"to":{"type":"value","value":[2]},"duration":{"type":"value","value":-2}})",
+        R"({"type":"operation","operation":"AFTER","value":{"type":"operation","operation":"SELECT","value":"level"},
+            "from":{"type":"value","value":2},"to":{"type":"value","value":6},"duration":{"type":"value","value":0.5}})",
+        R"({"type":"operation","operation":"AFTER","value":{"type":"operation","operation":"SELECT","value":"level"},
+            "from":{"type":"value","value":8},"to":{"type":"value","value":3},"duration":{"type":"value","value":0.2}})",
+        R"({"type":"operation","operation":"JUMP","value":{"type":"operation","operation":"SELECT","value":"state"},
+            "from":{"type":"value","value":[0,1]},"to":{"type":"value","value":[2,3]}})",
+        R"({"type":"operation","operation":"DURATION","minDuration":{"type":"value","value":2.5},
+            "value":{"type":"operation","operation":"GE","left":{"type":"operation","operation":"SELECT","value":"state"},
+                     "right":{"type":"value","value":2}}})",
+    };
+
+    for (const auto &task: tasks) {
+        const auto expect = runWithThreads(task, frame, 1);
+        ASSERT_TRUE(ComputeLib::Executor::holdsBoolVector(expect));
+        const auto &expectVec = std::get<ComputeLib::BoolVectorType>(expect);
+        EXPECT_TRUE(std::ranges::any_of(expectVec, [](const auto v) { return v != 0; })) << task;
+        for (const uint32_t threads: {2U, 4U, 7U}) {
+            const auto result = runWithThreads(task, frame, threads);
+            EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(result) == expectVec) << task << " with " << threads;
+        }
+    }
+}
+
+TEST(ParallelOpTest, durationDropsShortRuns) {
+    ComputeLib::Executor executor(1);
+    const std::string task = R"({
+      "type":"operation",
+      "operation":"DURATION",
+      "minDuration":{"type":"value","value":0.3},
+      "value":{
+        "type":"operation",
+        "operation":"GT",
+        "left":{"type":"value","value":[1,1,0,1,1,1,0,1,1,1,1]},
+        "right":{"type":"value","value":0}
+      }
+    })";
+    ComputeLib::BoolVectorType expect = {0, 0, 0, 1, 1, 1, 0, 1, 1, 1, 1};
+
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    ComputeLib::GenericValue result = executor.run(doc);
+    EXPECT_TRUE(executor.holdsBoolVector(result));
+    auto &vec = std::get<ComputeLib::BoolVectorType>(result);
+    EXPECT_EQ(vec.size(), expect.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(vec[i], expect[i]) << "Mismatch at index " << i;
+    }
+}
+
+TEST(ParallelOpTest, workersReportThreadIds) {
+    const ComputeLib::ThreadPool pool(4);
+    auto ids = pool.workerThreadIds();
+    ASSERT_EQ(ids.size(), 3);
+#ifdef __linux__
+    ids.emplace_back(ComputeLib::currentSystemThreadId());
+    std::ranges::sort(ids);
+    EXPECT_EQ(std::ranges::adjacent_find(ids), ids.end());
+#endif
+}
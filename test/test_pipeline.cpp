@@ -0,0 +1,137 @@
+#include "executor.h"
+#include "pipeline.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Runs of random states, some longer than a morsel, so temporal operators carry state across many batches.
+static DataFrame makeFrame() {
+    std::vector<double> state;
+    std::vector<double> level;
+    std::vector<int32_t> rpm;
+    uint64_t seed = 7;
+    const auto next = [&seed] {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+    while (state.size() < 3 * ComputeLib::MORSEL_SIZE) {
+        const auto value = static_cast<double>(next() % 4);
+        const std::size_t length = next() % 10 == 0 ? ComputeLib::MORSEL_SIZE / 2 + next() % 9000 : 1 + next() % 40;
+        state.insert(state.end(), length, value);
+        level.insert(level.end(), length, value * 3.0 + static_cast<double>(next() % 3));
+    }
+    for (std::size_t i = 0; i < state.size(); ++i) {
+        rpm.emplace_back(static_cast<int32_t>(next() % 7000) - 500);
+    }
+    level[100] = std::numeric_limits<double>::quiet_NaN();
+    const auto rows = static_cast<int64_t>(state.size());
+    DataFrame frame(0, rows * INTERVAL, INTERVAL);
+    frame.addColumn("state", state);
+    frame.addColumn("level", level);
+    frame.addColumn("rpm", rpm);
+    return frame;
+}
+
+TEST(PipelineTest, matchesWholeColumnExecution) {
+    const DataFrame frame = makeFrame();
+    const std::string state = selectColumn("state");
+    const std::string level = selectColumn("level");
+    const std::string over2 = R"({"type":"operation","operation":"GE","left":)" + state +
+                              R"(,"right":{"type":"value","value":2}})";
+    const std::vector<std::string> tasks = {
+        // element-wise
+        R"({"type":"operation","operation":"OR","operands":[{"type":"operation","operation":"GT","left":
+            {"type":"operation","operation":"ABS","value":{"type":"operation","operation":"MUL","left":)" + level +
+        R"(,"right":)" + RPM + R"(}},"right":{"type":"value","value":9000}},{"type":"operation","operation":"NOT",
+            "value":)" + over2 + R"(}]})",
+        R"({"type":"operation","operation":"DIV","left":)" + RPM + R"(,"right":{"type":"value","value":7}})",
+        level,
+        // temporal operators, forward and backward
+        R"({"type":"operation","operation":"HOLD","value":)" + state + R"(,"from":{"type":"value","value":[1]},
+            "to":{"type":"value","value":[2,3]},"duration":{"type":"value","value":1.5}})",
+        R"({"type":"operation","operation":"HOLD","value":)" + state + R"(,"from":{"type":"value","value":[0,1]},
+            "to":{"type":"value","value":[]},"duration":{"type":"value","value":-0.3}})",
+        R"({"type":"operation","operation":"HOLD","value":)" + state + R"(,"from":{"type":"value","value":[]},
+            "to":{"type":"value","value":[2]},"duration":{"type":"value","value":-2}})",
+        R"({"type":"operation","operation":"HOLD","value":)" + state + R"(,"from":{"type":"value","value":[1]},
+            "to":{"type":"value","value":[2]},"duration":{"type":"value","value":-1}})",
+        R"({"type":"operation","operation":"AFTER","value":)" + level + R"(,"from":{"type":"value","value":2},
+            "to":{"type":"value","value":6},"duration":{"type":"value","value":0.5}})",
+        R"({"type":"operation","operation":"AFTER","value":)" + level + R"(,"from":{"type":"value","value":8},
+            "to":{"type":"value","value":3},"duration":{"type":"value","value":0.2}})",
+        R"({"type":"operation","operation":"JUMP","value":)" + state + R"(,"from":{"type":"value","value":[0,1]},
+            "to":{"type":"value","value":[2,3]}})",
+        R"({"type":"operation","operation":"DURATION","minDuration":{"type":"value","value":2.5},"value":)" + over2 +
+        "}",
+        // a lagging DURATION next to an operand that is not held back
+        R"({"type":"operation","operation":"AND","operands":[{"type":"operation","operation":"DURATION",
+            "minDuration":{"type":"value","value":600},"value":)" + over2 + R"(},{"type":"operation","operation":"LT",
+            "left":)" + RPM + R"(,"right":{"type":"value","value":5000}}]})",
+        // aggregates, at the root and read by row-valued operators in a later pass
+        R"({"type":"operation","operation":"AVG","value":)" + RPM + "}",
+        R"({"type":"operation","operation":"MAX","value":)" + level + "}",
+        R"({"type":"operation","operation":"MIN","value":)" + level + "}",
+        R"({"type":"operation","operation":"COUNT","value":)" + over2 + R"(,"initialValue":{"type":"value","value":3},
+            "unit":{"type":"value","value":0.5}})",
+        R"({"type":"operation","operation":"GT","left":)" + RPM + R"(,"right":{"type":"operation","operation":"AVG",
+            "value":)" + RPM + "}}",
+        R"({"type":"operation","operation":"LT","left":{"type":"operation","operation":"MAX","value":)" + level +
+        R"(},"right":{"type":"operation","operation":"AVG","value":{"type":"operation","operation":"SUB","left":)" +
+        RPM + R"(,"right":{"type":"operation","operation":"MIN","value":)" + RPM + "}}}}",
+    };
+
+    for (const auto &task: tasks) {
+        const auto plan = compileTask(task);
+        ComputeLib::Executor reference(1);
+        reference.setDataSource(&frame);
+        const auto expect = reference.run(plan);
+        for (const std::size_t batch: {std::size_t{64}, std::size_t{1000}, ComputeLib::PIPELINE_BATCH_SIZE,
+                                       ComputeLib::MORSEL_SIZE + 5}) {
+            for (const uint32_t threads: {1U, 3U}) {
+                ComputeLib::Executor executor(threads);
+                executor.setDataSource(&frame);
+                EXPECT_TRUE(isSameValue(executor.runPipelined(plan, batch), expect))
+                    << task << " in batches of " << batch;
+            }
+        }
+    }
+}
+
+TEST(PipelineTest, heldBackRowsWaitForTheirRun) {
+    // The TRUE run crossing the batches is only settled once it ends.
+    DataFrame frame(0, 12 * INTERVAL, INTERVAL);
+    frame.addColumn("b", std::vector<double>{1, 1, 1, 0, 1, 1, 1, 1, 1, 0, 1, 1});
+    const auto plan = compileTask(R"({"type":"operation","operation":"DURATION","minDuration":{"type":"value",
+        "value":0.4},"value":{"type":"operation","operation":"EQ","left":{"type":"operation","operation":"SELECT",
+        "value":"b"},"right":{"type":"value","value":1}}})");
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    for (const std::size_t batch: {1UL, 2UL, 5UL}) {
+        const auto result = executor.runPipelined(plan, batch);
+        EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(result) ==
+            ComputeLib::BoolVectorType({0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 0})) << batch;
+    }
+}
+
+TEST(PipelineTest, reportsOperandErrors) {
+    DataFrame frame(0, 4 * INTERVAL, INTERVAL);
+    frame.addColumn("b", std::vector<double>{1, 2, 3, 4});
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    // A numeric[] constant of another length, and an aggregate over bool[].
+    EXPECT_THROW(executor.runPipelined(compileTask(R"({"type":"operation","operation":"ADD","left":
+        {"type":"operation","operation":"SELECT","value":"b"},"right":{"type":"value","value":[1, 2]}})"), 2),
+                 std::runtime_error);
+    EXPECT_THROW(executor.runPipelined(compileTask(R"({"type":"operation","operation":"MAX","value":
+        {"type":"operation","operation":"GT","left":{"type":"operation","operation":"SELECT","value":"b"},
+        "right":{"type":"value","value":2}}})"), 2), std::runtime_error);
+    EXPECT_THROW(executor.runPipelined(compileTask(selectColumn("b")), 0),
+                 std::runtime_error);
+}
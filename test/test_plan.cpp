@@ -0,0 +1,193 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include "rapidjson/document.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+
+TEST(PlanTest, compileOnceRunMany) {
+    const std::string task = R"({
+      "type":"operation",
+      "operation":"GT",
+      "left":{
+        "type":"operation",
+        "operation":"ADD",
+        "left":{"type":"operation","operation":"SELECT","value":"a"},
+        "right":{"type":"operation","operation":"SELECT","value":"b"}
+      },
+      "right":{"type":"value","value":10}
+    })";
+
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    const auto plan = ComputeLib::CompiledQuery::compile(doc);
+    EXPECT_EQ(plan.columns().size(), 2);
+
+    DataFrame first(0, 4 * INTERVAL, INTERVAL);
+    first.addColumn("a", std::vector<uint8_t>{1, 5, 9, 20});
+    first.addColumn("b", std::vector<int32_t>{1, 5, 2, -5});
+
+    // Columns are registered in a different order, binding must follow names.
+    DataFrame second(0, 3 * INTERVAL, INTERVAL);
+    second.addColumn("b", std::vector<double>{10.5, 0, 3});
+    second.addColumn("a", std::vector<uint32_t>{0, 11, 7});
+
+    ComputeLib::Executor executor(1);
+
+    executor.setDataSource(&first);
+    ComputeLib::GenericValue result = executor.run(plan);
+    EXPECT_TRUE(executor.holdsBoolVector(result));
+    ComputeLib::BoolVectorType expect = {0, 0, 1, 1};
+    auto &vec = std::get<ComputeLib::BoolVectorType>(result);
+    EXPECT_EQ(vec.size(), expect.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(vec[i], expect[i]) << "Mismatch at index " << i;
+    }
+
+    executor.setDataSource(&second);
+    result = executor.run(plan);
+    EXPECT_TRUE(executor.holdsBoolVector(result));
+    expect = {1, 1, 0};
+    auto &vec2 = std::get<ComputeLib::BoolVectorType>(result);
+    EXPECT_EQ(vec2.size(), expect.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(vec2[i], expect[i]) << "Mismatch at index " << i;
+    }
+}
+
+TEST(PlanTest, bareLiteralConstants) {
+    const std::string task = R"({
+      "type":"operation",
+      "operation":"COUNT",
+      "unit":0.5,
+      "initialValue":1,
+      "value":{
+        "type":"operation",
+        "operation":"GT",
+        "left":{"type":"value","value":[1,2,3,4]},
+        "right":{"type":"value","value":2}
+      }
+    })";
+
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    ComputeLib::Executor executor(1);
+    ComputeLib::GenericValue result = executor.run(doc);
+    EXPECT_TRUE(executor.holdsNumeric(result));
+    EXPECT_EQ(std::get<ComputeLib::NumericType>(result), 2);
+}
+
+TEST(PlanTest, invalidQuery) {
+    rapidjson::Document doc;
+    doc.Parse(R"({"type":"operation","operation":"FOO"})");
+    EXPECT_THROW(ComputeLib::CompiledQuery::compile(doc), std::runtime_error);
+
+    doc.Parse(R"({"type":"operation","operation":"ADD","left":{"type":"value","value":1}})");
+    EXPECT_THROW(ComputeLib::CompiledQuery::compile(doc), std::runtime_error);
+
+    doc.Parse(R"({"type":"operation","operation":"SELECT","value":"missing"})");
+    const auto plan = ComputeLib::CompiledQuery::compile(doc);
+    DataFrame frame(0, INTERVAL, INTERVAL);
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    EXPECT_THROW(executor.run(plan), std::runtime_error);
+}
+
+TEST(PlanTest, commonSubexpressionElimination) {
+    const std::string task = R"({
+      "type":"operation",
+      "operation":"AND",
+      "operands":[
+        {
+          "type":"operation",
+          "operation":"GT",
+          "left":{
+            "type":"operation",
+            "operation":"ADD",
+            "left":{"type":"operation","operation":"SELECT","value":"b"},
+            "right":{"type":"operation","operation":"SELECT","value":"b"}
+          },
+          "right":{"type":"value","value":10}
+        },
+        {
+          "type":"operation",
+          "operation":"LT",
+          "left":{"type":"operation","operation":"SELECT","value":"b"},
+          "right":{"type":"value","value":20}
+        },
+        {
+          "type":"operation",
+          "operation":"LT",
+          "left":{"type":"operation","operation":"SELECT","value":"b"},
+          "right":{"type":"value","value":20}
+        }
+      ]
+    })";
+
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    const auto plan = ComputeLib::CompiledQuery::compile(doc);
+
+    // SELECT b, ADD, 10, GT, 20, LT, AND
+    EXPECT_EQ(plan.nodes().size(), 7);
+    const auto &root = plan.node(plan.root());
+    EXPECT_EQ(root.inputs.size(), 3);
+    // The cheaper LT is moved ahead of the GT over ADD.
+    EXPECT_EQ(root.inputs[0], root.inputs[1]);
+    const auto &add = plan.node(plan.node(root.inputs[2]).inputs[0]);
+    EXPECT_EQ(add.op, ComputeLib::OperatorEnum::ADD);
+    EXPECT_EQ(add.inputs[0], add.inputs[1]);
+
+    DataFrame frame(0, 4 * INTERVAL, INTERVAL);
+    frame.addColumn("b", std::vector<uint8_t>{1, 6, 15, 25});
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    ComputeLib::GenericValue result = executor.run(plan);
+    EXPECT_TRUE(executor.holdsBoolVector(result));
+    ComputeLib::BoolVectorType expect = {0, 1, 1, 0};
+    auto &vec = std::get<ComputeLib::BoolVectorType>(result);
+    EXPECT_EQ(vec.size(), expect.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(vec[i], expect[i]) << "Mismatch at index " << i;
+    }
+}
+
+TEST(PlanTest, constantsAreMergedByTheirBits) {
+    // 0.0 and -0.0 compare equal but divide into +inf and -inf, so the two DIVs must stay apart.
+    const std::string task = R"({
+      "type":"operation",
+      "operation":"GT",
+      "left":{
+        "type":"operation",
+        "operation":"DIV",
+        "left":{"type":"value","value":[1,2]},
+        "right":{"type":"value","value":[0.0,0.0]}
+      },
+      "right":{
+        "type":"operation",
+        "operation":"DIV",
+        "left":{"type":"value","value":[1,2]},
+        "right":{"type":"value","value":[-0.0,-0.0]}
+      }
+    })";
+
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    const auto plan = ComputeLib::CompiledQuery::compile(doc);
+    const auto &root = plan.node(plan.root());
+    EXPECT_NE(root.inputs[0], root.inputs[1]);
+
+    ComputeLib::Executor executor(1);
+    ComputeLib::GenericValue result = executor.run(plan);
+    EXPECT_TRUE(executor.holdsBoolVector(result));
+    ComputeLib::BoolVectorType expect = {1, 1};
+    auto &vec = std::get<ComputeLib::BoolVectorType>(result);
+    EXPECT_EQ(vec.size(), expect.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(vec[i], expect[i]) << "Mismatch at index " << i;
+    }
+}
@@ -0,0 +1,145 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "profile.h"
+#include "test_util.h"
+#include "rapidjson/document.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <stdexcept>
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 3000;
+
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<uint8_t> gear(ROWS);
+    std::vector<double> speed(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        gear[i] = static_cast<uint8_t>(i / 50 % 4);
+        speed[i] = static_cast<double>(i % 100);
+    }
+    frame.addColumn("gear", gear);
+    frame.addColumn("speed", speed);
+    return frame;
+}
+
+// HOLD is not element-wise, so it stays a node of its own next to the fused compare.
+static const std::string TASK = R"({"type":"operation","operation":"AND","operands":[{"type":"operation",
+    "operation":"HOLD","value":{"type":"operation","operation":"SELECT","value":"gear"},"from":{"type":"value",
+    "value":[1]},"to":{"type":"value","value":[2]},"duration":{"type":"value","value":1}},{"type":"operation",
+    "operation":"GT","left":{"type":"operation","operation":"SELECT","value":"speed"},"right":{"type":"value",
+    "value":74}}]})";
+
+TEST(ProfileTest, recordsEveryNode) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    ComputeLib::QueryProfile profile(compileTask(TASK));
+    const auto expect = executor.run(profile.plan());
+    const auto first = executor.runProfiled(profile);
+    executor.runProfiled(profile);
+    ASSERT_EQ(first.size(), 1);
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(first.front()) == std::get<ComputeLib::BoolVectorType>(expect));
+
+    const auto &plan = profile.plan();
+    const auto &root = profile.node(plan.root());
+    EXPECT_EQ(root.executions, 2);
+    EXPECT_EQ(root.rowsOut, 2 * ROWS);
+    EXPECT_EQ(root.trueRows, 2 * std::get<ComputeLib::BoolVectorType>(expect).count());
+    EXPECT_GT(root.bytes, 0);
+    for (uint32_t i = 0; i < plan.nodes().size(); ++i) {
+        const auto &node = plan.node(i);
+        const auto &stats = profile.node(i);
+        if (node.kind == ComputeLib::NodeKind::CONSTANT) {
+            EXPECT_EQ(stats.executions, 0);
+            continue;
+        }
+        EXPECT_EQ(stats.executions, 2) << i;
+        if (node.op == ComputeLib::OperatorEnum::HOLD) {
+            EXPECT_EQ(stats.rowsIn, 2 * ROWS);
+            EXPECT_EQ(stats.rowsOut, 2 * ROWS);
+            EXPECT_TRUE(stats.boolRows);
+            EXPECT_GT(stats.selectivity(), 0.0);
+            EXPECT_LT(stats.selectivity(), 1.0);
+        }
+        if (node.op == ComputeLib::OperatorEnum::SELECT) {
+            // Columns are read in place.
+            EXPECT_EQ(stats.bytes, 0);
+            EXPECT_TRUE(std::isnan(stats.selectivity()));
+        }
+    }
+}
+
+TEST(ProfileTest, printsTextAndJson) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    rapidjson::Document first;
+    rapidjson::Document second;
+    first.Parse(TASK.c_str());
+    second.Parse(R"({"type":"operation","operation":"MAX","value":{"type":"operation","operation":"SELECT",
+        "value":"speed"}})");
+    const std::vector<const ComputeLib::Query *> queries = {&first, &second};
+    ComputeLib::QueryProfile profile(ComputeLib::CompiledQuery::compileBatch(queries));
+    executor.runProfiled(profile);
+
+    const std::string text = profile.toText();
+    for (const std::string expect: {"query 0:", "query 1:", "AND", "HOLD", "GT", "SELECT gear", "[1]", "runs=1",
+                                    "selectivity=", "MAX", "(shown above)"}) {
+        EXPECT_NE(text.find(expect), std::string::npos) << expect << "\n" << text;
+    }
+
+    rapidjson::Document json;
+    json.Parse(profile.toJson().c_str());
+    ASSERT_FALSE(json.HasParseError());
+    const auto &roots = json["queries"];
+    ASSERT_EQ(roots.Size(), 2);
+    EXPECT_STREQ(roots[0]["operation"].GetString(), "AND");
+    EXPECT_EQ(roots[0]["executions"].GetUint64(), 1);
+    EXPECT_EQ(roots[0]["rowsOut"].GetUint64(), ROWS);
+    EXPECT_TRUE(roots[0].HasMember("selectivity"));
+    EXPECT_EQ(roots[0]["inputs"].Size(), 2);
+    EXPECT_STREQ(roots[1]["operation"].GetString(), "MAX");
+    EXPECT_FALSE(roots[1].HasMember("selectivity"));
+    // The speed column is shared with the first query.
+    EXPECT_TRUE(roots[1]["inputs"][0]["shared"].GetBool());
+}
+
+TEST(ProfileTest, countsHardwareEvents) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(3);
+    executor.setDataSource(&frame);
+    ComputeLib::QueryProfile profile(compileTask(TASK), true);
+    try {
+        executor.runProfiled(profile);
+    } catch (const std::runtime_error &e) {
+        GTEST_SKIP() << e.what();
+    }
+
+    const auto &plan = profile.plan();
+    std::size_t counted = 0;
+    for (std::size_t k = 0; k < ComputeLib::COUNTER_EVENTS; ++k) {
+        const auto event = static_cast<ComputeLib::CounterEvent>(k);
+        if (!profile.counts(event)) {
+            continue;
+        }
+        ++counted;
+        EXPECT_NE(profile.toText().find(ComputeLib::getCounterEventName(event)), std::string::npos);
+    }
+    EXPECT_GT(counted, 0);
+    const auto event = profile.counts(ComputeLib::CounterEvent::TASK_CLOCK_NS)
+                           ? ComputeLib::CounterEvent::TASK_CLOCK_NS
+                           : ComputeLib::CounterEvent::INSTRUCTIONS;
+    if (profile.counts(event)) {
+        EXPECT_GT(profile.node(plan.root()).counters[static_cast<std::size_t>(event)], 0);
+    }
+
+    rapidjson::Document json;
+    json.Parse(profile.toJson().c_str());
+    ASSERT_FALSE(json.HasParseError());
+    EXPECT_EQ(json["queries"][0]["counters"].MemberCount(), counted);
+}
@@ -0,0 +1,166 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 3 * ComputeLib::MORSEL_SIZE + 4321;
+
+// op of value over [start, end) seconds; an empty bound is left out of the query.
+static std::string ranged(const std::string &op, const std::string &value, const std::string &start,
+                          const std::string &end) {
+    std::string task = R"({"type":"operation","operation":")" + op + R"(","value":)" + value;
+    if (!start.empty()) {
+        task += R"(,"start":{"type":"value","value":)" + start + "}";
+    }
+    if (!end.empty()) {
+        task += R"(,"end":{"type":"value","value":)" + end + "}";
+    }
+    return task + "}";
+}
+
+// Speed holds one NaN, near the end.
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<double> speed(ROWS);
+    std::vector<uint32_t> rpm(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        speed[i] = std::sin(static_cast<double>(i) * 0.001) * 80.0 + static_cast<double>(i % 7);
+        rpm[i] = static_cast<uint32_t>(1000 + i * 7919 % 5000);
+    }
+    speed[ROWS - 100] = std::numeric_limits<double>::quiet_NaN();
+    frame.addColumn("speed", speed);
+    frame.addColumn("rpm", rpm);
+    return frame;
+}
+
+TEST(RangeIndexTest, answersRangesLikeScans) {
+    std::vector<int32_t> values(10 * RangeIndex::BLOCK_ROWS + 17);
+    std::mt19937 random(7);
+    for (auto &value: values) {
+        value = static_cast<int32_t>(random() % 2001) - 1000;
+    }
+    const std::span<const int32_t> view(values);
+    const RangeIndex index(view);
+    std::vector<std::pair<std::size_t, std::size_t> > ranges = {
+        {0, values.size()}, {0, 1}, {5, 6}, {3, 1000}, {1024, 2048}, {1000, 3100}, {1023, 9 * 1024 + 1}
+    };
+    for (int k = 0; k < 200; ++k) {
+        const std::size_t a = random() % values.size();
+        const std::size_t b = random() % values.size();
+        ranges.emplace_back(std::min(a, b), std::max(a, b) + 1);
+    }
+    for (const auto &[begin, end]: ranges) {
+        const auto rows = view.subspan(begin, end - begin);
+        EXPECT_EQ(index.max(view, begin, end), *std::ranges::max_element(rows)) << begin << " " << end;
+        EXPECT_EQ(index.min(view, begin, end), *std::ranges::min_element(rows)) << begin << " " << end;
+        EXPECT_EQ(index.sum(view, begin, end), std::accumulate(rows.begin(), rows.end(), 0.0)) << begin << " " << end;
+        EXPECT_EQ(index.nanCount(begin, end), 0);
+    }
+
+    // NaN rows are left out of the sums and counted.
+    const std::vector<double> withNaN = {1, std::numeric_limits<double>::quiet_NaN(), 2, 4};
+    const RangeIndex nanIndex{std::span<const double>(withNaN)};
+    EXPECT_EQ(nanIndex.sum(std::span<const double>(withNaN), 0, 4), 7);
+    EXPECT_EQ(nanIndex.nanCount(0, 4), 1);
+    EXPECT_EQ(nanIndex.nanCount(2, 4), 0);
+    EXPECT_EQ(nanIndex.max(std::span<const double>(withNaN), 2, 4), 4);
+}
+
+TEST(RangeIndexTest, isBuiltOnceAndRebuiltAfterAppends) {
+    DataFrame frame(0, 3 * INTERVAL, INTERVAL);
+    frame.addColumn("level", std::vector<double>{1, 5, 3});
+    const RangeIndex &index = frame.getRangeIndex(0);
+    EXPECT_EQ(&frame.getRangeIndex(0), &index);
+    EXPECT_EQ(index.sum(std::get<std::span<const double> >(frame.getColumnView(0)), 0, 3), 9);
+
+    frame.appendRows({std::vector<double>{10}});
+    const RangeIndex &rebuilt = frame.getRangeIndex(0);
+    EXPECT_EQ(rebuilt.sum(std::get<std::span<const double> >(frame.getColumnView(0)), 0, 4), 19);
+    EXPECT_EQ(rebuilt.max(std::get<std::span<const double> >(frame.getColumnView(0)), 1, 4), 10);
+}
+
+TEST(RangeIndexTest, rangedAggregatesMatchScannedRows) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(3);
+    executor.setDataSource(&frame);
+    const auto number = [&](const std::string &task) {
+        return std::get<ComputeLib::NumericType>(executor.run(compileTask(task)));
+    };
+
+    // The same rows through an expression, which has no range index and is scanned.
+    const std::string scannedSpeed = R"({"type":"operation","operation":"ADD","left":)" + SPEED +
+                                     R"(,"right":{"type":"value","value":0}})";
+    const std::string scannedRpm = R"({"type":"operation","operation":"ADD","left":)" + RPM +
+                                   R"(,"right":{"type":"value","value":0}})";
+    const std::vector<std::pair<std::string, std::string> > bounds = {
+        {"0", ""}, {"", "0.05"}, {"12.3", "1500"}, {"0.1", "0.2"}, {"102.4", "4915.2"}, {"3000", ""}, {"-5", "1e9"}
+    };
+    for (const std::string op: {"MAX", "MIN", "AVG", "SUM"}) {
+        for (const auto &[start, end]: bounds) {
+            for (const auto &[column, scanned]: {std::pair{RPM, scannedRpm}, std::pair{SPEED, scannedSpeed}}) {
+                const double expect = number(ranged(op, scanned, start, end));
+                const double actual = number(ranged(op, column, start, end));
+                if (std::isnan(expect)) {
+                    EXPECT_TRUE(std::isnan(actual)) << op << " " << start << " " << end;
+                } else {
+                    EXPECT_NEAR(actual, expect, 1e-9 * std::max(1.0, std::abs(expect))) << op << " " << start;
+                }
+            }
+        }
+    }
+
+    // Bounds are seconds since the first row, the end is exclusive: rows 123 to 149.
+    const std::vector<double> &speed = std::get<std::vector<double> >(frame.getColumn(0));
+    EXPECT_EQ(number(ranged("MAX", SPEED, "12.3", "15")), *std::max_element(speed.begin() + 123, speed.begin() + 150));
+    EXPECT_EQ(number(ranged("SUM", RPM, "", "")), number(R"({"type":"operation","operation":"SUM","value":)" +
+                                                         RPM + "}"));
+    EXPECT_THROW(number(ranged("MAX", SPEED, "20", "10")), std::runtime_error);
+    EXPECT_THROW(number(ranged("MAX", SPEED, "1e9", "")), std::runtime_error);
+
+    // COUNT of the rows in range, and pipelined aggregates of the same rows.
+    const std::string fast = R"({"type":"operation","operation":"GT","left":)" + SPEED +
+                             R"(,"right":{"type":"value","value":40}})";
+    const std::string count = R"({"type":"operation","operation":"COUNT","value":)" + fast +
+                              R"(,"initialValue":{"type":"value","value":0},"unit":{"type":"value","value":1})" +
+                              R"(,"start":{"type":"value","value":100},"end":{"type":"value","value":200}})";
+    const auto counted = static_cast<std::size_t>(number(count));
+    std::size_t expect = 0;
+    for (std::size_t i = 1000; i < 2000; ++i) {
+        expect += speed[i] > 40;
+    }
+    EXPECT_EQ(counted, expect);
+    for (const auto &task: {count, ranged("AVG", RPM, "12.3", "4000"), ranged("MIN", SPEED, "", "100")}) {
+        const auto plan = compileTask(task);
+        const double pipelined = std::get<ComputeLib::NumericType>(executor.runPipelined(plan, 1000));
+        EXPECT_NEAR(pipelined, std::get<ComputeLib::NumericType>(executor.run(plan)), 1e-9 * std::abs(pipelined))
+            << task;
+    }
+}
+
+TEST(RangeIndexTest, sumsDoNotCancelAgainstRowsOutsideTheRange) {
+    // A huge first row, which differences of prefix sums would cancel the ones after it against.
+    std::vector<double> level(5000, 1);
+    level[0] = 1e17;
+    DataFrame frame(0, static_cast<int64_t>(level.size()) * INTERVAL, INTERVAL);
+    frame.addColumn("level", level);
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    const std::string select = selectColumn("level");
+    for (const auto &[op, expect]: {std::pair<std::string, double>{"SUM", 2999}, {"AVG", 1}}) {
+        const auto plan = compileTask(ranged(op, select, "0.1", "300"));
+        EXPECT_EQ(std::get<ComputeLib::NumericType>(executor.run(plan)), expect) << op;
+        EXPECT_EQ(std::get<ComputeLib::NumericType>(executor.runPipelined(plan, 1000)), expect) << op;
+    }
+}
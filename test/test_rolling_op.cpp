@@ -0,0 +1,156 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 2 * ComputeLib::MORSEL_SIZE + 777;
+
+static std::string rolling(const std::string &op, const std::string &value, const std::string &duration) {
+    return R"({"type":"operation","operation":")" + op + R"(","value":)" + value +
+           R"(,"duration":{"type":"value","value":)" + duration + "}}";
+}
+
+static const std::string HIGH_GEAR = compare("GE", GEAR, "3");
+
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<double> speed(ROWS);
+    std::vector<uint8_t> gear(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        speed[i] = std::sin(static_cast<double>(i) * 0.003) * 90.0 + static_cast<double>(i * 37 % 11) * 1e3;
+        gear[i] = static_cast<uint8_t>(i / 9 % 5);
+    }
+    frame.addColumn("speed", speed);
+    frame.addColumn("gear", gear);
+    return frame;
+}
+
+static ComputeLib::NumericVectorType runNumeric(ComputeLib::Executor &executor, const std::string &task) {
+    return std::get<ComputeLib::NumericVectorType>(executor.run(compileTask(task)));
+}
+
+TEST(RollingOpTest, matchesWindowsScannedRowByRow) {
+    const DataFrame frame = makeFrame();
+    const auto &speed = std::get<std::vector<double> >(frame.getColumn(0));
+    const auto &gear = std::get<std::vector<uint8_t> >(frame.getColumn(1));
+    ComputeLib::Executor single(1);
+    single.setDataSource(&frame);
+    ComputeLib::Executor parallel(3);
+    parallel.setDataSource(&frame);
+
+    // Durations of 1, 3, 10, 300 and, longer than a morsel, 30000 rows.
+    for (const auto &[duration, rows]: std::vector<std::pair<std::string, std::size_t> >{
+             {"0", 1}, {"0.35", 3}, {"1", 10}, {"30", 300}, {"3000", 30000}}) {
+        for (const std::string op: {"ROLLING_MAX", "ROLLING_MIN", "ROLLING_AVG", "ROLLING_SUM", "ROLLING_COUNT"}) {
+            const std::string task = rolling(op, op == "ROLLING_COUNT" ? HIGH_GEAR : SPEED, duration);
+            const auto result = runNumeric(parallel, task);
+            ASSERT_EQ(result.size(), ROWS);
+            // The same bits whatever the thread count.
+            EXPECT_TRUE(result == runNumeric(single, task)) << task;
+
+            for (std::size_t i = 0; i < ROWS; i += rows > 100 ? 97 : 1) {
+                const std::size_t first = i + 1 >= rows ? i + 1 - rows : 0;
+                double expect = 0;
+                if (op == "ROLLING_MAX") {
+                    expect = *std::max_element(speed.begin() + first, speed.begin() + i + 1);
+                } else if (op == "ROLLING_MIN") {
+                    expect = *std::min_element(speed.begin() + first, speed.begin() + i + 1);
+                } else if (op == "ROLLING_COUNT") {
+                    expect = static_cast<double>(std::count_if(gear.begin() + first, gear.begin() + i + 1,
+                                                               [](const uint8_t g) { return g >= 3; }));
+                } else {
+                    for (std::size_t j = first; j <= i; ++j) {
+                        expect += speed[j];
+                    }
+                    if (op == "ROLLING_AVG") {
+                        expect /= static_cast<double>(i + 1 - first);
+                    }
+                }
+                ASSERT_NEAR(result[i], expect, 1e-9 * std::max(1.0, std::abs(expect))) << task << " row " << i;
+            }
+        }
+    }
+}
+
+TEST(RollingOpTest, windowsWithNaNAreNaN) {
+    DataFrame frame(0, 8 * INTERVAL, INTERVAL);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    frame.addColumn("speed", std::vector<double>{1, 4, nan, 2, 3, 8, 5, 6});
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    for (const std::string op: {"ROLLING_MAX", "ROLLING_MIN", "ROLLING_AVG", "ROLLING_SUM"}) {
+        const auto result = runNumeric(executor, rolling(op, SPEED, "0.3"));
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            EXPECT_EQ(std::isnan(result[i]), i >= 2 && i <= 4) << op << " row " << i;
+        }
+    }
+    EXPECT_EQ(runNumeric(executor, rolling("ROLLING_MAX", SPEED, "0.3"))[7], 8);
+    EXPECT_EQ(runNumeric(executor, rolling("ROLLING_AVG", SPEED, "0.3"))[1], 2.5);
+
+    EXPECT_THROW(executor.run(compileTask(rolling("ROLLING_COUNT", SPEED, "1"))), std::runtime_error);
+    EXPECT_THROW(executor.run(compileTask(rolling("ROLLING_SUM", SPEED, "-1"))), std::runtime_error);
+}
+
+TEST(RollingOpTest, largeAndInfiniteRowsLeaveTheSum) {
+    const double inf = std::numeric_limits<double>::infinity();
+    for (const double first: {inf, -inf, 1e17}) {
+        DataFrame frame(0, 20 * INTERVAL, INTERVAL);
+        std::vector<double> speed(20, 1);
+        speed[0] = first;
+        frame.addColumn("speed", speed);
+        ComputeLib::Executor executor(2);
+        executor.setDataSource(&frame);
+        for (const std::string op: {"ROLLING_SUM", "ROLLING_AVG"}) {
+            const auto plan = compileTask(rolling(op, SPEED, "1"));
+            const auto result = std::get<ComputeLib::NumericVectorType>(executor.run(plan));
+            EXPECT_EQ(std::get<ComputeLib::NumericVectorType>(executor.runPipelined(plan, 7)), result) << op;
+            // Rows 1 to 9 are lost next to the first row while it is in the window.
+            EXPECT_EQ(result[9], op == "ROLLING_SUM" ? first : first / 10) << op << " " << first;
+            for (std::size_t i = 10; i < result.size(); ++i) {
+                EXPECT_EQ(result[i], op == "ROLLING_SUM" ? 10 : 1) << op << " " << first << " row " << i;
+            }
+        }
+    }
+
+    // Three row windows: inf and -inf together are NaN.
+    DataFrame frame(0, 7 * INTERVAL, INTERVAL);
+    frame.addColumn("speed", std::vector<double>{1, inf, 2, -inf, 3, 4, 5});
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    const auto result = runNumeric(executor, rolling("ROLLING_SUM", SPEED, "0.3"));
+    EXPECT_EQ(result[2], inf);
+    EXPECT_TRUE(std::isnan(result[3]));
+    EXPECT_EQ(result[5], -inf);
+    EXPECT_EQ(result[6], 12);
+}
+
+TEST(RollingOpTest, pipelinedMatchesWholeColumn) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    const std::string smooth = R"({"type":"operation","operation":"GT","left":)" +
+                               rolling("ROLLING_AVG", SPEED, "2") + R"(,"right":{"type":"value","value":5000}})";
+    for (const auto &task: {rolling("ROLLING_SUM", SPEED, "30"), rolling("ROLLING_MIN", SPEED, "3000"),
+                            rolling("ROLLING_COUNT", HIGH_GEAR, "1"), smooth}) {
+        const auto plan = compileTask(task);
+        const auto expect = executor.run(plan);
+        for (const std::size_t batch: {1000UL, 4096UL}) {
+            const auto pipelined = executor.runPipelined(plan, batch);
+            if (const auto *bits = std::get_if<ComputeLib::BoolVectorType>(&expect); bits != nullptr) {
+                EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(pipelined) == *bits) << task << " batch " << batch;
+            } else {
+                EXPECT_EQ(std::get<ComputeLib::NumericVectorType>(pipelined),
+                          std::get<ComputeLib::NumericVectorType>(expect)) << task << " batch " << batch;
+            }
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Long runs of a few states, with some single rows in between.
+static void makeColumns(std::vector<uint8_t> &gear, std::vector<uint32_t> &mode) {
+    uint64_t seed = 3;
+    const auto next = [&seed] {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+    while (gear.size() < 2 * ComputeLib::MORSEL_SIZE + 777) {
+        const std::size_t length = next() % 5 == 0 ? 1 : 1 + next() % 3000;
+        gear.insert(gear.end(), length, static_cast<uint8_t>(next() % 4));
+    }
+    while (mode.size() < gear.size()) {
+        const std::size_t length = next() % 7 == 0 ? 1 : 1 + next() % 600;
+        mode.insert(mode.end(), length, static_cast<uint32_t>(next() % 3 * 10));
+    }
+    mode.resize(gear.size());
+}
+
+TEST(RunLengthTest, encodesAndDecodes) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const DataColumn column = std::vector<double>{1, 1, 0.0, -0.0, -0.0, nan, nan, 2};
+    const RunLengthColumn runs = RunLengthColumn::encode(column);
+    EXPECT_EQ(runs.ends, (std::vector<std::size_t>{2, 3, 5, 6, 7, 8}));
+    const auto decoded = std::get<std::vector<double>>(runs.decode());
+    const auto &original = std::get<std::vector<double>>(column);
+    ASSERT_EQ(decoded.size(), original.size());
+    for (std::size_t i = 0; i < decoded.size(); ++i) {
+        EXPECT_EQ(std::bit_cast<uint64_t>(decoded[i]), std::bit_cast<uint64_t>(original[i])) << i;
+    }
+
+    DataFrame frame(0, 8 * INTERVAL, INTERVAL);
+    frame.addRunLengthColumn("x", runs);
+    EXPECT_NE(frame.getRunLengthColumn(0), nullptr);
+    EXPECT_EQ(std::get<std::vector<double>>(frame.getColumn("x")).size(), 8);
+    EXPECT_THROW(frame.addRunLengthColumn("y", RunLengthColumn::encode(std::vector<double>{1})), std::runtime_error);
+}
+
+TEST(RunLengthTest, runReadersAreMarkedInThePlan) {
+    const auto jump = compileTask(R"({"type":"operation","operation":"JUMP","value":{"type":"operation",
+        "operation":"SELECT","value":"gear"},"from":{"type":"value","value":[1]},"to":{"type":"value","value":[2]}})");
+    EXPECT_TRUE(jump.readsRuns(jump.node(jump.root()).inputs[0]));
+
+    // The EQ is fused with the AND, which reads the column block by block.
+    const auto fused = compileTask(R"({"type":"operation","operation":"AND","operands":[{"type":"operation",
+        "operation":"EQ","left":{"type":"operation","operation":"SELECT","value":"gear"},"right":{"type":"value",
+        "value":1}},{"type":"operation","operation":"GT","left":{"type":"operation","operation":"SELECT",
+        "value":"speed"},"right":{"type":"value","value":1}}]})");
+    for (uint32_t i = 0; i < fused.nodes().size(); ++i) {
+        EXPECT_FALSE(fused.readsRuns(i));
+    }
+}
+
+TEST(RunLengthTest, matchesExpandedColumns) {
+    std::vector<uint8_t> gear;
+    std::vector<uint32_t> mode;
+    makeColumns(gear, mode);
+    const auto rows = static_cast<int64_t>(gear.size());
+    DataFrame plain(0, rows * INTERVAL, INTERVAL);
+    plain.addColumn("gear", gear);
+    plain.addColumn("mode", mode);
+    DataFrame encoded(0, rows * INTERVAL, INTERVAL);
+    encoded.addRunLengthColumn("gear", RunLengthColumn::encode(gear));
+    encoded.addRunLengthColumn("mode", RunLengthColumn::encode(mode));
+
+    const std::string gearColumn = R"({"type":"operation","operation":"SELECT","value":"gear"})";
+    const std::string modeColumn = R"({"type":"operation","operation":"SELECT","value":"mode"})";
+    const auto hold = [&](const std::string &from, const std::string &to, const std::string &duration) {
+        return R"({"type":"operation","operation":"HOLD","value":)" + gearColumn + R"(,"from":{"type":"value",
+            "value":)" + from + R"(},"to":{"type":"value","value":)" + to + R"(},"duration":{"type":"value",
+            "value":)" + duration + "}}";
+    };
+    const auto jump = [&](const std::string &from, const std::string &to) {
+        return R"({"type":"operation","operation":"JUMP","value":)" + gearColumn + R"(,"from":{"type":"value",
+            "value":)" + from + R"(},"to":{"type":"value","value":)" + to + "}}";
+    };
+    const auto after = [&](const std::string &from, const std::string &to, const std::string &duration) {
+        return R"({"type":"operation","operation":"AFTER","value":)" + modeColumn + R"(,"from":{"type":"value",
+            "value":)" + from + R"(},"to":{"type":"value","value":)" + to + R"(},"duration":{"type":"value",
+            "value":)" + duration + "}}";
+    };
+    const std::vector<std::string> tasks = {
+        R"({"type":"operation","operation":"EQ","left":)" + gearColumn + R"(,"right":{"type":"value","value":2}})",
+        R"({"type":"operation","operation":"NE","left":)" + modeColumn + R"(,"right":{"type":"value","value":10}})",
+        R"({"type":"operation","operation":"GE","left":)" + gearColumn + R"(,"right":{"type":"value","value":2}})",
+        jump("[1]", "[2, 3]"), jump("[]", "[0]"), jump("[0, 1]", "[]"), jump("[1, 2]", "[1, 2]"),
+        hold("[1]", "[2]", "1.5"), hold("[]", "[0, 3]", "20"), hold("[2]", "[]", "0.1"), hold("[1]", "[1, 2]", "0"),
+        hold("[1]", "[2]", "-1.5"), hold("[]", "[3]", "-200"),
+        after("5", "15", "0.3"), after("25", "5", "2"), after("0", "20", "500"),
+        R"({"type":"operation","operation":"DURATION","minDuration":{"type":"value","value":10},"value":{"type":
+            "operation","operation":"EQ","left":)" + gearColumn + R"(,"right":{"type":"value","value":3}}})",
+        R"({"type":"operation","operation":"AND","operands":[)" + jump("[1]", "[2]") + R"(,{"type":"operation",
+            "operation":"LT","left":)" + gearColumn + R"(,"right":{"type":"value","value":3}}]})",
+    };
+
+    for (const auto &task: tasks) {
+        const auto plan = compileTask(task);
+        ComputeLib::Executor reference(1);
+        reference.setDataSource(&plain);
+        const auto expect = std::get<ComputeLib::BoolVectorType>(reference.run(plan));
+        for (const uint32_t threads: {1U, 3U}) {
+            ComputeLib::Executor executor(threads);
+            executor.setDataSource(&encoded);
+            EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(executor.run(plan)) == expect) << task;
+        }
+    }
+}
+
+TEST(RunLengthTest, reportsOperandErrors) {
+    DataFrame frame(0, 4 * INTERVAL, INTERVAL);
+    frame.addRunLengthColumn("gear", RunLengthColumn::encode(std::vector<uint8_t>{1, 1, 2, 2}));
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    // JUMP needs numeric[] bounds, as on an expanded column.
+    EXPECT_THROW(executor.run(compileTask(R"({"type":"operation","operation":"JUMP","value":{"type":"operation",
+        "operation":"SELECT","value":"gear"},"from":{"type":"value","value":1},"to":{"type":"value","value":[2]}})")),
+                 std::runtime_error);
+}
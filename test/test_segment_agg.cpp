@@ -0,0 +1,143 @@
+#include "executor.h"
+#include "streaming.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "state_machine.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 3 * ComputeLib::MORSEL_SIZE + 999;
+static constexpr std::size_t FIELDS = ComputeLib::SegmentTable::FIELDS;
+
+static std::string segments(const std::string &value, const std::string &target) {
+    return R"({"type":"operation","operation":"SEGMENT_AGG","value":)" + value + R"(,"target":)" + target + "}";
+}
+
+// Gear 4 from row 16000 to 17000 spans the first morsel boundary, and the last rows are in gear 4 too.
+static DataFrame makeFrame(const std::size_t rows = ROWS) {
+    DataFrame frame(0, static_cast<int64_t>(rows) * INTERVAL, INTERVAL);
+    std::vector<double> speed(rows);
+    std::vector<int32_t> rpm(rows);
+    std::vector<uint8_t> gear(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        speed[i] = std::sin(static_cast<double>(i) * 0.01) * 60.0 + static_cast<double>(i % 17) * 0.5;
+        rpm[i] = static_cast<int32_t>(i * 7919 % 6000) - 200;
+        const bool wide = (i >= 16000 && i < 17000) || i + 30 >= rows;
+        gear[i] = static_cast<uint8_t>(wide ? 4 : i % 211 < 3 ? 4 : i / 50 % 4);
+    }
+    frame.addColumn("speed", speed);
+    frame.addColumn("rpm", rpm);
+    frame.addColumn("gear", gear);
+    return frame;
+}
+
+TEST(SegmentAggTest, matchesRunsScannedRowByRow) {
+    const DataFrame frame = makeFrame();
+    const auto &speed = std::get<std::vector<double> >(frame.getColumn(0));
+    const auto &gear = std::get<std::vector<uint8_t> >(frame.getColumn(2));
+    ComputeLib::Executor single(1);
+    single.setDataSource(&frame);
+    ComputeLib::Executor parallel(3);
+    parallel.setDataSource(&frame);
+
+    for (const std::string constant: {"4", "3", "0"}) {
+        const auto minGear = static_cast<uint8_t>(std::stoi(constant));
+        const auto plan = compileTask(segments(compare("GE", GEAR, constant), SPEED));
+        const auto table = std::get<ComputeLib::NumericVectorType>(parallel.run(plan));
+        // The same bits whatever the thread count.
+        EXPECT_EQ(table, std::get<ComputeLib::NumericVectorType>(single.run(plan))) << constant;
+
+        std::vector<std::pair<std::size_t, std::size_t> > runs;
+        for (std::size_t i = 0; i < ROWS; ++i) {
+            if (gear[i] >= minGear && (i == 0 || gear[i - 1] < minGear)) {
+                runs.emplace_back(i, i);
+            }
+            if (gear[i] >= minGear) {
+                runs.back().second = i + 1;
+            }
+        }
+        ASSERT_EQ(table.size(), runs.size() * FIELDS) << constant;
+        for (std::size_t r = 0; r < runs.size(); ++r) {
+            const auto [first, last] = runs[r];
+            const auto rows = std::span(speed).subspan(first, last - first);
+            double sum = 0;
+            for (const double x: rows) {
+                sum += x;
+            }
+            const double *row = &table[r * FIELDS];
+            EXPECT_DOUBLE_EQ(row[0], static_cast<double>(first) * 0.1) << r;
+            EXPECT_DOUBLE_EQ(row[1], static_cast<double>(last) * 0.1) << r;
+            EXPECT_NEAR(row[2], static_cast<double>(last - first) * 0.1, 1e-9) << r;
+            EXPECT_EQ(row[3], *std::ranges::max_element(rows)) << r;
+            EXPECT_EQ(row[4], *std::ranges::min_element(rows)) << r;
+            EXPECT_NEAR(row[5], sum / static_cast<double>(rows.size()), 1e-9) << r;
+        }
+    }
+
+    // A run's start and end select its rows again as the range of an aggregate.
+    const auto table = std::get<ComputeLib::NumericVectorType>(
+        parallel.run(compileTask(segments(compare("EQ", GEAR, "4"), RPM))));
+    for (std::size_t r = 0; r < table.size(); r += 7 * FIELDS) {
+        const std::string ranged = R"({"type":"operation","operation":"MAX","value":)" + RPM +
+                                   R"(,"start":{"type":"value","value":)" + std::to_string(table[r]) +
+                                   R"(},"end":{"type":"value","value":)" + std::to_string(table[r + 1]) + "}}";
+        EXPECT_EQ(std::get<ComputeLib::NumericType>(parallel.run(compileTask(ranged))), table[r + 3]) << r;
+    }
+
+    EXPECT_TRUE(std::get<ComputeLib::NumericVectorType>(
+        parallel.run(compileTask(segments(compare("GT", GEAR, "9"), SPEED)))).empty());
+    EXPECT_THROW(parallel.run(compileTask(segments(SPEED, SPEED))), std::runtime_error);
+    EXPECT_THROW(parallel.run(compileTask(segments(compare("GT", GEAR, "1"), compare("GT", GEAR, "2")))),
+                 std::runtime_error);
+}
+
+TEST(SegmentAggTest, pipelinedAndStreamedMatchWholeColumn) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    const std::string events = R"({"type":"operation","operation":"DURATION","value":)" +
+                               compare("GE", GEAR, "3") + R"(,"minDuration":{"type":"value","value":3}})";
+    for (const auto &task: {segments(compare("EQ", GEAR, "4"), SPEED), segments(events, RPM)}) {
+        const auto plan = compileTask(task);
+        const auto expect = std::get<ComputeLib::NumericVectorType>(executor.run(plan));
+        ASSERT_FALSE(expect.empty());
+        for (const std::size_t batch: {1000UL, 4096UL, 70000UL}) {
+            EXPECT_EQ(std::get<ComputeLib::NumericVectorType>(executor.runPipelined(plan, batch)), expect)
+                << task << " batch " << batch;
+        }
+
+        // Each update has the runs that ended so far; the last one only ends with the stream.
+        DataFrame growing(0, 0, INTERVAL);
+        growing.addColumn("speed", std::vector<double>{});
+        growing.addColumn("rpm", std::vector<int32_t>{});
+        growing.addColumn("gear", std::vector<uint8_t>{});
+        ComputeLib::Executor streaming(2);
+        streaming.setDataSource(&growing);
+        ComputeLib::StreamingQuery query(streaming, plan);
+        std::size_t seen = 0;
+        for (std::size_t begin = 0; begin < ROWS; begin += 5000) {
+            const std::size_t end = std::min(ROWS, begin + 5000);
+            std::vector<DataColumn> rows;
+            for (const std::string name: {"speed", "rpm", "gear"}) {
+                rows.emplace_back(std::visit([&](const auto &vec) -> DataColumn {
+                    return std::decay_t<decltype(vec)>(vec.begin() + static_cast<std::ptrdiff_t>(begin),
+                                                       vec.begin() + static_cast<std::ptrdiff_t>(end));
+                }, frame.getColumn(name)));
+            }
+            growing.appendRows(rows);
+            const auto table = std::get<ComputeLib::NumericVectorType>(query.update());
+            ASSERT_GE(table.size(), seen);
+            ASSERT_LT(table.size(), expect.size());
+            EXPECT_TRUE(std::equal(table.begin(), table.end(), expect.begin())) << task << " rows " << end;
+            seen = table.size();
+        }
+        EXPECT_EQ(std::get<ComputeLib::NumericVectorType>(query.finish()), expect) << task;
+    }
+}
@@ -0,0 +1,79 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "test_util.h"
+#include "rapidjson/document.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+static ComputeLib::GenericValue runTask(const std::string &task, const DataFrame &frame) {
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    return executor.run(doc);
+}
+
+TEST(SelectOpTest, selectIsZeroCopy) {
+    DataFrame frame(0, 4 * INTERVAL, INTERVAL);
+    frame.addColumn("gear", std::vector<uint8_t>{1, 2, 3, 4});
+
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    const ComputeLib::GenericValue result = executor.selectOp(frame.getColumnIndex("gear"));
+    EXPECT_TRUE(executor.holdsNumericView(result));
+    const auto &view = std::get<std::span<const uint8_t>>(std::get<ComputeLib::NumericViewType>(result));
+    EXPECT_EQ(view.data(), std::get<std::vector<uint8_t>>(frame.getColumn("gear")).data());
+    EXPECT_EQ(view.size(), 4);
+}
+
+TEST(SelectOpTest, selectRootIsMaterialized) {
+    DataFrame frame(0, 3 * INTERVAL, INTERVAL);
+    frame.addColumn("temp", std::vector<int32_t>{-3, 0, 7});
+
+    const auto result = runTask(R"({"type":"operation","operation":"SELECT","value":"temp"})", frame);
+    EXPECT_TRUE(ComputeLib::Executor::holdsNumericVector(result));
+    const auto &vec = std::get<ComputeLib::NumericVectorType>(result);
+    EXPECT_EQ(vec, ComputeLib::NumericVectorType({-3, 0, 7}));
+}
+
+TEST(SelectOpTest, nativeColumnsMatchDoubleValues) {
+    const std::vector<uint8_t> raw = {0, 1, 1, 2, 2, 2, 1, 3, 3, 0, 2, 2, 2, 2};
+    DataFrame frame(0, static_cast<int64_t>(raw.size()) * INTERVAL, INTERVAL);
+    frame.addColumn("u8", raw);
+    frame.addColumn("i32", std::vector<int32_t>(raw.begin(), raw.end()));
+    frame.addColumn("u32", std::vector<uint32_t>(raw.begin(), raw.end()));
+    frame.addColumn("f64", std::vector<double>(raw.begin(), raw.end()));
+
+    const std::vector<std::string> tasks = {
+        R"({"type":"operation","operation":"HOLD","value":{"type":"operation","operation":"SELECT","value":"COL"},
+            "from":{"type":"value","value":[1]},"to":{"type":"value","value":[2]},"duration":{"type":"value","value":0.2}})",
+        R"({"type":"operation","operation":"HOLD","value":{"type":"operation","operation":"SELECT","value":"COL"},
+            "from":{"type":"value","value":[]},"to":{"type":"value","value":[2]},"duration":{"type":"value","value":-0.2}})",
+        R"({"type":"operation","operation":"JUMP","value":{"type":"operation","operation":"SELECT","value":"COL"},
+            "from":{"type":"value","value":[1]},"to":{"type":"value","value":[2,3]}})",
+        R"({"type":"operation","operation":"AFTER","value":{"type":"operation","operation":"SELECT","value":"COL"},
+            "from":{"type":"value","value":1},"to":{"type":"value","value":2},"duration":{"type":"value","value":0.1}})",
+        R"({"type":"operation","operation":"GE","left":{"type":"operation","operation":"SELECT","value":"COL"},
+            "right":{"type":"value","value":1.5}})",
+        R"({"type":"operation","operation":"SUB","left":{"type":"operation","operation":"SELECT","value":"COL"},
+            "right":{"type":"operation","operation":"SELECT","value":"u8"}})",
+        R"({"type":"operation","operation":"AVG","value":{"type":"operation","operation":"SELECT","value":"COL"}})",
+        R"({"type":"operation","operation":"MAX","value":{"type":"operation","operation":"SELECT","value":"COL"}})",
+    };
+
+    for (const std::string &task: tasks) {
+        const std::size_t pos = task.find("COL");
+        std::string expectTask = task;
+        expectTask.replace(pos, 3, "f64");
+        const auto expect = runTask(expectTask, frame);
+        for (const char *column: {"u8", "i32", "u32"}) {
+            std::string nativeTask = task;
+            nativeTask.replace(pos, 3, column);
+            EXPECT_TRUE(isSameValue(runTask(nativeTask, frame), expect)) << nativeTask;
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "profile.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = ComputeLib::MORSEL_SIZE + 1234;
+
+static std::string hold(const std::string &from, const std::string &to) {
+    return R"({"type":"operation","operation":"HOLD","value":)" + GEAR + R"(,"from":{"type":"value","value":)" +
+           from + R"(},"to":{"type":"value","value":)" + to + R"(},"duration":{"type":"value","value":1.5}})";
+}
+
+// Speed is above 60 in a few stretches only, so most blocks are decided by a speed test alone.
+static DataFrame makeFrame() {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    std::vector<uint8_t> gear(ROWS);
+    std::vector<double> speed(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        gear[i] = static_cast<uint8_t>(i / 13 % 4);
+        speed[i] = std::sin(static_cast<double>(i) * 0.0007) * 80.0;
+    }
+    frame.addColumn("gear", gear);
+    frame.addColumn("speed", speed);
+    return frame;
+}
+
+static ComputeLib::BoolVectorType runBool(ComputeLib::Executor &executor, const std::string &task) {
+    return std::get<ComputeLib::BoolVectorType>(executor.run(compileTask(task)));
+}
+
+TEST(ShortCircuitTest, defersLaterOperands) {
+    const auto plan = compileTask(logical("AND", {compare("GT", SPEED, 60), hold("[1]", "[2]")}));
+    const uint32_t root = plan.root();
+    EXPECT_TRUE(plan.deferredFor(root, 0).empty());
+    ASSERT_FALSE(plan.deferredFor(root, 1).empty());
+    for (const uint32_t node: plan.deferredFor(root, 1)) {
+        EXPECT_TRUE(plan.isDeferred(node));
+    }
+    EXPECT_EQ(plan.node(plan.deferredFor(root, 1).back()).op, ComputeLib::OperatorEnum::HOLD);
+
+    // The SELECT is also read by the first operand, so it is evaluated up front.
+    const auto shared = compileTask(logical("AND", {compare("GT", GEAR, 1), hold("[1]", "[2]")}));
+    for (const uint32_t node: shared.deferredFor(shared.root(), 1)) {
+        EXPECT_NE(shared.node(node).op, ComputeLib::OperatorEnum::SELECT);
+    }
+}
+
+TEST(ShortCircuitTest, matchesOperandsCombinedRowByRow) {
+    const DataFrame frame = makeFrame();
+    const std::string fast = compare("GT", SPEED, 60);
+    const std::string slow = compare("LT", SPEED, -60);
+    const std::string shifting = hold("[1]", "[2, 3]");
+    const std::vector<std::vector<std::string>> operandLists = {
+        {fast, shifting},
+        {slow, compare("EQ", GEAR, 2), shifting},
+        {shifting, fast},
+        {fast, logical("OR", {slow, shifting}), compare("NE", GEAR, 3)},
+        {compare("GT", SPEED, 100), hold("[0]", "[1]")},
+        {hold("[0]", "[1]"), shifting, hold("[3]", "[0]")},
+    };
+
+    ComputeLib::Executor reference(1);
+    reference.setDataSource(&frame);
+    for (const auto &operands: operandLists) {
+        std::vector<ComputeLib::BoolVectorType> values;
+        for (const auto &operand: operands) {
+            values.emplace_back(runBool(reference, operand));
+        }
+        for (const std::string op: {"AND", "OR"}) {
+            ComputeLib::BoolVectorType expect(ROWS, op == "AND");
+            for (std::size_t i = 0; i < ROWS; ++i) {
+                for (const auto &value: values) {
+                    expect.set(i, op == "AND" ? expect[i] && value[i] : expect[i] || value[i]);
+                }
+            }
+            const std::string task = logical(op, operands);
+            for (const uint32_t threads: {1U, 3U}) {
+                ComputeLib::Executor executor(threads);
+                executor.setDataSource(&frame);
+                EXPECT_TRUE(runBool(executor, task) == expect) << task;
+            }
+        }
+    }
+}
+
+TEST(ShortCircuitTest, skipsOperandsOfDecidedRows) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    const auto countHolds = [&](const std::string &task) {
+        ComputeLib::QueryProfile profile(compileTask(task));
+        executor.runProfiled(profile);
+        std::size_t executions = 0;
+        for (uint32_t i = 0; i < profile.plan().nodes().size(); ++i) {
+            if (profile.plan().node(i).op == ComputeLib::OperatorEnum::HOLD) {
+                executions += profile.node(i).executions;
+            }
+        }
+        return executions;
+    };
+
+    // Speed never exceeds 100, and is always below 100.
+    EXPECT_EQ(countHolds(logical("AND", {compare("GT", SPEED, 100), hold("[1]", "[2]")})), 0);
+    EXPECT_EQ(countHolds(logical("OR", {compare("LT", SPEED, 100), hold("[1]", "[2]")})), 0);
+    EXPECT_EQ(countHolds(logical("AND", {compare("GT", SPEED, 60), hold("[1]", "[2]")})), 1);
+    EXPECT_TRUE(runBool(executor, logical("AND", {compare("GT", SPEED, 100), hold("[1]", "[2]")})) ==
+        ComputeLib::BoolVectorType(ROWS, false));
+}
+
+TEST(ShortCircuitTest, reportsErrorsOfEvaluatedOperands) {
+    const DataFrame frame = makeFrame();
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    // A numeric[] operand is rejected once the first operand leaves rows undecided.
+    EXPECT_THROW(executor.run(compileTask(logical("AND", {compare("GT", SPEED, 60), SPEED}))), std::runtime_error);
+    EXPECT_THROW(executor.run(compileTask(logical("OR", {compare("GT", SPEED, 60),
+        R"({"type":"operation","operation":"AVG","value":)" + SPEED + "}"}))), std::runtime_error);
+}
@@ -0,0 +1,188 @@
+#include "executor.h"
+#include "streaming.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static const std::vector<std::string> COLUMNS = {"state", "level", "rpm"};
+
+// Runs of random states, some longer than a morsel, as in the pipeline tests.
+static DataFrame makeFrame() {
+    std::vector<double> state;
+    std::vector<double> level;
+    std::vector<int32_t> rpm;
+    uint64_t seed = 11;
+    const auto next = [&seed] {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+    while (state.size() < 2 * ComputeLib::MORSEL_SIZE) {
+        const auto value = static_cast<double>(next() % 4);
+        const std::size_t length = next() % 10 == 0 ? ComputeLib::MORSEL_SIZE / 3 + next() % 5000 : 1 + next() % 40;
+        state.insert(state.end(), length, value);
+        level.insert(level.end(), length, value * 3.0 + static_cast<double>(next() % 3));
+    }
+    for (std::size_t i = 0; i < state.size(); ++i) {
+        rpm.emplace_back(static_cast<int32_t>(next() % 7000) - 500);
+    }
+    const auto rows = static_cast<int64_t>(state.size());
+    DataFrame frame(0, rows * INTERVAL, INTERVAL);
+    frame.addColumn("state", state);
+    frame.addColumn("level", level);
+    frame.addColumn("rpm", rpm);
+    return frame;
+}
+
+// An empty frame with the columns of source, to append its rows to.
+static DataFrame emptyFrame(const DataFrame &source) {
+    DataFrame frame(0, 0, INTERVAL);
+    for (const auto &name: COLUMNS) {
+        frame.addColumn(name, std::visit([](const auto &vec) -> DataColumn {
+            return std::decay_t<decltype(vec)>{};
+        }, source.getColumn(name)));
+    }
+    return frame;
+}
+
+static void appendSlice(DataFrame &frame, const DataFrame &source, const std::size_t begin, const std::size_t end) {
+    std::vector<DataColumn> rows;
+    for (const auto &name: COLUMNS) {
+        rows.emplace_back(std::visit([&](const auto &vec) -> DataColumn {
+            return std::decay_t<decltype(vec)>(vec.begin() + static_cast<std::ptrdiff_t>(begin),
+                                               vec.begin() + static_cast<std::ptrdiff_t>(end));
+        }, source.getColumn(name)));
+    }
+    frame.appendRows(rows);
+}
+
+static void appendResult(ComputeLib::GenericValue &total, const ComputeLib::GenericValue &rows) {
+    if (ComputeLib::Executor::holdsBoolVector(rows)) {
+        std::get<ComputeLib::BoolVectorType>(total).append(std::get<ComputeLib::BoolVectorType>(rows));
+    } else {
+        auto &vec = std::get<ComputeLib::NumericVectorType>(total);
+        const auto &tail = std::get<ComputeLib::NumericVectorType>(rows);
+        vec.insert(vec.end(), tail.begin(), tail.end());
+    }
+}
+
+TEST(StreamingTest, matchesWholeColumnExecution) {
+    const DataFrame source = makeFrame();
+    const std::string state = selectColumn("state");
+    const std::string level = selectColumn("level");
+    const std::string over2 = R"({"type":"operation","operation":"GE","left":)" + state +
+                              R"(,"right":{"type":"value","value":2}})";
+    const std::vector<std::string> tasks = {
+        R"({"type":"operation","operation":"DIV","left":)" + RPM + R"(,"right":{"type":"value","value":7}})",
+        level,
+        R"({"type":"operation","operation":"HOLD","value":)" + state + R"(,"from":{"type":"value","value":[1]},
+            "to":{"type":"value","value":[2,3]},"duration":{"type":"value","value":1.5}})",
+        R"({"type":"operation","operation":"HOLD","value":)" + state + R"(,"from":{"type":"value","value":[1]},
+            "to":{"type":"value","value":[2]},"duration":{"type":"value","value":-1}})",
+        R"({"type":"operation","operation":"AFTER","value":)" + level + R"(,"from":{"type":"value","value":2},
+            "to":{"type":"value","value":6},"duration":{"type":"value","value":0.5}})",
+        R"({"type":"operation","operation":"JUMP","value":)" + state + R"(,"from":{"type":"value","value":[0,1]},
+            "to":{"type":"value","value":[2,3]}})",
+        R"({"type":"operation","operation":"AND","operands":[{"type":"operation","operation":"DURATION",
+            "minDuration":{"type":"value","value":600},"value":)" + over2 + R"(},{"type":"operation","operation":"LT",
+            "left":)" + RPM + R"(,"right":{"type":"value","value":5000}}]})",
+        R"({"type":"operation","operation":"AVG","value":)" + RPM + "}",
+        R"({"type":"operation","operation":"MIN","value":)" + level + "}",
+        R"({"type":"operation","operation":"COUNT","value":)" + over2 + R"(,"initialValue":{"type":"value","value":3},
+            "unit":{"type":"value","value":0.5}})",
+        R"({"type":"operation","operation":"LT","left":{"type":"operation","operation":"MAX","value":)" + level +
+        R"(},"right":{"type":"operation","operation":"AVG","value":)" + RPM + "}}",
+    };
+    const std::vector<std::size_t> batches = {1, 9, 700, ComputeLib::MORSEL_SIZE + 3, 64};
+
+    for (const auto &task: tasks) {
+        const auto plan = compileTask(task);
+        ComputeLib::Executor reference(1);
+        reference.setDataSource(&source);
+        const auto expect = reference.run(plan);
+
+        DataFrame frame = emptyFrame(source);
+        ComputeLib::Executor executor(2);
+        executor.setDataSource(&frame);
+        ComputeLib::StreamingQuery query(executor, plan);
+        const bool rowValued = ComputeLib::Executor::holdsBoolVector(expect) ||
+                               ComputeLib::Executor::holdsNumericVector(expect);
+        ComputeLib::GenericValue total = ComputeLib::Executor::holdsBoolVector(expect)
+                                             ? ComputeLib::GenericValue(ComputeLib::BoolVectorType{})
+                                             : ComputeLib::GenericValue(ComputeLib::NumericVectorType{});
+        ComputeLib::GenericValue last;
+        for (std::size_t begin = 0, k = 0; begin < source.getRowCount(); ++k) {
+            const std::size_t end = std::min(source.getRowCount(), begin + batches[k % batches.size()]);
+            appendSlice(frame, source, begin, end);
+            begin = end;
+            last = query.update();
+            if (rowValued) {
+                appendResult(total, last);
+                EXPECT_LE(query.settledRows(), end) << task;
+            }
+        }
+        const auto tail = query.finish();
+        if (rowValued) {
+            appendResult(total, tail);
+            EXPECT_EQ(query.settledRows(), source.getRowCount()) << task;
+            EXPECT_TRUE(isSameValue(total, expect)) << task;
+        } else {
+            EXPECT_TRUE(isSameValue(last, expect)) << task;
+            EXPECT_TRUE(isSameValue(tail, expect)) << task;
+        }
+    }
+}
+
+TEST(StreamingTest, updatesCoverOnlySettledRows) {
+    DataFrame frame(0, 0, INTERVAL);
+    frame.addColumn("b", std::vector<double>{});
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    const auto select = selectColumn("b");
+    const auto eq = std::string(R"({"type":"operation","operation":"EQ","left":)") + select +
+                    R"(,"right":{"type":"value","value":1}})";
+    const auto duration = compileTask(R"({"type":"operation","operation":"DURATION","minDuration":{"type":"value",
+        "value":0.4},"value":)" + eq + "}");
+    const auto average = compileTask(std::string(R"({"type":"operation","operation":"AVG","value":)") + select +
+                                     "}");
+    const auto equal = compileTask(eq);
+    ComputeLib::StreamingQuery durationQuery(executor, duration);
+    ComputeLib::StreamingQuery averageQuery(executor, average);
+    ComputeLib::StreamingQuery equalQuery(executor, equal);
+
+    // The open run of 1s is held back until it reaches 5 rows.
+    frame.appendRows({std::vector<double>{0, 1, 1}});
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(durationQuery.update()) == ComputeLib::BoolVectorType({0}));
+    EXPECT_EQ(std::get<ComputeLib::NumericType>(averageQuery.update()), 2.0 / 3);
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(equalQuery.update()) == ComputeLib::BoolVectorType({0, 1, 1}));
+    frame.appendRows({std::vector<double>{1, 1, 1, 1}});
+    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(durationQuery.update()) ==
+        ComputeLib::BoolVectorType({1, 1, 1, 1, 1, 1}));
+    EXPECT_EQ(std::get<ComputeLib::NumericType>(averageQuery.update()), 6.0 / 7);
+    EXPECT_EQ(equalQuery.settledRows(), 3);
+    frame.appendRows({std::vector<double>{1, 1}});
+    EXPECT_EQ(std::get<ComputeLib::BoolVectorType>(durationQuery.finish()).size(), 2);
+    EXPECT_EQ(durationQuery.settledRows(), 9);
+    EXPECT_THROW(durationQuery.update(), std::runtime_error);
+}
+
+TEST(StreamingTest, rejectsUnsupportedQueriesAndRows) {
+    DataFrame frame(0, 0, INTERVAL);
+    frame.addColumn("b", std::vector<double>{});
+    ComputeLib::Executor executor(1);
+    executor.setDataSource(&frame);
+    // Every appended row would change the earlier output of GT.
+    EXPECT_THROW(ComputeLib::StreamingQuery(executor, compileTask(R"({"type":"operation","operation":"GT",
+        "left":{"type":"operation","operation":"SELECT","value":"b"},"right":{"type":"operation",
+        "operation":"AVG","value":{"type":"operation","operation":"SELECT","value":"b"}}})")), std::runtime_error);
+
+    EXPECT_THROW(frame.appendRows({std::vector<int32_t>{1}}), std::runtime_error);
+    EXPECT_THROW(frame.appendRows({}), std::runtime_error);
+    frame.appendRows({std::vector<double>{1, 2}});
+    EXPECT_EQ(frame.getRowCount(), 2);
+}
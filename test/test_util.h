@@ -0,0 +1,91 @@
+#ifndef CPP_TEST_UTIL_H
+#define CPP_TEST_UTIL_H
+
+#include "executor.h"
+#include "plan.h"
+#include "rapidjson/document.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <variant>
+#include <vector>
+
+/*
+ * Helpers shared by the tests: frames sampled every INTERVAL, queries written as JSON text and compiled,
+ * and comparison of results. Each test file keeps its own data and the query shapes only it uses.
+ */
+
+// 100 ms between rows, 10 rows per second.
+inline constexpr int64_t INTERVAL = 100'000'000;
+
+inline ComputeLib::CompiledQuery compileTask(const std::string &task, const ComputeLib::CostModel *costs = nullptr) {
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    return ComputeLib::CompiledQuery::compile(doc, costs);
+}
+
+inline std::string selectColumn(const std::string &name) {
+    return R"({"type":"operation","operation":"SELECT","value":")" + name + R"("})";
+}
+
+inline const std::string SPEED = selectColumn("speed");
+inline const std::string RPM = selectColumn("rpm");
+inline const std::string GEAR = selectColumn("gear");
+
+// A constant written as JSON, e.g. "2.5" or "[1,2]".
+inline std::string value(const std::string &json) {
+    return R"({"type":"value","value":)" + json + "}";
+}
+
+inline std::string value(const double number) {
+    return value(std::to_string(number));
+}
+
+inline std::string binary(const std::string &op, const std::string &left, const std::string &right) {
+    return R"({"type":"operation","operation":")" + op + R"(","left":)" + left + R"(,"right":)" + right + "}";
+}
+
+// op, e.g. GT, of left and a constant.
+inline std::string compare(const std::string &op, const std::string &left, const std::string &constant) {
+    return binary(op, left, value(constant));
+}
+
+inline std::string compare(const std::string &op, const std::string &left, const double constant) {
+    return binary(op, left, value(constant));
+}
+
+inline std::string logical(const std::string &op, const std::vector<std::string> &operands) {
+    std::string task = R"({"type":"operation","operation":")" + op + R"(","operands":[)";
+    for (std::size_t i = 0; i < operands.size(); ++i) {
+        task += (i == 0 ? "" : ",") + operands[i];
+    }
+    return task + "]}";
+}
+
+// Same type and same bits, with NaN equal to NaN, as results of the same query must be whatever the mode.
+inline bool isSameValue(const ComputeLib::GenericValue &result, const ComputeLib::GenericValue &expect) {
+    if (result.index() != expect.index()) {
+        return false;
+    }
+    if (ComputeLib::Executor::holdsBoolVector(expect)) {
+        return std::get<ComputeLib::BoolVectorType>(result) == std::get<ComputeLib::BoolVectorType>(expect);
+    }
+    if (ComputeLib::Executor::holdsNumericVector(expect)) {
+        const auto &vec = std::get<ComputeLib::NumericVectorType>(result);
+        const auto &expectVec = std::get<ComputeLib::NumericVectorType>(expect);
+        return vec.size() == expectVec.size() &&
+               std::memcmp(vec.data(), expectVec.data(), vec.size() * sizeof(double)) == 0;
+    }
+    if (ComputeLib::Executor::holdsNumeric(expect)) {
+        const auto number = std::get<ComputeLib::NumericType>(result);
+        const auto expectNumber = std::get<ComputeLib::NumericType>(expect);
+        return number == expectNumber || (std::isnan(number) && std::isnan(expectNumber));
+    }
+    if (ComputeLib::Executor::holdsBool(expect)) {
+        return std::get<ComputeLib::BoolType>(result) == std::get<ComputeLib::BoolType>(expect);
+    }
+    return false;
+}
+
+#endif //CPP_TEST_UTIL_H
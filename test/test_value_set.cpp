@@ -0,0 +1,134 @@
+#include "executor.h"
+#include "data_frame.h"
+#include "value_set.h"
+#include "test_util.h"
+#include "rapidjson/document.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t ROWS = 5000;
+
+static ComputeLib::GenericValue runTask(ComputeLib::Executor &executor, const std::string &task) {
+    rapidjson::Document doc;
+    doc.Parse(task.c_str());
+    return executor.run(doc);
+}
+
+TEST(ValueSetTest, matchesNumericEquality) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const std::vector<double> members = {0.0, 3, 255, 256, 4000, 70000, -2, 1.5, nan};
+    const ComputeLib::ValueSet set(members);
+    EXPECT_FALSE(set.empty());
+    EXPECT_TRUE(ComputeLib::ValueSet().empty());
+    EXPECT_FALSE(ComputeLib::ValueSet().contains(uint8_t{0}));
+
+    EXPECT_TRUE(set.contains(uint8_t{0}));
+    EXPECT_TRUE(set.contains(uint8_t{255}));
+    EXPECT_FALSE(set.contains(uint8_t{4}));
+    EXPECT_TRUE(set.contains(uint32_t{4000}));
+    EXPECT_TRUE(set.contains(uint32_t{70000}));
+    EXPECT_FALSE(set.contains(uint32_t{70001}));
+    EXPECT_TRUE(set.contains(int32_t{-2}));
+    EXPECT_FALSE(set.contains(int32_t{-3}));
+    EXPECT_TRUE(set.contains(256));
+    EXPECT_TRUE(set.contains(-0.0));
+    EXPECT_TRUE(set.contains(1.5));
+    EXPECT_TRUE(set.contains(3.0));
+    EXPECT_FALSE(set.contains(3.5));
+    EXPECT_FALSE(set.contains(nan));
+    EXPECT_FALSE(set.contains(std::numeric_limits<double>::infinity()));
+}
+
+// JUMP and HOLD over every column type agree with a hash set lookup of the widened rows.
+TEST(ValueSetTest, operatorsMatchHashLookup) {
+    std::vector<uint8_t> gear(ROWS);
+    std::vector<int32_t> rpm(ROWS);
+    std::vector<uint32_t> mode(ROWS);
+    std::vector<double> level(ROWS);
+    uint64_t seed = 5;
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const auto state = static_cast<uint32_t>(seed >> 33) % 6;
+        gear[i] = static_cast<uint8_t>(state);
+        rpm[i] = static_cast<int32_t>(state) - 2;
+        mode[i] = state * 30000;
+        level[i] = state == 5 ? -0.0 : state * 0.5;
+    }
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    frame.addColumn("gear", gear);
+    frame.addColumn("rpm", rpm);
+    frame.addColumn("mode", mode);
+    frame.addColumn("level", level);
+
+    const std::vector<std::pair<std::string, std::string>> lists = {
+        {"[1, 2]", "[3]"}, {"[-1, 0.5, 60000]", "[-2, 0, 1.5, 120000]"}, {"[]", "[4, 2.0, 1e9]"}, {"[5]", "[]"},
+    };
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    for (const std::string column: {"gear", "rpm", "mode", "level"}) {
+        const auto rows = std::visit([](const auto &vec) {
+            return std::vector<double>(vec.begin(), vec.end());
+        }, frame.getColumn(column));
+        for (const auto &[from, to]: lists) {
+            rapidjson::Document fromDoc;
+            rapidjson::Document toDoc;
+            fromDoc.Parse(from.c_str());
+            toDoc.Parse(to.c_str());
+            std::unordered_set<double> fromValues;
+            std::unordered_set<double> toValues;
+            for (const auto &value: fromDoc.GetArray()) {
+                fromValues.insert(value.GetDouble());
+            }
+            for (const auto &value: toDoc.GetArray()) {
+                toValues.insert(value.GetDouble());
+            }
+            const auto isFrom = [&](const std::size_t i) { return fromValues.contains(rows[i]); };
+            const auto isTo = [&](const std::size_t i) { return toValues.contains(rows[i]); };
+
+            // The transitions of JUMP, and the runs of HOLD that reach five rows, as in HoldMachine::scan.
+            ComputeLib::BoolVectorType jumps(ROWS, 0);
+            ComputeLib::BoolVectorType holds(ROWS, 0);
+            bool running = false;
+            uint32_t held = 0;
+            for (std::size_t i = 1; i < ROWS; ++i) {
+                bool start;
+                bool keep;
+                if (toValues.empty()) {
+                    start = isFrom(i - 1) && !isFrom(i);
+                    keep = !isFrom(i);
+                } else if (fromValues.empty()) {
+                    start = isTo(i) && !isTo(i - 1);
+                    keep = isTo(i);
+                } else {
+                    start = isFrom(i - 1) && isTo(i);
+                    keep = isTo(i);
+                }
+                jumps.set(i, start);
+                if (!running) {
+                    running = start;
+                    held = start ? 1 : 0;
+                } else if (keep) {
+                    holds.set(i, ++held >= 5);
+                } else {
+                    running = false;
+                    held = 0;
+                }
+            }
+
+            const std::string select = selectColumn(column);
+            const std::string bounds = R"(,"from":{"type":"value","value":)" + from +
+                                       R"(},"to":{"type":"value","value":)" + to + "}";
+            const auto jump = runTask(executor, R"({"type":"operation","operation":"JUMP","value":)" + select + bounds +
+                                           "}");
+            EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(jump) == jumps) << column << " " << from << to;
+            const auto hold = runTask(executor, R"({"type":"operation","operation":"HOLD","value":)" + select + bounds +
+                                           R"(,"duration":{"type":"value","value":0.5}})");
+            EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(hold) == holds) << column << " " << from << to;
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#include "column_file.h"
+#include "executor.h"
+#include "data_frame.h"
+#include "plan.h"
+#include "test_util.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <vector>
+
+static constexpr std::size_t BLOCK = ZoneMap::BLOCK_ROWS;
+static constexpr std::size_t ROWS = 3 * BLOCK + 1234;
+
+static void expectSameZones(const ZoneMap &zones, const ZoneMap &expect) {
+    ASSERT_EQ(zones.blockCount(), expect.blockCount());
+    for (std::size_t b = 0; b < expect.blockCount(); ++b) {
+        EXPECT_EQ(zones.min[b], expect.min[b]) << b;
+        EXPECT_EQ(zones.max[b], expect.max[b]) << b;
+        EXPECT_EQ(zones.distinct[b], expect.distinct[b]) << b;
+        EXPECT_EQ(zones.hasNaN[b], expect.hasNaN[b]) << b;
+    }
+}
+
+// Block 0 climbs from 0 to 100, block 1 is constant 7 but for one NaN, block 2 is NaN only and the last,
+// partial block cycles through 1000..1009.
+static std::vector<double> makeLevel() {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<double> level(ROWS);
+    for (std::size_t i = 0; i < ROWS; ++i) {
+        const std::size_t row = i % BLOCK;
+        switch (i / BLOCK) {
+            case 0:
+                level[i] = static_cast<double>(row * 100 / (BLOCK - 1));
+                break;
+            case 1:
+                level[i] = row == 500 ? nan : 7;
+                break;
+            case 2:
+                level[i] = nan;
+                break;
+            default:
+                level[i] = 1000 + static_cast<double>(row % 10);
+        }
+    }
+    return level;
+}
+
+TEST(ZoneMapTest, summarizesBlocks) {
+    const std::vector<double> level = makeLevel();
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    frame.addColumn("level", level);
+    const ZoneMap *zones = frame.getZoneMap(0);
+    ASSERT_NE(zones, nullptr);
+    ASSERT_EQ(zones->blockCount(), 4);
+    EXPECT_EQ(zones->min[0], 0);
+    EXPECT_EQ(zones->max[0], 100);
+    EXPECT_EQ(zones->distinct[0], 101);
+    EXPECT_EQ(zones->hasNaN[0], 0);
+    EXPECT_EQ(zones->min[1], 7);
+    EXPECT_EQ(zones->max[1], 7);
+    EXPECT_EQ(zones->distinct[1], 1);
+    EXPECT_EQ(zones->hasNaN[1], 1);
+    EXPECT_GT(zones->min[2], zones->max[2]);
+    EXPECT_EQ(zones->distinct[2], 0);
+    EXPECT_EQ(zones->min[3], 1000);
+    EXPECT_EQ(zones->max[3], 1009);
+    EXPECT_EQ(zones->distinct[3], 10);
+
+    // The same statistics from runs, and from rows appended a few at a time.
+    DataFrame runs(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    runs.addRunLengthColumn("level", RunLengthColumn::encode(level));
+    expectSameZones(*runs.getZoneMap(0), *zones);
+    DataFrame appended(0, 0, INTERVAL);
+    appended.addColumn("level", std::vector<double>{});
+    for (std::size_t begin = 0, k = 0; begin < ROWS; ++k) {
+        const std::size_t end = std::min(ROWS, begin + (k % 3 == 0 ? 1 : 20000 + k));
+        appended.appendRows({std::vector<double>(level.begin() + static_cast<std::ptrdiff_t>(begin),
+                                                 level.begin() + static_cast<std::ptrdiff_t>(end))});
+        begin = end;
+    }
+    expectSameZones(*appended.getZoneMap(0), *zones);
+
+    // Distinct values are only counted up to MAX_DISTINCT.
+    std::vector<int32_t> many(BLOCK);
+    for (std::size_t i = 0; i < BLOCK; ++i) {
+        many[i] = static_cast<int32_t>(i) - 5;
+    }
+    DataFrame wide(0, static_cast<int64_t>(BLOCK) * INTERVAL, INTERVAL);
+    wide.addColumn("many", many);
+    EXPECT_EQ(wide.getZoneMap(0)->distinct[0], ZoneMap::MAX_DISTINCT);
+    EXPECT_EQ(wide.getZoneMap(0)->min[0], -5);
+    EXPECT_THROW(wide.setZoneMap(0, ZoneMap{}), std::runtime_error);
+}
+
+TEST(ZoneMapTest, comparesMatchScannedRows) {
+    const std::vector<double> level = makeLevel();
+    auto storage = std::make_shared<std::vector<double>>(level);
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    frame.addColumn("level", level);
+    frame.addColumn("other", level);
+    // Views come without zone maps, so every block is scanned.
+    DataFrame scanned(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    scanned.addColumnView("level", std::span<const double>(*storage), storage);
+    scanned.addColumnView("other", std::span<const double>(*storage), storage);
+    ASSERT_EQ(scanned.getZoneMap(0), nullptr);
+
+    const std::string select = selectColumn("level");
+    const std::string other = selectColumn("other");
+    for (const std::string op: {"EQ", "NE", "LT", "LE", "GT", "GE"}) {
+        for (const std::string constant: {"-1", "0", "7", "50", "100", "1000", "1005", "2000"}) {
+            const std::string compare = R"({"type":"operation","operation":")" + op + R"(","left":)" + select +
+                                        R"(,"right":{"type":"value","value":)" + constant + "}}";
+            // Alone, and fused with a compare that has to be scanned.
+            const std::string fused = R"({"type":"operation","operation":"OR","operands":[)" + compare +
+                                      R"(,{"type":"operation","operation":"GT","left":)" + other + R"(,"right":)" +
+                                      other + "}]}";
+            for (const auto &task: {compare, fused}) {
+                const auto plan = compileTask(task);
+                for (const uint32_t threads: {1U, 3U}) {
+                    ComputeLib::Executor executor(threads);
+                    executor.setDataSource(&scanned);
+                    const auto expect = std::get<ComputeLib::BoolVectorType>(executor.run(plan));
+                    executor.setDataSource(&frame);
+                    EXPECT_TRUE(std::get<ComputeLib::BoolVectorType>(executor.run(plan)) == expect) << task;
+                }
+            }
+        }
+    }
+}
+
+TEST(ZoneMapTest, decidedBlocksAreNotRead) {
+    // Zone maps that claim every row of block 1 exceeds 10, which the rows do not.
+    auto storage = std::make_shared<std::vector<uint32_t>>(2 * BLOCK, 5);
+    DataFrame frame(0, static_cast<int64_t>(2 * BLOCK) * INTERVAL, INTERVAL);
+    frame.addColumnView("rpm", std::span<const uint32_t>(*storage), storage);
+    ZoneMap zones;
+    zones.update(std::span<const uint32_t>(*storage));
+    zones.min[1] = 20;
+    zones.max[1] = 30;
+    frame.setZoneMap(0, zones);
+
+    ComputeLib::Executor executor(2);
+    executor.setDataSource(&frame);
+    const std::string over10 = R"({"type":"operation","operation":"GT","left":)" + RPM +
+                               R"(,"right":{"type":"value","value":10}})";
+    const std::string fused = R"({"type":"operation","operation":"AND","operands":[)" + over10 +
+                              R"(,{"type":"operation","operation":"LE","left":)" + RPM +
+                              R"(,"right":{"type":"value","value":40}}]})";
+    for (const auto &task: {over10, fused}) {
+        const auto result = std::get<ComputeLib::BoolVectorType>(executor.run(compileTask(task)));
+        EXPECT_EQ(result.count(), BLOCK) << task;
+        EXPECT_EQ(result[BLOCK - 1], 0) << task;
+        EXPECT_EQ(result[BLOCK], 1) << task;
+    }
+}
+
+TEST(ZoneMapTest, storedInColumnFiles) {
+    DataFrame frame(0, static_cast<int64_t>(ROWS) * INTERVAL, INTERVAL);
+    frame.addColumn("level", makeLevel());
+    const std::string path = (std::filesystem::temp_directory_path() / "compute_engine_zone_map.col").string();
+    writeColumnFile(frame, path);
+    const DataFrame mapped = openColumnFile(path);
+    ASSERT_NE(mapped.getZoneMap(0), nullptr);
+    expectSameZones(*mapped.getZoneMap(0), *frame.getZoneMap(0));
+    std::filesystem::remove(path);
+}